@@ -0,0 +1,259 @@
+/**
+ * @file fuzz_loader.c
+ * @brief Fuzzing harness for the JSON question loader
+ *
+ * Built two ways:
+ * - With TRIVIA_LIBFUZZER (clang -fsanitize=fuzzer) it only provides
+ *   LLVMFuzzerTestOneInput() and libFuzzer supplies main().
+ * - Otherwise it adds a replay driver usable by AFL (input on stdin or
+ *   as a file argument) and by CTest. The driver runs each input through
+ *   the harness and, with --scaling, also replicates the input to two
+ *   sizes and fails when parse time grows super-linearly with size.
+ *
+ * The harness checks memory safety (run it under ASan/UBSan) and the
+ * invariants every loaded question must satisfy.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "questions.h"
+#include "utils.h"
+#include "utf8.h"
+
+/** Inputs are replicated up to at least this size before timing. */
+#define SCALING_BASE_BYTES (256 * 1024)
+
+/** Size multiplier between the two timed runs. */
+#define SCALING_FACTOR 8
+
+/** Allowed time ratio for SCALING_FACTOR more input (linear is 8). */
+#define SCALING_MAX_RATIO 24.0
+
+/** Runs below this are too short to judge and always pass. */
+#define SCALING_MIN_SECONDS 0.002
+
+static bool string_terminated(const char *s, size_t cap) {
+    return memchr(s, '\0', cap) != NULL;
+}
+
+/**
+ * @brief Check the invariants of every question in a loaded bank
+ */
+static void check_bank(const QuestionBank *bank) {
+    for (size_t i = 0; i < bank->count; i++) {
+        const Question *q = &bank->questions[i];
+        if (!string_terminated(q->question, sizeof(q->question)) ||
+            !utf8_validate(q->question, strlen(q->question)) ||
+            q->question_width != utf8_display_width(q->question)) {
+            abort();
+        }
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            if (!string_terminated(q->options[o], sizeof(q->options[o])) ||
+                !utf8_validate(q->options[o], strlen(q->options[o])) ||
+                q->option_widths[o] != utf8_display_width(q->options[o])) {
+                abort();
+            }
+        }
+        int options = question_option_count(q);
+        if (q->correct_answer < 0 || q->correct_answer >= options) {
+            abort();
+        }
+        if ((int)q->difficulty < 0 || q->difficulty >= DIFFICULTY_COUNT) {
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return 0;
+    }
+
+    int loaded = question_bank_load_from_buffer(&bank, (const char*)data, size);
+    if (loaded >= 0) {
+        check_bank(&bank);
+        question_bank_dedup(&bank);
+        question_bank_validate(&bank);
+        question_bank_build_index(&bank);
+        check_bank(&bank);
+        if (bank.count > 0 && question_bank_get_random(&bank, -1) == NULL) {
+            abort();
+        }
+    }
+
+    question_bank_free(&bank);
+    return 0;
+}
+
+#ifndef TRIVIA_LIBFUZZER
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Build a buffer of @p input repeated until at least @p min_bytes
+ */
+static char* replicate(const char *input, size_t len, size_t min_bytes, size_t *out_len) {
+    size_t copies = len > 0 ? (min_bytes + len - 1) / len : 0;
+    if (copies == 0) {
+        copies = 1;
+    }
+    char *buf = (char*)malloc(copies * len + 1);
+    if (buf == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < copies; i++) {
+        memcpy(buf + i * len, input, len);
+    }
+    *out_len = copies * len;
+    return buf;
+}
+
+static double time_parse(const char *data, size_t len) {
+    double best = 1e9;
+    for (int r = 0; r < 3; r++) {
+        double t0 = now_sec();
+        LLVMFuzzerTestOneInput((const uint8_t*)data, len);
+        double elapsed = now_sec() - t0;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Fail when parse time grows super-linearly with input size
+ *
+ * @return int 0 if scaling is acceptable, -1 otherwise
+ */
+static int check_scaling(const char *name, const char *input, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+
+    size_t small_len = 0;
+    size_t large_len = 0;
+    char *small = replicate(input, len, SCALING_BASE_BYTES, &small_len);
+    char *large = replicate(input, len, small_len * SCALING_FACTOR, &large_len);
+    if (small == NULL || large == NULL) {
+        free(small);
+        free(large);
+        return 0;
+    }
+
+    double t_small = time_parse(small, small_len);
+    double t_large = time_parse(large, large_len);
+    free(small);
+    free(large);
+
+    double size_ratio = (double)large_len / (double)small_len;
+    double ratio = t_small > 0.0 ? t_large / t_small : 0.0;
+    double allowed = SCALING_MAX_RATIO * size_ratio / SCALING_FACTOR;
+    if (t_large >= SCALING_MIN_SECONDS && ratio > allowed) {
+        printf("  SLOW  %s: %zu -> %zu bytes took %.2f ms -> %.2f ms (x%.1f, allowed x%.1f)\n",
+               name, small_len, large_len, t_small * 1e3, t_large * 1e3, ratio, allowed);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_input(const char *name, const char *data, size_t len, bool scaling) {
+    LLVMFuzzerTestOneInput((const uint8_t*)data, len);
+    if (scaling && check_scaling(name, data, len) != 0) {
+        return -1;
+    }
+    printf("  ok    %s (%zu bytes)\n", name, len);
+    return 0;
+}
+
+static int run_file(const char *path, bool scaling) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        print_error("Failed to open %s", path);
+        return -1;
+    }
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(f, &data, &len);
+    fclose(f);
+    if (err != UTILS_SUCCESS) {
+        print_error("Failed to read %s", path);
+        return -1;
+    }
+    int rc = run_input(path, data, len, scaling);
+    free(data);
+    return rc;
+}
+
+static int run_path(const char *path, bool scaling) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        print_error("No such file or directory: %s", path);
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return run_file(path, scaling) != 0 ? 1 : 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        print_error("Failed to open directory %s", path);
+        return 1;
+    }
+    int failures = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        failures += run_path(child, scaling);
+    }
+    closedir(dir);
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    bool scaling = false;
+    int failures = 0;
+    int paths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--scaling] [FILE|DIR]...\n", argv[0]);
+            printf("Reads stdin when no path is given (AFL mode).\n");
+            return EXIT_SUCCESS;
+        } else {
+            failures += run_path(argv[i], scaling);
+            paths++;
+        }
+    }
+
+    if (paths == 0) {
+        char *data = NULL;
+        size_t len = 0;
+        if (read_stream(stdin, &data, &len) != UTILS_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        failures += run_input("<stdin>", data, len, scaling) != 0;
+        free(data);
+    }
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* TRIVIA_LIBFUZZER */
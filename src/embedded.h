@@ -0,0 +1,24 @@
+/**
+ * @file embedded.h
+ * @brief Question bank compiled into the executable
+ *
+ * The definitions are generated at build time by trivia-embedgen when the
+ * game is configured with -DEMBED_QUESTIONS=ON, which also defines
+ * TRIVIA_EMBEDDED_BANK. The arrays are a checked pack's record table and
+ * string pool, placed in read-only data. They are not played in place:
+ * the game copies every record into an ordinary QuestionBank at startup
+ * with pack_load_records(), which saves reading and parsing a file but
+ * not the per-question copy.
+ */
+
+#ifndef EMBEDDED_H
+#define EMBEDDED_H
+
+#include <stddef.h>
+#include "pack.h"
+
+extern const PackRecord embedded_records[];   /**< Record table */
+extern const size_t embedded_record_count;    /**< Number of records */
+extern const unsigned char embedded_pool[];   /**< String pool */
+
+#endif /* EMBEDDED_H */
@@ -0,0 +1,174 @@
+/**
+ * @file events.c
+ * @brief Implementation of the lock-free event queues
+ */
+
+#include "events.h"
+#include "utils.h"
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+int event_queue_init(EventQueue *queue, size_t capacity) {
+    if (queue == NULL || capacity == 0 || capacity > ((size_t)1 << 30)) {
+        return -1;
+    }
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    queue->cells = (EventCell*)aligned_alloc(64, ((size * sizeof(EventCell) + 63) / 64) * 64);
+    if (queue->cells == NULL) {
+        print_error("Failed to allocate an event queue of %zu events", size);
+        return -1;
+    }
+    queue->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (queue->wake_fd < 0) {
+        print_error("Failed to create an eventfd: %s", strerror(errno));
+        free(queue->cells);
+        queue->cells = NULL;
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].seq, (uint64_t)i);
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->tail, 0);
+    queue->head = 0;
+    atomic_init(&queue->sleeping, 0);
+    return 0;
+}
+
+/**
+ * @brief Wake the consumer if it announced that it is going to sleep
+ */
+static void wake_consumer(EventQueue *queue) {
+    /* Pairs with the fence in event_queue_wait(): either this load sees
+     * the consumer's flag, or the consumer's re-check sees our event. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->sleeping, memory_order_relaxed) &&
+        atomic_exchange(&queue->sleeping, 0)) {
+        uint64_t one = 1;
+        ssize_t rc = write(queue->wake_fd, &one, sizeof(one));
+        (void)rc;                       /* EAGAIN: a wakeup is already pending */
+    }
+}
+
+bool event_queue_push(EventQueue *queue, const GameEvent *event) {
+    uint64_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    EventCell *cell;
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;               /* The consumer has not freed this cell yet */
+        } else {
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+    cell->event = *event;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    wake_consumer(queue);
+    return true;
+}
+
+size_t event_queue_pop(EventQueue *queue, GameEvent *out, size_t max) {
+    size_t n = 0;
+    uint64_t head = queue->head;
+    while (n < max) {
+        EventCell *cell = &queue->cells[head & queue->mask];
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) != head + 1) {
+            break;
+        }
+        out[n++] = cell->event;
+        atomic_store_explicit(&cell->seq, head + queue->mask + 1, memory_order_release);
+        head++;
+    }
+    queue->head = head;
+    return n;
+}
+
+size_t event_queue_wait(EventQueue *queue, GameEvent *out, size_t max, int timeout_ms) {
+    size_t n = event_queue_pop(queue, out, max);
+    if (n > 0 || max == 0) {
+        return n;
+    }
+
+    atomic_store(&queue->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    n = event_queue_pop(queue, out, max);
+    if (n > 0) {
+        atomic_store(&queue->sleeping, 0);
+        return n;
+    }
+
+    struct pollfd pfd = { queue->wake_fd, POLLIN, 0 };
+    while (poll(&pfd, 1, timeout_ms) < 0 && errno == EINTR) {
+    }
+    atomic_store(&queue->sleeping, 0);
+    uint64_t count;
+    ssize_t rc = read(queue->wake_fd, &count, sizeof(count));
+    (void)rc;
+    return event_queue_pop(queue, out, max);
+}
+
+void event_queue_destroy(EventQueue *queue) {
+    if (queue == NULL || queue->cells == NULL) {
+        return;
+    }
+    close(queue->wake_fd);
+    free(queue->cells);
+    queue->cells = NULL;
+    queue->wake_fd = -1;
+}
+
+int event_router_init(EventRouter *router, int workers, size_t capacity) {
+    if (router == NULL || workers <= 0) {
+        return -1;
+    }
+    router->queues = (EventQueue*)calloc((size_t)workers, sizeof(EventQueue));
+    if (router->queues == NULL) {
+        return -1;
+    }
+    for (int w = 0; w < workers; w++) {
+        if (event_queue_init(&router->queues[w], capacity) != 0) {
+            for (int i = 0; i < w; i++) {
+                event_queue_destroy(&router->queues[i]);
+            }
+            free(router->queues);
+            router->queues = NULL;
+            return -1;
+        }
+    }
+    router->workers = workers;
+    return 0;
+}
+
+int event_router_owner(const EventRouter *router, uint32_t session) {
+    return (int)(session % (uint32_t)router->workers);
+}
+
+bool event_router_send(EventRouter *router, const GameEvent *event) {
+    return event_queue_push(&router->queues[event_router_owner(router, event->session)], event);
+}
+
+void event_router_destroy(EventRouter *router) {
+    if (router == NULL || router->queues == NULL) {
+        return;
+    }
+    for (int w = 0; w < router->workers; w++) {
+        event_queue_destroy(&router->queues[w]);
+    }
+    free(router->queues);
+    router->queues = NULL;
+    router->workers = 0;
+}
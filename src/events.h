@@ -0,0 +1,158 @@
+/**
+ * @file events.h
+ * @brief Lock-free event queues from producer threads to workers
+ *
+ * A standalone module: trivia-bench measures it and nothing else uses it
+ * yet. The game server runs every room on its own event loop and does not
+ * route through an EventRouter.
+ *
+ * Each worker owns a bounded multi-producer/single-consumer ring. Any
+ * thread may push; only the owning worker pops, in batches. Producers
+ * claim a cell with one compare-and-swap on the tail, and each cell
+ * carries a sequence number that publishes it to the consumer, so
+ * neither side takes a lock.
+ *
+ * A worker with nothing to do sleeps on an eventfd. Producers only write
+ * to it when the worker has announced that it is about to sleep, so a
+ * busy worker costs producers no system calls.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @brief Kinds of events routed to a session's worker
+ */
+typedef enum {
+    EVENT_CONNECT = 0,                    /**< A client joined the session */
+    EVENT_ANSWER,                         /**< A player answered (value: option slot) */
+    EVENT_DISCONNECT,                     /**< A client left the session */
+    EVENT_STOP                            /**< The worker should exit */
+} EventType;
+
+/**
+ * @brief One event (16 bytes)
+ */
+typedef struct {
+    uint32_t session;                     /**< Session ID; selects the owning worker */
+    uint16_t type;                        /**< EventType */
+    uint16_t player;                      /**< Player within the session */
+    int32_t value;                        /**< Type-specific value */
+    uint32_t source;                      /**< Producer-defined tag (connection, thread) */
+} GameEvent;
+
+/**
+ * @brief One ring cell
+ */
+typedef struct {
+    _Atomic uint64_t seq;                 /**< Position + 1 when full, position when free */
+    GameEvent event;                      /**< Payload */
+} EventCell;
+
+/**
+ * @brief Bounded MPSC event queue
+ */
+typedef struct {
+    EventCell *cells;                     /**< Ring of capacity cells */
+    uint64_t mask;                        /**< capacity - 1 */
+    _Alignas(64) _Atomic uint64_t tail;   /**< Next position producers claim */
+    _Alignas(64) uint64_t head;           /**< Next position the consumer reads */
+    _Atomic int sleeping;                 /**< Consumer is (about to be) blocked */
+    int wake_fd;                          /**< eventfd the consumer sleeps on */
+} EventQueue;
+
+/**
+ * @brief Per-worker queues with events routed by session
+ */
+typedef struct {
+    EventQueue *queues;                   /**< One queue per worker */
+    int workers;                          /**< Number of workers */
+} EventRouter;
+
+/**
+ * @brief Initialize a queue
+ *
+ * @param queue Pointer to EventQueue
+ * @param capacity Minimum number of events held (rounded up to a power of two)
+ * @return int 0 on success, -1 on error
+ */
+int event_queue_init(EventQueue *queue, size_t capacity);
+
+/**
+ * @brief Push an event; safe from any number of threads
+ *
+ * @param queue Pointer to EventQueue
+ * @param event Event to copy in
+ * @return bool true if queued, false if the queue is full
+ */
+bool event_queue_push(EventQueue *queue, const GameEvent *event);
+
+/**
+ * @brief Pop up to @p max events without blocking (consumer only)
+ *
+ * @param queue Pointer to EventQueue
+ * @param out Receives the events in queue order
+ * @param max Capacity of out
+ * @return size_t Number of events popped
+ */
+size_t event_queue_pop(EventQueue *queue, GameEvent *out, size_t max);
+
+/**
+ * @brief Pop up to @p max events, sleeping until one arrives (consumer only)
+ *
+ * @param queue Pointer to EventQueue
+ * @param out Receives the events in queue order
+ * @param max Capacity of out
+ * @param timeout_ms Longest sleep, -1 to wait indefinitely
+ * @return size_t Number of events popped (0 on timeout)
+ */
+size_t event_queue_wait(EventQueue *queue, GameEvent *out, size_t max, int timeout_ms);
+
+/**
+ * @brief Free a queue
+ *
+ * @param queue Pointer to EventQueue
+ */
+void event_queue_destroy(EventQueue *queue);
+
+/**
+ * @brief Create one queue per worker
+ *
+ * @param router Pointer to EventRouter
+ * @param workers Number of workers
+ * @param capacity Capacity of each queue
+ * @return int 0 on success, -1 on error
+ */
+int event_router_init(EventRouter *router, int workers, size_t capacity);
+
+/**
+ * @brief Worker that owns a session
+ *
+ * @param router Pointer to EventRouter
+ * @param session Session ID
+ * @return int Worker index
+ */
+int event_router_owner(const EventRouter *router, uint32_t session);
+
+/**
+ * @brief Push an event to the queue of its session's worker
+ *
+ * @param router Pointer to EventRouter
+ * @param event Event to route
+ * @return bool true if queued, false if that worker's queue is full
+ */
+bool event_router_send(EventRouter *router, const GameEvent *event);
+
+/**
+ * @brief Free all queues
+ *
+ * @param router Pointer to EventRouter
+ */
+void event_router_destroy(EventRouter *router);
+
+#endif /* EVENTS_H */
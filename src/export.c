@@ -0,0 +1,503 @@
+/**
+ * @file export.c
+ * @brief Implementation of the bank export writers
+ */
+
+#include "export.h"
+#include "pack.h"
+#include "utils.h"
+#include <errno.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Upper bound of one formatted question
+ *
+ * Every text byte may become a six-byte \\u escape; the rest is field
+ * names and punctuation. Each question reserves this much once and is
+ * then formatted without further bounds checks.
+ */
+#define EXPORT_QUESTION_MAX ((MAX_QUESTION_LEN + MAX_OPTIONS * MAX_ANSWER_LEN) * 6 + 512)
+
+static const char *const DIFFICULTY_NAMES[DIFFICULTY_COUNT] = { "easy", "medium", "hard" };
+static const char *const CATEGORY_NAMES[CATEGORY_COUNT] = {
+    "general", "science", "history", "sports", "entertainment"
+};
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y);
+}
+
+int export_writer_init(ExportWriter *writer, size_t capacity) {
+    if (writer == NULL) {
+        return -1;
+    }
+    memset(writer, 0, sizeof(ExportWriter));
+    if (capacity == 0) {
+        capacity = EXPORT_BUFFER_SIZE;
+    }
+    if (capacity < 2 * EXPORT_QUESTION_MAX) {
+        capacity = 2 * EXPORT_QUESTION_MAX;
+    }
+    writer->data = (char*)malloc(capacity);
+    if (writer->data == NULL) {
+        print_error("Failed to allocate export buffer");
+        return -1;
+    }
+    writer->cap = capacity;
+    writer->fd = -1;
+    return 0;
+}
+
+void export_writer_free(ExportWriter *writer) {
+    if (writer == NULL) {
+        return;
+    }
+    free(writer->data);
+    writer->data = NULL;
+    writer->len = 0;
+    writer->cap = 0;
+}
+
+void export_filter_init(ExportFilter *filter) {
+    if (filter == NULL) {
+        return;
+    }
+    filter->difficulty = -1;
+    filter->category = -1;
+    filter->ids = NULL;
+    filter->id_count = 0;
+}
+
+bool export_filter_match(const ExportFilter *filter, const Question *question) {
+    if (filter == NULL) {
+        return true;
+    }
+    if (filter->difficulty >= 0 && (int)question->difficulty != filter->difficulty) {
+        return false;
+    }
+    if (filter->category >= 0 && (int)question->category != filter->category) {
+        return false;
+    }
+    if (filter->ids != NULL &&
+        bsearch(&question->id, filter->ids, filter->id_count, sizeof(uint32_t),
+                compare_u32) == NULL) {
+        return false;
+    }
+    return true;
+}
+
+int export_format_from_name(const char *name) {
+    if (name == NULL) {
+        return -1;
+    }
+    if (strcmp(name, "json") == 0) {
+        return EXPORT_JSON;
+    }
+    if (strcmp(name, "jsonl") == 0) {
+        return EXPORT_JSONL;
+    }
+    if (strcmp(name, "pack") == 0) {
+        return EXPORT_PACK;
+    }
+    return -1;
+}
+
+static void flush_output(ExportWriter *w) {
+    size_t done = 0;
+    while (done < w->len && !w->failed) {
+        ssize_t n = write(w->fd, w->data + done, w->len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            w->failed = true;
+            break;
+        }
+        done += (size_t)n;
+    }
+    w->written += done;
+    w->len = 0;
+}
+
+/**
+ * @brief Make room for @p n more bytes, writing the buffer out if needed
+ */
+static void reserve(ExportWriter *w, size_t n) {
+    if (w->cap - w->len < n) {
+        flush_output(w);
+    }
+}
+
+static void put(ExportWriter *w, const void *data, size_t n) {
+    memcpy(w->data + w->len, data, n);
+    w->len += n;
+}
+
+#define PUT_LITERAL(w, s) put((w), (s), sizeof(s) - 1)
+
+static void put_str(ExportWriter *w, const char *s) {
+    put(w, s, strlen(s));
+}
+
+static void put_u32(ExportWriter *w, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    put(w, digits + sizeof(digits) - n, (size_t)n);
+}
+
+static void put_i32(ExportWriter *w, int value) {
+    if (value < 0) {
+        w->data[w->len++] = '-';
+        put_u32(w, 0u - (uint32_t)value);
+    } else {
+        put_u32(w, (uint32_t)value);
+    }
+}
+
+static bool is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/**
+ * @brief Length of the valid JSON escape at @p s, 0 if it is not one
+ */
+static size_t escape_len(const char *s, size_t avail) {
+    if (avail >= 2 && s[1] != '\0' && strchr("\"\\/bfnrt", s[1]) != NULL) {
+        return 2;
+    }
+    if (avail >= 6 && s[1] == 'u' && is_hex(s[2]) && is_hex(s[3]) && is_hex(s[4]) &&
+        is_hex(s[5])) {
+        return 6;
+    }
+    return 0;
+}
+
+size_t export_json_verbatim(const char *s, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    /* Text rarely needs escaping: skip 16 plain bytes at a time. */
+    const __m128i high_bits = _mm_set1_epi8((char)0xE0);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i special = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_and_si128(v, high_bits), _mm_setzero_si128()),
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+        if (_mm_movemask_epi8(special) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < len) {
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x20 || c == '"') {
+            break;
+        }
+        if (c == '\\') {
+            size_t n = escape_len(s + i, len - i);
+            if (n == 0) {
+                break;
+            }
+            i += n;
+        } else {
+            i++;
+        }
+    }
+    return i;
+}
+
+size_t export_json_escape(char *out, const char *s, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    size_t i = 0;
+    while (i < len) {
+        size_t plain = export_json_verbatim(s + i, len - i);
+        memcpy(out + n, s + i, plain);
+        n += plain;
+        i += plain;
+        if (i == len) {
+            break;
+        }
+        unsigned char c = (unsigned char)s[i++];
+        out[n++] = '\\';
+        if (c < 0x20) {
+            out[n++] = 'u';
+            out[n++] = '0';
+            out[n++] = '0';
+            out[n++] = hex[c >> 4];
+            out[n++] = hex[c & 15];
+        } else {
+            out[n++] = (char)c;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Write a string as a JSON string literal
+ */
+static void put_json_string(ExportWriter *w, const char *s) {
+    w->data[w->len++] = '"';
+    w->len += export_json_escape(w->data + w->len, s, strlen(s));
+    w->data[w->len++] = '"';
+}
+
+/**
+ * @brief Write one question as a JSON object
+ *
+ * @param pretty Indented multi-line layout (JSON) or a single line (JSONL)
+ */
+static void put_json_question(ExportWriter *w, const Question *q, bool pretty) {
+    const char *field = pretty ? ",\n    \"" : ",\"";
+    size_t field_len = pretty ? 7 : 2;
+    const char *colon = pretty ? "\": " : "\":";
+    size_t colon_len = pretty ? 3 : 2;
+
+    reserve(w, EXPORT_QUESTION_MAX);
+    if (pretty) {
+        PUT_LITERAL(w, "  {\n    \"");
+    } else {
+        PUT_LITERAL(w, "{\"");
+    }
+    if (q->id != 0) {
+        PUT_LITERAL(w, "id");
+        put(w, colon, colon_len);
+        put_u32(w, q->id);
+        put(w, field, field_len);
+    }
+    PUT_LITERAL(w, "question");
+    put(w, colon, colon_len);
+    put_json_string(w, q->question);
+
+    put(w, field, field_len);
+    PUT_LITERAL(w, "options");
+    put(w, colon, colon_len);
+    w->data[w->len++] = '[';
+    int options = question_option_count(q);
+    for (int i = 0; i < options; i++) {
+        if (i > 0) {
+            if (pretty) {
+                PUT_LITERAL(w, ", ");
+            } else {
+                w->data[w->len++] = ',';
+            }
+        }
+        put_json_string(w, q->options[i]);
+    }
+    w->data[w->len++] = ']';
+
+    put(w, field, field_len);
+    PUT_LITERAL(w, "correct");
+    put(w, colon, colon_len);
+    put_i32(w, q->correct_answer);
+
+    put(w, field, field_len);
+    PUT_LITERAL(w, "difficulty");
+    put(w, colon, colon_len);
+    w->data[w->len++] = '"';
+    put_str(w, DIFFICULTY_NAMES[q->difficulty < DIFFICULTY_COUNT ? q->difficulty : 0]);
+    w->data[w->len++] = '"';
+
+    if (q->category != CATEGORY_GENERAL && q->category < CATEGORY_COUNT) {
+        put(w, field, field_len);
+        PUT_LITERAL(w, "category");
+        put(w, colon, colon_len);
+        w->data[w->len++] = '"';
+        put_str(w, CATEGORY_NAMES[q->category]);
+        w->data[w->len++] = '"';
+    }
+
+    if (pretty) {
+        PUT_LITERAL(w, "\n  }");
+    } else {
+        PUT_LITERAL(w, "}\n");
+    }
+}
+
+static long export_json(ExportWriter *w, const QuestionBank *bank,
+                        const ExportFilter *filter, bool pretty) {
+    long written = 0;
+    if (pretty) {
+        reserve(w, 2);
+        PUT_LITERAL(w, "[\n");
+    }
+    for (size_t i = 0; i < bank->count && !w->failed; i++) {
+        const Question *q = &bank->questions[i];
+        if (!export_filter_match(filter, q)) {
+            continue;
+        }
+        if (pretty && written > 0) {
+            reserve(w, 2);
+            PUT_LITERAL(w, ",\n");
+        }
+        put_json_question(w, q, pretty);
+        written++;
+    }
+    if (pretty) {
+        reserve(w, 3);
+        if (written > 0) {
+            w->data[w->len++] = '\n';
+        }
+        PUT_LITERAL(w, "]\n");
+    }
+    return written;
+}
+
+/**
+ * @brief Write a binary pack
+ *
+ * The header needs the record count and the records need pool offsets,
+ * so the records of matching questions are built first; the pack then
+ * streams out in file order without seeking and can be written to a pipe.
+ */
+static long export_pack(ExportWriter *w, const QuestionBank *bank, const ExportFilter *filter) {
+    size_t slots = bank->count > 0 ? bank->count : 1;
+    PackRecord *records = (PackRecord*)malloc(slots * sizeof(PackRecord));
+    size_t *selected = (size_t*)malloc(slots * sizeof(size_t));
+    if (records == NULL || selected == NULL) {
+        print_error("Failed to allocate export selection");
+        free(records);
+        free(selected);
+        return -1;
+    }
+
+    size_t count = 0;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < bank->count; i++) {
+        const Question *q = &bank->questions[i];
+        int options = question_option_count(q);
+        if (options < 2 || q->correct_answer < 0 || q->correct_answer >= options ||
+            q->difficulty >= DIFFICULTY_COUNT || q->category >= CATEGORY_COUNT ||
+            !export_filter_match(filter, q)) {
+            continue;
+        }
+        PackRecord *record = &records[count];
+        memset(record, 0, sizeof(PackRecord));
+        record->id = q->id;
+        record->correct = (uint8_t)q->correct_answer;
+        record->difficulty = (uint8_t)q->difficulty;
+        record->category = (uint8_t)q->category;
+        record->option_count = (uint8_t)options;
+        record->text_offset = offset;
+        record->lengths[0] = (uint16_t)strlen(q->question);
+        record->widths[0] = q->question_width;
+        offset += record->lengths[0] + 1u;
+        for (int o = 0; o < options; o++) {
+            record->lengths[1 + o] = (uint16_t)strlen(q->options[o]);
+            record->widths[1 + o] = q->option_widths[o];
+            offset += record->lengths[1 + o] + 1u;
+        }
+        selected[count++] = i;
+    }
+    if (count > (size_t)INT32_MAX) {
+        print_error("Too many questions for one pack");
+        free(records);
+        free(selected);
+        return -1;
+    }
+
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.record_size = sizeof(PackRecord);
+    header.count = (uint32_t)count;
+    header.pool_offset = sizeof(PackHeader) + (uint64_t)count * sizeof(PackRecord);
+    header.pool_len = offset;
+    reserve(w, sizeof(header));
+    put(w, &header, sizeof(header));
+
+    /* Records go out in buffer-sized runs. */
+    const char *bytes = (const char*)records;
+    size_t remaining = count * sizeof(PackRecord);
+    while (remaining > 0 && !w->failed) {
+        if (w->len == w->cap) {
+            flush_output(w);
+        }
+        size_t n = w->cap - w->len < remaining ? w->cap - w->len : remaining;
+        put(w, bytes, n);
+        bytes += n;
+        remaining -= n;
+    }
+
+    for (size_t n = 0; n < count && !w->failed; n++) {
+        const Question *q = &bank->questions[selected[n]];
+        const PackRecord *record = &records[n];
+        reserve(w, MAX_QUESTION_LEN + MAX_OPTIONS * MAX_ANSWER_LEN);
+        put(w, q->question, record->lengths[0] + 1u);
+        for (int o = 0; o < record->option_count; o++) {
+            put(w, q->options[o], record->lengths[1 + o] + 1u);
+        }
+    }
+
+    free(records);
+    free(selected);
+    return (long)count;
+}
+
+long export_bank(ExportWriter *writer, int fd, const QuestionBank *bank,
+                 const ExportFilter *filter, ExportFormat format) {
+    if (writer == NULL || writer->data == NULL || bank == NULL || fd < 0) {
+        return -1;
+    }
+
+    /* Sorted private copy of the ID list for binary search. */
+    ExportFilter sorted;
+    uint32_t *ids = NULL;
+    if (filter != NULL) {
+        sorted = *filter;
+        if (filter->ids != NULL) {
+            ids = (uint32_t*)malloc((filter->id_count > 0 ? filter->id_count : 1) * sizeof(uint32_t));
+            if (ids == NULL) {
+                print_error("Failed to allocate export filter");
+                return -1;
+            }
+            memcpy(ids, filter->ids, filter->id_count * sizeof(uint32_t));
+            qsort(ids, filter->id_count, sizeof(uint32_t), compare_u32);
+            sorted.ids = ids;
+        }
+        filter = &sorted;
+    }
+
+    writer->fd = fd;
+    writer->len = 0;
+    writer->written = 0;
+    writer->failed = false;
+
+    long count;
+    switch (format) {
+        case EXPORT_JSON:
+            count = export_json(writer, bank, filter, true);
+            break;
+        case EXPORT_JSONL:
+            count = export_json(writer, bank, filter, false);
+            break;
+        case EXPORT_PACK:
+            count = export_pack(writer, bank, filter);
+            break;
+        default:
+            count = -1;
+            break;
+    }
+    free(ids);
+
+    if (count >= 0) {
+        flush_output(writer);
+    }
+    writer->len = 0;
+    if (writer->failed) {
+        print_error("Failed to write export: %s", strerror(errno));
+        return -1;
+    }
+    return count;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file export.h
+ * @brief Writing question banks as JSON, JSON Lines or binary packs
+ *
+ * Exports are formatted straight into a large reusable output buffer that
+ * is written to a file descriptor whenever it fills, so a bank streams out
+ * with one write(2) per buffer rather than one stdio call per field.
+ */
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "questions.h"
+
+/**
+ * @brief Default output buffer size
+ */
+#define EXPORT_BUFFER_SIZE (4u << 20)
+
+/**
+ * @brief Output formats
+ */
+typedef enum {
+    EXPORT_JSON = 0,                      /**< Pretty-printed JSON array */
+    EXPORT_JSONL,                         /**< One JSON object per line */
+    EXPORT_PACK                           /**< Binary pack (pack.h) */
+} ExportFormat;
+
+/**
+ * @brief Which questions to export; all conditions must hold
+ */
+typedef struct {
+    int difficulty;                       /**< Difficulty to keep, -1 for any */
+    int category;                         /**< Category to keep, -1 for any */
+    const uint32_t *ids;                  /**< IDs to keep, NULL for any */
+    size_t id_count;                      /**< Length of ids */
+} ExportFilter;
+
+/**
+ * @brief Reusable output buffer
+ */
+typedef struct {
+    char *data;                           /**< Buffer */
+    size_t len;                           /**< Bytes waiting to be written */
+    size_t cap;                           /**< Buffer size */
+    int fd;                               /**< Destination of the current export */
+    uint64_t written;                     /**< Bytes written by the last export */
+    bool failed;                          /**< A write failed */
+} ExportWriter;
+
+/**
+ * @brief Allocate an export writer
+ *
+ * @param writer Pointer to ExportWriter to initialize
+ * @param capacity Buffer size in bytes (0 for EXPORT_BUFFER_SIZE)
+ * @return int 0 on success, -1 on error
+ */
+int export_writer_init(ExportWriter *writer, size_t capacity);
+
+/**
+ * @brief Free an export writer's buffer
+ *
+ * @param writer Pointer to ExportWriter
+ */
+void export_writer_free(ExportWriter *writer);
+
+/**
+ * @brief Initialize a filter that keeps every question
+ *
+ * @param filter Pointer to ExportFilter
+ */
+void export_filter_init(ExportFilter *filter);
+
+/**
+ * @brief Check whether a question passes a filter
+ *
+ * The filter's ID list must be sorted (export_bank() sorts its own copy).
+ *
+ * @param filter Pointer to ExportFilter (NULL keeps everything)
+ * @param question Pointer to Question
+ * @return bool true if the question is kept
+ */
+bool export_filter_match(const ExportFilter *filter, const Question *question);
+
+/**
+ * @brief Write the questions of a bank that pass a filter
+ *
+ * Packs hold only playable questions; unplayable ones are skipped.
+ * JSON strings go through export_json_escape(), so the output is always
+ * valid JSON, and text without stray backslashes, quotes or control
+ * characters reads back through the JSON loader unchanged. The writer's
+ * buffer is reused; writer->written receives the bytes written.
+ *
+ * @param writer Pointer to initialized ExportWriter
+ * @param fd File descriptor to write to
+ * @param bank Pointer to QuestionBank
+ * @param filter Pointer to ExportFilter (NULL keeps everything)
+ * @param format Output format
+ * @return long Number of questions written, -1 on error
+ */
+long export_bank(ExportWriter *writer, int fd, const QuestionBank *bank,
+                 const ExportFilter *filter, ExportFormat format);
+
+/**
+ * @brief Count the leading bytes of bank text that are valid JSON string content
+ *
+ * Loaded text is the raw JSON between the quotes, so valid escapes such
+ * as \\n or \\u00e9 are kept as they are. The count stops at a control
+ * character, a quote or a backslash that does not start a valid escape.
+ *
+ * @param s Text
+ * @param len Length of s in bytes
+ * @return size_t len if the whole text can be written as is
+ */
+size_t export_json_verbatim(const char *s, size_t len);
+
+/**
+ * @brief Escape bank text as the content of a JSON string literal
+ *
+ * Valid escapes are copied, control characters become \\u escapes and
+ * quotes and stray backslashes are escaped with a backslash.
+ *
+ * @param out Destination, at least 6 * len bytes
+ * @param s Text
+ * @param len Length of s in bytes
+ * @return size_t Bytes written to out
+ */
+size_t export_json_escape(char *out, const char *s, size_t len);
+
+/**
+ * @brief Parse a format name ("json", "jsonl" or "pack")
+ *
+ * @param name Format name
+ * @return int ExportFormat value, -1 if unknown
+ */
+int export_format_from_name(const char *name);
+
+#endif /* EXPORT_H */
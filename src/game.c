@@ -5,6 +5,8 @@
 
 #include "game.h"
 #include "utils.h"
+#include "probes.h"
+#include "utf8.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,18 +14,133 @@
 #include <unistd.h>
 #include <stdbool.h>
 
-int game_init(GameState *state, QuestionBank *bank, const GameConfig *config) {
-    if (state == NULL || bank == NULL || config == NULL) {
-        return -1;
+/**
+ * @brief Columns between the edges of the ═ banner lines
+ */
+#define SCREEN_WIDTH 55
+
+/**
+ * @brief Number of orders of MAX_OPTIONS options
+ */
+#define OPTION_PERMUTATIONS 24
+
+/**
+ * @brief Every order of four options, indexed by a random byte
+ *
+ * Questions with fewer options use the entries below their option count,
+ * which keeps the order uniform.
+ */
+static const uint8_t OPTION_ORDERS[OPTION_PERMUTATIONS][MAX_OPTIONS] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {0, 3, 2, 1},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 0, 2}, {1, 3, 2, 0},
+    {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 0, 1, 2}, {3, 0, 2, 1}, {3, 1, 0, 2}, {3, 1, 2, 0}, {3, 2, 0, 1}, {3, 2, 1, 0}
+};
+
+/**
+ * @brief Pick the order the options of @p question are shown in
+ *
+ * Only fills the two four-byte maps in the state; option text is never
+ * copied. Bytes of 240 and above are redrawn so each order is equally
+ * likely.
+ */
+static void shuffle_options(GameState *state, const Question *question) {
+    const uint8_t *order = OPTION_ORDERS[0];
+    if (state->config.shuffle_options) {
+        uint32_t x = state->shuffle_seed;
+        uint32_t byte;
+        do {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            byte = x >> 24;
+        } while (byte >= 256 - 256 % OPTION_PERMUTATIONS);
+        state->shuffle_seed = x;
+        order = OPTION_ORDERS[byte % OPTION_PERMUTATIONS];
     }
-    
-    state->question_bank = bank;
+
+    int options = question_option_count(question);
+    int slot = 0;
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        if (order[i] < options) {
+            state->option_order[slot] = order[i];
+            state->option_slot[order[i]] = (uint8_t)slot;
+            slot++;
+        }
+    }
+    for (; slot < MAX_OPTIONS; slot++) {
+        state->option_order[slot] = (uint8_t)slot;
+        state->option_slot[slot] = (uint8_t)slot;
+    }
+}
+
+/**
+ * @brief Print text after a prefix, wrapping at SCREEN_WIDTH
+ *
+ * Continuation lines are indented to line up under the first line. Text
+ * whose precomputed width fits is printed as-is without measuring it.
+ */
+static void print_wrapped(const char *prefix, int prefix_width,
+                          const char *text, int text_width) {
+    int avail = SCREEN_WIDTH - prefix_width;
+    if (text_width <= avail || avail <= 0) {
+        printf("%s%s\n", prefix, text);
+        return;
+    }
+
+    const char *p = text;
+    bool first = true;
+    while (*p != '\0') {
+        size_t fit = utf8_fit_width(p, avail, NULL);
+        size_t line = fit;
+        if (p[fit] != '\0') {
+            /* Break after the last space that fits, if there is one. */
+            while (line > 0 && p[line] != ' ') {
+                line--;
+            }
+            if (line == 0) {
+                uint32_t cp;
+                line = fit > 0 ? fit : utf8_decode(p, &cp);
+            }
+        }
+        if (first) {
+            printf("%s%.*s\n", prefix, (int)line, p);
+            first = false;
+        } else {
+            printf("%*s%.*s\n", prefix_width, "", (int)line, p);
+        }
+        p += line;
+        while (*p == ' ') {
+            p++;
+        }
+    }
+}
+
+/**
+ * @brief Set up state shared by in-memory and paged games
+ *
+ * @param count Number of questions in the bank
+ * @param pool Pool for the game's buffers (NULL for malloc)
+ */
+static int game_init_common(GameState *state, size_t count, const GameConfig *config,
+                            SessionPool *pool) {
     state->config = *config;
+    state->pool = pool;
     state->game_active = false;
     state->current_player = 0;
     state->players = NULL;
     state->used_questions = NULL;
     state->used_count = 0;
+    state->locale = NULL;
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        state->option_order[i] = (uint8_t)i;
+        state->option_slot[i] = (uint8_t)i;
+    }
+    /* Per-session seed: sessions started together still differ. */
+    state->shuffle_seed = (uint32_t)(monotonic_ms() * 1000.0) ^ (uint32_t)(uintptr_t)state;
+    if (state->shuffle_seed == 0) {
+        state->shuffle_seed = 0x9e3779b9u;
+    }
     
     state->stats.total_questions = 0;
     state->stats.correct_answers = 0;
@@ -31,13 +148,19 @@ int game_init(GameState *state, QuestionBank *bank, const GameConfig *config) {
     state->stats.timeouts = 0;
     state->stats.score = 0;
     
-    if (bank != NULL && bank->count > 0) {
-        state->used_questions = (bool*)calloc(bank->count, sizeof(bool));
+    state->paged = NULL;
+    state->current_index = SIZE_MAX;
+    state->next_index = SIZE_MAX;
+    
+    if (count > 0) {
+        state->used_questions = pool != NULL
+                                ? (bool*)session_pool_calloc(pool, count, sizeof(bool))
+                                : (bool*)calloc(count, sizeof(bool));
         if (state->used_questions == NULL) {
             print_error("Failed to allocate memory for used questions tracking");
             return -1;
         }
-        state->used_count = (int)bank->count;
+        state->used_count = (int)count;
     }
     
     if (config->num_players > 1) {
@@ -56,12 +179,195 @@ int game_init(GameState *state, QuestionBank *bank, const GameConfig *config) {
     return 0;
 }
 
+int game_init(GameState *state, QuestionBank *bank, const GameConfig *config) {
+    if (state == NULL || bank == NULL || config == NULL) {
+        return -1;
+    }
+    
+    state->question_bank = bank;
+    return game_init_common(state, bank->count, config, NULL);
+}
+
+int game_init_pooled(GameState *state, QuestionBank *bank, const GameConfig *config,
+                     SessionPool *pool) {
+    if (state == NULL || bank == NULL || config == NULL || pool == NULL) {
+        return -1;
+    }
+    
+    state->question_bank = bank;
+    if (game_init_common(state, bank->count, config, pool) != 0) {
+        /* The timer is set up last, so only the buffers can be held. */
+        session_pool_release(pool, state->players);
+        session_pool_release(pool, state->used_questions);
+        state->players = NULL;
+        state->used_questions = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+GameState* game_create(SessionPool *pool, QuestionBank *bank, const GameConfig *config) {
+    GameState *state = (GameState*)session_pool_alloc(pool, sizeof(GameState));
+    if (state == NULL) {
+        return NULL;
+    }
+    if (game_init_pooled(state, bank, config, pool) != 0) {
+        session_pool_release(pool, state);
+        return NULL;
+    }
+    return state;
+}
+
+void game_destroy(GameState *state) {
+    if (state == NULL) {
+        return;
+    }
+    SessionPool *pool = state->pool;
+    game_cleanup(state);
+    session_pool_release(pool, state);
+}
+
+/**
+ * @brief Fixed part of a saved game; players and used-question bits follow
+ */
+typedef struct {
+    uint32_t bank_count;           /**< Questions in the bank it was saved against */
+    int32_t questions_per_game;    /**< GameConfig fields */
+    int32_t time_per_question;
+    int32_t difficulty;
+    int32_t num_players;
+    uint8_t shuffle_options;
+    uint8_t game_active;
+    uint8_t option_order[MAX_OPTIONS];
+    uint8_t option_slot[MAX_OPTIONS];
+    uint32_t shuffle_seed;
+    int32_t current_player;
+    GameStats stats;
+} SavedGame;
+
+size_t game_saved_fixed_size(void) {
+    return sizeof(SavedGame);
+}
+
+size_t game_saved_size(const GameState *state) {
+    if (state == NULL || state->question_bank == NULL) {
+        return 0;
+    }
+    size_t players = state->config.num_players > 1 ? (size_t)state->config.num_players : 0;
+    return sizeof(SavedGame) + players * sizeof(Player) + (state->question_bank->count + 7) / 8;
+}
+
+size_t game_save(const GameState *state, uint8_t *out, size_t cap) {
+    size_t size = game_saved_size(state);
+    if (size == 0 || out == NULL || cap < size) {
+        return 0;
+    }
+    SavedGame saved;
+    memset(&saved, 0, sizeof(saved));
+    saved.bank_count = (uint32_t)state->question_bank->count;
+    saved.questions_per_game = state->config.questions_per_game;
+    saved.time_per_question = state->config.time_per_question;
+    saved.difficulty = (int32_t)state->config.difficulty;
+    saved.num_players = state->config.num_players;
+    saved.shuffle_options = state->config.shuffle_options;
+    saved.game_active = state->game_active;
+    memcpy(saved.option_order, state->option_order, MAX_OPTIONS);
+    memcpy(saved.option_slot, state->option_slot, MAX_OPTIONS);
+    saved.shuffle_seed = state->shuffle_seed;
+    saved.current_player = state->current_player;
+    saved.stats = state->stats;
+    memcpy(out, &saved, sizeof(saved));
+    size_t at = sizeof(saved);
+    if (state->config.num_players > 1) {
+        memcpy(out + at, state->players, (size_t)state->config.num_players * sizeof(Player));
+        at += (size_t)state->config.num_players * sizeof(Player);
+    }
+    /* Asked questions as bits: a bank of 4096 questions saves in 512 bytes. */
+    memset(out + at, 0, size - at);
+    for (size_t i = 0; i < (size_t)state->used_count; i++) {
+        if (state->used_questions[i]) {
+            out[at + i / 8] |= (uint8_t)(1u << (i % 8));
+        }
+    }
+    return size;
+}
+
+GameState* game_restore(SessionPool *pool, QuestionBank *bank, const uint8_t *data, size_t len) {
+    SavedGame saved;
+    if (pool == NULL || bank == NULL || data == NULL || len < sizeof(saved)) {
+        return NULL;
+    }
+    memcpy(&saved, data, sizeof(saved));
+    size_t players = saved.num_players > 1 ? (size_t)saved.num_players : 0;
+    /* The bytes may come from another process: check everything the game
+     * later relies on. */
+    if (saved.bank_count != bank->count || saved.num_players < 1 || saved.current_player < 0 ||
+        saved.current_player >= saved.num_players || saved.questions_per_game < 1 ||
+        saved.time_per_question < 1 || saved.difficulty < -1 ||
+        saved.difficulty >= DIFFICULTY_COUNT ||
+        len != sizeof(saved) + players * sizeof(Player) + (bank->count + 7) / 8) {
+        return NULL;
+    }
+    /* Slot to option and option to slot must undo each other. */
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        if (saved.option_order[i] >= MAX_OPTIONS ||
+            saved.option_slot[saved.option_order[i]] != (uint8_t)i) {
+            return NULL;
+        }
+    }
+
+    GameConfig config;
+    config.questions_per_game = saved.questions_per_game;
+    config.time_per_question = saved.time_per_question;
+    config.difficulty = (Difficulty)saved.difficulty;
+    config.use_timer = false;
+    config.num_players = saved.num_players;
+    config.shuffle_options = saved.shuffle_options != 0;
+    GameState *state = game_create(pool, bank, &config);
+    if (state == NULL) {
+        return NULL;
+    }
+    state->game_active = saved.game_active != 0;
+    memcpy(state->option_order, saved.option_order, MAX_OPTIONS);
+    memcpy(state->option_slot, saved.option_slot, MAX_OPTIONS);
+    state->shuffle_seed = saved.shuffle_seed;
+    state->current_player = saved.current_player;
+    state->stats = saved.stats;
+    size_t at = sizeof(saved);
+    if (players > 0) {
+        memcpy(state->players, data + at, players * sizeof(Player));
+        for (size_t i = 0; i < players; i++) {
+            state->players[i].name[sizeof(state->players[i].name) - 1] = '\0';
+        }
+        at += players * sizeof(Player);
+    }
+    for (size_t i = 0; i < (size_t)state->used_count; i++) {
+        state->used_questions[i] = (data[at + i / 8] >> (i % 8)) & 1u;
+    }
+    return state;
+}
+
+int game_init_paged(GameState *state, PagedBank *bank, const GameConfig *config) {
+    if (state == NULL || bank == NULL || config == NULL) {
+        return -1;
+    }
+    
+    state->question_bank = NULL;
+    if (game_init_common(state, bank->count, config, NULL) != 0) {
+        return -1;
+    }
+    state->paged = bank;
+    return 0;
+}
+
 int game_init_players(GameState *state) {
     if (state == NULL || state->config.num_players < 2) {
         return -1;
     }
     
-    state->players = (Player*)malloc(state->config.num_players * sizeof(Player));
+    size_t bytes = (size_t)state->config.num_players * sizeof(Player);
+    state->players = state->pool != NULL ? (Player*)session_pool_alloc(state->pool, bytes)
+                                         : (Player*)malloc(bytes);
     if (state->players == NULL) {
         print_error("Failed to allocate memory for players");
         return -1;
@@ -123,11 +429,137 @@ int game_calculate_score(bool correct, int time_remaining, Difficulty difficulty
     return base_points + time_bonus;
 }
 
+/**
+ * @brief Draw from a paged bank, prefetching the question after it
+ *
+ * The next question is chosen now rather than at the next draw, so its
+ * pages can be read while the player is answering this one.
+ */
+static Question* draw_paged_question(GameState *state) {
+    PagedBank *bank = state->paged;
+    int difficulty_filter = (int)state->config.difficulty;
+    size_t index = state->next_index;
+    if (index == SIZE_MAX || state->used_questions[index]) {
+        index = paged_bank_pick(bank, difficulty_filter, state->used_questions);
+    }
+    if (index == SIZE_MAX) {
+        return NULL;
+    }
+    state->used_questions[index] = true;
+    
+    /* Read before queueing the next pages so the prefetcher cannot evict
+     * the page this question is on while it is being read. */
+    if (paged_bank_read(bank, index, &state->current) != 0) {
+        return NULL;
+    }
+    state->current_index = index;
+    
+    state->next_index = paged_bank_pick(bank, difficulty_filter, state->used_questions);
+    if (state->next_index != SIZE_MAX) {
+        paged_bank_prefetch(bank, state->next_index);
+    }
+    shuffle_options(state, &state->current);
+    
+    TRIVIA_PROBE3(question_drawn, state, index, (int)state->current.difficulty);
+    return &state->current;
+}
+
+/**
+ * @brief Bank index of a question returned by game_draw_question()
+ */
+static size_t question_index(const GameState *state, const Question *question) {
+    if (state->paged != NULL) {
+        return state->current_index;
+    }
+    return (size_t)(question - state->question_bank->questions);
+}
+
+Question* game_draw_question(GameState *state) {
+    if (state == NULL) {
+        return NULL;
+    }
+    if (state->paged != NULL) {
+        return draw_paged_question(state);
+    }
+    if (state->question_bank == NULL) {
+        return NULL;
+    }
+    
+    int difficulty_filter = (int)state->config.difficulty;
+    Question *question = question_bank_get_random_unused_r(state->question_bank,
+                                                            difficulty_filter,
+                                                            state->used_questions,
+                                                            state->used_count,
+                                                            &state->shuffle_seed);
+    if (question == NULL) {
+        return NULL;
+    }
+    
+    size_t question_idx = (size_t)(question - state->question_bank->questions);
+    if (question_idx < (size_t)state->used_count) {
+        state->used_questions[question_idx] = true;
+    }
+    shuffle_options(state, question);
+    
+    TRIVIA_PROBE3(question_drawn, state, question_idx, (int)question->difficulty);
+    return question;
+}
+
+int game_submit_answer(GameState *state, const Question *question, 
+                       int answer, int time_remaining) {
+    if (state == NULL || question == NULL) {
+        return -1;
+    }
+    
+    TRIVIA_PROBE3(answer_received, state, answer, time_remaining);
+    
+    bool correct = answer >= 1 && answer <= MAX_OPTIONS &&
+                   state->option_order[answer - 1] == question->correct_answer;
+    int points = 0;
+    
+    if (state->config.num_players > 1) {
+        Player *player = game_get_current_player(state);
+        if (player == NULL) {
+            return -1;
+        }
+        if (answer == 0) {
+            player->timeouts++;
+        } else if (correct) {
+            player->correct_answers++;
+            points = game_calculate_score(true, time_remaining, question->difficulty);
+            player->score += points;
+        } else {
+            player->wrong_answers++;
+        }
+    } else {
+        state->stats.total_questions++;
+        if (answer == 0) {
+            state->stats.timeouts++;
+        } else if (correct) {
+            state->stats.correct_answers++;
+            points = game_calculate_score(true, time_remaining, question->difficulty);
+            state->stats.score += points;
+        } else {
+            state->stats.wrong_answers++;
+        }
+    }
+    
+    TRIVIA_PROBE3(answer_graded, state, (int)correct, points);
+    return points;
+}
+
 int game_ask_question(GameState *state, const Question *question) {
     if (state == NULL || question == NULL) {
         return -1;
     }
     
+    size_t index = question_index(state, question);
+    Question translated;
+    const Question *shown = locale_resolve(state->locale, state->question_bank, index, &translated);
+    if (shown == NULL) {
+        shown = question;
+    }
+    
     clear_screen();
     
     printf("\n═══════════════════════════════════════════════════════\n");
@@ -139,15 +571,23 @@ int game_ask_question(GameState *state, const Question *question) {
                     player == &state->players[1] ? "Player 2" : "Player"));
         }
     }
-    printf("  %s\n", question->question);
+    print_wrapped("  ", 2, shown->question, shown->question_width);
     printf("  Difficulty: %s\n", difficulty_to_string(question->difficulty));
     printf("═══════════════════════════════════════════════════════\n\n");
     
-    for (int i = 0; i < MAX_OPTIONS && strlen(question->options[i]) > 0; i++) {
-        printf("  %d. %s\n", i + 1, question->options[i]);
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        int option = state->option_order[i];
+        if (shown->options[option][0] == '\0') {
+            break;
+        }
+        char prefix[16];
+        int prefix_width = snprintf(prefix, sizeof(prefix), "  %d. ", i + 1);
+        print_wrapped(prefix, prefix_width, shown->options[option], shown->option_widths[option]);
     }
     printf("\n");
     
+    TRIVIA_PROBE2(question_shown, state, index);
+    
     if (state->config.use_timer) {
         timer_reset(&state->timer, state->config.time_per_question);
         timer_start(&state->timer);
@@ -221,7 +661,7 @@ int game_ask_question(GameState *state, const Question *question) {
 }
 
 int game_run(GameState *state) {
-    if (state == NULL || state->question_bank == NULL) {
+    if (state == NULL || (state->question_bank == NULL && state->paged == NULL)) {
         return -1;
     }
     
@@ -249,23 +689,13 @@ int game_run(GameState *state) {
     }
     
     for (int i = 0; i < total_rounds; i++) {
-        int difficulty_filter = state->config.difficulty >= 0 ? 
-                               state->config.difficulty : -1;
-        Question *question = question_bank_get_random_unused(state->question_bank, 
-                                                              difficulty_filter,
-                                                              state->used_questions,
-                                                              state->used_count);
+        Question *question = game_draw_question(state);
         
         if (question == NULL) {
             print_error("No more questions available");
             break;
         }
         
-        size_t question_idx = (size_t)(question - state->question_bank->questions);
-        if (question_idx < (size_t)state->used_count) {
-            state->used_questions[question_idx] = true;
-        }
-        
         int user_answer = game_ask_question(state, question);
         
         if (user_answer == -1) {
@@ -273,51 +703,27 @@ int game_run(GameState *state) {
             break;
         }
         
-        bool correct = (user_answer == question->correct_answer + 1);
         int time_remaining = state->config.use_timer ? 
                             timer_get_remaining(&state->timer) : 
                             state->config.time_per_question;
+        int points = game_submit_answer(state, question, user_answer, time_remaining);
         
-        if (state->config.num_players > 1) {
-            Player *player = game_get_current_player(state);
-            if (player != NULL) {
-                if (user_answer == 0) {
-                    player->timeouts++;
-                    printf("\n❌ Time's up! The correct answer was: %d. %s\n",
-                           question->correct_answer + 1,
-                           question->options[question->correct_answer]);
-                } else if (correct) {
-                    player->correct_answers++;
-                    int points = game_calculate_score(true, time_remaining, 
-                                                    question->difficulty);
-                    player->score += points;
-                    printf("\n✅ Correct! +%d points\n", points);
-                } else {
-                    player->wrong_answers++;
-                    printf("\n❌ Wrong! The correct answer was: %d. %s\n",
-                           question->correct_answer + 1,
-                           question->options[question->correct_answer]);
-                }
-            }
+        Question translated;
+        const Question *shown = locale_resolve(state->locale, state->question_bank,
+                                               question_index(state, question), &translated);
+        if (shown == NULL) {
+            shown = question;
+        }
+        
+        int correct_choice = game_option_choice(state, question->correct_answer);
+        if (user_answer == 0) {
+            printf("\n❌ Time's up! The correct answer was: %d. %s\n",
+                   correct_choice, shown->options[question->correct_answer]);
+        } else if (user_answer == correct_choice) {
+            printf("\n✅ Correct! +%d points\n", points);
         } else {
-            state->stats.total_questions++;
-            if (user_answer == 0) {
-                state->stats.timeouts++;
-                printf("\n❌ Time's up! The correct answer was: %d. %s\n",
-                       question->correct_answer + 1,
-                       question->options[question->correct_answer]);
-            } else if (correct) {
-                state->stats.correct_answers++;
-                int points = game_calculate_score(true, time_remaining, 
-                                                question->difficulty);
-                state->stats.score += points;
-                printf("\n✅ Correct! +%d points\n", points);
-            } else {
-                state->stats.wrong_answers++;
-                printf("\n❌ Wrong! The correct answer was: %d. %s\n",
-                       question->correct_answer + 1,
-                       question->options[question->correct_answer]);
-            }
+            printf("\n❌ Wrong! The correct answer was: %d. %s\n",
+                   correct_choice, shown->options[question->correct_answer]);
         }
         
         if (state->config.num_players > 1) {
@@ -343,6 +749,13 @@ int game_run(GameState *state) {
     return state->stats.score;
 }
 
+int game_option_choice(const GameState *state, int option) {
+    if (state == NULL || option < 0 || option >= MAX_OPTIONS) {
+        return 0;
+    }
+    return state->option_slot[option] + 1;
+}
+
 void game_display_stats(const GameState *state) {
     if (state == NULL) {
         return;
@@ -427,12 +840,20 @@ void game_cleanup(GameState *state) {
     }
     
     if (state->players != NULL) {
-        free(state->players);
+        if (state->pool != NULL) {
+            session_pool_release(state->pool, state->players);
+        } else {
+            free(state->players);
+        }
         state->players = NULL;
     }
     
     if (state->used_questions != NULL) {
-        free(state->used_questions);
+        if (state->pool != NULL) {
+            session_pool_release(state->pool, state->used_questions);
+        } else {
+            free(state->used_questions);
+        }
         state->used_questions = NULL;
     }
     
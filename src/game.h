@@ -13,6 +13,9 @@
 #define GAME_H
 
 #include "questions.h"
+#include "locales.h"
+#include "paged.h"
+#include "pool.h"
 #include "timer.h"
 
 /**
@@ -24,6 +27,7 @@ typedef struct {
     Difficulty difficulty;          /**< Difficulty filter (-1 for any) */
     bool use_timer;                /**< Whether to use timer */
     int num_players;               /**< Number of players (1 for single-player) */
+    bool shuffle_options;          /**< Show options in a new random order on each ask */
 } GameConfig;
 
 /**
@@ -61,6 +65,15 @@ typedef struct {
     bool game_active;              /**< Whether game is currently active */
     bool *used_questions;          /**< Array tracking which questions have been asked */
     int used_count;                /**< Number of questions already asked */
+    const LocaleBank *locale;      /**< Translated text to show (NULL for base text) */
+    uint8_t option_order[MAX_OPTIONS]; /**< Option shown in each slot of the current ask */
+    uint8_t option_slot[MAX_OPTIONS];  /**< Slot showing each option of the current ask */
+    uint32_t shuffle_seed;         /**< xorshift state for draws and option shuffling */
+    PagedBank *paged;              /**< Out-of-core bank (NULL when question_bank is used) */
+    Question current;              /**< Question read from the paged bank */
+    size_t current_index;          /**< Index of current in the paged bank */
+    size_t next_index;             /**< Question drawn ahead and prefetched, SIZE_MAX if none */
+    SessionPool *pool;             /**< Source of the game's buffers (NULL for malloc) */
 } GameState;
 
 /**
@@ -73,6 +86,97 @@ typedef struct {
  */
 int game_init(GameState *state, QuestionBank *bank, const GameConfig *config);
 
+/**
+ * @brief Initialize game state over an out-of-core bank
+ * 
+ * Questions are read through the bank's page cache; locales are not
+ * available in this mode.
+ * 
+ * @param state Pointer to GameState to initialize
+ * @param bank Pointer to an open PagedBank
+ * @param config Game configuration
+ * @return int 0 on success, -1 on error
+ */
+int game_init_paged(GameState *state, PagedBank *bank, const GameConfig *config);
+
+/**
+ * @brief Initialize game state with buffers taken from a pool
+ * 
+ * Like game_init(), but the used-question flags and the player array
+ * come from the pool and go back to it in game_cleanup().
+ * 
+ * @param state Pointer to GameState to initialize
+ * @param bank Pointer to QuestionBank
+ * @param config Game configuration
+ * @param pool Worker's session pool
+ * @return int 0 on success, -1 on error
+ */
+int game_init_pooled(GameState *state, QuestionBank *bank, const GameConfig *config,
+                     SessionPool *pool);
+
+/**
+ * @brief Start a game whose state and buffers all come from a pool
+ * 
+ * @param pool Worker's session pool
+ * @param bank Pointer to QuestionBank
+ * @param config Game configuration
+ * @return GameState* Initialized game, NULL on error
+ */
+GameState* game_create(SessionPool *pool, QuestionBank *bank, const GameConfig *config);
+
+/**
+ * @brief End a game from game_create() and return it to its pool
+ * 
+ * @param state Game to destroy (NULL is ignored)
+ */
+void game_destroy(GameState *state);
+
+/**
+ * @brief Bytes game_save() needs for a game
+ * 
+ * @param state Game from game_create() or game_init_pooled()
+ * @return size_t Bytes
+ */
+size_t game_saved_size(const GameState *state);
+
+/**
+ * @brief Bytes of the fixed part of game_save() output
+ * 
+ * Players and the used-question bits follow it. A process that restores
+ * games saved by another build checks this and sizeof(Player) against
+ * the saving side's before trusting the bytes.
+ * 
+ * @return size_t Bytes
+ */
+size_t game_saved_fixed_size(void);
+
+/**
+ * @brief Write everything a game needs to carry on in another process
+ * 
+ * Configuration, scores, whose turn it is, which questions were asked,
+ * the option order of the current ask and the RNG state. Questions are
+ * referred to by bank index, so the side that restores must have loaded
+ * the same pack.
+ * 
+ * @param state Game over an in-memory bank
+ * @param out Buffer to write to
+ * @param cap Size of out
+ * @return size_t Bytes written, 0 if out is too small
+ */
+size_t game_save(const GameState *state, uint8_t *out, size_t cap);
+
+/**
+ * @brief Recreate a game written by game_save(), with buffers from a pool
+ * 
+ * @param pool Worker's session pool
+ * @param bank Same pack the game was saved against
+ * @param data Saved game
+ * @param len Bytes in data
+ * @return GameState* Game ready to continue, NULL if data is malformed or
+ *         was saved against a bank of another size
+ */
+GameState* game_restore(SessionPool *pool, QuestionBank *bank, const uint8_t *data, size_t len);
+
 /**
  * @brief Run a single game session
  * 
@@ -90,6 +194,44 @@ int game_run(GameState *state);
  */
 int game_ask_question(GameState *state, const Question *question);
 
+/**
+ * @brief Draw the next unused question for the current game
+ *
+ * Applies the configured difficulty filter, marks the returned question
+ * as used and picks the order its options are shown in. Performs no
+ * terminal I/O. With a paged bank the returned question is owned by the
+ * state and valid until the next draw, and the question after it is
+ * drawn at once so its text can be prefetched.
+ *
+ * @param state Pointer to GameState
+ * @return Question* Pointer to question, or NULL if none left
+ */
+Question* game_draw_question(GameState *state);
+
+/**
+ * @brief Grade an answer and update statistics for the current player
+ *
+ * Performs no terminal I/O, so it can drive sessions that are not
+ * attached to a terminal (bots, load generators).
+ *
+ * @param state Pointer to GameState
+ * @param question Question that was asked
+ * @param answer Displayed position chosen (1-4), 0 on timeout
+ * @param time_remaining Seconds left on the clock when answered
+ * @return int Points awarded, or -1 on error
+ */
+int game_submit_answer(GameState *state, const Question *question,
+                       int answer, int time_remaining);
+
+/**
+ * @brief Displayed position of an option in the current ask
+ *
+ * @param state Pointer to GameState
+ * @param option Option index in the question (0-3)
+ * @return int Position the option is shown at (1-4), 0 if out of range
+ */
+int game_option_choice(const GameState *state, int option);
+
 /**
  * @brief Display game statistics
  * 
@@ -0,0 +1,960 @@
+/**
+ * @file http.c
+ * @brief Admin query API: HTTP/1.1 keep-alive and pipelining on its own thread
+ */
+
+#define _GNU_SOURCE
+
+#include "http.h"
+#include "export.h"
+#include "metrics.h"
+#include "utils.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/**
+ * @brief Events taken per epoll_wait()
+ */
+#define HTTP_EVENTS 64
+
+/**
+ * @brief iovecs handed to one sendmsg()
+ */
+#define HTTP_IOV_BATCH 64
+
+/**
+ * @brief Pending response bytes above which pipelined requests wait
+ */
+#define HTTP_MAX_PENDING (1u << 20)
+
+/**
+ * @brief Room for one formatted number or piece of punctuation
+ */
+#define HTTP_FORMAT_MAX 128
+
+static const char *const DIFFICULTY_NAMES[DIFFICULTY_COUNT] = { "easy", "medium", "hard" };
+static const char *const CATEGORY_NAMES[CATEGORY_COUNT] = {
+    "general", "science", "history", "sports", "entertainment"
+};
+
+/**
+ * @brief Piece of a response: bank text, or bytes in the connection's arena
+ */
+typedef struct {
+    const char *base;                     /**< Bank text, NULL for arena bytes */
+    size_t off;                           /**< Arena offset when base is NULL */
+    size_t len;                           /**< Bytes */
+} HttpSegment;
+
+struct HttpConn {
+    bool open;                            /**< Slot in use */
+    bool closing;                         /**< Close once the output is sent */
+    bool peer_closed;                     /**< Peer sent FIN; answer what arrived, then close */
+    bool reading;                         /**< EPOLLIN is armed */
+    bool writing;                         /**< EPOLLOUT is armed */
+    char *in;                             /**< Received request bytes */
+    size_t in_len;                        /**< Bytes in in */
+    HttpSegment *segs;                    /**< Response segments in send order */
+    size_t seg_count;                     /**< Segments queued */
+    size_t seg_cap;                       /**< Allocated segments */
+    size_t seg_next;                      /**< First segment not fully sent */
+    size_t seg_sent;                      /**< Bytes of segs[seg_next] already sent */
+    size_t pending;                       /**< Response bytes not yet sent */
+    char *arena;                          /**< Headers, punctuation, escaped text */
+    size_t arena_len;                     /**< Bytes used in arena */
+    size_t arena_cap;                     /**< Allocated arena bytes */
+    bool failed;                          /**< Out of memory while building a response */
+};
+
+/**
+ * @brief A parsed request
+ */
+typedef struct {
+    char method[8];                       /**< Request method */
+    char path[HTTP_MAX_REQUEST];          /**< Path without the query string */
+    const char *query;                    /**< Query string in the request, or NULL */
+    size_t query_len;                     /**< Length of query */
+    bool keep_alive;                      /**< Connection stays open after the response */
+    size_t head_len;                      /**< Request bytes including the blank line */
+} HttpRequest;
+
+/* ---- Response building ---- */
+
+/**
+ * @brief Make room for one more segment
+ *
+ * @return bool false when out of memory
+ */
+static bool seg_reserve(HttpConn *c) {
+    if (c->failed) {
+        return false;
+    }
+    if (c->seg_count == c->seg_cap) {
+        size_t cap = c->seg_cap > 0 ? c->seg_cap * 2 : 64;
+        HttpSegment *segs = (HttpSegment*)realloc(c->segs, cap * sizeof(HttpSegment));
+        if (segs == NULL) {
+            c->failed = true;
+            return false;
+        }
+        c->segs = segs;
+        c->seg_cap = cap;
+    }
+    return true;
+}
+
+static void seg_push(HttpConn *c, const char *base, size_t off, size_t len) {
+    if (c->failed || len == 0) {
+        return;
+    }
+    /* Arena bytes written right after the previous arena segment extend it,
+     * unless that segment is already partly sent. */
+    if (base == NULL && c->seg_count > c->seg_next + 1) {
+        HttpSegment *last = &c->segs[c->seg_count - 1];
+        if (last->base == NULL && last->off + last->len == off) {
+            last->len += len;
+            c->pending += len;
+            return;
+        }
+    }
+    if (!seg_reserve(c)) {
+        return;
+    }
+    c->segs[c->seg_count].base = base;
+    c->segs[c->seg_count].off = off;
+    c->segs[c->seg_count].len = len;
+    c->seg_count++;
+    c->pending += len;
+}
+
+/**
+ * @brief Reserve arena space for up to @p len bytes
+ *
+ * @return char* Where to write, or NULL when out of memory
+ */
+static char* arena_reserve(HttpConn *c, size_t len) {
+    if (c->failed) {
+        return NULL;
+    }
+    if (c->arena_len + len > c->arena_cap) {
+        size_t cap = c->arena_cap > 0 ? c->arena_cap : 4096;
+        while (cap < c->arena_len + len) {
+            cap *= 2;
+        }
+        char *arena = (char*)realloc(c->arena, cap);
+        if (arena == NULL) {
+            c->failed = true;
+            return NULL;
+        }
+        c->arena = arena;
+        c->arena_cap = cap;
+    }
+    return c->arena + c->arena_len;
+}
+
+static void put_bytes(HttpServer *server, HttpConn *c, const char *data, size_t len) {
+    char *at = arena_reserve(c, len);
+    if (at == NULL) {
+        return;
+    }
+    memcpy(at, data, len);
+    seg_push(c, NULL, c->arena_len, len);
+    c->arena_len += len;
+    server->stats.copied_bytes += len;
+}
+
+#define PUT_LITERAL(server, c, s) put_bytes((server), (c), (s), sizeof(s) - 1)
+
+static void put_fmt(HttpServer *server, HttpConn *c, const char *format, ...) {
+    char *at = arena_reserve(c, HTTP_FORMAT_MAX);
+    if (at == NULL) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(at, HTTP_FORMAT_MAX, format, args);
+    va_end(args);
+    if (n <= 0) {
+        return;
+    }
+    size_t len = (size_t)n < HTTP_FORMAT_MAX ? (size_t)n : HTTP_FORMAT_MAX - 1;
+    seg_push(c, NULL, c->arena_len, len);
+    c->arena_len += len;
+    server->stats.copied_bytes += len;
+}
+
+/**
+ * @brief Append a JSON string
+ *
+ * Loaded text is the raw JSON between the quotes, so it is usually sent
+ * as is straight from the bank; text that needs escaping is rewritten
+ * into the arena by export_json_escape().
+ */
+static void put_json_string(HttpServer *server, HttpConn *c, const char *s) {
+    size_t len = strlen(s);
+
+    PUT_LITERAL(server, c, "\"");
+    if (export_json_verbatim(s, len) == len) {
+        seg_push(c, s, 0, len);
+        server->stats.bank_bytes += len;
+    } else {
+        char *at = arena_reserve(c, len * 6);
+        if (at == NULL) {
+            return;
+        }
+        size_t n = export_json_escape(at, s, len);
+        seg_push(c, NULL, c->arena_len, n);
+        c->arena_len += n;
+        server->stats.copied_bytes += n;
+    }
+    PUT_LITERAL(server, c, "\"");
+}
+
+static void put_question(HttpServer *server, HttpConn *c, const Question *q) {
+    put_fmt(server, c, "{\"id\":%u,\"question\":", q->id);
+    put_json_string(server, c, q->question);
+    PUT_LITERAL(server, c, ",\"options\":[");
+    int options = question_option_count(q);
+    for (int i = 0; i < options; i++) {
+        if (i > 0) {
+            PUT_LITERAL(server, c, ",");
+        }
+        put_json_string(server, c, q->options[i]);
+    }
+    put_fmt(server, c, "],\"correct\":%d,\"difficulty\":\"%s\",\"category\":\"%s\"}",
+            q->correct_answer,
+            DIFFICULTY_NAMES[q->difficulty < DIFFICULTY_COUNT ? q->difficulty : 0],
+            CATEGORY_NAMES[q->category < CATEGORY_COUNT ? q->category : 0]);
+}
+
+/**
+ * @brief Start a response; returns the segment that will hold its head
+ */
+static size_t response_begin(HttpConn *c) {
+    size_t slot = c->seg_count;
+    /* Placeholder, filled by response_end() once the body length is known. */
+    if (seg_reserve(c)) {
+        c->segs[slot].base = "";
+        c->segs[slot].off = 0;
+        c->segs[slot].len = 0;
+        c->seg_count++;
+    }
+    return slot;
+}
+
+static void response_end(HttpServer *server, HttpConn *c, size_t slot, int status,
+                         bool keep_alive) {
+    if (c->failed) {
+        return;
+    }
+    size_t body = 0;
+    for (size_t i = slot + 1; i < c->seg_count; i++) {
+        body += c->segs[i].len;
+    }
+    const char *reason = status == 200 ? "OK" : status == 400 ? "Bad Request"
+                       : status == 404 ? "Not Found" : status == 405 ? "Method Not Allowed"
+                       : status == 431 ? "Request Header Fields Too Large"
+                       : "Internal Server Error";
+    char *at = arena_reserve(c, 256);
+    if (at == NULL) {
+        return;
+    }
+    int n = snprintf(at, 256,
+                     "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                     "Content-Length: %zu\r\n%s\r\n",
+                     status, reason, body, keep_alive ? "" : "Connection: close\r\n");
+    c->segs[slot].base = NULL;
+    c->segs[slot].off = c->arena_len;
+    c->segs[slot].len = (size_t)n;
+    c->arena_len += (size_t)n;
+    c->pending += (size_t)n;
+    server->stats.copied_bytes += (size_t)n;
+    server->stats.requests++;
+    if (status >= 400) {
+        server->stats.errors++;
+    }
+}
+
+static void respond_error(HttpServer *server, HttpConn *c, int status, const char *message,
+                          bool keep_alive) {
+    size_t slot = response_begin(c);
+    put_fmt(server, c, "{\"error\":\"%s\"}", message);
+    response_end(server, c, slot, status, keep_alive);
+}
+
+/* ---- Request handling ---- */
+
+/**
+ * @brief Find a query parameter and URL-decode its value
+ *
+ * @return bool true if the parameter is present
+ */
+static bool query_param(const HttpRequest *req, const char *name, char *out, size_t cap) {
+    size_t name_len = strlen(name);
+    const char *p = req->query;
+    const char *end = req->query + req->query_len;
+    while (p != NULL && p < end) {
+        const char *amp = memchr(p, '&', (size_t)(end - p));
+        const char *stop = amp != NULL ? amp : end;
+        if ((size_t)(stop - p) > name_len && memcmp(p, name, name_len) == 0 && p[name_len] == '=') {
+            size_t n = 0;
+            for (const char *s = p + name_len + 1; s < stop && n + 1 < cap; s++) {
+                if (*s == '+') {
+                    out[n++] = ' ';
+                } else if (*s == '%' && stop - s >= 3) {
+                    char hex[3] = { s[1], s[2], '\0' };
+                    char *parsed = NULL;
+                    long v = strtol(hex, &parsed, 16);
+                    if (parsed != hex + 2 || v == 0) {
+                        return false;
+                    }
+                    out[n++] = (char)v;
+                    s += 2;
+                } else {
+                    out[n++] = *s;
+                }
+            }
+            out[n] = '\0';
+            return true;
+        }
+        p = amp != NULL ? amp + 1 : NULL;
+    }
+    return false;
+}
+
+/**
+ * @brief Read a non-negative integer parameter
+ *
+ * @return int 0 if absent or valid (value set), -1 if malformed
+ */
+static int query_count(const HttpRequest *req, const char *name, int max, int *value) {
+    char text[32];
+    if (!query_param(req, name, text, sizeof(text))) {
+        return 0;
+    }
+    int parsed = 0;
+    if (!is_valid_integer(text, &parsed) || parsed < 0) {
+        return -1;
+    }
+    *value = parsed < max ? parsed : max;
+    return 0;
+}
+
+static const Question* find_by_id(const HttpServer *server, uint32_t id) {
+    size_t lo = 0;
+    size_t hi = server->id_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (server->ids[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < server->id_count && server->ids[lo].id == id) {
+        return &server->bank->questions[server->ids[lo].index];
+    }
+    return NULL;
+}
+
+static void handle_get_question(HttpServer *server, HttpConn *c, const HttpRequest *req,
+                                const char *id_text) {
+    char *end = NULL;
+    unsigned long id = strtoul(id_text, &end, 10);
+    const Question *q = end != id_text && *end == '\0' && id <= UINT32_MAX
+                        ? find_by_id(server, (uint32_t)id) : NULL;
+    if (q == NULL) {
+        respond_error(server, c, 404, "no question with that id", req->keep_alive);
+        return;
+    }
+    size_t slot = response_begin(c);
+    put_question(server, c, q);
+    response_end(server, c, slot, 200, req->keep_alive);
+}
+
+static void handle_list(HttpServer *server, HttpConn *c, const HttpRequest *req) {
+    ExportFilter filter;
+    export_filter_init(&filter);
+    char name[32];
+    if (query_param(req, "difficulty", name, sizeof(name)) &&
+        (filter.difficulty = difficulty_from_name(name)) < 0) {
+        respond_error(server, c, 400, "unknown difficulty", req->keep_alive);
+        return;
+    }
+    if (query_param(req, "category", name, sizeof(name)) &&
+        (filter.category = category_from_name(name)) < 0) {
+        respond_error(server, c, 400, "unknown category", req->keep_alive);
+        return;
+    }
+    int offset = 0;
+    int limit = HTTP_DEFAULT_LIMIT;
+    if (query_count(req, "offset", INT_MAX, &offset) != 0 ||
+        query_count(req, "limit", HTTP_MAX_LIMIT, &limit) != 0) {
+        respond_error(server, c, 400, "offset and limit must be non-negative integers",
+                      req->keep_alive);
+        return;
+    }
+
+    size_t slot = response_begin(c);
+    PUT_LITERAL(server, c, "{\"questions\":[");
+    size_t total = 0;
+    int shown = 0;
+    const QuestionBank *bank = server->bank;
+    for (size_t i = 0; i < bank->count; i++) {
+        if (!export_filter_match(&filter, &bank->questions[i])) {
+            continue;
+        }
+        if (total++ < (size_t)offset || shown >= limit) {
+            continue;
+        }
+        if (shown++ > 0) {
+            PUT_LITERAL(server, c, ",");
+        }
+        put_question(server, c, &bank->questions[i]);
+    }
+    put_fmt(server, c, "],\"total\":%zu,\"offset\":%d}", total, offset);
+    response_end(server, c, slot, 200, req->keep_alive);
+}
+
+static void handle_search(HttpServer *server, HttpConn *c, const HttpRequest *req) {
+    char query[HTTP_MAX_REQUEST];
+    int limit = HTTP_DEFAULT_LIMIT;
+    if (!query_param(req, "q", query, sizeof(query)) ||
+        query_count(req, "limit", HTTP_MAX_LIMIT, &limit) != 0) {
+        respond_error(server, c, 400, "usage: /search?q=<query>[&limit=N]", req->keep_alive);
+        return;
+    }
+    long matches = search_query(&server->index, query, server->results, (size_t)limit);
+    if (matches < 0) {
+        respond_error(server, c, 400, "invalid query", req->keep_alive);
+        return;
+    }
+    size_t shown = (size_t)matches < (size_t)limit ? (size_t)matches : (size_t)limit;
+    size_t slot = response_begin(c);
+    PUT_LITERAL(server, c, "{\"questions\":[");
+    for (size_t i = 0; i < shown; i++) {
+        if (i > 0) {
+            PUT_LITERAL(server, c, ",");
+        }
+        put_question(server, c, &server->bank->questions[server->results[i]]);
+    }
+    put_fmt(server, c, "],\"total\":%ld}", matches);
+    response_end(server, c, slot, 200, req->keep_alive);
+}
+
+static void handle_request(HttpServer *server, HttpConn *c, const HttpRequest *req) {
+    if (strcmp(req->method, "GET") != 0) {
+        respond_error(server, c, 405, "only GET is supported", req->keep_alive);
+    } else if (strncmp(req->path, "/questions/", 11) == 0) {
+        handle_get_question(server, c, req, req->path + 11);
+    } else if (strcmp(req->path, "/questions") == 0) {
+        handle_list(server, c, req);
+    } else if (strcmp(req->path, "/search") == 0) {
+        handle_search(server, c, req);
+    } else if (strcmp(req->path, "/health") == 0) {
+        size_t slot = response_begin(c);
+        put_fmt(server, c, "{\"status\":\"ok\",\"questions\":%zu}", server->bank->count);
+        response_end(server, c, slot, 200, req->keep_alive);
+    } else {
+        respond_error(server, c, 404, "unknown path", req->keep_alive);
+    }
+}
+
+/**
+ * @brief Whether a header value lists @p token (case-insensitive)
+ */
+static bool header_has_token(const char *value, size_t len, const char *token) {
+    size_t token_len = strlen(token);
+    for (size_t i = 0; i + token_len <= len; i++) {
+        if (strncasecmp(value + i, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parse the request at the start of data
+ *
+ * @return int 1 if complete, 0 if more bytes are needed, -1 if malformed
+ */
+static int parse_request(const char *data, size_t len, HttpRequest *req) {
+    const char *end = NULL;
+    for (size_t i = 0; i + 4 <= len; i++) {
+        if (memcmp(data + i, "\r\n\r\n", 4) == 0) {
+            end = data + i + 4;
+            break;
+        }
+    }
+    if (end == NULL) {
+        return 0;
+    }
+    req->head_len = (size_t)(end - data);
+
+    const char *line_end = memchr(data, '\r', req->head_len);
+    const char *sp1 = memchr(data, ' ', (size_t)(line_end - data));
+    const char *sp2 = sp1 != NULL ? memchr(sp1 + 1, ' ', (size_t)(line_end - sp1 - 1)) : NULL;
+    if (sp1 == NULL || sp2 == NULL || (size_t)(sp1 - data) >= sizeof(req->method) ||
+        sp1[1] != '/' || line_end - sp2 != 9 || memcmp(sp2 + 1, "HTTP/1.", 7) != 0) {
+        return -1;
+    }
+    memcpy(req->method, data, (size_t)(sp1 - data));
+    req->method[sp1 - data] = '\0';
+    const char *target = sp1 + 1;
+    const char *question = memchr(target, '?', (size_t)(sp2 - target));
+    const char *path_end = question != NULL ? question : sp2;
+    memcpy(req->path, target, (size_t)(path_end - target));
+    req->path[path_end - target] = '\0';
+    req->query = question != NULL ? question + 1 : NULL;
+    req->query_len = question != NULL ? (size_t)(sp2 - question - 1) : 0;
+    req->keep_alive = sp2[8] == '1';
+
+    /* Headers: only Connection and a request body matter here. */
+    const char *line = line_end + 2;
+    while (line < end - 2) {
+        const char *eol = memchr(line, '\r', (size_t)(end - line));
+        const char *colon = memchr(line, ':', (size_t)(eol - line));
+        if (colon != NULL) {
+            size_t name_len = (size_t)(colon - line);
+            const char *value = colon + 1;
+            size_t value_len = (size_t)(eol - value);
+            if (name_len == 10 && strncasecmp(line, "Connection", 10) == 0) {
+                if (header_has_token(value, value_len, "close")) {
+                    req->keep_alive = false;
+                } else if (header_has_token(value, value_len, "keep-alive")) {
+                    req->keep_alive = true;
+                }
+            } else if ((name_len == 14 && strncasecmp(line, "Content-Length", 14) == 0 &&
+                        strtol(value, NULL, 10) != 0) ||
+                       (name_len == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0)) {
+                /* No endpoint takes a body; one would break request framing. */
+                return -1;
+            }
+        }
+        line = eol + 2;
+    }
+    return 1;
+}
+
+/* ---- Connections ---- */
+
+static void conn_watch(HttpServer *server, int fd) {
+    HttpConn *c = &server->conns[fd];
+    bool reading = !c->closing && !c->peer_closed && c->pending < HTTP_MAX_PENDING;
+    bool writing = c->pending > 0;
+    if (reading == c->reading && writing == c->writing) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = (c->peer_closed ? 0 : EPOLLRDHUP) | (reading ? EPOLLIN : 0) |
+                (writing ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    c->reading = reading;
+    c->writing = writing;
+}
+
+static void conn_close(HttpServer *server, int fd) {
+    HttpConn *c = &server->conns[fd];
+    if (!c->open) {
+        return;
+    }
+    free(c->in);
+    free(c->segs);
+    free(c->arena);
+    memset(c, 0, sizeof(*c));
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    server->conn_count--;
+}
+
+/**
+ * @brief Send queued segments with sendmsg(), HTTP_IOV_BATCH at a time
+ *
+ * @return int 0 when sent or the socket is full, -1 on a send error
+ */
+static int conn_flush(HttpConn *c, int fd) {
+    while (c->seg_next < c->seg_count) {
+        struct iovec iov[HTTP_IOV_BATCH];
+        int n = 0;
+        for (size_t i = c->seg_next; i < c->seg_count && n < HTTP_IOV_BATCH; i++) {
+            const HttpSegment *s = &c->segs[i];
+            const char *base = s->base != NULL ? s->base : c->arena + s->off;
+            size_t skip = i == c->seg_next ? c->seg_sent : 0;
+            iov[n].iov_base = (void*)(base + skip);
+            iov[n].iov_len = s->len - skip;
+            n++;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        ssize_t sent = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+        }
+        c->pending -= (size_t)sent;
+        size_t left = (size_t)sent;
+        while (left > 0) {
+            size_t rest = c->segs[c->seg_next].len - c->seg_sent;
+            if (left < rest) {
+                c->seg_sent += left;
+                break;
+            }
+            left -= rest;
+            c->seg_next++;
+            c->seg_sent = 0;
+        }
+        while (c->seg_next < c->seg_count && c->segs[c->seg_next].len == 0) {
+            c->seg_next++;
+        }
+        if ((size_t)sent == 0) {
+            return 0;
+        }
+    }
+    c->seg_count = 0;
+    c->seg_next = 0;
+    c->seg_sent = 0;
+    c->arena_len = 0;
+    return 0;
+}
+
+/**
+ * @brief Answer every complete request in the input buffer, in order
+ */
+static void conn_process(HttpServer *server, int fd) {
+    HttpConn *c = &server->conns[fd];
+    size_t used = 0;
+    HttpRequest req;
+    while (!c->closing && c->pending < HTTP_MAX_PENDING) {
+        int r = parse_request(c->in + used, c->in_len - used, &req);
+        if (r == 0) {
+            if (c->in_len - used >= HTTP_MAX_REQUEST) {
+                respond_error(server, c, 431, "request head too large", false);
+                c->closing = true;
+            }
+            break;
+        }
+        if (r < 0) {
+            respond_error(server, c, 400, "malformed request", false);
+            c->closing = true;
+            break;
+        }
+        used += req.head_len;
+        handle_request(server, c, &req);
+        if (c->failed) {
+            c->closing = true;
+            c->pending = 0;
+            c->seg_count = c->seg_next;
+            break;
+        }
+        if (!req.keep_alive) {
+            c->closing = true;
+        }
+    }
+    if (used > 0) {
+        memmove(c->in, c->in + used, c->in_len - used);
+        c->in_len -= used;
+    }
+}
+
+/**
+ * @brief Read, answer and send; closes the connection when it is done
+ */
+static void conn_service(HttpServer *server, int fd, uint32_t events) {
+    HttpConn *c = &server->conns[fd];
+    if ((events & EPOLLIN) && c->reading && c->in_len < HTTP_MAX_REQUEST) {
+        if (c->in == NULL) {
+            c->in = (char*)malloc(HTTP_MAX_REQUEST);
+            if (c->in == NULL) {
+                conn_close(server, fd);
+                return;
+            }
+        }
+        ssize_t n = recv(fd, c->in + c->in_len, HTTP_MAX_REQUEST - c->in_len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+        } else if (n == 0) {
+            c->peer_closed = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            conn_close(server, fd);
+            return;
+        }
+    }
+    if (events & (EPOLLRDHUP | EPOLLHUP)) {
+        c->peer_closed = true;
+    }
+    if (events & EPOLLERR) {
+        conn_close(server, fd);
+        return;
+    }
+    conn_process(server, fd);
+    if (conn_flush(c, fd) != 0) {
+        conn_close(server, fd);
+        return;
+    }
+    /* Requests left waiting on the pending limit can go now. */
+    if (c->pending == 0 && c->in_len > 0 && !c->closing) {
+        conn_process(server, fd);
+        if (conn_flush(c, fd) != 0) {
+            conn_close(server, fd);
+            return;
+        }
+    }
+    if (c->pending == 0 && (c->closing || c->peer_closed)) {
+        conn_close(server, fd);
+        return;
+    }
+    conn_watch(server, fd);
+}
+
+static void conn_accept(HttpServer *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (server->conn_count >= server->opts.max_connections) {
+            close(fd);
+            continue;
+        }
+        if (fd >= server->conn_cap) {
+            int cap = server->conn_cap;
+            while (cap <= fd) {
+                cap *= 2;
+            }
+            HttpConn *conns = (HttpConn*)realloc(server->conns, (size_t)cap * sizeof(HttpConn));
+            if (conns == NULL) {
+                close(fd);
+                continue;
+            }
+            memset(conns + server->conn_cap, 0, (size_t)(cap - server->conn_cap) * sizeof(HttpConn));
+            server->conns = conns;
+            server->conn_cap = cap;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        HttpConn *c = &server->conns[fd];
+        memset(c, 0, sizeof(*c));
+        c->open = true;
+        c->reading = true;
+        server->conn_count++;
+        server->stats.accepted++;
+    }
+}
+
+static void* http_main(void *arg) {
+    HttpServer *server = (HttpServer*)arg;
+    struct epoll_event events[HTTP_EVENTS];
+    while (!server->stopping) {
+        int n = epoll_wait(server->epoll_fd, events, HTTP_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            print_error("HTTP epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server->listen_fd) {
+                conn_accept(server);
+            } else if (fd == server->wake_fd) {
+                uint64_t value;
+                while (read(server->wake_fd, &value, sizeof(value)) > 0) {
+                }
+            } else if (fd < server->conn_cap && server->conns[fd].open) {
+                conn_service(server, fd, events[i].events);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* ---- Public API ---- */
+
+static int compare_ids(const void *a, const void *b) {
+    const HttpIdEntry *x = (const HttpIdEntry*)a;
+    const HttpIdEntry *y = (const HttpIdEntry*)b;
+    if (x->id != y->id) {
+        return x->id < y->id ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+void http_options_init(HttpOptions *opts) {
+    if (opts == NULL) {
+        return;
+    }
+    opts->host = "127.0.0.1";
+    opts->port = 8081;
+    opts->max_connections = 256;
+    opts->listen_fd = -1;
+}
+
+static void http_free(HttpServer *server) {
+    for (int fd = 0; server->conns != NULL && fd < server->conn_cap; fd++) {
+        conn_close(server, fd);
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0) {
+        close(server->wake_fd);
+    }
+    search_index_free(&server->index);
+    free(server->ids);
+    free(server->results);
+    free(server->conns);
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->ids = NULL;
+    server->results = NULL;
+    server->conns = NULL;
+    server->conn_cap = 0;
+    server->conn_count = 0;
+}
+
+int http_server_start(HttpServer *server, const QuestionBank *bank, const HttpOptions *opts) {
+    if (server == NULL || bank == NULL || opts == NULL) {
+        return -1;
+    }
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    if (opts->port < 0 || opts->port > 65535 || opts->max_connections < 1) {
+        print_error("Invalid HTTP options");
+        return -1;
+    }
+    server->opts = *opts;
+    server->bank = bank;
+
+    if (search_index_build(&server->index, bank) != 0) {
+        print_error("Failed to index the bank for search");
+        http_free(server);
+        return -1;
+    }
+    server->ids = (HttpIdEntry*)malloc((bank->count > 0 ? bank->count : 1) * sizeof(HttpIdEntry));
+    server->results = (size_t*)malloc(HTTP_MAX_LIMIT * sizeof(size_t));
+    server->conn_cap = 64;
+    server->conns = (HttpConn*)calloc((size_t)server->conn_cap, sizeof(HttpConn));
+    if (server->ids == NULL || server->results == NULL || server->conns == NULL) {
+        print_error("Failed to allocate HTTP server buffers");
+        http_free(server);
+        return -1;
+    }
+    for (size_t i = 0; i < bank->count; i++) {
+        if (bank->questions[i].id != 0) {
+            server->ids[server->id_count].id = bank->questions[i].id;
+            server->ids[server->id_count].index = (uint32_t)i;
+            server->id_count++;
+        }
+    }
+    /* Sorted by ID, then bank order, so a lookup finds the first copy. */
+    qsort(server->ids, server->id_count, sizeof(HttpIdEntry), compare_ids);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)opts->port);
+    if (opts->listen_fd < 0 &&
+        inet_pton(AF_INET, opts->host != NULL ? opts->host : "127.0.0.1", &addr.sin_addr) != 1) {
+        print_error("Invalid HTTP listen address: %s", opts->host);
+        http_free(server);
+        return -1;
+    }
+    int one = 1;
+    if (opts->listen_fd >= 0) {
+        /* Taken over from the process this one replaced: already bound. */
+        server->listen_fd = opts->listen_fd;
+        fcntl(server->listen_fd, F_SETFL, fcntl(server->listen_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(server->listen_fd, F_SETFD, FD_CLOEXEC);
+    } else if ((server->listen_fd =
+                    socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+        setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, SOMAXCONN) != 0) {
+        print_error("Failed to listen on HTTP port %d: %s", opts->port, strerror(errno));
+        http_free(server);
+        return -1;
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len);
+    server->port = ntohs(addr.sin_port);
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = server->listen_fd;
+    int added = server->epoll_fd >= 0 && server->wake_fd >= 0
+                ? epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) : -1;
+    ev.data.fd = server->wake_fd;
+    if (added != 0 || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev) != 0) {
+        print_error("Failed to set up the HTTP event loop: %s", strerror(errno));
+        http_free(server);
+        return -1;
+    }
+
+    if (pthread_create(&server->thread, NULL, http_main, server) != 0) {
+        print_error("Failed to start the HTTP thread");
+        http_free(server);
+        return -1;
+    }
+    server->running = true;
+    return 0;
+}
+
+void http_server_stop(HttpServer *server) {
+    if (server == NULL) {
+        return;
+    }
+    if (server->running) {
+        server->stopping = 1;
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+        pthread_join(server->thread, NULL);
+        server->running = false;
+    }
+    http_free(server);
+}
+
+void http_publish_metrics(const HttpServer *server) {
+    if (server == NULL) {
+        return;
+    }
+    metrics_set("http.accepted", (double)server->stats.accepted);
+    metrics_set("http.requests", (double)server->stats.requests);
+    metrics_set("http.errors", (double)server->stats.errors);
+    metrics_set("http.bank_bytes", (double)server->stats.bank_bytes);
+    metrics_set("http.copied_bytes", (double)server->stats.copied_bytes);
+}
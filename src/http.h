@@ -0,0 +1,134 @@
+/**
+ * @file http.h
+ * @brief Admin query API: HTTP/1.1 over the question bank on its own thread
+ *
+ * Read-only endpoints for admin tools and the CMS:
+ *
+ *   GET /questions/<id>                         one question by pack ID
+ *   GET /questions?difficulty=&category=&offset=&limit=   filtered listing
+ *   GET /search?q=<query>&limit=                full-text search (search.h)
+ *   GET /health                                 question count
+ *
+ * Connections are kept alive (HTTP/1.1 default) and pipelined requests
+ * are answered in order. Responses are written with sendmsg() from a
+ * list of segments: question and option text is referenced straight in
+ * the bank's Question records rather than copied, and only the JSON
+ * punctuation, numbers and headers are formatted into a per-connection
+ * arena. The API runs its own epoll loop on its own thread, so admin
+ * traffic never runs on the game loop; the bank must stay unchanged while
+ * the API is running.
+ */
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "questions.h"
+#include "search.h"
+
+/**
+ * @brief Largest request head (request line and headers) accepted
+ */
+#define HTTP_MAX_REQUEST 8192
+
+/**
+ * @brief Questions returned by a listing or search without a limit
+ */
+#define HTTP_DEFAULT_LIMIT 100
+
+/**
+ * @brief Most questions returned by one listing or search
+ */
+#define HTTP_MAX_LIMIT 1000
+
+/**
+ * @brief Admin API settings
+ */
+typedef struct {
+    const char *host;                     /**< IPv4 address to listen on */
+    int port;                             /**< TCP port, 0 picks a free one */
+    int max_connections;                  /**< Connections accepted at once */
+    int listen_fd;                        /**< Listener inherited in an upgrade, -1 to bind */
+} HttpOptions;
+
+/**
+ * @brief Running totals
+ */
+typedef struct {
+    uint64_t accepted;                    /**< Connections accepted */
+    uint64_t requests;                    /**< Requests answered */
+    uint64_t errors;                      /**< Requests answered with 4xx */
+    uint64_t bank_bytes;                  /**< Body bytes sent straight from the bank */
+    uint64_t copied_bytes;                /**< Response bytes formatted or escaped */
+} HttpStats;
+
+/**
+ * @brief Bank index entry mapping a pack ID to its question
+ */
+typedef struct {
+    uint32_t id;                          /**< Pack ID */
+    uint32_t index;                       /**< Index in the bank */
+} HttpIdEntry;
+
+typedef struct HttpConn HttpConn;
+
+/**
+ * @brief Admin API state; the loop thread owns everything but stopping
+ */
+typedef struct {
+    HttpOptions opts;                     /**< Settings */
+    const QuestionBank *bank;             /**< Bank being served (read-only) */
+    SearchIndex index;                    /**< Full-text index over bank */
+    HttpIdEntry *ids;                     /**< Questions with an ID, sorted by ID */
+    size_t id_count;                      /**< Length of ids */
+    size_t *results;                      /**< Search result scratch (HTTP_MAX_LIMIT) */
+    int listen_fd;                        /**< Listener */
+    int epoll_fd;                         /**< Event loop */
+    int wake_fd;                          /**< eventfd that interrupts the loop */
+    int port;                             /**< Bound port */
+    volatile int stopping;                /**< Set by http_server_stop() */
+    pthread_t thread;                     /**< Loop thread */
+    bool running;                         /**< Thread was started */
+    HttpConn *conns;                      /**< Connections indexed by fd */
+    int conn_cap;                         /**< Length of conns */
+    int conn_count;                       /**< Open connections */
+    HttpStats stats;                      /**< Running totals (read after stop) */
+} HttpServer;
+
+/**
+ * @brief Fill in default options (127.0.0.1:8081, 256 connections)
+ *
+ * @param opts Options to fill
+ */
+void http_options_init(HttpOptions *opts);
+
+/**
+ * @brief Index the bank, bind the listener and start the API thread
+ *
+ * @param server Server to initialize
+ * @param bank Bank to serve; must not change until http_server_stop()
+ * @param opts Settings
+ * @return int 0 on success, -1 on error
+ */
+int http_server_start(HttpServer *server, const QuestionBank *bank, const HttpOptions *opts);
+
+/**
+ * @brief Stop the API thread, close its connections and free the server
+ *
+ * The stats stay readable afterwards.
+ *
+ * @param server Started server
+ */
+void http_server_stop(HttpServer *server);
+
+/**
+ * @brief Publish the API totals as metrics
+ *
+ * @param server Server (after http_server_stop())
+ */
+void http_publish_metrics(const HttpServer *server);
+
+#endif /* HTTP_H */
@@ -0,0 +1,249 @@
+/**
+ * @file leaderboard.c
+ * @brief Player totals ranked by score
+ */
+
+#include "leaderboard.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Buckets allocated for an empty leaderboard
+ */
+#define LEADERBOARD_INITIAL_BUCKETS 64
+
+static uint32_t hash_name(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char*)name; *p != '\0'; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Whether entry a ranks before entry b
+ */
+static bool ranks_before(const LeaderboardEntry *a, const LeaderboardEntry *b) {
+    if (a->total != b->total) {
+        return a->total > b->total;
+    }
+    return strcmp(a->name, b->name) < 0;
+}
+
+/**
+ * @brief Position in the order array where @p entry is or would go
+ */
+static size_t order_position(const Leaderboard *lb, const LeaderboardEntry *entry) {
+    size_t lo = 0;
+    size_t hi = lb->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ranks_before(&lb->entries[lb->order[mid]], entry)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Find a player's entry index
+ *
+ * @return long Index, or -1 if absent
+ */
+static long find_entry(const Leaderboard *lb, const char *name) {
+    size_t mask = lb->bucket_count - 1;
+    for (size_t b = hash_name(name) & mask; lb->buckets[b] != 0; b = (b + 1) & mask) {
+        uint32_t index = lb->buckets[b] - 1;
+        if (strcmp(lb->entries[index].name, name) == 0) {
+            return (long)index;
+        }
+    }
+    return -1;
+}
+
+static int grow(Leaderboard *lb) {
+    size_t capacity = lb->capacity * 2;
+    LeaderboardEntry *entries = (LeaderboardEntry*)realloc(lb->entries,
+                                                           capacity * sizeof(LeaderboardEntry));
+    if (entries == NULL) {
+        return -1;
+    }
+    lb->entries = entries;
+    uint32_t *order = (uint32_t*)realloc(lb->order, capacity * sizeof(uint32_t));
+    if (order == NULL) {
+        return -1;
+    }
+    lb->order = order;
+    lb->capacity = capacity;
+
+    /* Keep the hash at most half full. */
+    if (capacity * 2 > lb->bucket_count) {
+        size_t bucket_count = lb->bucket_count * 2;
+        uint32_t *buckets = (uint32_t*)calloc(bucket_count, sizeof(uint32_t));
+        if (buckets == NULL) {
+            return -1;
+        }
+        for (size_t i = 0; i < lb->count; i++) {
+            size_t b = hash_name(lb->entries[i].name) & (bucket_count - 1);
+            while (buckets[b] != 0) {
+                b = (b + 1) & (bucket_count - 1);
+            }
+            buckets[b] = (uint32_t)i + 1;
+        }
+        free(lb->buckets);
+        lb->buckets = buckets;
+        lb->bucket_count = bucket_count;
+    }
+    return 0;
+}
+
+int leaderboard_init(Leaderboard *lb) {
+    if (lb == NULL) {
+        return -1;
+    }
+    memset(lb, 0, sizeof(*lb));
+    lb->capacity = LEADERBOARD_INITIAL_BUCKETS / 2;
+    lb->bucket_count = LEADERBOARD_INITIAL_BUCKETS;
+    lb->entries = (LeaderboardEntry*)malloc(lb->capacity * sizeof(LeaderboardEntry));
+    lb->order = (uint32_t*)malloc(lb->capacity * sizeof(uint32_t));
+    lb->buckets = (uint32_t*)calloc(lb->bucket_count, sizeof(uint32_t));
+    if (lb->entries == NULL || lb->order == NULL || lb->buckets == NULL) {
+        print_error("Failed to allocate leaderboard");
+        leaderboard_free(lb);
+        return -1;
+    }
+    return 0;
+}
+
+void leaderboard_free(Leaderboard *lb) {
+    if (lb == NULL) {
+        return;
+    }
+    free(lb->entries);
+    free(lb->order);
+    free(lb->buckets);
+    memset(lb, 0, sizeof(*lb));
+}
+
+void leaderboard_clear(Leaderboard *lb) {
+    if (lb == NULL) {
+        return;
+    }
+    lb->count = 0;
+    memset(lb->buckets, 0, lb->bucket_count * sizeof(uint32_t));
+}
+
+bool leaderboard_valid_name(const char *name) {
+    if (name == NULL || name[0] == '\0') {
+        return false;
+    }
+    size_t len = 0;
+    for (const char *p = name; *p != '\0'; p++, len++) {
+        char c = *p;
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                  c == '_' || c == '-' || c == '.';
+        if (!ok || len + 1 >= LEADERBOARD_MAX_NAME) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int leaderboard_set(Leaderboard *lb, const char *name, int64_t total) {
+    if (lb == NULL || !leaderboard_valid_name(name)) {
+        return -1;
+    }
+    long found = find_entry(lb, name);
+    if (found < 0) {
+        if (lb->count == lb->capacity && grow(lb) != 0) {
+            print_error("Failed to grow leaderboard");
+            return -1;
+        }
+        uint32_t index = (uint32_t)lb->count;
+        LeaderboardEntry *entry = &lb->entries[index];
+        memset(entry->name, 0, sizeof(entry->name));
+        strcpy(entry->name, name);
+        entry->total = total;
+        size_t at = order_position(lb, entry);
+        memmove(&lb->order[at + 1], &lb->order[at], (lb->count - at) * sizeof(uint32_t));
+        lb->order[at] = index;
+        size_t mask = lb->bucket_count - 1;
+        size_t b = hash_name(name) & mask;
+        while (lb->buckets[b] != 0) {
+            b = (b + 1) & mask;
+        }
+        lb->buckets[b] = index + 1;
+        lb->count++;
+        return 0;
+    }
+
+    LeaderboardEntry *entry = &lb->entries[found];
+    if (entry->total == total) {
+        return 0;
+    }
+    /* Take the entry out of the order, change it, and put it back. */
+    size_t from = order_position(lb, entry);
+    memmove(&lb->order[from], &lb->order[from + 1], (lb->count - from - 1) * sizeof(uint32_t));
+    lb->count--;
+    entry->total = total;
+    size_t to = order_position(lb, entry);
+    memmove(&lb->order[to + 1], &lb->order[to], (lb->count - to) * sizeof(uint32_t));
+    lb->order[to] = (uint32_t)found;
+    lb->count++;
+    return 0;
+}
+
+int leaderboard_add(Leaderboard *lb, const char *name, int64_t points, int64_t *total) {
+    if (lb == NULL || !leaderboard_valid_name(name)) {
+        return -1;
+    }
+    long found = find_entry(lb, name);
+    int64_t updated = 0;
+    if (__builtin_add_overflow(found >= 0 ? lb->entries[found].total : 0, points, &updated)) {
+        errno = ERANGE;
+        return -1;
+    }
+    if (leaderboard_set(lb, name, updated) != 0) {
+        return -1;
+    }
+    if (total != NULL) {
+        *total = updated;
+    }
+    return 0;
+}
+
+size_t leaderboard_rank(const Leaderboard *lb, const char *name, int64_t *total) {
+    if (lb == NULL || name == NULL) {
+        return 0;
+    }
+    long found = find_entry(lb, name);
+    if (found < 0) {
+        return 0;
+    }
+    /* Ties share the rank of the first player with that total. */
+    LeaderboardEntry first;
+    first.name[0] = '\0';
+    first.total = lb->entries[found].total;
+    if (total != NULL) {
+        *total = first.total;
+    }
+    return order_position(lb, &first) + 1;
+}
+
+const LeaderboardEntry* leaderboard_at(const Leaderboard *lb, size_t position, size_t *rank) {
+    if (lb == NULL || position >= lb->count) {
+        return NULL;
+    }
+    const LeaderboardEntry *entry = &lb->entries[lb->order[position]];
+    if (rank != NULL) {
+        LeaderboardEntry first;
+        first.name[0] = '\0';
+        first.total = entry->total;
+        *rank = order_position(lb, &first) + 1;
+    }
+    return entry;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file leaderboard.h
+ * @brief Player totals ranked by score
+ *
+ * Players are kept in a hash table by name and in an array ordered by
+ * total (highest first, then by name), so a rank is a binary search and a
+ * top-N listing is a slice. Players with the same total share a rank.
+ * Updating a total moves one entry within the order array.
+ */
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Longest player name plus its terminator
+ */
+#define LEADERBOARD_MAX_NAME 32
+
+/**
+ * @brief A player's total
+ */
+typedef struct {
+    char name[LEADERBOARD_MAX_NAME];      /**< Player name */
+    int64_t total;                        /**< Total score */
+} LeaderboardEntry;
+
+/**
+ * @brief Leaderboard
+ */
+typedef struct {
+    LeaderboardEntry *entries;            /**< Players, in insertion order */
+    size_t count;                         /**< Players */
+    size_t capacity;                      /**< Allocated entries */
+    uint32_t *order;                      /**< Entry indices, best total first */
+    uint32_t *buckets;                    /**< Hash of names: entry index + 1, 0 = empty */
+    size_t bucket_count;                  /**< Buckets (power of two) */
+} Leaderboard;
+
+/**
+ * @brief Initialize an empty leaderboard
+ *
+ * @param lb Leaderboard
+ * @return int 0 on success, -1 on error
+ */
+int leaderboard_init(Leaderboard *lb);
+
+/**
+ * @brief Free a leaderboard
+ *
+ * @param lb Leaderboard
+ */
+void leaderboard_free(Leaderboard *lb);
+
+/**
+ * @brief Remove every player, keeping the storage
+ *
+ * @param lb Leaderboard
+ */
+void leaderboard_clear(Leaderboard *lb);
+
+/**
+ * @brief Whether a name can be used (1-31 of A-Z a-z 0-9 _ - .)
+ *
+ * @param name Name
+ * @return bool true if valid
+ */
+bool leaderboard_valid_name(const char *name);
+
+/**
+ * @brief Set a player's total, adding the player if new
+ *
+ * @param lb Leaderboard
+ * @param name Player name
+ * @param total New total
+ * @return int 0 on success, -1 on an invalid name or allocation failure
+ */
+int leaderboard_set(Leaderboard *lb, const char *name, int64_t total);
+
+/**
+ * @brief Add points to a player's total
+ *
+ * @param lb Leaderboard
+ * @param name Player name
+ * @param points Points to add (may be negative)
+ * @param total Receives the new total (may be NULL)
+ * @return int 0 on success, -1 on error (errno is ERANGE, and the total
+ *         unchanged, if it would overflow)
+ */
+int leaderboard_add(Leaderboard *lb, const char *name, int64_t points, int64_t *total);
+
+/**
+ * @brief A player's rank
+ *
+ * @param lb Leaderboard
+ * @param name Player name
+ * @param total Receives the player's total (may be NULL)
+ * @return size_t Rank from 1, or 0 if the player is unknown
+ */
+size_t leaderboard_rank(const Leaderboard *lb, const char *name, int64_t *total);
+
+/**
+ * @brief Player at a position in rank order
+ *
+ * @param lb Leaderboard
+ * @param position 0 for the leader
+ * @param rank Receives the player's rank (may be NULL)
+ * @return const LeaderboardEntry* Entry, or NULL past the end
+ */
+const LeaderboardEntry* leaderboard_at(const Leaderboard *lb, size_t position, size_t *rank);
+
+#endif /* LEADERBOARD_H */
@@ -0,0 +1,321 @@
+/**
+ * @file locales.c
+ * @brief Implementation of per-locale translated variants
+ */
+
+#include "locales.h"
+#include "metrics.h"
+#include "utils.h"
+#include <ctype.h>
+
+/**
+ * @brief Base question ID and its index, sorted by ID for lookups
+ */
+typedef struct {
+    uint32_t id;
+    size_t index;
+} IdEntry;
+
+/**
+ * @brief State shared with the object callback while loading a pack
+ */
+typedef struct {
+    LocaleBank *locale;
+    const QuestionBank *base;
+    const IdEntry *ids;
+    size_t id_count;
+    int failed;
+} LocaleLoad;
+
+static int compare_ids(const void *a, const void *b) {
+    const IdEntry *ea = (const IdEntry*)a;
+    const IdEntry *eb = (const IdEntry*)b;
+    return ea->id < eb->id ? -1 : (ea->id > eb->id);
+}
+
+static bool valid_code(const char *code) {
+    size_t len = code != NULL ? strlen(code) : 0;
+    if (len == 0 || len >= MAX_LOCALE_CODE_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)code[i]) && code[i] != '-' && code[i] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int pool_append(LocaleBank *locale, const char *text) {
+    size_t len = strlen(text) + 1;
+    if (locale->pool_len + len > locale->pool_cap) {
+        size_t cap = locale->pool_cap > 0 ? locale->pool_cap : 4096;
+        while (cap < locale->pool_len + len) {
+            cap *= 2;
+        }
+        char *pool = (char*)realloc(locale->pool, cap);
+        if (pool == NULL) {
+            return -1;
+        }
+        locale->pool = pool;
+        locale->pool_cap = cap;
+    }
+    memcpy(locale->pool + locale->pool_len, text, len);
+    locale->pool_len += len;
+    return 0;
+}
+
+static int add_variant(const char *object, void *ctx) {
+    LocaleLoad *load = (LocaleLoad*)ctx;
+    Question q;
+    int options = question_parse_text(object, &q);
+    if (options < 0 || q.id == 0) {
+        return -1;
+    }
+
+    IdEntry key = { q.id, 0 };
+    const IdEntry *match = (const IdEntry*)bsearch(&key, load->ids, load->id_count,
+                                                   sizeof(IdEntry), compare_ids);
+    if (match == NULL ||
+        options != question_option_count(&load->base->questions[match->index])) {
+        return -1;
+    }
+
+    LocaleBank *locale = load->locale;
+    LocaleVariant *variant = &locale->variants[match->index];
+    if (variant->offset != UINT32_MAX || locale->pool_len > UINT32_MAX - 4096) {
+        return -1;
+    }
+
+    uint32_t offset = (uint32_t)locale->pool_len;
+    question_compute_widths(&q);
+    if (pool_append(locale, q.question) != 0) {
+        load->failed = 1;
+        return -1;
+    }
+    for (int i = 0; i < options; i++) {
+        if (pool_append(locale, q.options[i]) != 0) {
+            load->failed = 1;
+            return -1;
+        }
+    }
+    variant->offset = offset;
+    variant->widths[0] = q.question_width;
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        variant->widths[1 + i] = q.option_widths[i];
+    }
+    locale->translated++;
+    return 0;
+}
+
+int locale_bank_load_from_buffer(LocaleBank *locale, const QuestionBank *base,
+                                 const char *code, const char *data, size_t len) {
+    if (locale == NULL || base == NULL || !valid_code(code)) {
+        return -1;
+    }
+
+    memset(locale, 0, sizeof(LocaleBank));
+    strncpy(locale->code, code, sizeof(locale->code) - 1);
+    locale->variant_count = base->count;
+    locale->variants = (LocaleVariant*)malloc((base->count > 0 ? base->count : 1) *
+                                              sizeof(LocaleVariant));
+    IdEntry *ids = (IdEntry*)malloc((base->count > 0 ? base->count : 1) * sizeof(IdEntry));
+    if (locale->variants == NULL || ids == NULL) {
+        print_error("Failed to allocate memory for locale %s", code);
+        free(ids);
+        locale_bank_free(locale);
+        return -1;
+    }
+
+    size_t id_count = 0;
+    for (size_t i = 0; i < base->count; i++) {
+        locale->variants[i].offset = UINT32_MAX;
+        if (base->questions[i].id != 0) {
+            ids[id_count].id = base->questions[i].id;
+            ids[id_count].index = i;
+            id_count++;
+        }
+    }
+    qsort(ids, id_count, sizeof(IdEntry), compare_ids);
+
+    LocaleLoad load = { locale, base, ids, id_count, 0 };
+    int loaded = question_scan_objects(data, len, add_variant, &load);
+    free(ids);
+    if (loaded < 0 || load.failed) {
+        print_error("Failed to load locale %s", code);
+        locale_bank_free(locale);
+        return -1;
+    }
+    return loaded;
+}
+
+void locale_bank_free(LocaleBank *locale) {
+    if (locale == NULL) {
+        return;
+    }
+    free(locale->variants);
+    free(locale->pool);
+    locale->variants = NULL;
+    locale->pool = NULL;
+    locale->variant_count = 0;
+    locale->translated = 0;
+    locale->pool_len = 0;
+    locale->pool_cap = 0;
+}
+
+const Question* locale_resolve(const LocaleBank *locale, const QuestionBank *base,
+                               size_t index, Question *scratch) {
+    if (base == NULL || index >= base->count) {
+        return NULL;
+    }
+    const Question *q = &base->questions[index];
+    if (locale == NULL || scratch == NULL || index >= locale->variant_count ||
+        locale->variants[index].offset == UINT32_MAX) {
+        return q;
+    }
+
+    const LocaleVariant *variant = &locale->variants[index];
+    int options = question_option_count(q);
+    const char *text = locale->pool + variant->offset;
+
+    *scratch = *q;
+    strncpy(scratch->question, text, sizeof(scratch->question) - 1);
+    scratch->question_width = variant->widths[0];
+    text += strlen(text) + 1;
+    for (int i = 0; i < options; i++) {
+        strncpy(scratch->options[i], text, sizeof(scratch->options[i]) - 1);
+        scratch->option_widths[i] = variant->widths[1 + i];
+        text += strlen(text) + 1;
+    }
+    return scratch;
+}
+
+int locale_registry_init(LocaleRegistry *registry, const QuestionBank *base,
+                         const char *base_path) {
+    if (registry == NULL || base == NULL || base_path == NULL) {
+        return -1;
+    }
+    memset(registry, 0, sizeof(LocaleRegistry));
+    registry->base = base;
+    strncpy(registry->base_path, base_path, sizeof(registry->base_path) - 1);
+    if (pthread_mutex_init(&registry->lock, NULL) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Build "<dir>/<name>.<code>.json" from the base pack path
+ */
+static void locale_pack_path(const char *base_path, const char *code,
+                             char *path, size_t size) {
+    size_t len = strlen(base_path);
+    if (len > 5 && strcmp(base_path + len - 5, ".json") == 0) {
+        len -= 5;
+    }
+    snprintf(path, size, "%.*s.%s.json", (int)len, base_path, code);
+}
+
+static LocaleBank* locale_load_pack(const LocaleRegistry *registry, const char *code) {
+    char path[320];
+    locale_pack_path(registry->base_path, code, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        print_error("No question pack for locale %s (%s)", code, path);
+        return NULL;
+    }
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(file, &data, &len);
+    fclose(file);
+    if (err != UTILS_SUCCESS) {
+        print_error("Failed to read %s", path);
+        return NULL;
+    }
+
+    LocaleBank *locale = (LocaleBank*)malloc(sizeof(LocaleBank));
+    if (locale == NULL ||
+        locale_bank_load_from_buffer(locale, registry->base, code, data, len) < 0) {
+        free(locale);
+        free(data);
+        return NULL;
+    }
+    free(data);
+    return locale;
+}
+
+LocaleBank* locale_acquire(LocaleRegistry *registry, const char *code) {
+    if (registry == NULL || !valid_code(code)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&registry->lock);
+    int free_slot = -1;
+    for (int i = 0; i < MAX_LOCALES; i++) {
+        LocaleBank *locale = registry->locales[i];
+        if (locale == NULL) {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+        } else if (strcmp(locale->code, code) == 0) {
+            locale->refcount++;
+            pthread_mutex_unlock(&registry->lock);
+            return locale;
+        }
+    }
+
+    LocaleBank *locale = NULL;
+    if (free_slot < 0) {
+        print_error("Too many locales in use");
+    } else {
+        /* Loading under the lock keeps two sessions from loading one pack twice. */
+        double t0 = monotonic_ms();
+        locale = locale_load_pack(registry, code);
+        if (locale != NULL) {
+            locale->refcount = 1;
+            registry->locales[free_slot] = locale;
+
+            char metric[MAX_METRIC_NAME_LEN];
+            snprintf(metric, sizeof(metric), "locale.%s.load_ms", code);
+            metrics_set(metric, monotonic_ms() - t0);
+            snprintf(metric, sizeof(metric), "locale.%s.bytes", code);
+            metrics_set(metric, (double)(locale->pool_cap +
+                                         locale->variant_count * sizeof(LocaleVariant)));
+        }
+    }
+    pthread_mutex_unlock(&registry->lock);
+    return locale;
+}
+
+void locale_release(LocaleRegistry *registry, LocaleBank *locale) {
+    if (registry == NULL || locale == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&registry->lock);
+    if (--locale->refcount <= 0) {
+        for (int i = 0; i < MAX_LOCALES; i++) {
+            if (registry->locales[i] == locale) {
+                registry->locales[i] = NULL;
+            }
+        }
+        locale_bank_free(locale);
+        free(locale);
+    }
+    pthread_mutex_unlock(&registry->lock);
+}
+
+void locale_registry_free(LocaleRegistry *registry) {
+    if (registry == NULL) {
+        return;
+    }
+    for (int i = 0; i < MAX_LOCALES; i++) {
+        if (registry->locales[i] != NULL) {
+            locale_bank_free(registry->locales[i]);
+            free(registry->locales[i]);
+            registry->locales[i] = NULL;
+        }
+    }
+    pthread_mutex_destroy(&registry->lock);
+}
@@ -0,0 +1,136 @@
+/**
+ * @file locales.h
+ * @brief Translated question variants loaded per locale on demand
+ * 
+ * This module handles:
+ * - Loading a locale pack (questions.<code>.json next to the base pack)
+ *   the first time a session in that locale starts
+ * - Sharing one loaded locale between sessions with reference counting
+ * - Resolving a base question to its translated text
+ * 
+ * Locale packs carry only text keyed by question "id". Answer index,
+ * difficulty and category stay in the base bank and are held once, so
+ * memory grows with the locales in use rather than locales x questions.
+ */
+
+#ifndef LOCALES_H
+#define LOCALES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "questions.h"
+
+/**
+ * @brief Maximum number of locales loaded at once
+ */
+#define MAX_LOCALES 16
+
+/**
+ * @brief Maximum length of a locale code including the terminator
+ */
+#define MAX_LOCALE_CODE_LEN 8
+
+/**
+ * @brief Translated text of one base question
+ */
+typedef struct {
+    uint32_t offset;                         /**< Question text in the pool, UINT32_MAX if untranslated */
+    uint16_t widths[1 + MAX_OPTIONS];        /**< Display widths of question and options */
+} LocaleVariant;
+
+/**
+ * @brief All translated variants for one locale
+ */
+typedef struct {
+    char code[MAX_LOCALE_CODE_LEN];          /**< Locale code, e.g. "fr" */
+    LocaleVariant *variants;                 /**< One entry per base question */
+    size_t variant_count;                    /**< Number of base questions */
+    size_t translated;                       /**< Variants with text */
+    char *pool;                              /**< NUL-separated question and option text */
+    size_t pool_len;                         /**< Bytes used in pool */
+    size_t pool_cap;                         /**< Bytes allocated for pool */
+    int refcount;                            /**< Sessions currently using the locale */
+} LocaleBank;
+
+/**
+ * @brief Loaded locales for one base bank
+ */
+typedef struct {
+    const QuestionBank *base;                /**< Bank the variants translate */
+    char base_path[256];                     /**< Path of the base pack */
+    LocaleBank *locales[MAX_LOCALES];        /**< Loaded locales */
+    pthread_mutex_t lock;                    /**< Protects locales and refcounts */
+} LocaleRegistry;
+
+/**
+ * @brief Initialize a registry; no locale is loaded until acquired
+ * 
+ * @param registry Pointer to LocaleRegistry
+ * @param base Base bank the locale packs translate
+ * @param base_path Path of the base pack, e.g. "data/questions.json"
+ * @return int 0 on success, -1 on error
+ */
+int locale_registry_init(LocaleRegistry *registry, const QuestionBank *base,
+                         const char *base_path);
+
+/**
+ * @brief Get a locale, loading its pack on first use
+ * 
+ * @param registry Pointer to LocaleRegistry
+ * @param code Locale code (letters, digits, '-' or '_')
+ * @return LocaleBank* Shared locale, or NULL if the pack cannot be loaded
+ */
+LocaleBank* locale_acquire(LocaleRegistry *registry, const char *code);
+
+/**
+ * @brief Release a locale; it is freed when no session uses it
+ * 
+ * @param registry Pointer to LocaleRegistry
+ * @param locale Locale returned by locale_acquire()
+ */
+void locale_release(LocaleRegistry *registry, LocaleBank *locale);
+
+/**
+ * @brief Free every loaded locale
+ * 
+ * @param registry Pointer to LocaleRegistry
+ */
+void locale_registry_free(LocaleRegistry *registry);
+
+/**
+ * @brief Load translated variants from JSON text in memory
+ * 
+ * Variants whose ID is unknown or whose option count differs from the
+ * base question are skipped, so answer indices stay valid.
+ * 
+ * @param locale Pointer to LocaleBank to initialize
+ * @param base Base bank the variants translate
+ * @param code Locale code
+ * @param data JSON text
+ * @param len Length of data in bytes
+ * @return int Number of variants loaded, -1 on error
+ */
+int locale_bank_load_from_buffer(LocaleBank *locale, const QuestionBank *base,
+                                 const char *code, const char *data, size_t len);
+
+/**
+ * @brief Free a LocaleBank's memory
+ * 
+ * @param locale Pointer to LocaleBank
+ */
+void locale_bank_free(LocaleBank *locale);
+
+/**
+ * @brief Get a base question in a locale
+ * 
+ * @param locale Locale, or NULL for the base text
+ * @param base Base bank
+ * @param index Index of the question in the base bank
+ * @param scratch Storage for the translated copy
+ * @return const Question* The base question if untranslated, else scratch
+ */
+const Question* locale_resolve(const LocaleBank *locale, const QuestionBank *base,
+                               size_t index, Question *scratch);
+
+#endif /* LOCALES_H */
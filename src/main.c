@@ -20,7 +20,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "game.h"
+#ifdef TRIVIA_EMBEDDED_BANK
+#include "embedded.h"
+#endif
+#include "locales.h"
+#include "metrics.h"
+#include "pack.h"
+#include "paged.h"
 #include "questions.h"
 #include "utils.h"
 
@@ -29,6 +39,392 @@
  */
 #define DEFAULT_QUESTIONS_FILE "data/questions.json"
 
+/**
+ * @brief Maximum number of phases in the startup profile
+ */
+#define MAX_STARTUP_PHASES 16
+
+/**
+ * @brief Command line options
+ */
+typedef struct {
+    char questions_file[256];      /**< Questions file to load */
+    bool file_given;               /**< Whether questions_file came from the command line */
+    bool startup_profile;          /**< Print the startup phase breakdown */
+    bool dump_metrics;             /**< Print all metrics on exit */
+    char locale[MAX_LOCALE_CODE_LEN]; /**< Locale to play in (empty for base text) */
+    size_t memory_cap_mb;          /**< Play a pack out of core within this many MB (0: load it all) */
+    bool huge_pages;               /**< Back a mapped pack with transparent huge pages */
+    bool prefault;                 /**< Fault a mapped pack in from a background thread */
+    bool lock_memory;              /**< mlock() the bank's hot arrays */
+} Options;
+
+/**
+ * @brief Wall-clock time spent in each startup phase
+ */
+typedef struct {
+    const char *names[MAX_STARTUP_PHASES]; /**< Phase names in execution order */
+    double ms[MAX_STARTUP_PHASES];         /**< Duration of each phase */
+    bool background[MAX_STARTUP_PHASES];   /**< Ran alongside the other phases */
+    int count;                             /**< Number of recorded phases */
+    double start_ms;                       /**< Timestamp when main() started */
+    double mark_ms;                        /**< End of the previous phase */
+} StartupProfile;
+
+/**
+ * @brief Add a phase to the profile and publish it as a metric
+ * 
+ * @param profile Pointer to StartupProfile
+ * @param name Phase name
+ * @param ms Duration of the phase
+ * @param background Whether the phase overlapped the others
+ */
+static void startup_phase_record(StartupProfile *profile, const char *name, double ms,
+                                 bool background) {
+    if (profile->count < MAX_STARTUP_PHASES) {
+        profile->names[profile->count] = name;
+        profile->ms[profile->count] = ms;
+        profile->background[profile->count] = background;
+        profile->count++;
+    }
+    
+    char metric[MAX_METRIC_NAME_LEN];
+    snprintf(metric, sizeof(metric), "startup.%s_ms", name);
+    for (char *p = metric; *p != '\0'; p++) {
+        if (*p == ' ') {
+            *p = '_';
+        }
+    }
+    metrics_set(metric, ms);
+}
+
+/**
+ * @brief Close the current phase and record it in the profile and metrics
+ * 
+ * @param profile Pointer to StartupProfile
+ * @param name Phase name
+ */
+static void startup_phase_end(StartupProfile *profile, const char *name) {
+    double now = monotonic_ms();
+    double elapsed = now - profile->mark_ms;
+    profile->mark_ms = now;
+    startup_phase_record(profile, name, elapsed, false);
+}
+
+/**
+ * @brief Close a phase that ended @p ms after the current mark
+ * 
+ * For steps timed inside a library call; the next phase starts where
+ * this one ended.
+ * 
+ * @param profile Pointer to StartupProfile
+ * @param name Phase name
+ * @param ms Duration of the phase
+ */
+static void startup_phase_split(StartupProfile *profile, const char *name, double ms) {
+    profile->mark_ms += ms;
+    startup_phase_record(profile, name, ms, false);
+}
+
+/**
+ * @brief Record work done by a background thread during startup
+ * 
+ * Background phases overlap the others and do not move the phase mark.
+ * 
+ * @param profile Pointer to StartupProfile
+ * @param name Phase name
+ * @param ms Time the thread spent
+ */
+static void startup_phase_background(StartupProfile *profile, const char *name, double ms) {
+    startup_phase_record(profile, name, ms, true);
+}
+
+/**
+ * @brief Print the startup phase breakdown
+ * 
+ * @param profile Pointer to StartupProfile
+ * @param total_ms Time from main() to the first menu
+ */
+static void startup_profile_print(const StartupProfile *profile, double total_ms) {
+    printf("\nStartup profile:\n");
+    for (int i = 0; i < profile->count; i++) {
+        if (profile->background[i]) {
+            printf("  %-16s %10.3f ms  (background)\n", profile->names[i], profile->ms[i]);
+            continue;
+        }
+        double share = total_ms > 0.0 ? profile->ms[i] / total_ms * 100.0 : 0.0;
+        printf("  %-16s %10.3f ms  %5.1f%%\n", profile->names[i], profile->ms[i], share);
+    }
+    printf("  %-16s %10.3f ms\n", "total to menu", total_ms);
+}
+
+/**
+ * @brief Print command line usage
+ * 
+ * @param prog Program name
+ */
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--startup-profile] [--metrics] [--locale CODE] [--memory-cap MB] "
+           "[--huge-pages] [--prefault] [--mlock] [questions_file]\n", prog);
+}
+
+/**
+ * @brief Parse command line arguments
+ * 
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments
+ * @param options Receives the parsed options
+ * @return int 0 on success, -1 on error
+ */
+static int parse_args(int argc, char *argv[], Options *options) {
+    strncpy(options->questions_file, DEFAULT_QUESTIONS_FILE, sizeof(options->questions_file) - 1);
+    options->questions_file[sizeof(options->questions_file) - 1] = '\0';
+    options->file_given = false;
+    options->startup_profile = false;
+    options->dump_metrics = false;
+    options->locale[0] = '\0';
+    options->memory_cap_mb = 0;
+    options->huge_pages = false;
+    options->prefault = false;
+    options->lock_memory = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--startup-profile") == 0) {
+            options->startup_profile = true;
+        } else if (strcmp(argv[i], "--metrics") == 0) {
+            options->dump_metrics = true;
+        } else if (strcmp(argv[i], "--locale") == 0 && i + 1 < argc) {
+            strncpy(options->locale, argv[++i], sizeof(options->locale) - 1);
+            options->locale[sizeof(options->locale) - 1] = '\0';
+        } else if (strcmp(argv[i], "--memory-cap") == 0 && i + 1 < argc) {
+            int mb = 0;
+            if (!is_valid_integer(argv[++i], &mb) || mb <= 0) {
+                print_error("Invalid memory cap: %s", argv[i]);
+                return -1;
+            }
+            options->memory_cap_mb = (size_t)mb;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            options->huge_pages = true;
+        } else if (strcmp(argv[i], "--prefault") == 0) {
+            options->prefault = true;
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            options->lock_memory = true;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            print_error("Unknown option: %s", argv[i]);
+            return -1;
+        } else {
+            strncpy(options->questions_file, argv[i], sizeof(options->questions_file) - 1);
+            options->questions_file[sizeof(options->questions_file) - 1] = '\0';
+            options->file_given = true;
+        }
+    }
+    
+    return 0;
+}
+
+#ifdef TRIVIA_EMBEDDED_BANK
+/**
+ * @brief Load the bank compiled into the executable, timing each phase
+ * 
+ * The embedded records were deduplicated and checked at build time, so
+ * only the copy into the bank and the index build remain.
+ * 
+ * @param bank Pointer to initialized QuestionBank
+ * @param profile Pointer to StartupProfile
+ * @return int Number of questions loaded, -1 on error
+ */
+static int load_embedded_bank(QuestionBank *bank, StartupProfile *profile) {
+    int loaded = pack_load_records(bank, embedded_records, embedded_record_count,
+                                 (const char*)embedded_pool);
+    startup_phase_end(profile, "embedded copy");
+    if (loaded < 0 || question_bank_build_index(bank) != 0) {
+        return -1;
+    }
+    startup_phase_end(profile, "index build");
+    
+    metrics_set("bank.questions", (double)bank->count);
+    metrics_set("bank.file_bytes", 0.0);
+    return loaded;
+}
+#endif
+
+/**
+ * @brief Join the prefault thread, if any, record its time and unmap the pack
+ * 
+ * @param map Mapping from load_mapped_pack() (unmapped or zeroed is fine)
+ * @param profile Pointer to StartupProfile
+ * @param print Whether to print the prefault time as a profile line
+ */
+static void unmap_pack(PackMapping *map, StartupProfile *profile, bool print) {
+    if (map->prefaulting) {
+        pack_map_prefault_wait(map);
+        startup_phase_background(profile, "prefault", map->prefault_ms);
+        if (print) {
+            printf("\n  %-16s %10.3f ms  (background, joined at exit)\n", "prefault",
+                   map->prefault_ms);
+        }
+    }
+    pack_unmap(map);
+}
+
+/**
+ * @brief Map a binary pack and play it in place, timing each phase
+ * 
+ * The mapping stays alive for the whole run: every question is read from
+ * it, so huge pages and prefaulting apply to the pages draws touch.
+ * 
+ * @param paged Receives the bank over the mapping
+ * @param map Receives the mapping; unmapped again on failure
+ * @param fd Open pack file
+ * @param options Command line options
+ * @param profile Pointer to StartupProfile
+ * @return int Number of questions, -1 on error
+ */
+static int load_mapped_pack(PagedBank *paged, PackMapping *map, int fd,
+                            const Options *options, StartupProfile *profile) {
+    int rc = pack_map(map, fd, options->huge_pages);
+    startup_phase_end(profile, "map");
+    if (rc != 0) {
+        print_error("Failed to map questions file: %s", options->questions_file);
+        return -1;
+    }
+    metrics_set("bank.file_bytes", (double)map->len);
+    
+    if (options->huge_pages) {
+        if (pack_map_huge_pages(map) != 0) {
+            print_error("Huge pages not available for the pack: %s", strerror(errno));
+        }
+        startup_phase_end(profile, "huge pages");
+    }
+    if (options->prefault && pack_map_prefault_start(map) != 0) {
+        print_error("Failed to start the prefault thread");
+    }
+    
+    /* The prefault thread keeps running through the menu and the game;
+     * unmap_pack() joins it. */
+    int loaded = paged_bank_open_mapped(paged, map);
+    startup_phase_end(profile, "open pack");
+    if (loaded < 0) {
+        unmap_pack(map, profile, false);
+        return -1;
+    }
+    metrics_set("bank.questions", (double)loaded);
+    return loaded;
+}
+
+/**
+ * @brief Map a binary pack and copy its questions into @p bank
+ * 
+ * For locales, whose variants resolve against an in-memory bank.
+ * 
+ * @param bank Pointer to initialized QuestionBank
+ * @param fd Open pack file
+ * @param options Command line options
+ * @param profile Pointer to StartupProfile
+ * @return int Number of questions loaded, -1 on error
+ */
+static int copy_mapped_pack(QuestionBank *bank, int fd, const Options *options,
+                            StartupProfile *profile) {
+    PackMapping map;
+    int rc = pack_map(&map, fd, false);
+    startup_phase_end(profile, "map");
+    if (rc != 0) {
+        print_error("Failed to map questions file: %s", options->questions_file);
+        return -1;
+    }
+    metrics_set("bank.file_bytes", (double)map.len);
+    
+    int loaded = pack_load_from_buffer(bank, map.data, map.len);
+    startup_phase_end(profile, "parse");
+    pack_unmap(&map);
+    return loaded;
+}
+
+/**
+ * @brief Load, clean up and index the question bank, timing each phase
+ * 
+ * Binary packs are mapped and played in place through @p paged, leaving
+ * @p map mapped; with a locale they are copied into @p bank instead. JSON
+ * files are read into memory.
+ * 
+ * @param bank Pointer to initialized QuestionBank
+ * @param paged Receives the bank over a pack played in place
+ * @param map Receives the mapping of a pack played in place
+ * @param options Command line options
+ * @param profile Pointer to StartupProfile
+ * @return int Number of playable questions, -1 on error
+ */
+static int load_question_bank(QuestionBank *bank, PagedBank *paged, PackMapping *map,
+                              const Options *options, StartupProfile *profile) {
+    const char *filename = options->questions_file;
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    char magic[4];
+    bool is_pack = fd >= 0 && pread(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+                   pack_is_pack(magic, sizeof(magic));
+    startup_phase_end(profile, "open");
+    if (fd < 0) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    
+    int loaded;
+    if (is_pack && options->locale[0] == '\0') {
+        loaded = load_mapped_pack(paged, map, fd, options, profile);
+        close(fd);
+        return loaded;
+    }
+    if (is_pack) {
+        if (options->huge_pages || options->prefault) {
+            print_error("--huge-pages and --prefault only apply to a pack played without --locale");
+        }
+        loaded = copy_mapped_pack(bank, fd, options, profile);
+        close(fd);
+    } else {
+        FILE *file = fdopen(fd, "r");
+        char *data = NULL;
+        size_t len = 0;
+        UtilsError err = file != NULL ? read_stream(file, &data, &len) : UTILS_ERROR_IO_FAILED;
+        if (file != NULL) {
+            fclose(file);
+        } else {
+            close(fd);
+        }
+        startup_phase_end(profile, "read");
+        if (err != UTILS_SUCCESS) {
+            print_error("Failed to read questions file: %s", filename);
+            return -1;
+        }
+        metrics_set("bank.file_bytes", (double)len);
+        
+        loaded = question_bank_load_from_buffer(bank, data, len);
+        free(data);
+        startup_phase_end(profile, "parse");
+    }
+    if (loaded < 0) {
+        return -1;
+    }
+    
+    QuestionPrepareReport report;
+    int prepared = question_bank_prepare(bank, &report);
+    startup_phase_split(profile, "dedup", report.dedup_ms);
+    startup_phase_split(profile, "validate", report.validate_ms);
+    startup_phase_end(profile, "index build");
+    if (prepared < 0) {
+        return -1;
+    }
+    if (report.duplicates > 0) {
+        printf("Removed %d duplicate question(s)\n", report.duplicates);
+    }
+    if (report.invalid > 0) {
+        printf("Removed %d invalid question(s)\n", report.invalid);
+    }
+    
+    metrics_set("bank.questions", (double)bank->count);
+    metrics_set("bank.duplicates_removed", report.duplicates);
+    metrics_set("bank.invalid_removed", report.invalid);
+    return prepared;
+}
+
 /**
  * @brief Get number of players from user
  * 
@@ -136,12 +532,17 @@ static int display_menu(void) {
  * @return int Exit code (0 on success)
  */
 int main(int argc, char *argv[]) {
-    char questions_file[256] = DEFAULT_QUESTIONS_FILE;
+    StartupProfile profile;
+    profile.count = 0;
+    profile.start_ms = monotonic_ms();
+    profile.mark_ms = profile.start_ms;
     
-    if (argc > 1) {
-        strncpy(questions_file, argv[1], sizeof(questions_file) - 1);
-        questions_file[sizeof(questions_file) - 1] = '\0';
+    Options options;
+    if (parse_args(argc, argv, &options) != 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
     }
+    startup_phase_end(&profile, "argument parsing");
     
     QuestionBank bank;
     if (question_bank_init(&bank) != 0) {
@@ -149,18 +550,84 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     
-    printf("Loading questions from: %s\n", questions_file);
-    int loaded = question_bank_load_from_json(&bank, questions_file);
+    PagedBank paged;
+    PackMapping map;
+    memset(&map, 0, sizeof(map));
+    bool use_paged = options.memory_cap_mb > 0;
+#ifdef TRIVIA_EMBEDDED_BANK
+    bool use_embedded = !options.file_given && !use_paged;
+#else
+    bool use_embedded = false;
+#endif
+    if (use_embedded) {
+        printf("Loading the built-in question bank\n");
+    } else {
+        printf("Loading questions from: %s\n", options.questions_file);
+    }
+    int loaded;
+    if (use_paged) {
+        if (options.locale[0] != '\0') {
+            print_error("--locale is not available with --memory-cap");
+            question_bank_free(&bank);
+            return EXIT_FAILURE;
+        }
+        loaded = paged_bank_open(&paged, options.questions_file, options.memory_cap_mb << 20);
+        startup_phase_end(&profile, "open pack");
+        if (loaded >= 0) {
+            metrics_set("bank.questions", (double)loaded);
+            metrics_set("paged.resident_bytes", (double)paged.resident_bytes);
+        }
+#ifdef TRIVIA_EMBEDDED_BANK
+    } else if (use_embedded) {
+        loaded = load_embedded_bank(&bank, &profile);
+#endif
+    } else {
+        loaded = load_question_bank(&bank, &paged, &map, &options, &profile);
+        /* A pack played in place keeps its mapping. */
+        use_paged = map.data != NULL;
+    }
     
     if (loaded <= 0) {
         print_error("Failed to load questions or no questions found");
         print_error("Please ensure the questions file exists and is properly formatted");
+        if (use_paged && loaded == 0) {
+            paged_bank_close(&paged);
+        }
+        unmap_pack(&map, &profile, false);
         question_bank_free(&bank);
         return EXIT_FAILURE;
     }
     
     print_success("Loaded %d questions", loaded);
     
+    if (options.lock_memory) {
+        int locked = use_paged ? paged_bank_lock(&paged) : question_bank_lock(&bank);
+        startup_phase_end(&profile, "mlock");
+        if (locked != 0) {
+            print_error("Failed to lock the question bank in memory: %s", strerror(errno));
+        }
+        metrics_set("bank.locked_bytes",
+                    (double)(use_paged ? paged.locked_bytes : bank.locked_bytes));
+    }
+    
+    LocaleRegistry locales;
+    if (locale_registry_init(&locales, &bank, options.questions_file) != 0) {
+        print_error("Failed to initialize locales");
+        if (use_paged) {
+            paged_bank_close(&paged);
+        }
+        unmap_pack(&map, &profile, false);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    
+    double total_ms = monotonic_ms() - profile.start_ms;
+    metrics_set("startup.total_ms", total_ms);
+    if (options.startup_profile) {
+        startup_profile_print(&profile, total_ms);
+        wait_for_enter();
+    }
+    
     bool running = true;
     while (running) {
         int choice = display_menu();
@@ -188,6 +655,7 @@ int main(int argc, char *argv[]) {
         config.time_per_question = 30;
         config.use_timer = true;
         config.num_players = num_players;
+        config.shuffle_options = true;
         
         switch (choice) {
             case 1:
@@ -205,7 +673,9 @@ int main(int argc, char *argv[]) {
         }
         
         GameState game;
-        if (game_init(&game, &bank, &config) != 0) {
+        int init = use_paged ? game_init_paged(&game, &paged, &config)
+                             : game_init(&game, &bank, &config);
+        if (init != 0) {
             print_error("Failed to initialize game");
             wait_for_enter();
             continue;
@@ -215,13 +685,42 @@ int main(int argc, char *argv[]) {
             get_player_names(&game);
         }
         
+        /* The locale pack is only loaded while a game in it is running. */
+        LocaleBank *locale = NULL;
+        if (options.locale[0] != '\0') {
+            locale = locale_acquire(&locales, options.locale);
+            if (locale == NULL) {
+                printf("Playing with the original question text.\n");
+            }
+        }
+        game.locale = locale;
+        
         game_run(&game);
         game_cleanup(&game);
+        locale_release(&locales, locale);
         
         wait_for_enter();
     }
     
+    locale_registry_free(&locales);
     question_bank_free(&bank);
+    if (use_paged) {
+        if (map.data == NULL) {
+            PagedStats stats;
+            paged_bank_stats(&paged, &stats);
+            metrics_set("paged.hits", (double)stats.hits);
+            metrics_set("paged.misses", (double)stats.misses);
+            metrics_set("paged.prefetched", (double)stats.prefetched);
+            metrics_set("paged.evictions", (double)stats.evictions);
+        }
+        paged_bank_close(&paged);
+    }
+    unmap_pack(&map, &profile, options.startup_profile);
+    
+    if (options.dump_metrics) {
+        printf("\nMetrics:\n");
+        metrics_dump(stdout);
+    }
     
     printf("\nThank you for playing Terminal Trivia Game!\n");
     return EXIT_SUCCESS;
@@ -0,0 +1,97 @@
+/**
+ * @file metrics.c
+ * @brief Implementation of the process-wide metrics registry
+ */
+
+#include "metrics.h"
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    char name[MAX_METRIC_NAME_LEN];
+    double value;
+} Metric;
+
+static Metric metrics[MAX_METRICS];
+static int metric_count = 0;
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Find or create a metric; caller holds metrics_mutex
+ */
+static Metric* metrics_lookup(const char *name, int create) {
+    for (int i = 0; i < metric_count; i++) {
+        if (strcmp(metrics[i].name, name) == 0) {
+            return &metrics[i];
+        }
+    }
+    if (!create || metric_count >= MAX_METRICS) {
+        return NULL;
+    }
+    Metric *m = &metrics[metric_count++];
+    strncpy(m->name, name, sizeof(m->name) - 1);
+    m->name[sizeof(m->name) - 1] = '\0';
+    m->value = 0.0;
+    return m;
+}
+
+int metrics_set(const char *name, double value) {
+    if (name == NULL) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    Metric *m = metrics_lookup(name, 1);
+    if (m != NULL) {
+        m->value = value;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+    
+    return m != NULL ? 0 : -1;
+}
+
+int metrics_add(const char *name, double delta) {
+    if (name == NULL) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    Metric *m = metrics_lookup(name, 1);
+    if (m != NULL) {
+        m->value += delta;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+    
+    return m != NULL ? 0 : -1;
+}
+
+double metrics_get(const char *name) {
+    if (name == NULL) {
+        return 0.0;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    Metric *m = metrics_lookup(name, 0);
+    double value = m != NULL ? m->value : 0.0;
+    pthread_mutex_unlock(&metrics_mutex);
+    
+    return value;
+}
+
+void metrics_dump(FILE *out) {
+    if (out == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    for (int i = 0; i < metric_count; i++) {
+        fprintf(out, "%s %.3f\n", metrics[i].name, metrics[i].value);
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+}
+
+void metrics_reset(void) {
+    pthread_mutex_lock(&metrics_mutex);
+    metric_count = 0;
+    pthread_mutex_unlock(&metrics_mutex);
+}
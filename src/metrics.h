@@ -0,0 +1,64 @@
+/**
+ * @file metrics.h
+ * @brief Process-wide named metrics
+ * 
+ * This module provides:
+ * - A small registry of named numeric values (timings, counters, gauges)
+ * - Thread-safe set/add access
+ * - A plain-text dump for operators
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+/**
+ * @brief Maximum number of distinct metrics
+ */
+#define MAX_METRICS 128
+
+/**
+ * @brief Maximum length of a metric name
+ */
+#define MAX_METRIC_NAME_LEN 64
+
+/**
+ * @brief Set a metric to a value, creating it if needed
+ * 
+ * @param name Metric name (e.g. "startup.parse_ms")
+ * @param value New value
+ * @return int 0 on success, -1 if the registry is full
+ */
+int metrics_set(const char *name, double value);
+
+/**
+ * @brief Add to a metric, creating it at zero if needed
+ * 
+ * @param name Metric name
+ * @param delta Amount to add
+ * @return int 0 on success, -1 if the registry is full
+ */
+int metrics_add(const char *name, double delta);
+
+/**
+ * @brief Get the current value of a metric
+ * 
+ * @param name Metric name
+ * @return double Value, or 0.0 if the metric does not exist
+ */
+double metrics_get(const char *name);
+
+/**
+ * @brief Write all metrics as "name value" lines
+ * 
+ * @param out Output stream
+ */
+void metrics_dump(FILE *out);
+
+/**
+ * @brief Remove all metrics
+ */
+void metrics_reset(void);
+
+#endif /* METRICS_H */
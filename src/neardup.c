@@ -0,0 +1,414 @@
+/**
+ * @file neardup.c
+ * @brief Near-duplicate question detection with MinHash and LSH
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "neardup.h"
+#include "metrics.h"
+#include "search.h"
+#include "utils.h"
+
+#define LSH_ROWS (MINHASH_SIZE / LSH_BANDS)
+
+/** Words that carry no meaning for duplicate detection. */
+static const char *const STOPWORDS[] = {
+    "a", "about", "an", "and", "are", "as", "at", "be", "by", "called",
+    "did", "do", "does", "for", "from", "has", "have", "how", "in", "is",
+    "it", "its", "known", "name", "of", "on", "or", "the", "this", "to",
+    "was", "were", "what", "whats", "which", "who", "whom", "whose", "with"
+};
+
+/**
+ * @brief Signature being built and the per-function hash seeds
+ */
+typedef struct {
+    MinHashSignature *sig;
+    uint64_t seeds[MINHASH_SIZE];
+} SignatureContext;
+
+/**
+ * @brief Question key of one band, sorted to find equal buckets
+ */
+typedef struct {
+    uint64_t key;
+    uint32_t doc;
+} BandEntry;
+
+/**
+ * @brief Candidate pair that passed the similarity check
+ */
+typedef struct {
+    uint32_t a;
+    uint32_t b;
+} DupPair;
+
+/**
+ * @brief Workers running right now and the most that ever ran at once
+ */
+typedef struct {
+    atomic_int active;
+    atomic_int peak;
+} WorkerGauge;
+
+typedef struct {
+    WorkerGauge *gauge;
+    const QuestionBank *bank;
+    MinHashSignature *sigs;
+    size_t begin;
+    size_t end;
+} SignatureJob;
+
+typedef struct {
+    WorkerGauge *gauge;
+    const MinHashSignature *sigs;
+    size_t count;
+    double threshold;
+    int band_begin;
+    int band_end;
+    DupPair *pairs;
+    size_t pair_count;
+    size_t pair_cap;
+    int failed;
+} BandJob;
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static bool is_stopword(const char *token, size_t len) {
+    if (len < 2) {
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(STOPWORDS) / sizeof(STOPWORDS[0]); i++) {
+        if (strlen(STOPWORDS[i]) == len && memcmp(STOPWORDS[i], token, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void hash_token(const char *token, size_t len, int position, void *ctx) {
+    (void)position;
+    if (is_stopword(token, len)) {
+        return;
+    }
+
+    SignatureContext *sc = (SignatureContext*)ctx;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)token[i];
+        h *= 1099511628211ULL;
+    }
+
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        uint32_t v = (uint32_t)mix64(h ^ sc->seeds[k]);
+        if (v < sc->sig->values[k]) {
+            sc->sig->values[k] = v;
+        }
+    }
+    sc->sig->empty = false;
+}
+
+void minhash_signature(const Question *question, MinHashSignature *sig) {
+    SignatureContext sc;
+    sc.sig = sig;
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        sc.seeds[k] = mix64(0x9e3779b97f4a7c15ULL * (uint64_t)(k + 1));
+        sig->values[k] = UINT32_MAX;
+    }
+    sig->empty = true;
+
+    /* The correct answer is part of the content: the same wording with a
+     * different answer is a different question. */
+    search_tokenize(question->question, hash_token, &sc);
+    if (question->correct_answer >= 0 && question->correct_answer < MAX_OPTIONS) {
+        search_tokenize(question->options[question->correct_answer], hash_token, &sc);
+    }
+}
+
+double minhash_similarity(const MinHashSignature *a, const MinHashSignature *b) {
+    if (a->empty || b->empty) {
+        return 0.0;
+    }
+    int equal = 0;
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        equal += a->values[k] == b->values[k];
+    }
+    return (double)equal / MINHASH_SIZE;
+}
+
+static void gauge_enter(WorkerGauge *gauge) {
+    int active = atomic_fetch_add(&gauge->active, 1) + 1;
+    int peak = atomic_load(&gauge->peak);
+    while (active > peak && !atomic_compare_exchange_weak(&gauge->peak, &peak, active)) {
+    }
+}
+
+static void gauge_leave(WorkerGauge *gauge) {
+    atomic_fetch_sub(&gauge->active, 1);
+}
+
+static void* signature_worker(void *arg) {
+    SignatureJob *job = (SignatureJob*)arg;
+    gauge_enter(job->gauge);
+    for (size_t i = job->begin; i < job->end; i++) {
+        minhash_signature(&job->bank->questions[i], &job->sigs[i]);
+    }
+    gauge_leave(job->gauge);
+    return NULL;
+}
+
+static int compare_band_entries(const void *a, const void *b) {
+    const BandEntry *ea = (const BandEntry*)a;
+    const BandEntry *eb = (const BandEntry*)b;
+    if (ea->key != eb->key) {
+        return ea->key < eb->key ? -1 : 1;
+    }
+    return ea->doc < eb->doc ? -1 : (ea->doc > eb->doc);
+}
+
+static int push_pair(BandJob *job, uint32_t a, uint32_t b) {
+    if (job->pair_count == job->pair_cap) {
+        size_t cap = job->pair_cap > 0 ? job->pair_cap * 2 : 64;
+        DupPair *pairs = (DupPair*)realloc(job->pairs, cap * sizeof(DupPair));
+        if (pairs == NULL) {
+            return -1;
+        }
+        job->pairs = pairs;
+        job->pair_cap = cap;
+    }
+    job->pairs[job->pair_count].a = a;
+    job->pairs[job->pair_count].b = b;
+    job->pair_count++;
+    return 0;
+}
+
+/**
+ * @brief Find similar pairs in a range of bands
+ *
+ * Within a bucket each question is only compared with the bucket's first
+ * question and its predecessor, which keeps large buckets of identical
+ * questions linear while still chaining them into one cluster.
+ */
+static void* band_worker(void *arg) {
+    BandJob *job = (BandJob*)arg;
+    BandEntry *entries = (BandEntry*)malloc((job->count > 0 ? job->count : 1) * sizeof(BandEntry));
+    if (entries == NULL) {
+        job->failed = 1;
+        return NULL;
+    }
+    gauge_enter(job->gauge);
+
+    for (int band = job->band_begin; band < job->band_end && !job->failed; band++) {
+        size_t n = 0;
+        for (size_t i = 0; i < job->count; i++) {
+            const MinHashSignature *sig = &job->sigs[i];
+            if (sig->empty) {
+                continue;
+            }
+            uint64_t key = (uint64_t)band;
+            for (int r = 0; r < LSH_ROWS; r++) {
+                key = mix64(key ^ sig->values[band * LSH_ROWS + r]);
+            }
+            entries[n].key = key;
+            entries[n].doc = (uint32_t)i;
+            n++;
+        }
+        qsort(entries, n, sizeof(BandEntry), compare_band_entries);
+
+        size_t head = 0;
+        for (size_t i = 1; i < n; i++) {
+            if (entries[i].key != entries[head].key) {
+                head = i;
+                continue;
+            }
+            uint32_t doc = entries[i].doc;
+            uint32_t first = entries[head].doc;
+            uint32_t prev = entries[i - 1].doc;
+            if (minhash_similarity(&job->sigs[first], &job->sigs[doc]) >= job->threshold) {
+                if (push_pair(job, first, doc) != 0) {
+                    job->failed = 1;
+                    break;
+                }
+            } else if (prev != first &&
+                       minhash_similarity(&job->sigs[prev], &job->sigs[doc]) >= job->threshold) {
+                if (push_pair(job, prev, doc) != 0) {
+                    job->failed = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    gauge_leave(job->gauge);
+    free(entries);
+    return NULL;
+}
+
+/**
+ * @brief Run @p count jobs of @p job_size bytes each, one per thread
+ *
+ * Jobs 1..count-1 get their own threads before job 0 runs on the calling
+ * thread, so every job of a phase runs at the same time. A job whose
+ * thread cannot be created runs inline.
+ */
+static void run_jobs(void *jobs, size_t job_size, int count, void *(*worker)(void*)) {
+    char *base = (char*)jobs;
+    pthread_t tids[LSH_BANDS];
+    bool started[LSH_BANDS];
+    for (int t = 1; t < count; t++) {
+        started[t] = pthread_create(&tids[t], NULL, worker, base + (size_t)t * job_size) == 0;
+        if (!started[t]) {
+            worker(base + (size_t)t * job_size);
+        }
+    }
+    worker(base);
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        }
+    }
+}
+
+static size_t find_root(size_t *parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void union_sets(size_t *parent, size_t a, size_t b) {
+    size_t ra = find_root(parent, a);
+    size_t rb = find_root(parent, b);
+    /* The earliest question in the bank stays the representative. */
+    if (ra < rb) {
+        parent[rb] = ra;
+    } else if (rb < ra) {
+        parent[ra] = rb;
+    }
+}
+
+int neardup_find_clusters(const QuestionBank *bank, double threshold, int threads,
+                          NearDupResult *result) {
+    if (bank == NULL || result == NULL) {
+        return -1;
+    }
+    memset(result, 0, sizeof(NearDupResult));
+    if (bank->count > UINT32_MAX) {
+        print_error("Bank too large for near-duplicate detection");
+        return -1;
+    }
+
+    size_t count = bank->count;
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > LSH_BANDS) {
+        threads = LSH_BANDS;
+    }
+
+    MinHashSignature *sigs = (MinHashSignature*)malloc((count > 0 ? count : 1) * sizeof(MinHashSignature));
+    size_t *parent = (size_t*)malloc((count > 0 ? count : 1) * sizeof(size_t));
+    SignatureJob sig_jobs[LSH_BANDS];
+    BandJob band_jobs[LSH_BANDS];
+    WorkerGauge gauge;
+    atomic_init(&gauge.active, 0);
+    atomic_init(&gauge.peak, 0);
+    if (sigs == NULL || parent == NULL) {
+        print_error("Failed to allocate near-duplicate state");
+        free(sigs);
+        free(parent);
+        return -1;
+    }
+
+    /* Signatures: contiguous question ranges per thread. */
+    for (int t = 0; t < threads; t++) {
+        sig_jobs[t].gauge = &gauge;
+        sig_jobs[t].bank = bank;
+        sig_jobs[t].sigs = sigs;
+        sig_jobs[t].begin = count * (size_t)t / (size_t)threads;
+        sig_jobs[t].end = count * (size_t)(t + 1) / (size_t)threads;
+    }
+    run_jobs(sig_jobs, sizeof(SignatureJob), threads, signature_worker);
+
+    /* Banding: each thread owns a range of bands and its own pair list. */
+    for (int t = 0; t < threads; t++) {
+        memset(&band_jobs[t], 0, sizeof(BandJob));
+        band_jobs[t].gauge = &gauge;
+        band_jobs[t].sigs = sigs;
+        band_jobs[t].count = count;
+        band_jobs[t].threshold = threshold;
+        band_jobs[t].band_begin = LSH_BANDS * t / threads;
+        band_jobs[t].band_end = LSH_BANDS * (t + 1) / threads;
+    }
+    run_jobs(band_jobs, sizeof(BandJob), threads, band_worker);
+    metrics_set("neardup.peak_workers", (double)atomic_load(&gauge.peak));
+
+    int rc = 0;
+    for (size_t i = 0; i < count; i++) {
+        parent[i] = i;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (band_jobs[t].failed) {
+            rc = -1;
+        }
+        for (size_t p = 0; p < band_jobs[t].pair_count; p++) {
+            union_sets(parent, band_jobs[t].pairs[p].a, band_jobs[t].pairs[p].b);
+        }
+        free(band_jobs[t].pairs);
+    }
+    free(sigs);
+
+    if (rc != 0) {
+        print_error("Failed to allocate near-duplicate candidates");
+        free(parent);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        parent[i] = find_root(parent, i);
+        if (parent[i] != i) {
+            result->duplicates++;
+        }
+    }
+
+    /* A representative heads a cluster if anything points at it. */
+    bool *has_members = (bool*)calloc(count > 0 ? count : 1, sizeof(bool));
+    if (has_members == NULL) {
+        free(parent);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (parent[i] != i && !has_members[parent[i]]) {
+            has_members[parent[i]] = true;
+            result->clusters++;
+        }
+    }
+    free(has_members);
+
+    result->cluster_of = parent;
+    result->count = count;
+    return 0;
+}
+
+void neardup_result_free(NearDupResult *result) {
+    if (result == NULL) {
+        return;
+    }
+    free(result->cluster_of);
+    result->cluster_of = NULL;
+    result->count = 0;
+    result->clusters = 0;
+    result->duplicates = 0;
+}
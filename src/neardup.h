@@ -0,0 +1,94 @@
+/**
+ * @file neardup.h
+ * @brief Near-duplicate question detection with MinHash and LSH
+ * 
+ * This module handles:
+ * - MinHash signatures over the content words of a question and its
+ *   correct answer
+ * - Locality-sensitive hashing (banding) to find candidate pairs
+ * - Grouping near-duplicates into clusters with union-find
+ * 
+ * Candidate generation sorts one key per question per band, so the whole
+ * bank is clustered in roughly linear time instead of comparing every pair.
+ */
+
+#ifndef NEARDUP_H
+#define NEARDUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "questions.h"
+
+/**
+ * @brief Number of hash functions in a MinHash signature
+ */
+#define MINHASH_SIZE 64
+
+/**
+ * @brief Number of LSH bands (MINHASH_SIZE / LSH_BANDS rows per band)
+ */
+#define LSH_BANDS 16
+
+/**
+ * @brief Default estimated Jaccard similarity for a near-duplicate
+ */
+#define NEARDUP_DEFAULT_THRESHOLD 0.6
+
+/**
+ * @brief MinHash signature of one question
+ */
+typedef struct {
+    uint32_t values[MINHASH_SIZE];   /**< Minimum hash per hash function */
+    bool empty;                      /**< No content words were found */
+} MinHashSignature;
+
+/**
+ * @brief Near-duplicate clusters over a bank
+ */
+typedef struct {
+    size_t *cluster_of;              /**< Cluster representative per question */
+    size_t count;                    /**< Number of questions */
+    size_t clusters;                 /**< Clusters with two or more questions */
+    size_t duplicates;               /**< Questions that are not their representative */
+} NearDupResult;
+
+/**
+ * @brief Compute the MinHash signature of a question
+ * 
+ * @param question Pointer to Question
+ * @param sig Receives the signature
+ */
+void minhash_signature(const Question *question, MinHashSignature *sig);
+
+/**
+ * @brief Estimate the Jaccard similarity of two signatures
+ * 
+ * @param a First signature
+ * @param b Second signature
+ * @return double Fraction of matching hash values (0.0-1.0)
+ */
+double minhash_similarity(const MinHashSignature *a, const MinHashSignature *b);
+
+/**
+ * @brief Cluster near-duplicate questions in a bank
+ * 
+ * Publishes the most worker threads that ran at once as the
+ * "neardup.peak_workers" metric.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @param threshold Minimum estimated similarity to join a cluster
+ * @param threads Worker threads for signatures and banding (<=0 for one)
+ * @param result Receives the clusters; free with neardup_result_free()
+ * @return int 0 on success, -1 on error
+ */
+int neardup_find_clusters(const QuestionBank *bank, double threshold, int threads,
+                          NearDupResult *result);
+
+/**
+ * @brief Free a NearDupResult
+ * 
+ * @param result Pointer to NearDupResult
+ */
+void neardup_result_free(NearDupResult *result);
+
+#endif /* NEARDUP_H */
@@ -0,0 +1,250 @@
+/**
+ * @file pack.c
+ * @brief Binary question pack reader
+ */
+
+#include "pack.h"
+#include "probes.h"
+#include "utf8.h"
+#include "utils.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(PackHeader) == 32, "PackHeader layout changed");
+_Static_assert(sizeof(PackRecord) == 40, "PackRecord layout changed");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Pack records are read in place and require a little-endian host"
+#endif
+
+static const PackRecord* pack_records(const void *data) {
+    return (const PackRecord*)((const char*)data + sizeof(PackHeader));
+}
+
+bool pack_is_pack(const void *data, size_t len) {
+    return data != NULL && len >= 4 && memcmp(data, PACK_MAGIC, 4) == 0;
+}
+
+bool pack_record_valid(const PackRecord *r, uint64_t pool_len) {
+    if (r->option_count < 2 || r->option_count > MAX_OPTIONS ||
+        r->correct >= r->option_count || r->difficulty >= DIFFICULTY_COUNT ||
+        r->category >= CATEGORY_COUNT || r->text_offset > pool_len) {
+        return false;
+    }
+    uint64_t size = pack_record_text_size(r);
+    if (size > pool_len - r->text_offset || r->lengths[0] >= MAX_QUESTION_LEN) {
+        return false;
+    }
+    for (int i = 1; i <= r->option_count; i++) {
+        if (r->lengths[i] == 0 || r->lengths[i] >= MAX_ANSWER_LEN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t pack_record_text_size(const PackRecord *r) {
+    uint64_t size = 0;
+    for (int i = 0; i <= r->option_count && i <= MAX_OPTIONS; i++) {
+        size += r->lengths[i] + 1u;
+    }
+    return size;
+}
+
+bool pack_record_text_valid(const PackRecord *r, const char *text) {
+    for (int i = 0; i <= r->option_count; i++) {
+        size_t len = r->lengths[i];
+        if (text[len] != '\0' || memchr(text, '\0', len) != NULL ||
+            !utf8_validate(text, len)) {
+            return false;
+        }
+        text += len + 1;
+    }
+    return true;
+}
+
+void pack_record_to_question(const PackRecord *r, const char *text, Question *q) {
+    memset(q, 0, sizeof(*q));
+    q->id = r->id;
+    q->correct_answer = r->correct;
+    q->difficulty = (Difficulty)r->difficulty;
+    q->category = (Category)r->category;
+    memcpy(q->question, text, r->lengths[0]);
+    q->question_width = r->widths[0];
+    text += r->lengths[0] + 1;
+    for (int i = 0; i < r->option_count; i++) {
+        memcpy(q->options[i], text, r->lengths[1 + i]);
+        q->option_widths[i] = r->widths[1 + i];
+        text += r->lengths[1 + i] + 1;
+    }
+}
+
+int pack_read_header(const void *data, size_t len, PackHeader *header) {
+    if (data == NULL || len < sizeof(PackHeader) || !pack_is_pack(data, len)) {
+        return -1;
+    }
+    memcpy(header, data, sizeof(PackHeader));
+    if (header->version != PACK_VERSION || header->record_size != sizeof(PackRecord) ||
+        header->count > (uint32_t)INT32_MAX ||
+        header->pool_offset < sizeof(PackHeader) + (uint64_t)header->count * sizeof(PackRecord)) {
+        return -1;
+    }
+    return 0;
+}
+
+int pack_check(const void *data, size_t len) {
+    PackHeader header;
+    if (pack_read_header(data, len, &header) != 0 || header.pool_offset > len ||
+        header.pool_len > len - header.pool_offset) {
+        return -1;
+    }
+
+    const PackRecord *records = pack_records(data);
+    const char *pool = (const char*)data + header.pool_offset;
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (!pack_record_valid(&records[i], header.pool_len) ||
+            !pack_record_text_valid(&records[i], pool + records[i].text_offset)) {
+            return -1;
+        }
+    }
+    return (int)header.count;
+}
+
+void pack_read_question(const void *data, size_t index, Question *q) {
+    PackHeader header;
+    memcpy(&header, data, sizeof(header));
+    const PackRecord *r = &pack_records(data)[index];
+    pack_record_to_question(r, (const char*)data + header.pool_offset + r->text_offset, q);
+}
+
+int pack_load_from_buffer(QuestionBank *bank, const void *data, size_t len) {
+    if (bank == NULL) {
+        return -1;
+    }
+    int count = pack_check(data, len);
+    if (count < 0) {
+        print_error("Malformed question pack");
+        return -1;
+    }
+
+    PackHeader header;
+    memcpy(&header, data, sizeof(header));
+    return pack_load_records(bank, pack_records(data), (size_t)count,
+                             (const char*)data + header.pool_offset);
+}
+
+int pack_load_records(QuestionBank *bank, const PackRecord *records, size_t count,
+                      const char *pool) {
+    if (bank == NULL || count > (size_t)INT32_MAX) {
+        return -1;
+    }
+    Question q;
+    uint64_t bytes = count * sizeof(PackRecord);
+    for (size_t i = 0; i < count; i++) {
+        pack_record_to_question(&records[i], pool + records[i].text_offset, &q);
+        if (question_bank_add(bank, &q) != 0) {
+            return -1;
+        }
+        bytes += pack_record_text_size(&records[i]);
+    }
+    TRIVIA_PROBE2(bank_loaded, (int)count, bytes);
+    return (int)count;
+}
+
+int pack_map(PackMapping *map, int fd, bool huge_aligned) {
+    memset(map, 0, sizeof(*map));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+
+    if (!huge_aligned) {
+        void *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            return -1;
+        }
+        map->data = data;
+        map->len = len;
+        return 0;
+    }
+
+    /* Reserve enough address space to place the file on a huge page
+     * boundary, map it there and give back the slack on either side. */
+    size_t reserve_len = len + PACK_HUGE_PAGE_SIZE;
+    char *reserve = mmap(NULL, reserve_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserve == MAP_FAILED) {
+        return -1;
+    }
+    uintptr_t aligned = ((uintptr_t)reserve + PACK_HUGE_PAGE_SIZE - 1) &
+                        ~(uintptr_t)(PACK_HUGE_PAGE_SIZE - 1);
+    char *data = mmap((void*)aligned, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (data == MAP_FAILED) {
+        munmap(reserve, reserve_len);
+        return -1;
+    }
+    size_t head = (size_t)(data - reserve);
+    if (head > 0) {
+        munmap(reserve, head);
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapped_end = head + ((len + page - 1) & ~(page - 1));
+    if (mapped_end < reserve_len) {
+        munmap(reserve + mapped_end, reserve_len - mapped_end);
+    }
+    map->data = data;
+    map->len = len;
+    return 0;
+}
+
+int pack_map_huge_pages(PackMapping *map) {
+#ifdef MADV_HUGEPAGE
+    return madvise(map->data, map->len, MADV_HUGEPAGE);
+#else
+    (void)map;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+static void* prefault_worker(void *arg) {
+    PackMapping *map = (PackMapping*)arg;
+    double start = monotonic_ms();
+    madvise(map->data, map->len, MADV_WILLNEED);
+
+    const volatile char *bytes = (const volatile char*)map->data;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t off = 0; off < map->len; off += page) {
+        (void)bytes[off];
+    }
+    map->prefault_ms = monotonic_ms() - start;
+    return NULL;
+}
+
+int pack_map_prefault_start(PackMapping *map) {
+    if (map->prefaulting) {
+        return 0;
+    }
+    if (pthread_create(&map->prefaulter, NULL, prefault_worker, map) != 0) {
+        return -1;
+    }
+    map->prefaulting = true;
+    return 0;
+}
+
+void pack_map_prefault_wait(PackMapping *map) {
+    if (map->prefaulting) {
+        pthread_join(map->prefaulter, NULL);
+        map->prefaulting = false;
+    }
+}
+
+void pack_unmap(PackMapping *map) {
+    pack_map_prefault_wait(map);
+    if (map->data != NULL) {
+        munmap(map->data, map->len);
+    }
+    map->data = NULL;
+    map->len = 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file pack.h
+ * @brief Binary question pack format ("TQPK")
+ *
+ * A pack is a fixed-size header, one fixed-size record per question and a
+ * pool of NUL-terminated strings:
+ *
+ *   PackHeader | PackRecord[count] | pool (pool_offset, pool_len)
+ *
+ * Each record points at its question text in the pool; its options follow
+ * the text in order. Display widths are stored so readers never decode
+ * UTF-8. All fields are little-endian, and records can be used in place
+ * from a mapped file. Packs are written by export.h.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "questions.h"
+
+/**
+ * @brief First four bytes of every pack
+ */
+#define PACK_MAGIC "TQPK"
+
+/**
+ * @brief Current pack format version
+ */
+#define PACK_VERSION 1
+
+/**
+ * @brief Alignment of mappings that may be backed by huge pages
+ */
+#define PACK_HUGE_PAGE_SIZE (2u * 1024 * 1024)
+
+/**
+ * @brief Pack file header (32 bytes)
+ */
+typedef struct {
+    char magic[4];                        /**< PACK_MAGIC */
+    uint16_t version;                     /**< PACK_VERSION */
+    uint16_t record_size;                 /**< sizeof(PackRecord) */
+    uint32_t count;                       /**< Number of records */
+    uint32_t reserved;                    /**< Zero */
+    uint64_t pool_offset;                 /**< File offset of the string pool */
+    uint64_t pool_len;                    /**< Length of the string pool in bytes */
+} PackHeader;
+
+/**
+ * @brief One question in a pack (40 bytes)
+ */
+typedef struct {
+    uint32_t id;                          /**< Stable ID (0 if none) */
+    uint8_t correct;                      /**< Index of the correct option */
+    uint8_t difficulty;                   /**< Difficulty value */
+    uint8_t category;                     /**< Category value */
+    uint8_t option_count;                 /**< Number of options */
+    uint64_t text_offset;                 /**< Pool offset of the question text */
+    uint16_t lengths[1 + MAX_OPTIONS];    /**< Byte length of text, then each option */
+    uint16_t widths[1 + MAX_OPTIONS];     /**< Display columns of text, then each option */
+    uint32_t reserved;                    /**< Zero */
+} PackRecord;
+
+/**
+ * @brief A pack file mapped read-only into memory
+ */
+typedef struct {
+    void *data;                           /**< Mapped bytes */
+    size_t len;                           /**< Length of the mapping */
+    pthread_t prefaulter;                 /**< Prefault thread */
+    bool prefaulting;                     /**< Whether the thread was started */
+    double prefault_ms;                   /**< Time the thread spent, valid after the wait */
+} PackMapping;
+
+/**
+ * @brief Check whether a buffer starts with a pack header
+ *
+ * @param data Buffer to check
+ * @param len Length of data in bytes
+ * @return bool true if data starts with PACK_MAGIC
+ */
+bool pack_is_pack(const void *data, size_t len);
+
+/**
+ * @brief Read and check a pack header
+ *
+ * @param data Pack bytes (at least the header)
+ * @param len Length of data in bytes
+ * @param header Receives the header
+ * @return int 0 on success, -1 if this is not a supported pack
+ */
+int pack_read_header(const void *data, size_t len, PackHeader *header);
+
+/**
+ * @brief Check a record's fields and that its strings lie in the pool
+ *
+ * @param r Pointer to PackRecord
+ * @param pool_len Length of the pack's string pool
+ * @return bool true if the record is usable
+ */
+bool pack_record_valid(const PackRecord *r, uint64_t pool_len);
+
+/**
+ * @brief Bytes of pool used by a record's strings, terminators included
+ *
+ * @param r Pointer to PackRecord
+ * @return uint64_t Size of the record's text block
+ */
+uint64_t pack_record_text_size(const PackRecord *r);
+
+/**
+ * @brief Check the text block of a record
+ *
+ * @param r Pointer to a record that passed pack_record_valid()
+ * @param text The record's pack_record_text_size() bytes of pool
+ * @return bool true if every string is NUL-terminated valid UTF-8
+ */
+bool pack_record_text_valid(const PackRecord *r, const char *text);
+
+/**
+ * @brief Build a Question from a record and its text block
+ *
+ * @param r Pointer to a checked PackRecord
+ * @param text The record's text block
+ * @param q Receives the question
+ */
+void pack_record_to_question(const PackRecord *r, const char *text, Question *q);
+
+/**
+ * @brief Check a pack's header, records and pool
+ *
+ * Every record must be in bounds, playable and point at NUL-terminated,
+ * valid UTF-8 strings of the recorded lengths.
+ *
+ * @param data Pack bytes
+ * @param len Length of data in bytes
+ * @return int Number of records, -1 if the pack is malformed
+ */
+int pack_check(const void *data, size_t len);
+
+/**
+ * @brief Copy one record of a checked pack into a Question
+ *
+ * @param data Pack bytes that passed pack_check()
+ * @param index Record index
+ * @param q Receives the question
+ */
+void pack_read_question(const void *data, size_t index, Question *q);
+
+/**
+ * @brief Add the questions of a checked record table and pool to a bank
+ *
+ * Nothing is validated; use for records that passed pack_check(), such as
+ * a bank compiled in by trivia-embedgen.
+ *
+ * @param bank Pointer to QuestionBank to populate
+ * @param records Record table
+ * @param count Number of records
+ * @param pool String pool the records point into
+ * @return int Number of questions loaded, -1 on error
+ */
+int pack_load_records(QuestionBank *bank, const PackRecord *records, size_t count,
+                      const char *pool);
+
+/**
+ * @brief Load every question of a pack in memory
+ *
+ * The whole pack is rejected if it is malformed. Does not build the
+ * difficulty index.
+ *
+ * @param bank Pointer to QuestionBank to populate
+ * @param data Pack bytes
+ * @param len Length of data in bytes
+ * @return int Number of questions loaded, -1 on error
+ */
+int pack_load_from_buffer(QuestionBank *bank, const void *data, size_t len);
+
+/**
+ * @brief Map a whole pack file read-only
+ *
+ * With @p huge_aligned the mapping starts on a PACK_HUGE_PAGE_SIZE
+ * boundary so that pack_map_huge_pages() can take effect.
+ *
+ * @param map Pointer to PackMapping to initialize
+ * @param fd Open pack file (may be closed afterwards)
+ * @param huge_aligned Align the mapping for huge pages
+ * @return int 0 on success, -1 on error
+ */
+int pack_map(PackMapping *map, int fd, bool huge_aligned);
+
+/**
+ * @brief Ask for the mapping to be backed by transparent huge pages
+ *
+ * @param map Pointer to PackMapping
+ * @return int 0 on success, -1 if the kernel refused (errno is set)
+ */
+int pack_map_huge_pages(PackMapping *map);
+
+/**
+ * @brief Start faulting the mapping in from a background thread
+ *
+ * The thread issues MADV_WILLNEED and touches every page, so readers
+ * following behind it find the pages already mapped.
+ *
+ * @param map Pointer to PackMapping
+ * @return int 0 on success, -1 if the thread could not be started
+ */
+int pack_map_prefault_start(PackMapping *map);
+
+/**
+ * @brief Wait for the prefault thread, if any
+ *
+ * @param map Pointer to PackMapping
+ */
+void pack_map_prefault_wait(PackMapping *map);
+
+/**
+ * @brief Wait for the prefault thread and unmap the pack
+ *
+ * @param map Pointer to PackMapping
+ */
+void pack_unmap(PackMapping *map);
+
+#endif /* PACK_H */
@@ -0,0 +1,560 @@
+/**
+ * @file paged.c
+ * @brief Implementation of the out-of-core question bank
+ */
+
+#include "paged.h"
+#include "probes.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Random index picks tried before scanning for unused questions
+ */
+#define PAGED_DRAW_ATTEMPTS 8
+
+static pthread_once_t paged_seed_once = PTHREAD_ONCE_INIT;
+
+static void seed_random(void) {
+    srand((unsigned int)time(NULL));
+}
+
+/**
+ * @brief pread() exactly @p len bytes
+ */
+static int read_full(int fd, void *buf, size_t len, uint64_t offset) {
+    char *p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static void lru_unlink(PagedBank *bank, int32_t s) {
+    PagedSlot *slot = &bank->slots[s];
+    if (slot->prev >= 0) {
+        bank->slots[slot->prev].next = slot->next;
+    } else {
+        bank->lru_head = slot->next;
+    }
+    if (slot->next >= 0) {
+        bank->slots[slot->next].prev = slot->prev;
+    } else {
+        bank->lru_tail = slot->prev;
+    }
+    slot->prev = -1;
+    slot->next = -1;
+}
+
+static void lru_push_front(PagedBank *bank, int32_t s) {
+    PagedSlot *slot = &bank->slots[s];
+    slot->prev = -1;
+    slot->next = bank->lru_head;
+    if (bank->lru_head >= 0) {
+        bank->slots[bank->lru_head].prev = s;
+    }
+    bank->lru_head = s;
+    if (bank->lru_tail < 0) {
+        bank->lru_tail = s;
+    }
+}
+
+static void lru_push_back(PagedBank *bank, int32_t s) {
+    PagedSlot *slot = &bank->slots[s];
+    slot->next = -1;
+    slot->prev = bank->lru_tail;
+    if (bank->lru_tail >= 0) {
+        bank->slots[bank->lru_tail].next = s;
+    }
+    bank->lru_tail = s;
+    if (bank->lru_head < 0) {
+        bank->lru_head = s;
+    }
+}
+
+/**
+ * @brief Find or load a pool page; called and returns with the lock held
+ *
+ * The file is read with the lock released. The slot being filled is kept
+ * out of the LRU list so it cannot be evicted, and threads wanting the
+ * same page wait for it instead of reading it twice.
+ *
+ * @param prefetch Whether the prefetch thread is asking (for the counters)
+ * @return int32_t Slot holding the page, -1 on I/O error
+ */
+static int32_t load_page(PagedBank *bank, uint64_t page, bool prefetch) {
+    for (;;) {
+        int32_t s = bank->slot_of_page[page];
+        if (s >= 0) {
+            if (bank->slots[s].loading) {
+                pthread_cond_wait(&bank->changed, &bank->lock);
+                continue;
+            }
+            if (!prefetch) {
+                bank->stats.hits++;
+            }
+            lru_unlink(bank, s);
+            lru_push_front(bank, s);
+            return s;
+        }
+
+        /* A never-used slot first, then the least recently used page. */
+        if (bank->free_slots > 0) {
+            s = bank->slot_count - bank->free_slots;
+            PagedSlot *slot = &bank->slots[s];
+            slot->data = (char*)malloc(PAGED_PAGE_SIZE);
+            if (slot->data == NULL) {
+                return -1;
+            }
+            bank->free_slots--;
+        } else if (bank->lru_tail >= 0) {
+            s = bank->lru_tail;
+            lru_unlink(bank, s);
+            if (bank->slots[s].page != UINT64_MAX) {
+                bank->slot_of_page[bank->slots[s].page] = -1;
+                bank->stats.evictions++;
+            }
+        } else {
+            /* Every slot is being filled; wait for one to finish. */
+            pthread_cond_wait(&bank->changed, &bank->lock);
+            continue;
+        }
+
+        PagedSlot *slot = &bank->slots[s];
+        slot->page = page;
+        slot->loading = true;
+        bank->slot_of_page[page] = s;
+        if (prefetch) {
+            bank->stats.prefetched++;
+        } else {
+            bank->stats.misses++;
+        }
+
+        uint64_t start = page * PAGED_PAGE_SIZE;
+        size_t len = bank->pool_len - start < PAGED_PAGE_SIZE ?
+                     (size_t)(bank->pool_len - start) : PAGED_PAGE_SIZE;
+        pthread_mutex_unlock(&bank->lock);
+        int rc = read_full(bank->fd, slot->data, len, bank->pool_offset + start);
+        pthread_mutex_lock(&bank->lock);
+
+        slot->loading = false;
+        pthread_cond_broadcast(&bank->changed);
+        if (rc != 0) {
+            bank->slot_of_page[page] = -1;
+            slot->page = UINT64_MAX;
+            lru_push_back(bank, s);
+            return -1;
+        }
+        lru_push_front(bank, s);
+        return s;
+    }
+}
+
+static void* prefetch_worker(void *arg) {
+    PagedBank *bank = (PagedBank*)arg;
+    pthread_mutex_lock(&bank->lock);
+    while (!bank->stopping) {
+        if (bank->queue_len == 0) {
+            pthread_cond_wait(&bank->changed, &bank->lock);
+            continue;
+        }
+        uint64_t page = bank->queue[bank->queue_head];
+        bank->queue_head = (bank->queue_head + 1) % PAGED_PREFETCH_QUEUE;
+        bank->queue_len--;
+        if (bank->slot_of_page[page] < 0) {
+            bank->prefetching = true;
+            load_page(bank, page, true);
+            bank->prefetching = false;
+        }
+        if (bank->queue_len == 0) {
+            /* Wake paged_bank_prefetch_wait(). */
+            pthread_cond_broadcast(&bank->changed);
+        }
+    }
+    pthread_mutex_unlock(&bank->lock);
+    return NULL;
+}
+
+/**
+ * @brief Check the records against the file and build the difficulty index
+ */
+static int index_records(PagedBank *bank, uint64_t file_size) {
+    if (bank->pool_offset > file_size || bank->pool_len > file_size - bank->pool_offset) {
+        print_error("Pack string pool extends past the end of the file");
+        return -1;
+    }
+
+    for (size_t i = 0; i < bank->count; i++) {
+        const PackRecord *r = &bank->records[i];
+        if (!pack_record_valid(r, bank->pool_len)) {
+            print_error("Malformed pack record %zu", i);
+            return -1;
+        }
+        bank->difficulty_count[r->difficulty]++;
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        size_t n = bank->difficulty_count[d];
+        bank->by_difficulty[d] = (uint32_t*)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+        if (bank->by_difficulty[d] == NULL) {
+            return -1;
+        }
+        bank->difficulty_count[d] = 0;
+    }
+    for (size_t i = 0; i < bank->count; i++) {
+        int d = bank->records[i].difficulty;
+        bank->by_difficulty[d][bank->difficulty_count[d]++] = (uint32_t)i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the records from the file and index them
+ */
+static int load_metadata(PagedBank *bank, uint64_t file_size) {
+    size_t bytes = bank->count * sizeof(PackRecord);
+    bank->records = (PackRecord*)malloc(bytes > 0 ? bytes : 1);
+    if (bank->records == NULL ||
+        read_full(bank->fd, bank->records, bytes, sizeof(PackHeader)) != 0) {
+        print_error("Failed to read pack records");
+        return -1;
+    }
+    return index_records(bank, file_size);
+}
+
+int paged_bank_open(PagedBank *bank, const char *filename, size_t memory_cap) {
+    if (bank == NULL || filename == NULL) {
+        return -1;
+    }
+    memset(bank, 0, sizeof(PagedBank));
+    bank->fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (bank->fd < 0) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    pthread_mutex_init(&bank->lock, NULL);
+    pthread_cond_init(&bank->changed, NULL);
+    bank->lru_head = -1;
+    bank->lru_tail = -1;
+
+    char raw[sizeof(PackHeader)];
+    PackHeader header;
+    struct stat st;
+    if (read_full(bank->fd, raw, sizeof(raw), 0) != 0 ||
+        pack_read_header(raw, sizeof(raw), &header) != 0 || fstat(bank->fd, &st) != 0) {
+        print_error("%s is not a question pack (export one with trivia-export)", filename);
+        paged_bank_close(bank);
+        return -1;
+    }
+    bank->count = header.count;
+    bank->pool_offset = header.pool_offset;
+    bank->pool_len = header.pool_len;
+    bank->page_count = (header.pool_len + PAGED_PAGE_SIZE - 1) / PAGED_PAGE_SIZE;
+
+    /* Records, index and page map are resident; the rest of the cap is cache. */
+    size_t metadata = bank->count * (sizeof(PackRecord) + sizeof(uint32_t)) +
+                      bank->page_count * sizeof(int32_t);
+    size_t per_slot = PAGED_PAGE_SIZE + sizeof(PagedSlot);
+    size_t slots = memory_cap > metadata ? (memory_cap - metadata) / per_slot : 0;
+    if (slots > bank->page_count) {
+        slots = bank->page_count;
+    }
+    if (slots < PAGED_MIN_PAGES && slots < bank->page_count) {
+        print_error("Memory cap of %zu KB is too small: questions need %zu KB plus %d KB of cache",
+                    memory_cap / 1024, metadata / 1024, PAGED_MIN_PAGES * PAGED_PAGE_SIZE / 1024);
+        paged_bank_close(bank);
+        return -1;
+    }
+    if (slots > INT32_MAX) {
+        slots = INT32_MAX;
+    }
+
+    if (load_metadata(bank, (uint64_t)st.st_size) != 0) {
+        paged_bank_close(bank);
+        return -1;
+    }
+    bank->slot_of_page = (int32_t*)malloc((bank->page_count > 0 ? bank->page_count : 1) *
+                                          sizeof(int32_t));
+    bank->slots = (PagedSlot*)calloc(slots > 0 ? slots : 1, sizeof(PagedSlot));
+    if (bank->slot_of_page == NULL || bank->slots == NULL) {
+        print_error("Failed to allocate page cache");
+        paged_bank_close(bank);
+        return -1;
+    }
+    for (uint64_t p = 0; p < bank->page_count; p++) {
+        bank->slot_of_page[p] = -1;
+    }
+    for (size_t s = 0; s < slots; s++) {
+        bank->slots[s].page = UINT64_MAX;
+        bank->slots[s].prev = -1;
+        bank->slots[s].next = -1;
+    }
+    bank->slot_count = (int32_t)slots;
+    bank->free_slots = (int32_t)slots;
+    bank->resident_bytes = metadata + slots * per_slot;
+
+    /* Questions are drawn at random; kernel readahead would only waste I/O. */
+    posix_fadvise(bank->fd, (off_t)bank->pool_offset, (off_t)bank->pool_len, POSIX_FADV_RANDOM);
+
+    bank->prefetcher_running =
+        pthread_create(&bank->prefetcher, NULL, prefetch_worker, bank) == 0;
+    TRIVIA_PROBE2(bank_loaded, (int)bank->count, (uint64_t)st.st_size);
+    return (int)bank->count;
+}
+
+int paged_bank_open_mapped(PagedBank *bank, const PackMapping *map) {
+    if (bank == NULL || map == NULL || map->data == NULL) {
+        return -1;
+    }
+    memset(bank, 0, sizeof(PagedBank));
+    bank->fd = -1;
+    pthread_mutex_init(&bank->lock, NULL);
+    pthread_cond_init(&bank->changed, NULL);
+    bank->lru_head = -1;
+    bank->lru_tail = -1;
+
+    PackHeader header;
+    if (pack_read_header(map->data, map->len, &header) != 0) {
+        print_error("Not a question pack (export one with trivia-export)");
+        paged_bank_close(bank);
+        return -1;
+    }
+    bank->count = header.count;
+    bank->pool_offset = header.pool_offset;
+    bank->pool_len = header.pool_len;
+
+    /* The records are never written; the cast only lets them share the
+     * field with the heap copy used by the cache. */
+    bank->records = (PackRecord*)((const char*)map->data + sizeof(PackHeader));
+    bank->map = map;
+    if (index_records(bank, map->len) != 0) {
+        paged_bank_close(bank);
+        return -1;
+    }
+    bank->pool = (const char*)map->data + bank->pool_offset;
+    bank->resident_bytes = bank->count * sizeof(uint32_t);
+    TRIVIA_PROBE2(bank_loaded, (int)bank->count, (uint64_t)map->len);
+    return (int)bank->count;
+}
+
+int paged_bank_read(PagedBank *bank, size_t index, Question *q) {
+    if (bank == NULL || q == NULL || index >= bank->count) {
+        return -1;
+    }
+
+    const PackRecord *r = &bank->records[index];
+    if (bank->map != NULL) {
+        const char *mapped = bank->pool + r->text_offset;
+        if (!pack_record_text_valid(r, mapped)) {
+            print_error("Corrupt text for question %zu", index);
+            return -1;
+        }
+        pack_record_to_question(r, mapped, q);
+        return 0;
+    }
+
+    char text[MAX_QUESTION_LEN + MAX_OPTIONS * MAX_ANSWER_LEN];
+    uint64_t size = pack_record_text_size(r);
+    uint64_t done = 0;
+
+    pthread_mutex_lock(&bank->lock);
+    while (done < size) {
+        uint64_t offset = r->text_offset + done;
+        int32_t s = load_page(bank, offset / PAGED_PAGE_SIZE, false);
+        if (s < 0) {
+            pthread_mutex_unlock(&bank->lock);
+            print_error("Failed to read question %zu", index);
+            return -1;
+        }
+        /* Copy while locked: the slot may be reused once the lock drops. */
+        size_t in_page = (size_t)(offset % PAGED_PAGE_SIZE);
+        size_t n = PAGED_PAGE_SIZE - in_page;
+        if (n > size - done) {
+            n = (size_t)(size - done);
+        }
+        memcpy(text + done, bank->slots[s].data + in_page, n);
+        done += n;
+    }
+    pthread_mutex_unlock(&bank->lock);
+
+    if (!pack_record_text_valid(r, text)) {
+        print_error("Corrupt text for question %zu", index);
+        return -1;
+    }
+    pack_record_to_question(r, text, q);
+    return 0;
+}
+
+void paged_bank_prefetch(PagedBank *bank, size_t index) {
+    if (bank == NULL || index >= bank->count) {
+        return;
+    }
+
+    const PackRecord *r = &bank->records[index];
+    if (bank->map != NULL) {
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)(bank->pool + r->text_offset) & ~(page - 1);
+        uintptr_t end = (uintptr_t)(bank->pool + r->text_offset + pack_record_text_size(r));
+        madvise((void*)start, end - start, MADV_WILLNEED);
+        return;
+    }
+    if (!bank->prefetcher_running) {
+        return;
+    }
+    uint64_t first = r->text_offset / PAGED_PAGE_SIZE;
+    uint64_t last = (r->text_offset + pack_record_text_size(r) - 1) / PAGED_PAGE_SIZE;
+
+    pthread_mutex_lock(&bank->lock);
+    for (uint64_t page = first; page <= last; page++) {
+        if (bank->slot_of_page[page] >= 0) {
+            continue;
+        }
+        if (bank->queue_len == PAGED_PREFETCH_QUEUE) {
+            /* Stale requests are the least useful; drop the oldest. */
+            bank->queue_head = (bank->queue_head + 1) % PAGED_PREFETCH_QUEUE;
+            bank->queue_len--;
+        }
+        bank->queue[(bank->queue_head + bank->queue_len) % PAGED_PREFETCH_QUEUE] = page;
+        bank->queue_len++;
+    }
+    pthread_cond_broadcast(&bank->changed);
+    pthread_mutex_unlock(&bank->lock);
+}
+
+void paged_bank_prefetch_wait(PagedBank *bank) {
+    if (bank == NULL || !bank->prefetcher_running) {
+        return;
+    }
+    pthread_mutex_lock(&bank->lock);
+    while ((bank->queue_len > 0 || bank->prefetching) && !bank->stopping) {
+        pthread_cond_wait(&bank->changed, &bank->lock);
+    }
+    pthread_mutex_unlock(&bank->lock);
+}
+
+size_t paged_bank_pick(PagedBank *bank, int difficulty, const bool *used) {
+    if (bank == NULL || bank->count == 0) {
+        return SIZE_MAX;
+    }
+    bool filtered = difficulty >= 0 && difficulty < DIFFICULTY_COUNT;
+    size_t n = filtered ? bank->difficulty_count[difficulty] : bank->count;
+    if (n == 0) {
+        return SIZE_MAX;
+    }
+
+    pthread_once(&paged_seed_once, seed_random);
+    for (int attempt = 0; attempt < PAGED_DRAW_ATTEMPTS; attempt++) {
+        size_t pick = (size_t)rand() % n;
+        size_t idx = filtered ? bank->by_difficulty[difficulty][pick] : pick;
+        if (used == NULL || !used[idx]) {
+            return idx;
+        }
+    }
+
+    /* Mostly used up: count what is left, then walk to a random one. */
+    size_t unused = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t idx = filtered ? bank->by_difficulty[difficulty][i] : i;
+        unused += !used[idx];
+    }
+    if (unused == 0) {
+        return SIZE_MAX;
+    }
+    size_t target = (size_t)rand() % unused;
+    for (size_t i = 0; i < n; i++) {
+        size_t idx = filtered ? bank->by_difficulty[difficulty][i] : i;
+        if (!used[idx] && target-- == 0) {
+            return idx;
+        }
+    }
+    return SIZE_MAX;
+}
+
+void paged_bank_stats(PagedBank *bank, PagedStats *stats) {
+    if (bank == NULL || stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&bank->lock);
+    *stats = bank->stats;
+    pthread_mutex_unlock(&bank->lock);
+}
+
+int paged_bank_lock(PagedBank *bank) {
+    if (bank == NULL || bank->records == NULL || bank->locked_bytes > 0) {
+        return 0;
+    }
+    size_t bytes = bank->count * sizeof(PackRecord);
+    if (mlock(bank->records, bytes) != 0) {
+        return -1;
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        size_t index_bytes = bank->difficulty_count[d] * sizeof(uint32_t);
+        if (index_bytes > 0 && mlock(bank->by_difficulty[d], index_bytes) == 0) {
+            bytes += index_bytes;
+        }
+    }
+    bank->locked_bytes = bytes;
+    return 0;
+}
+
+void paged_bank_close(PagedBank *bank) {
+    if (bank == NULL) {
+        return;
+    }
+    if (bank->prefetcher_running) {
+        pthread_mutex_lock(&bank->lock);
+        bank->stopping = true;
+        pthread_cond_broadcast(&bank->changed);
+        pthread_mutex_unlock(&bank->lock);
+        pthread_join(bank->prefetcher, NULL);
+        bank->prefetcher_running = false;
+    }
+    if (bank->slots != NULL) {
+        for (int32_t s = 0; s < bank->slot_count; s++) {
+            free(bank->slots[s].data);
+        }
+    }
+    if (bank->locked_bytes > 0) {
+        munlock(bank->records, bank->count * sizeof(PackRecord));
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            if (bank->difficulty_count[d] > 0) {
+                munlock(bank->by_difficulty[d], bank->difficulty_count[d] * sizeof(uint32_t));
+            }
+        }
+        bank->locked_bytes = 0;
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        free(bank->by_difficulty[d]);
+        bank->by_difficulty[d] = NULL;
+    }
+    free(bank->slots);
+    free(bank->slot_of_page);
+    if (bank->map == NULL) {
+        free(bank->records);
+    }
+    bank->map = NULL;
+    bank->pool = NULL;
+    bank->slots = NULL;
+    bank->slot_of_page = NULL;
+    bank->records = NULL;
+    bank->count = 0;
+    if (bank->fd >= 0) {
+        close(bank->fd);
+        bank->fd = -1;
+    }
+    pthread_cond_destroy(&bank->changed);
+    pthread_mutex_destroy(&bank->lock);
+}
@@ -0,0 +1,198 @@
+/**
+ * @file paged.h
+ * @brief Out-of-core question bank backed by a binary pack
+ *
+ * Only the pack's fixed-size records (ID, answer, difficulty, lengths and
+ * widths) and a per-difficulty index stay in memory. Question text is read
+ * from the pack's string pool through a bounded LRU cache of fixed-size
+ * pages, so banks larger than RAM can be played within a memory cap.
+ *
+ * A background thread loads pages ahead of time: the game draws the next
+ * question while the current one is on screen and asks for its pages to
+ * be prefetched, so the read usually hits the cache.
+ *
+ * A bank can instead be opened over a pack that is already mapped
+ * (paged_bank_open_mapped()). Records and text are then read in place
+ * from the mapping and the kernel's page cache takes the place of the LRU
+ * cache, so huge pages and prefaulting on the mapping serve every draw.
+ */
+
+#ifndef PAGED_H
+#define PAGED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "questions.h"
+#include "pack.h"
+
+/**
+ * @brief Size of one cached page of question text
+ */
+#define PAGED_PAGE_SIZE (64 * 1024)
+
+/**
+ * @brief Fewest pages a cache may hold (a question spans at most two)
+ */
+#define PAGED_MIN_PAGES 4
+
+/**
+ * @brief Pending prefetch requests; older requests are dropped when full
+ */
+#define PAGED_PREFETCH_QUEUE 64
+
+/**
+ * @brief One slot of the page cache
+ */
+typedef struct {
+    char *data;                           /**< PAGED_PAGE_SIZE bytes */
+    uint64_t page;                        /**< Pool page held, UINT64_MAX if none */
+    int32_t prev;                         /**< Towards most recently used (-1 at head) */
+    int32_t next;                         /**< Towards least recently used (-1 at tail) */
+    bool loading;                         /**< Being read; not in the LRU list */
+} PagedSlot;
+
+/**
+ * @brief Page cache counters
+ */
+typedef struct {
+    uint64_t hits;                        /**< Page reads served from the cache */
+    uint64_t misses;                      /**< Page reads that went to the file */
+    uint64_t prefetched;                  /**< Pages loaded by the prefetch thread */
+    uint64_t evictions;                   /**< Pages dropped to make room */
+} PagedStats;
+
+/**
+ * @brief Out-of-core question bank
+ */
+typedef struct {
+    int fd;                               /**< Open pack file (-1 when mapped) */
+    const PackMapping *map;               /**< Mapping read in place (NULL for the cache) */
+    const char *pool;                     /**< String pool inside map */
+    PackRecord *records;                  /**< All records (in map when mapped) */
+    size_t count;                         /**< Number of questions */
+    uint32_t *by_difficulty[DIFFICULTY_COUNT]; /**< Question indices per difficulty */
+    size_t difficulty_count[DIFFICULTY_COUNT]; /**< Length of each index list */
+    uint64_t pool_offset;                 /**< File offset of the string pool */
+    uint64_t pool_len;                    /**< Length of the string pool */
+
+    PagedSlot *slots;                     /**< Page cache */
+    int32_t slot_count;                   /**< Number of slots */
+    int32_t *slot_of_page;                /**< Slot per pool page, -1 if not cached */
+    uint64_t page_count;                  /**< Pages in the pool */
+    int32_t lru_head;                     /**< Most recently used slot */
+    int32_t lru_tail;                     /**< Least recently used slot */
+    int32_t free_slots;                   /**< Slots never used yet */
+    size_t resident_bytes;                /**< Memory held by records, index and cache */
+    size_t locked_bytes;                  /**< Bytes pinned by paged_bank_lock() */
+    PagedStats stats;                     /**< Cache counters */
+    pthread_mutex_t lock;                 /**< Guards the cache and queue */
+    pthread_cond_t changed;               /**< A page finished loading or a request arrived */
+
+    uint64_t queue[PAGED_PREFETCH_QUEUE]; /**< Pages waiting to be prefetched */
+    size_t queue_head;                    /**< Next request to serve */
+    size_t queue_len;                     /**< Requests waiting */
+    pthread_t prefetcher;                 /**< Prefetch thread */
+    bool prefetcher_running;              /**< Whether the thread was started */
+    bool prefetching;                     /**< The thread is loading a dequeued page */
+    bool stopping;                        /**< Tells the thread to exit */
+} PagedBank;
+
+/**
+ * @brief Open a pack for out-of-core play
+ *
+ * Reads and checks every record, builds the difficulty index and sizes
+ * the page cache so that records, index and cache together stay within
+ * @p memory_cap. Fails if the records alone do not fit.
+ *
+ * @param bank Pointer to PagedBank to initialize
+ * @param filename Path to a binary pack
+ * @param memory_cap Resident memory budget in bytes
+ * @return int Number of questions, -1 on error
+ */
+int paged_bank_open(PagedBank *bank, const char *filename, size_t memory_cap);
+
+/**
+ * @brief Open a bank over a mapped pack, reading it in place
+ *
+ * Checks every record and builds the difficulty index; question text is
+ * checked when it is read. No cache or prefetch thread is set up. The
+ * mapping must stay mapped until paged_bank_close() and is not unmapped
+ * by it.
+ *
+ * @param bank Pointer to PagedBank to initialize
+ * @param map Mapping of a binary pack from pack_map()
+ * @return int Number of questions, -1 on error
+ */
+int paged_bank_open_mapped(PagedBank *bank, const PackMapping *map);
+
+/**
+ * @brief Read one question, loading its text pages if needed
+ *
+ * Safe to call from several threads.
+ *
+ * @param bank Pointer to PagedBank
+ * @param index Question index
+ * @param q Receives the question
+ * @return int 0 on success, -1 on I/O error or corrupt text
+ */
+int paged_bank_read(PagedBank *bank, size_t index, Question *q);
+
+/**
+ * @brief Ask the prefetch thread to load a question's text pages
+ *
+ * Returns immediately; pages already cached are skipped. On a mapped bank
+ * the kernel is asked to read the text ahead (MADV_WILLNEED).
+ *
+ * @param bank Pointer to PagedBank
+ * @param index Question index
+ */
+void paged_bank_prefetch(PagedBank *bank, size_t index);
+
+/**
+ * @brief Wait until the prefetch thread has served every pending request
+ *
+ * Returns at once if there is no prefetch thread.
+ *
+ * @param bank Pointer to PagedBank
+ */
+void paged_bank_prefetch_wait(PagedBank *bank);
+
+/**
+ * @brief Pick a random unused question
+ *
+ * @param bank Pointer to PagedBank
+ * @param difficulty Difficulty filter (-1 for any)
+ * @param used Flags of questions already asked (may be NULL)
+ * @return size_t Question index, SIZE_MAX if none is left
+ */
+size_t paged_bank_pick(PagedBank *bank, int difficulty, const bool *used);
+
+/**
+ * @brief Pin the records and difficulty index in RAM with mlock()
+ *
+ * The locked bytes are already counted in the memory cap. The lock is
+ * released by paged_bank_close().
+ *
+ * @param bank Pointer to PagedBank
+ * @return int 0 on success, -1 if the kernel refused (errno is set)
+ */
+int paged_bank_lock(PagedBank *bank);
+
+/**
+ * @brief Copy the cache counters
+ *
+ * @param bank Pointer to PagedBank
+ * @param stats Receives the counters
+ */
+void paged_bank_stats(PagedBank *bank, PagedStats *stats);
+
+/**
+ * @brief Stop the prefetch thread and free the bank
+ *
+ * @param bank Pointer to PagedBank
+ */
+void paged_bank_close(PagedBank *bank);
+
+#endif /* PAGED_H */
@@ -0,0 +1,140 @@
+/**
+ * @file pool.c
+ * @brief Implementation of the per-worker session pools
+ */
+
+#include "pool.h"
+#include "metrics.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Smallest block size (header included) as a power of two
+ */
+#define POOL_MIN_SHIFT 5
+
+/**
+ * @brief Header stored in front of every block
+ *
+ * Sized and aligned like max_align_t so the payload keeps malloc's
+ * alignment.
+ */
+union PoolBlock {
+    struct {
+        PoolBlock *next;                  /**< Next free block in the class */
+        unsigned size_class;              /**< Class the block belongs to */
+    } h;
+    max_align_t align;
+};
+
+/**
+ * @brief Size class holding size payload bytes, -1 if too large
+ */
+static int size_class_for(size_t size) {
+    if (size > ((size_t)1 << (POOL_MIN_SHIFT + POOL_SIZE_CLASSES - 1)) - sizeof(PoolBlock)) {
+        return -1;
+    }
+    size_t total = size + sizeof(PoolBlock);
+    int cls = 0;
+    while (((size_t)1 << (POOL_MIN_SHIFT + cls)) < total) {
+        cls++;
+    }
+    return cls;
+}
+
+int session_pool_init(SessionPool *pool, size_t max_cached) {
+    if (pool == NULL) {
+        return -1;
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->max_cached = max_cached > 0 ? max_cached : POOL_DEFAULT_MAX_CACHED;
+    return 0;
+}
+
+void* session_pool_alloc(SessionPool *pool, size_t size) {
+    if (pool == NULL) {
+        return NULL;
+    }
+    int cls = size_class_for(size);
+    if (cls < 0) {
+        print_error("Pool allocation of %zu bytes is too large", size);
+        return NULL;
+    }
+
+    PoolBlock *block = pool->free_lists[cls];
+    if (block != NULL) {
+        pool->free_lists[cls] = block->h.next;
+        pool->cached[cls]--;
+        pool->hits++;
+    } else {
+        block = (PoolBlock*)malloc((size_t)1 << (POOL_MIN_SHIFT + cls));
+        if (block == NULL) {
+            return NULL;
+        }
+        block->h.size_class = (unsigned)cls;
+        pool->misses++;
+    }
+    block->h.next = NULL;
+    return block + 1;
+}
+
+void* session_pool_calloc(SessionPool *pool, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = session_pool_alloc(pool, count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void session_pool_release(SessionPool *pool, void *ptr) {
+    if (pool == NULL || ptr == NULL) {
+        return;
+    }
+    PoolBlock *block = (PoolBlock*)ptr - 1;
+    unsigned cls = block->h.size_class;
+    if (pool->cached[cls] >= pool->max_cached) {
+        free(block);
+        return;
+    }
+    block->h.next = pool->free_lists[cls];
+    pool->free_lists[cls] = block;
+    pool->cached[cls]++;
+}
+
+double session_pool_hit_rate(const SessionPool *pool) {
+    if (pool == NULL || pool->hits + pool->misses == 0) {
+        return 0.0;
+    }
+    return (double)pool->hits / (double)(pool->hits + pool->misses);
+}
+
+void session_pool_publish(const SessionPool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    metrics_add("pool.hits", (double)pool->hits);
+    metrics_add("pool.misses", (double)pool->misses);
+    double hits = metrics_get("pool.hits");
+    double total = hits + metrics_get("pool.misses");
+    metrics_set("pool.hit_rate", total > 0.0 ? hits / total : 0.0);
+}
+
+void session_pool_destroy(SessionPool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    for (int cls = 0; cls < POOL_SIZE_CLASSES; cls++) {
+        PoolBlock *block = pool->free_lists[cls];
+        while (block != NULL) {
+            PoolBlock *next = block->h.next;
+            free(block);
+            block = next;
+        }
+        pool->free_lists[cls] = NULL;
+        pool->cached[cls] = 0;
+    }
+}
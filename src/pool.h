@@ -0,0 +1,106 @@
+/**
+ * @file pool.h
+ * @brief Per-worker free-list pools for session objects and buffers
+ *
+ * A SessionPool keeps freed blocks on power-of-two size-class free lists
+ * instead of handing them back to the allocator, so a worker that keeps
+ * starting and ending games reuses the same GameState, Player arrays and
+ * used-question flags and, once warm, makes no allocator calls at all.
+ *
+ * A pool belongs to one worker thread and takes no locks. Blocks must be
+ * released to the pool they came from.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of size classes (32 bytes up to 64 GB)
+ */
+#define POOL_SIZE_CLASSES 32
+
+/**
+ * @brief Default number of free blocks kept per size class
+ */
+#define POOL_DEFAULT_MAX_CACHED 4096
+
+typedef union PoolBlock PoolBlock;
+
+/**
+ * @brief Single-owner size-class free-list pool
+ */
+typedef struct {
+    PoolBlock *free_lists[POOL_SIZE_CLASSES]; /**< Cached blocks per class */
+    size_t cached[POOL_SIZE_CLASSES];     /**< Length of each free list */
+    size_t max_cached;                    /**< Free blocks kept per class; extras are freed */
+    uint64_t hits;                        /**< Allocations served from a free list */
+    uint64_t misses;                      /**< Allocations that went to malloc */
+} SessionPool;
+
+/**
+ * @brief Initialize an empty pool
+ *
+ * @param pool Pool to initialize
+ * @param max_cached Free blocks kept per size class (0 for the default)
+ * @return int 0 on success, -1 on error
+ */
+int session_pool_init(SessionPool *pool, size_t max_cached);
+
+/**
+ * @brief Allocate an uninitialized block of at least size bytes
+ *
+ * @param pool Pool to allocate from
+ * @param size Bytes needed
+ * @return void* Block aligned like malloc, NULL on error
+ */
+void* session_pool_alloc(SessionPool *pool, size_t size);
+
+/**
+ * @brief Allocate a zeroed block for count elements of size bytes
+ *
+ * @param pool Pool to allocate from
+ * @param count Number of elements
+ * @param size Size of one element
+ * @return void* Zeroed block, NULL on error or overflow
+ */
+void* session_pool_calloc(SessionPool *pool, size_t count, size_t size);
+
+/**
+ * @brief Return a block to its pool's free list
+ *
+ * @param pool Pool the block was allocated from
+ * @param ptr Block (NULL is ignored)
+ */
+void session_pool_release(SessionPool *pool, void *ptr);
+
+/**
+ * @brief Fraction of allocations served without malloc
+ *
+ * @param pool Pool to inspect
+ * @return double Hit rate in [0, 1], 0 before the first allocation
+ */
+double session_pool_hit_rate(const SessionPool *pool);
+
+/**
+ * @brief Add the pool's counters to the process metrics
+ *
+ * Adds to pool.hits and pool.misses and recomputes pool.hit_rate from
+ * the totals, so each worker can publish its own pool.
+ *
+ * @param pool Pool to publish
+ */
+void session_pool_publish(const SessionPool *pool);
+
+/**
+ * @brief Free every cached block
+ *
+ * Blocks still in use must be released before the pool is destroyed.
+ *
+ * @param pool Pool to destroy
+ */
+void session_pool_destroy(SessionPool *pool);
+
+#endif /* POOL_H */
@@ -0,0 +1,38 @@
+/**
+ * @file probes.h
+ * @brief Static tracepoints (USDT) on the game and loader hot paths
+ * 
+ * When <sys/sdt.h> is available at build time (TRIVIA_HAVE_SDT), each
+ * probe compiles to a single nop plus an ELF note, so it costs nothing
+ * until a tracer attaches. Otherwise the macros expand to no-ops.
+ * 
+ * Provider: trivia
+ * - bank_loaded(count, bytes)                 questions loaded or a pack opened
+ * - question_drawn(state, index, difficulty)  question picked for a game
+ * - question_shown(state, index)              question printed to the player
+ * - answer_received(state, answer, remaining) answer handed to grading
+ * - answer_graded(state, correct, points)     answer scored
+ * - timer_expired(timer, seconds)             countdown reached zero
+ * 
+ * Example:
+ *   bpftrace -e 'usdt:./TerminalTriviaGame:trivia:answer_graded { @[arg1] = count(); }'
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#if defined(TRIVIA_HAVE_SDT)
+
+#include <sys/sdt.h>
+
+#define TRIVIA_PROBE2(name, a, b)       DTRACE_PROBE2(trivia, name, a, b)
+#define TRIVIA_PROBE3(name, a, b, c)    DTRACE_PROBE3(trivia, name, a, b, c)
+
+#else
+
+#define TRIVIA_PROBE2(name, a, b)       do { (void)(a); (void)(b); } while (0)
+#define TRIVIA_PROBE3(name, a, b, c)    do { (void)(a); (void)(b); (void)(c); } while (0)
+
+#endif /* TRIVIA_HAVE_SDT */
+
+#endif /* PROBES_H */
@@ -5,21 +5,104 @@
 
 #include "questions.h"
 #include "utils.h"
+#include "probes.h"
+#include "utf8.h"
 #include <time.h>
 #include <ctype.h>
+#include <strings.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
 
-static int parse_json_question(const char *json_line, Question *q) {
-    if (json_line == NULL || q == NULL) {
-        return -1;
+/**
+ * @brief Random index picks tried before scanning for unused questions
+ */
+#define RANDOM_DRAW_ATTEMPTS 8
+
+static pthread_once_t random_seed_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Seed rand() once per process
+ *
+ * Reseeding from time() on every draw returned the same index for every
+ * draw within the same second and cost a full srand() per call.
+ */
+static void seed_random(void) {
+    srand((unsigned int)time(NULL));
+}
+
+/**
+ * @brief Random number below @p n from @p seed, or from rand() if NULL
+ */
+static size_t random_below(uint32_t *seed, size_t n) {
+    if (seed == NULL) {
+        pthread_once(&random_seed_once, seed_random);
+        return (size_t)rand() % n;
+    }
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return (size_t)(((uint64_t)x * n) >> 32);
+}
+
+/**
+ * @brief Find a top-level key of an object and return where its value starts
+ *
+ * Steps over strings with the escape rules of question_scan_objects(), so
+ * text such as an option reading "id" is never taken for the key itself.
+ *
+ * @param object NUL-terminated object text
+ * @param name Key to look for
+ * @return char* First byte after the key's ':', or NULL if absent
+ */
+static char* find_field(char *object, const char *name) {
+    size_t name_len = strlen(name);
+    int depth = 0;
+    for (char *p = object; *p != '\0'; p++) {
+        if (*p == '{' || *p == '[') {
+            depth++;
+        } else if (*p == '}' || *p == ']') {
+            depth--;
+        } else if (*p == '"') {
+            char *start = p + 1;
+            char *end = start;
+            while (*end != '\0' && *end != '"') {
+                end += end[0] == '\\' && end[1] != '\0' ? 2 : 1;
+            }
+            if (*end == '\0') {
+                return NULL;
+            }
+            p = end;
+            if (depth == 1 && (size_t)(end - start) == name_len &&
+                memcmp(start, name, name_len) == 0) {
+                char *after = end + 1;
+                while (isspace((unsigned char)*after)) after++;
+                if (*after == ':') {
+                    return after + 1;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parse the "id", "question" and "options" fields of an object
+ *
+ * @param line Writable NUL-terminated copy of the object
+ * @param q Receives the ID and text fields
+ * @return int Number of options parsed, -1 on error
+ */
+static int parse_json_text(char *line, Question *q) {
+    char *id_start = find_field(line, "id");
+    if (id_start != NULL) {
+        long id = strtol(id_start, NULL, 10);
+        q->id = id > 0 && id <= (long)UINT32_MAX ? (uint32_t)id : 0;
     }
     
-    char line[1024];
-    strncpy(line, json_line, sizeof(line) - 1);
-    line[sizeof(line) - 1] = '\0';
-    
-    char *q_start = strstr(line, "\"question\"");
-    if (q_start == NULL) return -1;
-    q_start = strchr(q_start, ':');
+    char *q_start = find_field(line, "question");
     if (q_start == NULL) return -1;
     q_start = strchr(q_start, '"');
     if (q_start == NULL) return -1;
@@ -29,68 +112,103 @@ static int parse_json_question(const char *json_line, Question *q) {
     *q_end = '\0';
     strncpy(q->question, q_start, MAX_QUESTION_LEN - 1);
     q->question[MAX_QUESTION_LEN - 1] = '\0';
+    utf8_trim_partial(q->question);
     *q_end = '"';
     
-    char *opt_start = strstr(line, "\"options\"");
+    char *opt_start = find_field(line, "options");
     if (opt_start == NULL) return -1;
     opt_start = strchr(opt_start, '[');
     if (opt_start == NULL) return -1;
     opt_start++;
     
     int opt_idx = 0;
-    while (opt_idx < MAX_OPTIONS) {
-        char *opt_begin = strchr(opt_start, '"');
-        if (opt_begin == NULL) break;
-        opt_begin++;
+    while (isspace((unsigned char)*opt_start)) opt_start++;
+    while (*opt_start != ']') {
+        if (opt_idx >= MAX_OPTIONS) break;
+        if (*opt_start != '"') return -1;
+        char *opt_begin = opt_start + 1;
         char *opt_end = strchr(opt_begin, '"');
-        if (opt_end == NULL) break;
+        if (opt_end == NULL || opt_end == opt_begin) return -1;
         *opt_end = '\0';
         strncpy(q->options[opt_idx], opt_begin, MAX_ANSWER_LEN - 1);
         q->options[opt_idx][MAX_ANSWER_LEN - 1] = '\0';
+        utf8_trim_partial(q->options[opt_idx]);
         *opt_end = '"';
         opt_idx++;
         opt_start = opt_end + 1;
-        if (*opt_start == ']') break;
+        while (isspace((unsigned char)*opt_start)) opt_start++;
+        if (*opt_start == ',') {
+            opt_start++;
+            while (isspace((unsigned char)*opt_start)) opt_start++;
+        } else if (*opt_start != ']') {
+            return -1;
+        }
     }
     
-    char *corr_start = strstr(line, "\"correct\"");
-    if (corr_start == NULL) return -1;
-    corr_start = strchr(corr_start, ':');
+    return opt_idx;
+}
+
+static int parse_json_question(const char *json_line, Question *q) {
+    if (json_line == NULL || q == NULL) {
+        return -1;
+    }
+    
+    char line[MAX_OBJECT_LEN];
+    size_t line_len = strnlen(json_line, sizeof(line) - 1);
+    memcpy(line, json_line, line_len);
+    line[line_len] = '\0';
+    
+    int opt_idx = parse_json_text(line, q);
+    if (opt_idx < 0) {
+        return -1;
+    }
+    
+    char *corr_start = find_field(line, "correct");
     if (corr_start == NULL) return -1;
-    corr_start++;
-    while (isspace(*corr_start)) corr_start++;
-    q->correct_answer = atoi(corr_start);
-    if (q->correct_answer < 0 || q->correct_answer >= opt_idx) {
+    while (isspace((unsigned char)*corr_start)) corr_start++;
+    long correct = strtol(corr_start, NULL, 10);
+    if (correct < 0 || correct >= opt_idx) {
         return -1;
     }
+    q->correct_answer = (int)correct;
     
-    char *diff_start = strstr(line, "\"difficulty\"");
+    char *diff_start = find_field(line, "difficulty");
     if (diff_start == NULL) {
         q->difficulty = DIFFICULTY_EASY;
     } else {
-        diff_start = strchr(diff_start, ':');
+        diff_start = strchr(diff_start, '"');
         if (diff_start == NULL) {
             q->difficulty = DIFFICULTY_EASY;
         } else {
-            diff_start = strchr(diff_start, '"');
-            if (diff_start == NULL) {
+            diff_start++;
+            if (strncmp(diff_start, "easy", 4) == 0) {
                 q->difficulty = DIFFICULTY_EASY;
+            } else if (strncmp(diff_start, "medium", 6) == 0) {
+                q->difficulty = DIFFICULTY_MEDIUM;
+            } else if (strncmp(diff_start, "hard", 4) == 0) {
+                q->difficulty = DIFFICULTY_HARD;
             } else {
-                diff_start++;
-                if (strncmp(diff_start, "easy", 4) == 0) {
-                    q->difficulty = DIFFICULTY_EASY;
-                } else if (strncmp(diff_start, "medium", 6) == 0) {
-                    q->difficulty = DIFFICULTY_MEDIUM;
-                } else if (strncmp(diff_start, "hard", 4) == 0) {
-                    q->difficulty = DIFFICULTY_HARD;
-                } else {
-                    q->difficulty = DIFFICULTY_EASY;
-                }
+                q->difficulty = DIFFICULTY_EASY;
             }
         }
     }
     
     q->category = CATEGORY_GENERAL;
+    char *cat_start = find_field(line, "category");
+    if (cat_start != NULL && (cat_start = strchr(cat_start, '"')) != NULL) {
+        char name[32];
+        size_t n = 0;
+        cat_start++;
+        while (cat_start[n] != '"' && cat_start[n] != '\0' && n < sizeof(name) - 1) {
+            name[n] = cat_start[n];
+            n++;
+        }
+        name[n] = '\0';
+        int category = category_from_name(name);
+        if (category >= 0) {
+            q->category = (Category)category;
+        }
+    }
     
     return 0;
 }
@@ -103,6 +221,12 @@ int question_bank_init(QuestionBank *bank) {
     bank->capacity = 10;
     bank->count = 0;
     bank->questions = (Question*)malloc(bank->capacity * sizeof(Question));
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        bank->by_difficulty[d] = NULL;
+        bank->difficulty_count[d] = 0;
+    }
+    bank->index_valid = false;
+    bank->locked_bytes = 0;
     
     if (bank->questions == NULL) {
         print_error("Failed to allocate memory for question bank");
@@ -130,77 +254,411 @@ int question_bank_add(QuestionBank *bank, const Question *question) {
     }
     
     bank->questions[bank->count] = *question;
+    question_compute_widths(&bank->questions[bank->count]);
     bank->count++;
+    bank->index_valid = false;
     
     return 0;
 }
 
-int question_bank_load_from_json(QuestionBank *bank, const char *filename) {
-    if (bank == NULL || filename == NULL) {
-        return -1;
+void question_compute_widths(Question *question) {
+    if (question == NULL) {
+        return;
     }
-    
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        print_error("Failed to open questions file: %s", filename);
+    question->question_width = (uint16_t)utf8_display_width(question->question);
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        question->option_widths[i] = (uint16_t)utf8_display_width(question->options[i]);
+    }
+}
+
+int question_scan_objects(const char *data, size_t len,
+                          int (*callback)(const char *object, void *ctx), void *ctx) {
+    if (data == NULL && len > 0) {
         return -1;
     }
     
-    char buffer[8192];
-    size_t buffer_pos = 0;
-    int loaded = 0;
-    int in_object = 0;
+    char object[MAX_OBJECT_LEN];
+    const char *obj_start = NULL;
+    int accepted = 0;
     int brace_count = 0;
+    bool in_string = false;
+    bool escaped = false;
     
-    int c;
-    while ((c = fgetc(file)) != EOF) {
-        if (buffer_pos >= sizeof(buffer) - 1) {
-            buffer_pos = 0;
-            brace_count = 0;
-            in_object = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
             continue;
         }
         
-        buffer[buffer_pos++] = (char)c;
-        
-        if (c == '{') {
-            if (!in_object) {
-                buffer_pos = 1;
-                buffer[0] = '{';
-                in_object = 1;
+        if (c == '"') {
+            in_string = obj_start != NULL;
+        } else if (c == '{') {
+            if (obj_start == NULL) {
+                obj_start = &data[i];
                 brace_count = 1;
             } else {
                 brace_count++;
             }
-        } else if (c == '}') {
+        } else if (c == '}' && obj_start != NULL) {
             brace_count--;
-            if (in_object && brace_count == 0) {
-                buffer[buffer_pos] = '\0';
-                Question q;
-                if (parse_json_question(buffer, &q) == 0) {
-                    if (question_bank_add(bank, &q) == 0) {
-                        loaded++;
+            if (brace_count == 0) {
+                size_t obj_len = (size_t)(&data[i] - obj_start) + 1;
+                if (obj_len < sizeof(object) && utf8_validate(obj_start, obj_len)) {
+                    memcpy(object, obj_start, obj_len);
+                    object[obj_len] = '\0';
+                    if (callback(object, ctx) == 0) {
+                        accepted++;
                     }
                 }
-                buffer_pos = 0;
-                in_object = 0;
-                brace_count = 0;
+                obj_start = NULL;
             }
-        } else if (c == '[' || c == ']') {
-            continue;
         }
     }
     
+    return accepted;
+}
+
+int question_parse_text(const char *object, Question *q) {
+    if (object == NULL || q == NULL) {
+        return -1;
+    }
+    
+    char line[MAX_OBJECT_LEN];
+    size_t line_len = strnlen(object, sizeof(line) - 1);
+    memcpy(line, object, line_len);
+    line[line_len] = '\0';
+    
+    memset(q, 0, sizeof(*q));
+    return parse_json_text(line, q);
+}
+
+int question_parse_object(const char *object, Question *q) {
+    if (object == NULL || q == NULL) {
+        return -1;
+    }
+    memset(q, 0, sizeof(*q));
+    return parse_json_question(object, q);
+}
+
+static int add_parsed_question(const char *object, void *ctx) {
+    QuestionBank *bank = (QuestionBank*)ctx;
+    Question q;
+    if (question_parse_object(object, &q) != 0) {
+        return -1;
+    }
+    return question_bank_add(bank, &q);
+}
+
+int question_bank_load_from_buffer(QuestionBank *bank, const char *data, size_t len) {
+    if (bank == NULL || (data == NULL && len > 0)) {
+        return -1;
+    }
+    
+    int loaded = question_scan_objects(data, len, add_parsed_question, bank);
+    
+    TRIVIA_PROBE2(bank_loaded, loaded, len);
+    return loaded;
+}
+
+int question_bank_load_from_json(QuestionBank *bank, const char *filename) {
+    if (bank == NULL || filename == NULL) {
+        return -1;
+    }
+    
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(file, &data, &len);
     fclose(file);
+    if (err != UTILS_SUCCESS) {
+        print_error("Failed to read questions file: %s", filename);
+        return -1;
+    }
+    
+    int loaded = question_bank_load_from_buffer(bank, data, len);
+    free(data);
+    
+    if (loaded > 0 && question_bank_build_index(bank) != 0) {
+        return -1;
+    }
     return loaded;
 }
 
+static uint64_t hash_question(const Question *q) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char*)q->question; *p; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        h = (h ^ 0xFF) * 1099511628211ULL;
+        for (const unsigned char *p = (const unsigned char*)q->options[i]; *p; p++) {
+            h = (h ^ *p) * 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+static bool questions_equal(const Question *a, const Question *b) {
+    if (strcmp(a->question, b->question) != 0) {
+        return false;
+    }
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        if (strcmp(a->options[i], b->options[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void compact_bank(QuestionBank *bank, const bool *remove) {
+    size_t out = 0;
+    for (size_t i = 0; i < bank->count; i++) {
+        if (!remove[i]) {
+            if (out != i) {
+                bank->questions[out] = bank->questions[i];
+            }
+            out++;
+        }
+    }
+    bank->count = out;
+    bank->index_valid = false;
+}
+
+int question_bank_dedup(QuestionBank *bank) {
+    if (bank == NULL) {
+        return -1;
+    }
+    if (bank->count < 2) {
+        return 0;
+    }
+    
+    size_t slots = 16;
+    while (slots < bank->count * 2) {
+        slots *= 2;
+    }
+    size_t *table = (size_t*)malloc(slots * sizeof(size_t));
+    uint64_t *hashes = (uint64_t*)malloc(bank->count * sizeof(uint64_t));
+    bool *remove = (bool*)calloc(bank->count, sizeof(bool));
+    if (table == NULL || hashes == NULL || remove == NULL) {
+        free(table);
+        free(hashes);
+        free(remove);
+        return -1;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        table[i] = SIZE_MAX;
+    }
+    
+    int removed = 0;
+    for (size_t i = 0; i < bank->count; i++) {
+        hashes[i] = hash_question(&bank->questions[i]);
+        size_t slot = (size_t)hashes[i] & (slots - 1);
+        while (table[slot] != SIZE_MAX) {
+            size_t other = table[slot];
+            if (hashes[other] == hashes[i] &&
+                questions_equal(&bank->questions[other], &bank->questions[i])) {
+                remove[i] = true;
+                removed++;
+                break;
+            }
+            slot = (slot + 1) & (slots - 1);
+        }
+        if (!remove[i]) {
+            table[slot] = i;
+        }
+    }
+    
+    if (removed > 0) {
+        compact_bank(bank, remove);
+    }
+    
+    free(table);
+    free(hashes);
+    free(remove);
+    return removed;
+}
+
+int question_option_count(const Question *question) {
+    if (question == NULL) {
+        return 0;
+    }
+    int count = 0;
+    while (count < MAX_OPTIONS && question->options[count][0] != '\0') {
+        count++;
+    }
+    return count;
+}
+
+int question_bank_validate(QuestionBank *bank) {
+    if (bank == NULL) {
+        return -1;
+    }
+    if (bank->count == 0) {
+        return 0;
+    }
+    
+    bool *remove = (bool*)calloc(bank->count, sizeof(bool));
+    if (remove == NULL) {
+        return -1;
+    }
+    
+    int removed = 0;
+    for (size_t i = 0; i < bank->count; i++) {
+        const Question *q = &bank->questions[i];
+        int options = question_option_count(q);
+        if (q->question[0] == '\0' || options < 2 ||
+            q->correct_answer < 0 || q->correct_answer >= options ||
+            (int)q->difficulty < 0 || q->difficulty >= DIFFICULTY_COUNT) {
+            remove[i] = true;
+            removed++;
+        }
+    }
+    
+    if (removed > 0) {
+        compact_bank(bank, remove);
+    }
+    
+    free(remove);
+    return removed;
+}
+
+int question_bank_build_index(QuestionBank *bank) {
+    if (bank == NULL) {
+        return -1;
+    }
+    
+    size_t counts[DIFFICULTY_COUNT] = { 0 };
+    for (size_t i = 0; i < bank->count; i++) {
+        Difficulty d = bank->questions[i].difficulty;
+        if ((int)d >= 0 && d < DIFFICULTY_COUNT) {
+            counts[d]++;
+        }
+    }
+    
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        size_t *list = (size_t*)realloc(bank->by_difficulty[d], 
+                                        (counts[d] > 0 ? counts[d] : 1) * sizeof(size_t));
+        if (list == NULL) {
+            print_error("Failed to allocate memory for difficulty index");
+            bank->index_valid = false;
+            return -1;
+        }
+        bank->by_difficulty[d] = list;
+        bank->difficulty_count[d] = 0;
+    }
+    
+    for (size_t i = 0; i < bank->count; i++) {
+        Difficulty d = bank->questions[i].difficulty;
+        if ((int)d >= 0 && d < DIFFICULTY_COUNT) {
+            bank->by_difficulty[d][bank->difficulty_count[d]++] = i;
+        }
+    }
+    
+    bank->index_valid = true;
+    return 0;
+}
+
+int question_bank_prepare(QuestionBank *bank, QuestionPrepareReport *report) {
+    if (bank == NULL) {
+        return -1;
+    }
+    QuestionPrepareReport local;
+    if (report == NULL) {
+        report = &local;
+    }
+    memset(report, 0, sizeof(*report));
+    
+    double mark = monotonic_ms();
+    report->duplicates = question_bank_dedup(bank);
+    double now = monotonic_ms();
+    report->dedup_ms = now - mark;
+    mark = now;
+    report->invalid = question_bank_validate(bank);
+    now = monotonic_ms();
+    report->validate_ms = now - mark;
+    mark = now;
+    if (report->duplicates < 0 || report->invalid < 0 || question_bank_build_index(bank) != 0) {
+        return -1;
+    }
+    report->index_ms = monotonic_ms() - mark;
+    return (int)bank->count;
+}
+
+int question_bank_copy(QuestionBank *dst, const QuestionBank *src) {
+    if (dst == NULL || src == NULL || question_bank_init(dst) != 0) {
+        return -1;
+    }
+    if (src->count > dst->capacity) {
+        Question *questions = (Question*)realloc(dst->questions, src->count * sizeof(Question));
+        if (questions == NULL) {
+            print_error("Failed to allocate memory for question bank");
+            question_bank_free(dst);
+            return -1;
+        }
+        dst->questions = questions;
+        dst->capacity = src->count;
+    }
+    memcpy(dst->questions, src->questions, src->count * sizeof(Question));
+    dst->count = src->count;
+    if (question_bank_build_index(dst) != 0) {
+        question_bank_free(dst);
+        return -1;
+    }
+    return 0;
+}
+
+int question_bank_lock(QuestionBank *bank) {
+    if (bank == NULL || bank->questions == NULL || bank->locked_bytes > 0) {
+        return 0;
+    }
+    size_t bytes = bank->count * sizeof(Question);
+    if (bytes > 0 && mlock(bank->questions, bytes) != 0) {
+        return -1;
+    }
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        size_t index_bytes = bank->difficulty_count[d] * sizeof(size_t);
+        if (index_bytes > 0 && mlock(bank->by_difficulty[d], index_bytes) == 0) {
+            bytes += index_bytes;
+        }
+    }
+    bank->locked_bytes = bytes;
+    return 0;
+}
+
 void question_bank_free(QuestionBank *bank) {
     if (bank != NULL && bank->questions != NULL) {
+        if (bank->locked_bytes > 0) {
+            munlock(bank->questions, bank->count * sizeof(Question));
+            for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+                if (bank->difficulty_count[d] > 0) {
+                    munlock(bank->by_difficulty[d], bank->difficulty_count[d] * sizeof(size_t));
+                }
+            }
+            bank->locked_bytes = 0;
+        }
         free(bank->questions);
         bank->questions = NULL;
         bank->count = 0;
         bank->capacity = 0;
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            free(bank->by_difficulty[d]);
+            bank->by_difficulty[d] = NULL;
+            bank->difficulty_count[d] = 0;
+        }
+        bank->index_valid = false;
     }
 }
 
@@ -209,6 +667,15 @@ Question* question_bank_get_random(QuestionBank *bank, int difficulty) {
         return NULL;
     }
     
+    if (bank->index_valid && difficulty >= 0 && difficulty < DIFFICULTY_COUNT) {
+        size_t n = bank->difficulty_count[difficulty];
+        if (n == 0) {
+            return NULL;
+        }
+        pthread_once(&random_seed_once, seed_random);
+        return &bank->questions[bank->by_difficulty[difficulty][(size_t)rand() % n]];
+    }
+    
     int valid_count = 0;
     int *valid_indices = NULL;
     
@@ -233,7 +700,7 @@ Question* question_bank_get_random(QuestionBank *bank, int difficulty) {
         valid_count = (int)bank->count;
     }
     
-    srand((unsigned int)time(NULL));
+    pthread_once(&random_seed_once, seed_random);
     int random_idx = rand() % valid_count;
     
     int actual_idx;
@@ -249,10 +716,33 @@ Question* question_bank_get_random(QuestionBank *bank, int difficulty) {
 
 Question* question_bank_get_random_unused(QuestionBank *bank, int difficulty, 
                                          const bool *used_questions, int used_count) {
+    return question_bank_get_random_unused_r(bank, difficulty, used_questions, used_count, NULL);
+}
+
+Question* question_bank_get_random_unused_r(QuestionBank *bank, int difficulty,
+                                           const bool *used_questions, int used_count,
+                                           uint32_t *seed) {
     if (bank == NULL || bank->count == 0) {
         return NULL;
     }
     
+    /* Fast path: rejection-sample the index a few times before falling
+     * back to collecting every unused candidate. */
+    if (bank->index_valid) {
+        bool filtered = difficulty >= 0 && difficulty < DIFFICULTY_COUNT;
+        size_t n = filtered ? bank->difficulty_count[difficulty] : bank->count;
+        if (n == 0) {
+            return NULL;
+        }
+        for (int attempt = 0; attempt < RANDOM_DRAW_ATTEMPTS; attempt++) {
+            size_t pick = random_below(seed, n);
+            size_t idx = filtered ? bank->by_difficulty[difficulty][pick] : pick;
+            if (used_questions == NULL || idx >= (size_t)used_count || !used_questions[idx]) {
+                return &bank->questions[idx];
+            }
+        }
+    }
+    
     int valid_count = 0;
     int *valid_indices = NULL;
     
@@ -294,8 +784,7 @@ Question* question_bank_get_random_unused(QuestionBank *bank, int difficulty,
         }
     }
     
-    srand((unsigned int)time(NULL));
-    int random_idx = rand() % valid_count;
+    int random_idx = (int)random_below(seed, (size_t)valid_count);
     int actual_idx = valid_indices[random_idx];
     
     free(valid_indices);
@@ -322,3 +811,29 @@ const char* category_to_string(Category category) {
     }
 }
 
+/**
+ * @brief Index of a name in a table, ignoring case
+ */
+static int lookup_name(const char *name, const char *const *names, int count) {
+    if (name == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int difficulty_from_name(const char *name) {
+    static const char *const names[DIFFICULTY_COUNT] = { "easy", "medium", "hard" };
+    return lookup_name(name, names, DIFFICULTY_COUNT);
+}
+
+int category_from_name(const char *name) {
+    static const char *const names[CATEGORY_COUNT] = {
+        "general", "science", "history", "sports", "entertainment"
+    };
+    return lookup_name(name, names, CATEGORY_COUNT);
+}
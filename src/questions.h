@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @brief Maximum length for question text
@@ -31,6 +32,11 @@
  */
 #define MAX_OPTIONS 4
 
+/**
+ * @brief Maximum length of one question object in a JSON pack
+ */
+#define MAX_OBJECT_LEN 8192
+
 /**
  * @brief Difficulty levels for questions
  */
@@ -62,6 +68,9 @@ typedef struct {
     int correct_answer;                   /**< Index of correct answer (0-3) */
     Difficulty difficulty;                /**< Difficulty level */
     Category category;                    /**< Question category */
+    uint32_t id;                          /**< Stable ID from the pack (0 if none) */
+    uint16_t question_width;              /**< Display columns of question */
+    uint16_t option_widths[MAX_OPTIONS];  /**< Display columns of each option */
 } Question;
 
 /**
@@ -71,6 +80,10 @@ typedef struct {
     Question *questions;                  /**< Array of questions */
     size_t count;                         /**< Number of questions */
     size_t capacity;                      /**< Current capacity of array */
+    size_t *by_difficulty[DIFFICULTY_COUNT]; /**< Question indices per difficulty */
+    size_t difficulty_count[DIFFICULTY_COUNT]; /**< Length of each index list */
+    bool index_valid;                     /**< Whether the index matches the questions */
+    size_t locked_bytes;                  /**< Bytes pinned by question_bank_lock() */
 } QuestionBank;
 
 /**
@@ -84,6 +97,9 @@ int question_bank_init(QuestionBank *bank);
 /**
  * @brief Add a question to the question bank
  * 
+ * The stored copy gets its display widths computed, so callers need not
+ * fill them in.
+ * 
  * @param bank Pointer to QuestionBank
  * @param question Question to add
  * @return int 0 on success, -1 on error
@@ -93,12 +109,162 @@ int question_bank_add(QuestionBank *bank, const Question *question);
 /**
  * @brief Load questions from a JSON file
  * 
+ * Reads the whole file, parses it and builds the difficulty index. The
+ * bank keeps every parsed question in pack order; callers that play it
+ * follow up with question_bank_prepare().
+ * 
  * @param bank Pointer to QuestionBank to populate
  * @param filename Path to JSON file
  * @return int Number of questions loaded, -1 on error
  */
 int question_bank_load_from_json(QuestionBank *bank, const char *filename);
 
+/**
+ * @brief Call a function for every top-level JSON object in a buffer
+ * 
+ * Objects longer than MAX_OBJECT_LEN or containing invalid UTF-8 are
+ * skipped. The object passed to the callback is a NUL-terminated copy.
+ * 
+ * @param data JSON text (need not be NUL-terminated)
+ * @param len Length of data in bytes
+ * @param callback Called per object; returns 0 if it accepted the object
+ * @param ctx Opaque pointer passed to callback
+ * @return int Number of accepted objects, -1 on error
+ */
+int question_scan_objects(const char *data, size_t len,
+                          int (*callback)(const char *object, void *ctx), void *ctx);
+
+/**
+ * @brief Parse one JSON question object
+ * 
+ * @param object NUL-terminated JSON object, as passed by question_scan_objects()
+ * @param q Receives the question
+ * @return int 0 on success, -1 if a required field is missing or invalid
+ */
+int question_parse_object(const char *object, Question *q);
+
+/**
+ * @brief Parse only the ID, question text and options of one JSON object
+ * 
+ * Used for translated variants, which carry no answer or difficulty.
+ * 
+ * @param object NUL-terminated JSON object
+ * @param q Receives the ID and text fields (other fields are zeroed)
+ * @return int Number of options parsed, -1 on error
+ */
+int question_parse_text(const char *object, Question *q);
+
+/**
+ * @brief Compute the display widths stored in a question
+ * 
+ * @param question Pointer to Question to update
+ */
+void question_compute_widths(Question *question);
+
+/**
+ * @brief Parse questions from JSON text already in memory
+ * 
+ * Objects longer than MAX_OBJECT_LEN, containing invalid UTF-8 or
+ * missing required fields are skipped. Does not build the difficulty index.
+ * 
+ * @param bank Pointer to QuestionBank to populate
+ * @param data JSON text (need not be NUL-terminated)
+ * @param len Length of data in bytes
+ * @return int Number of questions loaded, -1 on error
+ */
+int question_bank_load_from_buffer(QuestionBank *bank, const char *data, size_t len);
+
+/**
+ * @brief Build the per-difficulty index used for fast random draws
+ * 
+ * Adding or removing questions invalidates the index; draws then fall
+ * back to scanning the bank until it is rebuilt.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @return int 0 on success, -1 on error
+ */
+int question_bank_build_index(QuestionBank *bank);
+
+/**
+ * @brief Remove exact duplicate questions (same text and options)
+ * 
+ * Keeps the first occurrence of each question.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @return int Number of questions removed, -1 on error
+ */
+int question_bank_dedup(QuestionBank *bank);
+
+/**
+ * @brief Remove questions that cannot be played
+ * 
+ * A question is invalid when its text is empty, it has fewer than two
+ * options, its correct index is out of range or its difficulty is unknown.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @return int Number of questions removed, -1 on error
+ */
+int question_bank_validate(QuestionBank *bank);
+
+/**
+ * @brief What question_bank_prepare() removed and how long each step took
+ */
+typedef struct {
+    int duplicates;                       /**< Exact duplicates removed */
+    int invalid;                          /**< Unplayable questions removed */
+    double dedup_ms;                      /**< Time spent removing duplicates */
+    double validate_ms;                   /**< Time spent validating */
+    double index_ms;                      /**< Time spent building the index */
+} QuestionPrepareReport;
+
+/**
+ * @brief Make a freshly parsed bank playable
+ * 
+ * Removes exact duplicates, then unplayable questions, then builds the
+ * difficulty index. Everything that loads a pack into a QuestionBank to
+ * play it (the game, libtrivia, the server, shards and the load
+ * generator) runs this after loading, so they all play the same bank;
+ * tools that report on a pack as written skip it. Binary packs the game
+ * plays in place (mapped or under --memory-cap) are not prepared: their
+ * records are checked when opened, but any duplicates in them are kept.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @param report Receives what was removed and the step timings (may be NULL)
+ * @return int Questions left, -1 on error
+ */
+int question_bank_prepare(QuestionBank *bank, QuestionPrepareReport *report);
+
+/**
+ * @brief Count the non-empty options of a question
+ * 
+ * @param question Pointer to Question
+ * @return int Number of options (0-MAX_OPTIONS)
+ */
+int question_option_count(const Question *question);
+
+/**
+ * @brief Make an independent copy of a bank and build its index
+ * 
+ * The copy's memory is first touched by the calling thread, so on a NUMA
+ * host it is placed on that thread's node.
+ * 
+ * @param dst Pointer to an uninitialized QuestionBank
+ * @param src Bank to copy
+ * @return int 0 on success, -1 on error
+ */
+int question_bank_copy(QuestionBank *dst, const QuestionBank *src);
+
+/**
+ * @brief Pin the question array and difficulty index in RAM with mlock()
+ * 
+ * Keeps the arrays every draw touches from being paged out. Call once the
+ * bank is complete; the lock is released by question_bank_free().
+ * 
+ * @param bank Pointer to QuestionBank
+ * @return int 0 on success, -1 if the kernel refused (errno is set)
+ */
+int question_bank_lock(QuestionBank *bank);
+
 /**
  * @brief Free all memory associated with a question bank
  * 
@@ -127,6 +293,24 @@ Question* question_bank_get_random(QuestionBank *bank, int difficulty);
 Question* question_bank_get_random_unused(QuestionBank *bank, int difficulty, 
                                          const bool *used_questions, int used_count);
 
+/**
+ * @brief Get a random unused question using a caller-owned RNG state
+ * 
+ * Same as question_bank_get_random_unused() but draws from the xorshift
+ * state at @p seed instead of the process-wide rand(), so concurrent
+ * sessions neither share nor contend on one generator.
+ * 
+ * @param bank Pointer to QuestionBank
+ * @param difficulty Optional difficulty filter (use -1 for any)
+ * @param used_questions Boolean array indicating which questions have been used
+ * @param used_count Number of questions already used
+ * @param seed Non-zero xorshift state, updated in place (NULL uses rand())
+ * @return Question* Pointer to question, or NULL if none found
+ */
+Question* question_bank_get_random_unused_r(QuestionBank *bank, int difficulty,
+                                           const bool *used_questions, int used_count,
+                                           uint32_t *seed);
+
 /**
  * @brief Get difficulty name as string
  * 
@@ -143,5 +327,21 @@ const char* difficulty_to_string(Difficulty difficulty);
  */
 const char* category_to_string(Category category);
 
+/**
+ * @brief Parse a difficulty name as written in packs ("easy", "medium", "hard")
+ * 
+ * @param name Name to look up (case-insensitive)
+ * @return int Difficulty value, -1 if unknown
+ */
+int difficulty_from_name(const char *name);
+
+/**
+ * @brief Parse a category name as written in packs ("science", "history", ...)
+ * 
+ * @param name Name to look up (case-insensitive)
+ * @return int Category value, -1 if unknown
+ */
+int category_from_name(const char *name);
+
 #endif /* QUESTIONS_H */
 
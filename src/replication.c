@@ -0,0 +1,974 @@
+/**
+ * @file replication.c
+ * @brief Leaderboard primary and replicas: asynchronous log shipping over TCP
+ */
+
+#define _GNU_SOURCE
+
+#include "replication.h"
+#include "metrics.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Events handled per epoll_wait
+ */
+#define REPLICATION_EVENTS 64
+
+/**
+ * @brief A replica's unsent bytes are topped up from the log below this
+ */
+#define REPLICATION_SHIP_BYTES 65536
+
+/**
+ * @brief A client whose unsent replies reach this is not read until they drain
+ */
+#define REPLICATION_MAX_PENDING (1u << 20)
+
+/**
+ * @brief What is on the other end of a connection
+ */
+typedef enum {
+    CONN_CLIENT,                          /**< Queries (and SUBMITs on a primary) */
+    CONN_REPLICA,                         /**< Primary: a replica being shipped the log */
+    CONN_UPSTREAM                         /**< Replica: the primary */
+} ConnKind;
+
+/**
+ * @brief Growable byte buffer
+ */
+typedef struct {
+    char *data;                           /**< Bytes */
+    size_t len;                           /**< Bytes used */
+    size_t cap;                           /**< Bytes allocated */
+} LineBuf;
+
+struct ReplicationConn {
+    bool open;                            /**< Slot in use */
+    ConnKind kind;                        /**< Peer */
+    bool connecting;                      /**< Upstream: connect() still in progress */
+    bool reading;                         /**< EPOLLIN is armed */
+    bool writing;                         /**< EPOLLOUT is armed */
+    bool eof;                             /**< Peer finished sending */
+    LineBuf in;                           /**< Received bytes */
+    LineBuf out;                          /**< Bytes not yet sent */
+    size_t out_sent;                      /**< Bytes of out already sent */
+    uint64_t next_seq;                    /**< Replica: next record to ship */
+    uint64_t acked;                       /**< Replica: last record acknowledged (sent, upstream) */
+    bool loading;                         /**< Upstream: a snapshot is arriving */
+    uint64_t snapshot_epoch;              /**< Upstream: epoch of the primary sending it */
+    uint64_t snapshot_seq;                /**< Upstream: record the snapshot stands for */
+    uint64_t snapshot_left;               /**< Upstream: SET lines still to come */
+};
+
+/* ---- Buffers ---- */
+
+static int buf_reserve(LineBuf *buf, size_t extra) {
+    if (buf->cap - buf->len >= extra) {
+        return 0;
+    }
+    size_t cap = buf->cap > 0 ? buf->cap : 4096;
+    while (cap - buf->len < extra) {
+        cap *= 2;
+    }
+    char *data = (char*)realloc(buf->data, cap);
+    if (data == NULL) {
+        return -1;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
+
+static void buf_free(LineBuf *buf) {
+    free(buf->data);
+    memset(buf, 0, sizeof(*buf));
+}
+
+/**
+ * @brief Append one formatted line to a connection's output
+ */
+__attribute__((format(printf, 2, 3)))
+static int out_printf(ReplicationConn *c, const char *fmt, ...) {
+    if (buf_reserve(&c->out, REPLICATION_MAX_LINE) != 0) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(c->out.data + c->out.len, c->out.cap - c->out.len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= c->out.cap - c->out.len) {
+        return -1;
+    }
+    c->out.len += (size_t)n;
+    return 0;
+}
+
+static size_t out_pending(const ReplicationConn *c) {
+    return c->out.len - c->out_sent;
+}
+
+static int64_t wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Parse a whole decimal token as a signed 64-bit value
+ */
+static bool parse_i64(const char *text, int64_t *out) {
+    if (text == NULL || *text == '\0') {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    *out = (int64_t)value;
+    return true;
+}
+
+static bool parse_u64(const char *text, uint64_t *out) {
+    if (text == NULL || *text < '0' || *text > '9') {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    *out = (uint64_t)value;
+    return true;
+}
+
+/* ---- Connections ---- */
+
+static ReplicationConn* conn_slot(ReplicationNode *node, int fd) {
+    if (fd >= node->conn_cap) {
+        int cap = node->conn_cap;
+        while (cap <= fd) {
+            cap *= 2;
+        }
+        ReplicationConn *conns = (ReplicationConn*)realloc(node->conns,
+                                                           (size_t)cap * sizeof(ReplicationConn));
+        if (conns == NULL) {
+            return NULL;
+        }
+        memset(conns + node->conn_cap, 0, (size_t)(cap - node->conn_cap) * sizeof(ReplicationConn));
+        node->conns = conns;
+        node->conn_cap = cap;
+    }
+    ReplicationConn *c = &node->conns[fd];
+    memset(c, 0, sizeof(*c));
+    return c;
+}
+
+/**
+ * @brief Arm EPOLLIN/EPOLLOUT for what the connection needs now
+ */
+static void conn_watch(ReplicationNode *node, int fd) {
+    ReplicationConn *c = &node->conns[fd];
+    bool reading = !c->eof && !c->connecting &&
+                   (c->kind != CONN_CLIENT || out_pending(c) < REPLICATION_MAX_PENDING);
+    bool writing = c->connecting || out_pending(c) > 0;
+    if (reading == c->reading && writing == c->writing) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = (reading ? EPOLLIN : 0) | (writing ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(node->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    c->reading = reading;
+    c->writing = writing;
+}
+
+static void conn_close(ReplicationNode *node, int fd) {
+    ReplicationConn *c = &node->conns[fd];
+    if (!c->open) {
+        return;
+    }
+    if (c->kind == CONN_REPLICA) {
+        for (int i = 0; i < node->stats.replicas; i++) {
+            if (node->replica_fds[i] == fd) {
+                node->replica_fds[i] = node->replica_fds[--node->stats.replicas];
+                break;
+            }
+        }
+    }
+    if (fd == node->upstream_fd) {
+        node->upstream_fd = -1;
+        leaderboard_clear(&node->loading);
+    }
+    buf_free(&c->in);
+    buf_free(&c->out);
+    memset(c, 0, sizeof(*c));
+    epoll_ctl(node->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+}
+
+/**
+ * @brief Send what the socket takes
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int conn_flush(ReplicationNode *node, int fd) {
+    ReplicationConn *c = &node->conns[fd];
+    while (c->out_sent < c->out.len) {
+        ssize_t n = send(fd, c->out.data + c->out_sent, c->out.len - c->out_sent,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            break;
+        }
+        c->out_sent += (size_t)n;
+    }
+    if (c->out_sent == c->out.len) {
+        c->out.len = 0;
+        c->out_sent = 0;
+    } else if (c->out_sent >= c->out.cap / 2) {
+        memmove(c->out.data, c->out.data + c->out_sent, c->out.len - c->out_sent);
+        c->out.len -= c->out_sent;
+        c->out_sent = 0;
+    }
+    conn_watch(node, fd);
+    return 0;
+}
+
+static void conn_accept(ReplicationNode *node) {
+    for (;;) {
+        int fd = accept4(node->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        ReplicationConn *c = conn_slot(node, fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (c == NULL || epoll_ctl(node->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        c->open = true;
+        c->kind = CONN_CLIENT;
+        c->reading = true;
+        node->stats.accepted++;
+    }
+}
+
+/* ---- Primary: the log ---- */
+
+static ReplicationRecord* record_at(const ReplicationNode *node, uint64_t seq) {
+    return &node->log[(seq - 1) % node->opts.log_capacity];
+}
+
+/**
+ * @brief Oldest record still in the ring
+ */
+static uint64_t oldest_seq(const ReplicationNode *node) {
+    return node->seq > node->opts.log_capacity ? node->seq - node->opts.log_capacity + 1 : 1;
+}
+
+static int send_snapshot(ReplicationNode *node, ReplicationConn *c) {
+    const Leaderboard *lb = &node->board;
+    if (out_printf(c, "SNAPSHOT %llu %llu %zu\n", (unsigned long long)node->epoch,
+                   (unsigned long long)node->seq, lb->count) != 0 ||
+        buf_reserve(&c->out, lb->count * (LEADERBOARD_MAX_NAME + 28)) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < lb->count; i++) {
+        const LeaderboardEntry *e = &lb->entries[lb->order[i]];
+        if (out_printf(c, "SET %s %lld\n", e->name, (long long)e->total) != 0) {
+            return -1;
+        }
+    }
+    c->next_seq = node->seq + 1;
+    node->stats.snapshots++;
+    return 0;
+}
+
+/**
+ * @brief Queue log records for a replica until its buffer is full enough
+ *
+ * A replica that has fallen out of the ring gets a snapshot instead.
+ */
+static int ship(ReplicationNode *node, ReplicationConn *c) {
+    while (out_pending(c) < REPLICATION_SHIP_BYTES && c->next_seq <= node->seq) {
+        if (c->next_seq < oldest_seq(node)) {
+            if (send_snapshot(node, c) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        const ReplicationRecord *r = record_at(node, c->next_seq);
+        if (out_printf(c, "LOG %llu %lld %s %lld\n", (unsigned long long)r->seq,
+                       (long long)r->ms, r->name, (long long)r->total) != 0) {
+            return -1;
+        }
+        c->next_seq++;
+        node->stats.records_shipped++;
+    }
+    return 0;
+}
+
+static void ship_all(ReplicationNode *node) {
+    for (int i = node->stats.replicas - 1; i >= 0; i--) {
+        int fd = node->replica_fds[i];
+        if (ship(node, &node->conns[fd]) != 0 || conn_flush(node, fd) != 0) {
+            conn_close(node, fd);
+        }
+    }
+}
+
+/* ---- Commands ---- */
+
+static int cmd_submit(ReplicationNode *node, ReplicationConn *c, const char *name,
+                      const char *points_text) {
+    int64_t points = 0;
+    int64_t total = 0;
+    if (!node->primary) {
+        return out_printf(c, "ERR read-only replica\n");
+    }
+    if (!parse_i64(points_text, &points) || !leaderboard_valid_name(name)) {
+        return out_printf(c, "ERR usage: SUBMIT <player> <points>\n");
+    }
+    errno = 0;
+    if (leaderboard_add(&node->board, name, points, &total) != 0) {
+        return out_printf(c, errno == ERANGE ? "ERR total out of range\n" : "ERR out of memory\n");
+    }
+    node->seq++;
+    ReplicationRecord *r = record_at(node, node->seq);
+    r->seq = node->seq;
+    r->ms = wall_ms();
+    r->total = total;
+    memset(r->name, 0, sizeof(r->name));
+    strcpy(r->name, name);
+    node->stats.submits++;
+    return out_printf(c, "OK %lld %llu\n", (long long)total, (unsigned long long)node->seq);
+}
+
+static int cmd_top(ReplicationNode *node, ReplicationConn *c, const char *n_text) {
+    int n = 0;
+    if (n_text == NULL || !is_valid_integer(n_text, &n) || n < 1 || n > REPLICATION_MAX_TOP) {
+        return out_printf(c, "ERR usage: TOP <1-%d>\n", REPLICATION_MAX_TOP);
+    }
+    size_t k = (size_t)n < node->board.count ? (size_t)n : node->board.count;
+    if (out_printf(c, "TOP %zu\n", k) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < k; i++) {
+        size_t rank = 0;
+        const LeaderboardEntry *e = leaderboard_at(&node->board, i, &rank);
+        if (out_printf(c, "%zu %s %lld\n", rank, e->name, (long long)e->total) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int cmd_status(ReplicationNode *node, ReplicationConn *c) {
+    if (node->primary) {
+        return out_printf(c, "STATUS role=primary seq=%llu players=%zu replicas=%d lag=%llu\n",
+                          (unsigned long long)node->seq, node->board.count,
+                          node->stats.replicas, (unsigned long long)node->stats.lag_records);
+    }
+    return out_printf(c, "STATUS role=replica seq=%llu head=%llu players=%zu lag_ms=%lld "
+                      "snapshots=%llu connected=%d\n",
+                      (unsigned long long)node->seq, (unsigned long long)node->head,
+                      node->board.count, (long long)node->stats.lag_ms,
+                      (unsigned long long)node->stats.snapshots,
+                      node->upstream_fd >= 0 && !node->conns[node->upstream_fd].connecting);
+}
+
+/**
+ * @brief Turn a client connection into a replica being shipped the log
+ */
+static int cmd_replicate(ReplicationNode *node, int fd, const char *epoch_text,
+                         const char *applied_text) {
+    ReplicationConn *c = &node->conns[fd];
+    uint64_t epoch = 0;
+    uint64_t applied = 0;
+    if (!node->primary) {
+        return out_printf(c, "ERR not a primary\n");
+    }
+    if (!parse_u64(epoch_text, &epoch) || !parse_u64(applied_text, &applied)) {
+        return out_printf(c, "ERR usage: REPLICATE <epoch> <seq>\n");
+    }
+    if (node->stats.replicas == REPLICATION_MAX_REPLICAS) {
+        return out_printf(c, "ERR too many replicas\n");
+    }
+    c->kind = CONN_REPLICA;
+    node->replica_fds[node->stats.replicas++] = fd;
+    /* Records applied under another epoch came from a primary that has
+     * since restarted, and the same numbers now mean other updates; only
+     * a snapshot brings the two back together. An empty replica has
+     * nothing to disagree with. */
+    if (applied > 0 && (epoch != node->epoch || applied > node->seq)) {
+        c->acked = 0;
+        return send_snapshot(node, c);
+    }
+    c->acked = applied;
+    c->next_seq = applied + 1;
+    return out_printf(c, "EPOCH %llu\n", (unsigned long long)node->epoch);
+}
+
+/**
+ * @brief Answer one line from a client or a replica
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int handle_command(ReplicationNode *node, int fd, char *line) {
+    ReplicationConn *c = &node->conns[fd];
+    char *save = NULL;
+    char *cmd = strtok_r(line, " \t", &save);
+    char *arg1 = cmd != NULL ? strtok_r(NULL, " \t", &save) : NULL;
+    char *arg2 = arg1 != NULL ? strtok_r(NULL, " \t", &save) : NULL;
+    if (cmd == NULL) {
+        return 0;
+    }
+
+    if (c->kind == CONN_REPLICA) {
+        uint64_t acked = 0;
+        if (strcmp(cmd, "ACK") == 0 && parse_u64(arg1, &acked) && acked <= node->seq) {
+            c->acked = acked > c->acked ? acked : c->acked;
+            return 0;
+        }
+        return -1;
+    }
+
+    node->stats.commands++;
+    if (strcmp(cmd, "SUBMIT") == 0) {
+        return cmd_submit(node, c, arg1, arg2);
+    }
+    if (strcmp(cmd, "RANK") == 0) {
+        int64_t total = 0;
+        if (arg1 == NULL) {
+            return out_printf(c, "ERR usage: RANK <player>\n");
+        }
+        size_t rank = leaderboard_rank(&node->board, arg1, &total);
+        if (rank == 0) {
+            return out_printf(c, "NONE %s\n", arg1);
+        }
+        return out_printf(c, "RANK %s %zu %lld\n", arg1, rank, (long long)total);
+    }
+    if (strcmp(cmd, "TOP") == 0) {
+        return cmd_top(node, c, arg1);
+    }
+    if (strcmp(cmd, "STATUS") == 0) {
+        return cmd_status(node, c);
+    }
+    if (strcmp(cmd, "REPLICATE") == 0) {
+        return cmd_replicate(node, fd, arg1, arg2);
+    }
+    return out_printf(c, "ERR unknown command %s\n", cmd);
+}
+
+/* ---- Replica: applying the primary's stream ---- */
+
+static void finish_snapshot(ReplicationNode *node, ReplicationConn *c) {
+    Leaderboard loaded = node->loading;
+    node->loading = node->board;
+    node->board = loaded;
+    leaderboard_clear(&node->loading);
+    node->epoch = c->snapshot_epoch;
+    node->seq = c->snapshot_seq;
+    if (node->head < node->seq) {
+        node->head = node->seq;
+    }
+    c->loading = false;
+    node->stats.snapshots++;
+}
+
+/**
+ * @brief Apply one line from the primary
+ *
+ * @return int 0 to keep the connection, -1 to drop it (and reconnect)
+ */
+static int handle_upstream(ReplicationNode *node, ReplicationConn *c, char *line) {
+    char *save = NULL;
+    char *cmd = strtok_r(line, " ", &save);
+    char *args[4] = { NULL, NULL, NULL, NULL };
+    for (int i = 0; i < 4 && cmd != NULL; i++) {
+        args[i] = strtok_r(NULL, " ", &save);
+    }
+    if (cmd == NULL) {
+        return -1;
+    }
+
+    if (strcmp(cmd, "SET") == 0) {
+        int64_t total = 0;
+        if (!c->loading || !parse_i64(args[1], &total) ||
+            leaderboard_set(&node->loading, args[0], total) != 0) {
+            return -1;
+        }
+        if (--c->snapshot_left == 0) {
+            finish_snapshot(node, c);
+        }
+        return 0;
+    }
+    if (c->loading) {
+        return -1;
+    }
+    if (strcmp(cmd, "LOG") == 0) {
+        uint64_t seq = 0;
+        int64_t ms = 0;
+        int64_t total = 0;
+        if (!parse_u64(args[0], &seq) || !parse_i64(args[1], &ms) || !parse_i64(args[3], &total)) {
+            return -1;
+        }
+        /* A gap means the stream and this replica disagree; start over
+         * from what has been applied. */
+        if (seq != node->seq + 1 || leaderboard_set(&node->board, args[2], total) != 0) {
+            return -1;
+        }
+        node->seq = seq;
+        if (node->head < seq) {
+            node->head = seq;
+        }
+        int64_t lag = wall_ms() - ms;
+        node->stats.lag_ms = lag > 0 ? lag : 0;
+        node->stats.records_applied++;
+        return 0;
+    }
+    if (strcmp(cmd, "EPOCH") == 0) {
+        /* Streaming from here: what is applied is part of this history. */
+        return parse_u64(args[0], &node->epoch) ? 0 : -1;
+    }
+    if (strcmp(cmd, "SNAPSHOT") == 0) {
+        if (!parse_u64(args[0], &c->snapshot_epoch) || !parse_u64(args[1], &c->snapshot_seq) ||
+            !parse_u64(args[2], &c->snapshot_left)) {
+            return -1;
+        }
+        leaderboard_clear(&node->loading);
+        c->loading = true;
+        if (c->snapshot_left == 0) {
+            finish_snapshot(node, c);
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "HEAD") == 0) {
+        uint64_t head = 0;
+        /* HEAD follows everything shipped before it, so a head behind what
+         * was applied means the primary lost history. */
+        if (!parse_u64(args[0], &head) || head < node->seq) {
+            return -1;
+        }
+        node->head = head;
+        if (head == node->seq) {
+            node->stats.lag_ms = 0;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/* ---- Reading ---- */
+
+/**
+ * @brief Handle every complete line received
+ *
+ * A client whose replies pile up is left with the rest of its lines
+ * buffered until they drain.
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int process_lines(ReplicationNode *node, int fd) {
+    ReplicationConn *c = &node->conns[fd];
+    size_t start = 0;
+    int result = 0;
+    while (result == 0 && c->open && start < c->in.len) {
+        if (c->kind == CONN_CLIENT && out_pending(c) >= REPLICATION_MAX_PENDING) {
+            break;
+        }
+        char *line = c->in.data + start;
+        char *nl = (char*)memchr(line, '\n', c->in.len - start);
+        if (nl == NULL) {
+            if (c->in.len - start >= REPLICATION_MAX_LINE) {
+                result = -1;
+            }
+            break;
+        }
+        size_t len = (size_t)(nl - line);
+        start += len + 1;
+        if (len >= REPLICATION_MAX_LINE) {
+            result = -1;
+            break;
+        }
+        *nl = '\0';
+        if (len > 0 && line[len - 1] == '\r') {
+            line[len - 1] = '\0';
+        }
+        result = c->kind == CONN_UPSTREAM ? handle_upstream(node, c, line)
+                                          : handle_command(node, fd, line);
+    }
+    if (result == 0 && start > 0) {
+        memmove(c->in.data, c->in.data + start, c->in.len - start);
+        c->in.len -= start;
+    }
+    if (result == 0 && c->kind == CONN_UPSTREAM && node->seq > c->acked) {
+        c->acked = node->seq;
+        result = out_printf(c, "ACK %llu\n", (unsigned long long)node->seq);
+    }
+    return result;
+}
+
+/**
+ * @brief Read everything available on a connection
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int conn_read(ReplicationConn *c, int fd) {
+    for (;;) {
+        if (buf_reserve(&c->in, 65536) != 0) {
+            return -1;
+        }
+        ssize_t n = recv(fd, c->in.data + c->in.len, c->in.cap - c->in.len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->in.len += (size_t)n;
+            if (c->kind == CONN_CLIENT && c->in.len >= REPLICATION_MAX_PENDING) {
+                return 0;
+            }
+            continue;
+        }
+        if (n == 0) {
+            c->eof = true;
+            return 0;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    }
+}
+
+/* ---- Replica: the upstream connection ---- */
+
+static void upstream_connect(ReplicationNode *node) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)node->opts.primary_port);
+    inet_pton(AF_INET, node->opts.primary_host, &addr.sin_addr);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+        close(fd);
+        return;
+    }
+    ReplicationConn *c = conn_slot(node, fd);
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.fd = fd;
+    if (c == NULL || epoll_ctl(node->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return;
+    }
+    c->open = true;
+    c->kind = CONN_UPSTREAM;
+    c->connecting = true;
+    c->writing = true;
+    node->upstream_fd = fd;
+}
+
+/**
+ * @brief The connect() finished: ask for the log from what is applied
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int upstream_connected(ReplicationNode *node, int fd) {
+    ReplicationConn *c = &node->conns[fd];
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+        return -1;
+    }
+    c->connecting = false;
+    c->acked = node->seq;
+    node->stats.reconnects++;
+    return out_printf(c, "REPLICATE %llu %llu\n", (unsigned long long)node->epoch,
+                      (unsigned long long)node->seq);
+}
+
+/* ---- Loop ---- */
+
+/**
+ * @brief Heartbeats and lag (primary), reconnects (replica)
+ */
+static void tick(ReplicationNode *node) {
+    if (node->primary) {
+        uint64_t worst = 0;
+        for (int i = node->stats.replicas - 1; i >= 0; i--) {
+            int fd = node->replica_fds[i];
+            ReplicationConn *c = &node->conns[fd];
+            if (node->seq - c->acked > worst) {
+                worst = node->seq - c->acked;
+            }
+            if (ship(node, c) != 0 ||
+                out_printf(c, "HEAD %llu\n", (unsigned long long)node->seq) != 0 ||
+                conn_flush(node, fd) != 0) {
+                conn_close(node, fd);
+            }
+        }
+        node->stats.lag_records = worst;
+        return;
+    }
+    if (node->upstream_fd < 0) {
+        upstream_connect(node);
+    }
+    node->stats.lag_records = node->head > node->seq ? node->head - node->seq : 0;
+}
+
+/**
+ * @brief Service one ready connection
+ */
+static void conn_event(ReplicationNode *node, int fd, uint32_t events) {
+    ReplicationConn *c = &node->conns[fd];
+    if (c->connecting) {
+        if (upstream_connected(node, fd) != 0 || conn_flush(node, fd) != 0) {
+            conn_close(node, fd);
+        }
+        return;
+    }
+    if ((events & (EPOLLERR | EPOLLHUP)) != 0 && !(events & EPOLLIN)) {
+        conn_close(node, fd);
+        return;
+    }
+    if ((events & EPOLLIN) != 0 && conn_read(c, fd) != 0) {
+        conn_close(node, fd);
+        return;
+    }
+    if (process_lines(node, fd) != 0 || conn_flush(node, fd) != 0) {
+        conn_close(node, fd);
+        return;
+    }
+    /* Replies drained below the limit: answer what was held back. */
+    if (c->kind == CONN_CLIENT && out_pending(c) < REPLICATION_MAX_PENDING &&
+        memchr(c->in.data, '\n', c->in.len) != NULL) {
+        if (process_lines(node, fd) != 0 || conn_flush(node, fd) != 0) {
+            conn_close(node, fd);
+            return;
+        }
+    }
+    if (c->eof && out_pending(c) == 0) {
+        conn_close(node, fd);
+    }
+}
+
+void replication_options_init(ReplicationOptions *opts) {
+    if (opts == NULL) {
+        return;
+    }
+    memset(opts, 0, sizeof(*opts));
+    opts->host = "127.0.0.1";
+    opts->port = 7000;
+    opts->primary_host = NULL;
+    opts->primary_port = 7000;
+    opts->log_capacity = 65536;
+}
+
+int replication_node_init(ReplicationNode *node, const ReplicationOptions *opts) {
+    if (node == NULL || opts == NULL) {
+        return -1;
+    }
+    memset(node, 0, sizeof(*node));
+    node->opts = *opts;
+    node->primary = opts->primary_host == NULL;
+    node->listen_fd = -1;
+    node->epoll_fd = -1;
+    node->wake_fd = -1;
+    node->upstream_fd = -1;
+
+    struct in_addr primary_addr;
+    if (node->primary ? opts->log_capacity == 0
+                      : inet_pton(AF_INET, opts->primary_host, &primary_addr) != 1 ||
+                        opts->primary_port <= 0 || opts->primary_port > 65535) {
+        print_error("A primary needs a log capacity and a replica an IPv4 primary address");
+        return -1;
+    }
+    if (leaderboard_init(&node->board) != 0 ||
+        (!node->primary && leaderboard_init(&node->loading) != 0)) {
+        replication_node_destroy(node);
+        return -1;
+    }
+    if (node->primary) {
+        /* A fresh epoch per start tells replicas the history they hold is
+         * not this process's. */
+        if (getrandom(&node->epoch, sizeof(node->epoch), 0) != (ssize_t)sizeof(node->epoch) ||
+            node->epoch == 0) {
+            node->epoch = ((uint64_t)wall_ms() << 20) ^ (uint64_t)getpid() ^ 1u;
+        }
+        node->log = (ReplicationRecord*)calloc(opts->log_capacity, sizeof(ReplicationRecord));
+        if (node->log == NULL) {
+            print_error("Failed to allocate a log of %zu records", opts->log_capacity);
+            replication_node_destroy(node);
+            return -1;
+        }
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)opts->port);
+    if (inet_pton(AF_INET, opts->host != NULL ? opts->host : "127.0.0.1", &addr.sin_addr) != 1) {
+        print_error("Invalid listen address: %s", opts->host);
+        replication_node_destroy(node);
+        return -1;
+    }
+    node->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (node->listen_fd < 0 ||
+        setsockopt(node->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(node->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(node->listen_fd, SOMAXCONN) != 0) {
+        print_error("Failed to listen on port %d: %s", opts->port, strerror(errno));
+        replication_node_destroy(node);
+        return -1;
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(node->listen_fd, (struct sockaddr*)&addr, &addr_len);
+    node->port = ntohs(addr.sin_port);
+
+    node->conn_cap = 64;
+    node->conns = (ReplicationConn*)calloc((size_t)node->conn_cap, sizeof(ReplicationConn));
+    node->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    node->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = node->listen_fd;
+    int added = node->conns != NULL && node->epoll_fd >= 0 && node->wake_fd >= 0
+                ? epoll_ctl(node->epoll_fd, EPOLL_CTL_ADD, node->listen_fd, &ev) : -1;
+    ev.data.fd = node->wake_fd;
+    if (added != 0 || epoll_ctl(node->epoll_fd, EPOLL_CTL_ADD, node->wake_fd, &ev) != 0) {
+        print_error("Failed to set up the replication event loop");
+        replication_node_destroy(node);
+        return -1;
+    }
+    if (!node->primary) {
+        upstream_connect(node);
+    }
+    node->next_tick = monotonic_ms() + REPLICATION_TICK_MS;
+    return 0;
+}
+
+int replication_node_run(ReplicationNode *node) {
+    if (node == NULL || node->epoll_fd < 0) {
+        return -1;
+    }
+    struct epoll_event events[REPLICATION_EVENTS];
+    while (!node->stopping) {
+        double now = monotonic_ms();
+        int timeout = now >= node->next_tick ? 0 : (int)(node->next_tick - now) + 1;
+        int n = epoll_wait(node->epoll_fd, events, REPLICATION_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            print_error("epoll_wait failed: %s", strerror(errno));
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == node->listen_fd) {
+                conn_accept(node);
+            } else if (fd == node->wake_fd) {
+                uint64_t value;
+                while (read(node->wake_fd, &value, sizeof(value)) > 0) {
+                }
+            } else if (fd < node->conn_cap && node->conns[fd].open) {
+                conn_event(node, fd, events[i].events);
+            }
+        }
+        /* Ship what this round of SUBMITs appended. */
+        if (node->primary) {
+            ship_all(node);
+        }
+        if (monotonic_ms() >= node->next_tick) {
+            tick(node);
+            node->next_tick = monotonic_ms() + REPLICATION_TICK_MS;
+        }
+    }
+    return 0;
+}
+
+void replication_node_stop(ReplicationNode *node) {
+    if (node == NULL) {
+        return;
+    }
+    node->stopping = 1;
+    if (node->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(node->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void replication_publish_metrics(const ReplicationNode *node) {
+    if (node == NULL) {
+        return;
+    }
+    metrics_set("leaderboard.players", (double)node->board.count);
+    metrics_set("leaderboard.seq", (double)node->seq);
+    metrics_set("leaderboard.commands", (double)node->stats.commands);
+    metrics_set("leaderboard.submits", (double)node->stats.submits);
+    metrics_set("leaderboard.records_shipped", (double)node->stats.records_shipped);
+    metrics_set("leaderboard.records_applied", (double)node->stats.records_applied);
+    metrics_set("leaderboard.snapshots", (double)node->stats.snapshots);
+    metrics_set("leaderboard.reconnects", (double)node->stats.reconnects);
+    metrics_set("leaderboard.replicas", (double)node->stats.replicas);
+    metrics_set("leaderboard.lag_records", (double)node->stats.lag_records);
+    metrics_set("leaderboard.lag_ms", (double)node->stats.lag_ms);
+}
+
+void replication_node_destroy(ReplicationNode *node) {
+    if (node == NULL) {
+        return;
+    }
+    for (int fd = 0; node->conns != NULL && fd < node->conn_cap; fd++) {
+        conn_close(node, fd);
+    }
+    free(node->conns);
+    free(node->log);
+    leaderboard_free(&node->board);
+    leaderboard_free(&node->loading);
+    if (node->listen_fd >= 0) {
+        close(node->listen_fd);
+    }
+    if (node->epoll_fd >= 0) {
+        close(node->epoll_fd);
+    }
+    if (node->wake_fd >= 0) {
+        close(node->wake_fd);
+    }
+    memset(node, 0, sizeof(*node));
+    node->listen_fd = -1;
+    node->epoll_fd = -1;
+    node->wake_fd = -1;
+    node->upstream_fd = -1;
+}
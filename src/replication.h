@@ -0,0 +1,173 @@
+/**
+ * @file replication.h
+ * @brief Leaderboard primary and replicas: asynchronous log shipping over TCP
+ *
+ * A node owns a Leaderboard and serves text lines on one epoll loop:
+ *
+ *   SUBMIT <player> <points>   primary only: add points -> OK <total> <seq>
+ *   RANK <player>              -> RANK <player> <rank> <total>, or NONE <player>
+ *   TOP <n>                    -> TOP <k>, then k lines "<rank> <player> <total>"
+ *   STATUS                     -> STATUS role=... seq=... (lag and counts)
+ *
+ * Every accepted SUBMIT becomes a numbered log record holding the
+ * player's new total, kept in a ring of the last log_capacity records.
+ * The client gets its OK as soon as the primary has applied the record;
+ * shipping to replicas happens afterwards (asynchronous).
+ *
+ * A primary picks a random epoch each time it starts, since it keeps no
+ * state across a restart and its sequence numbers start again from 1. A
+ * replica connects to the primary and sends "REPLICATE <epoch> <applied
+ * seq>", naming the epoch its records came from. If the epochs match (or
+ * the replica is empty) and the primary still holds the next record, it
+ * replies "EPOCH <epoch>" and streams the log from there ("LOG <seq> <ms>
+ * <player> <total>"); otherwise it sends a snapshot ("SNAPSHOT <epoch>
+ * <seq> <players>", one "SET <player> <total>" per player). A replica acknowledges with "ACK <seq>" after each batch it
+ * applies, and every tick the primary queues "HEAD <seq>" behind whatever
+ * it has shipped, so a replica can tell how far behind it is. A snapshot
+ * is loaded into a separate board and swapped in whole, so queries never
+ * see half of one. A replica that loses the primary keeps answering
+ * queries from what it has and reconnects.
+ *
+ * Records carry the primary's wall-clock time in milliseconds, so the
+ * replica's lag_ms is only meaningful between hosts with synced clocks.
+ */
+
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <signal.h>
+#include "leaderboard.h"
+
+/**
+ * @brief Longest command or log line
+ */
+#define REPLICATION_MAX_LINE 256
+
+/**
+ * @brief Most players one TOP returns
+ */
+#define REPLICATION_MAX_TOP 1000
+
+/**
+ * @brief Milliseconds between heartbeats and reconnect attempts
+ */
+#define REPLICATION_TICK_MS 100
+
+/**
+ * @brief Most replicas one primary ships to
+ */
+#define REPLICATION_MAX_REPLICAS 32
+
+/**
+ * @brief Node settings
+ */
+typedef struct {
+    const char *host;                     /**< IPv4 address to listen on */
+    int port;                             /**< Query port, 0 picks a free one */
+    const char *primary_host;             /**< Replicas: primary address, NULL for a primary */
+    int primary_port;                     /**< Replicas: primary port */
+    size_t log_capacity;                  /**< Primary: records kept for catch-up */
+} ReplicationOptions;
+
+/**
+ * @brief One shipped update
+ */
+typedef struct {
+    uint64_t seq;                         /**< Position in the log, from 1 */
+    int64_t ms;                           /**< Primary wall clock when applied */
+    int64_t total;                        /**< Player's new total */
+    char name[LEADERBOARD_MAX_NAME];      /**< Player */
+} ReplicationRecord;
+
+/**
+ * @brief Running totals and lag
+ */
+typedef struct {
+    uint64_t accepted;                    /**< Connections accepted */
+    uint64_t commands;                    /**< Client commands answered */
+    uint64_t submits;                     /**< Updates applied (primary) */
+    uint64_t records_shipped;             /**< Log records sent (primary) */
+    uint64_t records_applied;             /**< Log records applied (replica) */
+    uint64_t snapshots;                   /**< Snapshots sent (primary) or loaded (replica) */
+    uint64_t reconnects;                  /**< Connections made to the primary (replica) */
+    uint64_t lag_records;                 /**< Replica: head - applied; primary: worst replica */
+    int64_t lag_ms;                       /**< Replica: delay of the last change applied */
+    int replicas;                         /**< Primary: replicas connected */
+} ReplicationStats;
+
+typedef struct ReplicationConn ReplicationConn;
+
+/**
+ * @brief A primary or replica node; owned by the thread in replication_node_run()
+ */
+typedef struct {
+    ReplicationOptions opts;              /**< Settings */
+    bool primary;                         /**< Role */
+    Leaderboard board;                    /**< Current totals */
+    uint64_t epoch;                       /**< Random per primary start; replica: of its history */
+    uint64_t seq;                         /**< Last record applied */
+    uint64_t head;                        /**< Replica: last record the primary reported */
+    Leaderboard loading;                  /**< Replica: snapshot being received */
+    ReplicationRecord *log;               /**< Primary: ring of recent records */
+    int replica_fds[REPLICATION_MAX_REPLICAS]; /**< Primary: replica connections */
+    int listen_fd;                        /**< Query listener */
+    int epoll_fd;                         /**< Event loop */
+    int wake_fd;                          /**< eventfd that interrupts the loop */
+    int upstream_fd;                      /**< Replica: connection to the primary, -1 if none */
+    int port;                             /**< Bound query port */
+    double next_tick;                     /**< monotonic_ms() of the next heartbeat */
+    volatile sig_atomic_t stopping;       /**< Set by replication_node_stop() */
+    ReplicationConn *conns;               /**< Connections indexed by fd */
+    int conn_cap;                         /**< Length of conns */
+    ReplicationStats stats;               /**< Running totals */
+} ReplicationNode;
+
+/**
+ * @brief Fill in default options (a primary on 127.0.0.1:7000, 65536 records)
+ *
+ * @param opts Options to fill
+ */
+void replication_options_init(ReplicationOptions *opts);
+
+/**
+ * @brief Bind the query port; a replica also starts connecting to its primary
+ *
+ * @param node Node to initialize
+ * @param opts Settings
+ * @return int 0 on success, -1 on error
+ */
+int replication_node_init(ReplicationNode *node, const ReplicationOptions *opts);
+
+/**
+ * @brief Run the event loop until replication_node_stop() is called
+ *
+ * @param node Initialized node
+ * @return int 0 on a clean stop, -1 on error
+ */
+int replication_node_run(ReplicationNode *node);
+
+/**
+ * @brief Ask the loop to stop; safe from signal handlers and other threads
+ *
+ * @param node Node
+ */
+void replication_node_stop(ReplicationNode *node);
+
+/**
+ * @brief Publish counts and lag as metrics
+ *
+ * @param node Node
+ */
+void replication_publish_metrics(const ReplicationNode *node);
+
+/**
+ * @brief Close connections and free the node
+ *
+ * @param node Node
+ */
+void replication_node_destroy(ReplicationNode *node);
+
+#endif /* REPLICATION_H */
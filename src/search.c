@@ -0,0 +1,648 @@
+/**
+ * @file search.c
+ * @brief Implementation of the inverted full-text index
+ */
+
+#include "search.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**
+ * @brief Position gap between fields so phrases cannot span them
+ */
+#define FIELD_GAP 2
+
+/**
+ * @brief Maximum tokens tracked per question while building or matching
+ */
+#define MAX_DOC_TOKENS 2048
+
+/**
+ * @brief Token occurrence collected while indexing one question
+ */
+typedef struct {
+    uint32_t term;
+    uint32_t position;
+} TermHit;
+
+/**
+ * @brief Per-question build state passed to the tokenizer callback
+ */
+typedef struct {
+    SearchIndex *index;
+    TermHit *hits;
+    size_t hit_count;
+    uint32_t base;
+    uint32_t next_base;
+    int error;
+} BuildContext;
+
+/**
+ * @brief Decoding cursor over one posting list
+ */
+typedef struct {
+    const PostingList *list;
+    uint32_t next_skip;          /**< First skip entry not yet passed */
+    const uint8_t *ptr;
+    const uint8_t *end;
+    uint32_t doc;
+    uint32_t pos_count;
+    const uint8_t *pos_ptr;      /**< Start of the current doc's positions */
+    bool valid;
+} PostingCursor;
+
+/**
+ * @brief One term of a parsed query
+ */
+typedef struct {
+    char text[MAX_TOKEN_LEN + 1];
+    size_t len;
+    int group;                   /**< Phrase group; consecutive terms share it */
+    int offset;                  /**< Offset of the term within its phrase */
+} QueryTerm;
+
+static uint64_t hash_term(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static inline bool is_token_char(unsigned char c) {
+    return isalnum(c) || c >= 0x80;
+}
+
+int search_tokenize(const char *text,
+                    void (*callback)(const char *token, size_t len, int position, void *ctx),
+                    void *ctx) {
+    if (text == NULL) {
+        return 0;
+    }
+
+    char token[MAX_TOKEN_LEN];
+    int position = 0;
+    const unsigned char *p = (const unsigned char*)text;
+    while (*p != '\0') {
+        while (*p != '\0' && !is_token_char(*p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        size_t len = 0;
+        while (is_token_char(*p)) {
+            if (len < MAX_TOKEN_LEN) {
+                token[len++] = (char)tolower(*p);
+            }
+            p++;
+        }
+        if (callback != NULL) {
+            callback(token, len, position, ctx);
+        }
+        position++;
+    }
+    return position;
+}
+
+static void encode_varint(uint8_t *out, size_t *len, uint32_t value) {
+    while (value >= 0x80) {
+        out[(*len)++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[(*len)++] = (uint8_t)value;
+}
+
+static inline const uint8_t* decode_varint(const uint8_t *p, const uint8_t *end, uint32_t *value) {
+    uint32_t v = 0;
+    int shift = 0;
+    while (p < end) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return p;
+        }
+        shift += 7;
+    }
+    *value = v;
+    return end;
+}
+
+static inline const uint8_t* skip_varints(const uint8_t *p, const uint8_t *end, uint32_t count) {
+    while (count > 0 && p < end) {
+        if (!(*p++ & 0x80)) {
+            count--;
+        }
+    }
+    return p;
+}
+
+static int find_slot(const SearchIndex *index, const char *term, size_t len, size_t *slot_out) {
+    size_t mask = index->slot_count - 1;
+    size_t slot = (size_t)hash_term(term, len) & mask;
+    while (index->slots[slot] != 0) {
+        const PostingList *list = &index->lists[index->slots[slot] - 1];
+        const char *existing = index->term_pool + list->term_offset;
+        if (strncmp(existing, term, len) == 0 && existing[len] == '\0') {
+            *slot_out = slot;
+            return (int)(index->slots[slot] - 1);
+        }
+        slot = (slot + 1) & mask;
+    }
+    *slot_out = slot;
+    return -1;
+}
+
+static int grow_slots(SearchIndex *index) {
+    size_t new_count = index->slot_count * 2;
+    uint32_t *slots = (uint32_t*)calloc(new_count, sizeof(uint32_t));
+    if (slots == NULL) {
+        return -1;
+    }
+    for (size_t t = 0; t < index->term_count; t++) {
+        const char *term = index->term_pool + index->lists[t].term_offset;
+        size_t slot = (size_t)hash_term(term, strlen(term)) & (new_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (new_count - 1);
+        }
+        slots[slot] = (uint32_t)(t + 1);
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->slot_count = new_count;
+    return 0;
+}
+
+/**
+ * @brief Find a term, adding it to the dictionary if new
+ *
+ * @return long Term index, or -1 on allocation failure
+ */
+static long intern_term(SearchIndex *index, const char *term, size_t len) {
+    size_t slot;
+    int existing = find_slot(index, term, len, &slot);
+    if (existing >= 0) {
+        return existing;
+    }
+
+    if ((index->term_count + 1) * 2 > index->slot_count) {
+        if (grow_slots(index) != 0) {
+            return -1;
+        }
+        find_slot(index, term, len, &slot);
+    }
+    if (index->term_count == index->term_cap) {
+        size_t cap = index->term_cap * 2;
+        PostingList *lists = (PostingList*)realloc(index->lists, cap * sizeof(PostingList));
+        if (lists == NULL) {
+            return -1;
+        }
+        index->lists = lists;
+        index->term_cap = cap;
+    }
+    while (index->pool_len + len + 1 > index->pool_cap) {
+        size_t cap = index->pool_cap * 2;
+        char *pool = (char*)realloc(index->term_pool, cap);
+        if (pool == NULL) {
+            return -1;
+        }
+        index->term_pool = pool;
+        index->pool_cap = cap;
+    }
+
+    PostingList *list = &index->lists[index->term_count];
+    list->term_offset = (uint32_t)index->pool_len;
+    list->doc_freq = 0;
+    list->last_doc = 0;
+    list->data = NULL;
+    list->len = 0;
+    list->cap = 0;
+    list->skips = NULL;
+    list->skip_count = 0;
+    memcpy(index->term_pool + index->pool_len, term, len);
+    index->term_pool[index->pool_len + len] = '\0';
+    index->pool_len += len + 1;
+
+    index->slots[slot] = (uint32_t)(index->term_count + 1);
+    return (long)index->term_count++;
+}
+
+static void collect_hit(const char *token, size_t len, int position, void *ctx) {
+    BuildContext *bc = (BuildContext*)ctx;
+    if (bc->error || bc->hit_count >= MAX_DOC_TOKENS) {
+        return;
+    }
+    long term = intern_term(bc->index, token, len);
+    if (term < 0) {
+        bc->error = 1;
+        return;
+    }
+    uint32_t pos = bc->base + (uint32_t)position;
+    bc->hits[bc->hit_count].term = (uint32_t)term;
+    bc->hits[bc->hit_count].position = pos;
+    bc->hit_count++;
+    if (pos + FIELD_GAP > bc->next_base) {
+        bc->next_base = pos + FIELD_GAP;
+    }
+}
+
+static int compare_hits(const void *a, const void *b) {
+    const TermHit *x = (const TermHit*)a;
+    const TermHit *y = (const TermHit*)b;
+    if (x->term != y->term) {
+        return x->term < y->term ? -1 : 1;
+    }
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+/**
+ * @brief Append one document's positions for a term to its posting list
+ */
+static int append_posting(PostingList *list, uint32_t doc, const TermHit *hits, size_t count) {
+    size_t worst = (count + 2) * 5;
+    if (list->len + worst > list->cap) {
+        size_t cap = list->cap > 0 ? list->cap * 2 : 16;
+        while (cap < list->len + worst) {
+            cap *= 2;
+        }
+        uint8_t *data = (uint8_t*)realloc(list->data, cap);
+        if (data == NULL) {
+            return -1;
+        }
+        list->data = data;
+        list->cap = cap;
+    }
+
+    if (list->doc_freq > 0 && list->doc_freq % SEARCH_SKIP_INTERVAL == 0) {
+        uint32_t n = list->skip_count;
+        if (n == 0 || (n >= 4 && (n & (n - 1)) == 0)) {
+            size_t cap = n == 0 ? 4 : (size_t)n * 2;
+            PostingSkip *skips = (PostingSkip*)realloc(list->skips, cap * sizeof(PostingSkip));
+            if (skips == NULL) {
+                return -1;
+            }
+            list->skips = skips;
+        }
+        list->skips[list->skip_count].base_doc = list->last_doc;
+        list->skips[list->skip_count].offset = (uint32_t)list->len;
+        list->skip_count++;
+    }
+
+    encode_varint(list->data, &list->len, list->doc_freq == 0 ? doc : doc - list->last_doc);
+    encode_varint(list->data, &list->len, (uint32_t)count);
+    uint32_t prev = 0;
+    for (size_t i = 0; i < count; i++) {
+        encode_varint(list->data, &list->len, hits[i].position - prev);
+        prev = hits[i].position;
+    }
+    list->last_doc = doc;
+    list->doc_freq++;
+    return 0;
+}
+
+int search_index_build(SearchIndex *index, const QuestionBank *bank) {
+    if (index == NULL || bank == NULL) {
+        return -1;
+    }
+
+    memset(index, 0, sizeof(*index));
+    index->term_cap = 1024;
+    index->pool_cap = 16 * 1024;
+    index->slot_count = 2048;
+    index->lists = (PostingList*)malloc(index->term_cap * sizeof(PostingList));
+    index->term_pool = (char*)malloc(index->pool_cap);
+    index->slots = (uint32_t*)calloc(index->slot_count, sizeof(uint32_t));
+    TermHit *hits = (TermHit*)malloc(MAX_DOC_TOKENS * sizeof(TermHit));
+    if (index->lists == NULL || index->term_pool == NULL || index->slots == NULL || hits == NULL) {
+        free(hits);
+        search_index_free(index);
+        print_error("Failed to allocate memory for search index");
+        return -1;
+    }
+
+    BuildContext bc;
+    bc.index = index;
+    bc.hits = hits;
+    bc.error = 0;
+
+    for (size_t doc = 0; doc < bank->count; doc++) {
+        const Question *q = &bank->questions[doc];
+        bc.hit_count = 0;
+        bc.base = 0;
+        bc.next_base = 0;
+
+        search_tokenize(q->question, collect_hit, &bc);
+        for (int o = 0; o < MAX_OPTIONS && q->options[o][0] != '\0'; o++) {
+            bc.base = bc.next_base;
+            search_tokenize(q->options[o], collect_hit, &bc);
+        }
+        if (bc.error) {
+            break;
+        }
+
+        qsort(hits, bc.hit_count, sizeof(TermHit), compare_hits);
+        size_t start = 0;
+        while (start < bc.hit_count) {
+            size_t end = start + 1;
+            while (end < bc.hit_count && hits[end].term == hits[start].term) {
+                end++;
+            }
+            if (append_posting(&index->lists[hits[start].term], (uint32_t)doc,
+                               &hits[start], end - start) != 0) {
+                bc.error = 1;
+                break;
+            }
+            start = end;
+        }
+        if (bc.error) {
+            break;
+        }
+    }
+
+    free(hits);
+    if (bc.error) {
+        search_index_free(index);
+        print_error("Failed to build search index");
+        return -1;
+    }
+
+    index->doc_count = bank->count;
+    return 0;
+}
+
+void search_index_free(SearchIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+    if (index->lists != NULL) {
+        for (size_t t = 0; t < index->term_count; t++) {
+            free(index->lists[t].data);
+            free(index->lists[t].skips);
+        }
+    }
+    free(index->lists);
+    free(index->term_pool);
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+size_t search_index_posting_bytes(const SearchIndex *index) {
+    size_t total = 0;
+    if (index != NULL) {
+        for (size_t t = 0; t < index->term_count; t++) {
+            total += index->lists[t].len;
+        }
+    }
+    return total;
+}
+
+static void cursor_read_doc(PostingCursor *c, uint32_t base) {
+    if (c->ptr >= c->end) {
+        c->valid = false;
+        return;
+    }
+    uint32_t delta;
+    c->ptr = decode_varint(c->ptr, c->end, &delta);
+    c->doc = base + delta;
+    c->ptr = decode_varint(c->ptr, c->end, &c->pos_count);
+    c->pos_ptr = c->ptr;
+    c->ptr = skip_varints(c->ptr, c->end, c->pos_count);
+}
+
+static void cursor_init(PostingCursor *c, const PostingList *list) {
+    c->list = list;
+    c->next_skip = 0;
+    c->ptr = list->data;
+    c->end = list->data + list->len;
+    c->valid = true;
+    cursor_read_doc(c, 0);
+}
+
+static void cursor_advance_to(PostingCursor *c, uint32_t target) {
+    if (!c->valid || c->doc >= target) {
+        return;
+    }
+    
+    const PostingList *list = c->list;
+    const uint8_t *block = NULL;
+    uint32_t base = 0;
+    while (c->next_skip < list->skip_count && list->skips[c->next_skip].base_doc < target) {
+        const uint8_t *start = list->data + list->skips[c->next_skip].offset;
+        if (start >= c->ptr) {
+            block = start;
+            base = list->skips[c->next_skip].base_doc;
+        }
+        c->next_skip++;
+    }
+    if (block != NULL) {
+        c->ptr = block;
+        cursor_read_doc(c, base);
+    }
+    
+    while (c->valid && c->doc < target) {
+        cursor_read_doc(c, c->doc);
+    }
+}
+
+static size_t cursor_positions(const PostingCursor *c, uint32_t *out, size_t max) {
+    const uint8_t *p = c->pos_ptr;
+    uint32_t pos = 0;
+    size_t n = c->pos_count < max ? c->pos_count : max;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t delta;
+        p = decode_varint(p, c->end, &delta);
+        pos += delta;
+        out[i] = pos;
+    }
+    return n;
+}
+
+static bool contains_position(const uint32_t *positions, size_t n, uint32_t value) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (positions[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < n && positions[lo] == value;
+}
+
+static void add_query_term(const char *token, size_t len, int position, void *ctx) {
+    QueryTerm **cursor = (QueryTerm**)ctx;
+    QueryTerm *t = *cursor;
+    memcpy(t->text, token, len);
+    t->text[len] = '\0';
+    t->len = len;
+    t->offset = position;
+    (*cursor)++;
+}
+
+/**
+ * @brief Split a query into terms, grouping quoted phrases
+ *
+ * @return int Number of terms, -1 if the query has too many terms
+ */
+static int parse_query(const char *query, QueryTerm *terms) {
+    int count = 0;
+    int group = 0;
+    const char *p = query;
+    char segment[1024];
+
+    while (*p != '\0') {
+        bool phrase = false;
+        const char *start = p;
+        const char *end;
+        if (*p == '"') {
+            phrase = true;
+            start = p + 1;
+            end = strchr(start, '"');
+            if (end == NULL) {
+                end = start + strlen(start);
+            }
+            p = *end == '"' ? end + 1 : end;
+        } else {
+            end = strchr(start, '"');
+            if (end == NULL) {
+                end = start + strlen(start);
+            }
+            p = end;
+        }
+
+        size_t len = (size_t)(end - start);
+        if (len >= sizeof(segment)) {
+            len = sizeof(segment) - 1;
+        }
+        memcpy(segment, start, len);
+        segment[len] = '\0';
+
+        int tokens = search_tokenize(segment, NULL, NULL);
+        if (count + tokens > MAX_QUERY_TERMS) {
+            return -1;
+        }
+        QueryTerm *cursor = &terms[count];
+        search_tokenize(segment, add_query_term, &cursor);
+        for (int i = 0; i < tokens; i++) {
+            terms[count + i].group = phrase ? group : group + i;
+            if (!phrase) {
+                terms[count + i].offset = 0;
+            }
+        }
+        group += phrase ? 1 : tokens;
+        count += tokens;
+    }
+    return count;
+}
+
+/**
+ * @brief Check every multi-term phrase at the cursors' current document
+ */
+static bool phrases_match(const QueryTerm *terms, int count, const PostingCursor *cursors,
+                          uint32_t *first, uint32_t *other) {
+    for (int i = 0; i < count; i++) {
+        if (terms[i].offset != 0) {
+            continue;
+        }
+        bool is_phrase = i + 1 < count && terms[i + 1].group == terms[i].group;
+        if (!is_phrase) {
+            continue;
+        }
+        size_t n = cursor_positions(&cursors[i], first, MAX_DOC_TOKENS);
+        bool found = false;
+        for (size_t k = 0; k < n && !found; k++) {
+            found = true;
+            for (int j = i + 1; j < count && terms[j].group == terms[i].group; j++) {
+                size_t m = cursor_positions(&cursors[j], other, MAX_DOC_TOKENS);
+                if (!contains_position(other, m, first[k] + (uint32_t)terms[j].offset)) {
+                    found = false;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+long search_query(const SearchIndex *index, const char *query,
+                  size_t *results, size_t max_results) {
+    if (index == NULL || query == NULL) {
+        return -1;
+    }
+
+    QueryTerm terms[MAX_QUERY_TERMS];
+    int count = parse_query(query, terms);
+    if (count <= 0) {
+        return -1;
+    }
+
+    PostingCursor cursors[MAX_QUERY_TERMS];
+    for (int i = 0; i < count; i++) {
+        size_t slot;
+        int term = index->slot_count > 0 ? find_slot(index, terms[i].text, terms[i].len, &slot) : -1;
+        if (term < 0) {
+            return 0;
+        }
+        cursor_init(&cursors[i], &index->lists[term]);
+    }
+
+    uint32_t *first = (uint32_t*)malloc(2 * MAX_DOC_TOKENS * sizeof(uint32_t));
+    if (first == NULL) {
+        return -1;
+    }
+    uint32_t *other = first + MAX_DOC_TOKENS;
+
+    long matches = 0;
+    for (;;) {
+        uint32_t target = 0;
+        bool done = false;
+        for (int i = 0; i < count; i++) {
+            if (!cursors[i].valid) {
+                done = true;
+                break;
+            }
+            if (cursors[i].doc > target) {
+                target = cursors[i].doc;
+            }
+        }
+        if (done) {
+            break;
+        }
+
+        bool aligned = true;
+        for (int i = 0; i < count; i++) {
+            cursor_advance_to(&cursors[i], target);
+            if (!cursors[i].valid) {
+                done = true;
+                break;
+            }
+            if (cursors[i].doc != target) {
+                aligned = false;
+            }
+        }
+        if (done) {
+            break;
+        }
+        if (!aligned) {
+            continue;
+        }
+
+        if (phrases_match(terms, count, cursors, first, other)) {
+            if (results != NULL && (size_t)matches < max_results) {
+                results[matches] = target;
+            }
+            matches++;
+        }
+        cursor_advance_to(&cursors[0], target + 1);
+    }
+
+    free(first);
+    return matches;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file search.h
+ * @brief Inverted full-text index over question and option text
+ *
+ * This module handles:
+ * - Tokenizing question text and options (lowercased ASCII words,
+ *   UTF-8 bytes kept as word characters)
+ * - Building an inverted index with varint delta-compressed posting lists
+ *   that carry word positions
+ * - Answering AND queries over terms and "quoted phrases"
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "questions.h"
+
+/**
+ * @brief Maximum stored length of a single token
+ */
+#define MAX_TOKEN_LEN 48
+
+/**
+ * @brief Maximum number of terms in one query
+ */
+#define MAX_QUERY_TERMS 16
+
+/**
+ * @brief Postings between consecutive skip entries
+ */
+#define SEARCH_SKIP_INTERVAL 64
+
+/**
+ * @brief Skip entry letting a cursor jump over a block of postings
+ */
+typedef struct {
+    uint32_t base_doc;           /**< Last document before the block */
+    uint32_t offset;             /**< Byte offset of the block in the list */
+} PostingSkip;
+
+/**
+ * @brief Posting list of one term
+ */
+typedef struct {
+    uint32_t term_offset;        /**< Offset of the term in the term pool */
+    uint32_t doc_freq;           /**< Number of questions containing the term */
+    uint32_t last_doc;           /**< Last document appended */
+    uint8_t *data;               /**< Encoded postings */
+    size_t len;                  /**< Bytes used in data */
+    size_t cap;                  /**< Bytes allocated for data */
+    PostingSkip *skips;          /**< One entry per SEARCH_SKIP_INTERVAL postings */
+    uint32_t skip_count;         /**< Number of skip entries */
+} PostingList;
+
+/**
+ * @brief Inverted index over a QuestionBank
+ *
+ * Document IDs are indices into the bank the index was built from. Each
+ * posting is varint(doc delta), varint(position count), then varint
+ * position deltas. Positions of different fields are separated by a gap,
+ * so phrases never match across the question and an option.
+ */
+typedef struct {
+    PostingList *lists;          /**< Posting lists, one per term */
+    size_t term_count;           /**< Number of distinct terms */
+    size_t term_cap;             /**< Allocated posting lists */
+    char *term_pool;             /**< NUL-separated term strings */
+    size_t pool_len;             /**< Bytes used in term_pool */
+    size_t pool_cap;             /**< Bytes allocated for term_pool */
+    uint32_t *slots;             /**< Hash table of term index + 1 (0 = empty) */
+    size_t slot_count;           /**< Hash table size (power of two) */
+    size_t doc_count;            /**< Number of indexed questions */
+} SearchIndex;
+
+/**
+ * @brief Build an index over every question in a bank
+ *
+ * @param index Pointer to SearchIndex to initialize
+ * @param bank Pointer to QuestionBank to index
+ * @return int 0 on success, -1 on error
+ */
+int search_index_build(SearchIndex *index, const QuestionBank *bank);
+
+/**
+ * @brief Free all memory held by an index
+ *
+ * @param index Pointer to SearchIndex
+ */
+void search_index_free(SearchIndex *index);
+
+/**
+ * @brief Run a query against the index
+ *
+ * Bare words must all appear (AND); words in double quotes must appear
+ * consecutively in the same field. Matching is case-insensitive.
+ *
+ * @param index Pointer to SearchIndex
+ * @param query Query text, e.g. `mars "red planet"`
+ * @param results Receives matching question indices in bank order (may be NULL)
+ * @param max_results Capacity of results
+ * @return long Total number of matches, -1 on error (empty or too long query)
+ */
+long search_query(const SearchIndex *index, const char *query,
+                  size_t *results, size_t max_results);
+
+/**
+ * @brief Total bytes used by posting lists
+ *
+ * @param index Pointer to SearchIndex
+ * @return size_t Encoded posting bytes
+ */
+size_t search_index_posting_bytes(const SearchIndex *index);
+
+/**
+ * @brief Split text into lowercase tokens
+ *
+ * @param text Text to tokenize
+ * @param callback Called for each token with its position (0-based)
+ * @param ctx Opaque pointer passed to callback
+ * @return int Number of tokens produced
+ */
+int search_tokenize(const char *text,
+                    void (*callback)(const char *token, size_t len, int position, void *ctx),
+                    void *ctx);
+
+#endif /* SEARCH_H */
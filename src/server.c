@@ -0,0 +1,2160 @@
+/**
+ * @file server.c
+ * @brief Game server: WebSocket connections and rooms on one epoll loop
+ */
+
+#define _GNU_SOURCE
+
+#include "server.h"
+#include "export.h"
+#include "game.h"
+#include "metrics.h"
+#include "utils.h"
+#include "websocket.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+
+/**
+ * @brief Shared receive buffer; parked bytes plus one recv() must fit
+ */
+#define SERVER_SCRATCH_SIZE (64 * 1024)
+
+/**
+ * @brief Outgoing message buffer (a question with every field escaped fits)
+ */
+#define SERVER_FORMAT_SIZE (16 * 1024)
+
+/**
+ * @brief Pooled buffer holding a connection's partial handshake or frame
+ */
+#define SERVER_PARK_SIZE 8192
+
+/**
+ * @brief Events taken per epoll_wait()
+ */
+#define SERVER_EVENTS 256
+
+/**
+ * @brief Initial room hash buckets
+ */
+#define SERVER_ROOM_BUCKETS 64
+
+/**
+ * @brief Seats in a room created without a count
+ */
+#define SERVER_DEFAULT_SEATS 2
+
+/**
+ * @brief First word of a handoff stream and its reply
+ */
+#define HANDOFF_MAGIC 0x48565254u
+
+/**
+ * @brief Handoff stream format; bump on any change to HandoffHeader,
+ *        HandoffRoom or what game_save() writes
+ */
+#define HANDOFF_VERSION 2
+
+/**
+ * @brief Handoff stream bytes buffered before a write
+ */
+#define HANDOFF_CHUNK (256 * 1024)
+
+/**
+ * @brief Seconds a handoff read or write may block
+ */
+#define HANDOFF_IO_TIMEOUT_S 10
+
+/**
+ * @brief First word of the upgrade hello and of the new process's reply
+ */
+#define UPGRADE_MAGIC 0x55504752u
+
+enum {
+    CONN_FREE = 0,                        /**< Slot unused */
+    CONN_HANDSHAKE,                       /**< Waiting for the HTTP upgrade */
+    CONN_OPEN,                            /**< Exchanging frames */
+    CONN_CLOSING                          /**< Flushing output, then closed */
+};
+
+/**
+ * @brief A framed message shared by every output queue that holds it
+ */
+typedef struct {
+    uint32_t refs;                        /**< Queue entries pointing here */
+    uint32_t len;                         /**< Frame bytes */
+    uint8_t data[];                       /**< Header and payload */
+} ServerFrame;
+
+/**
+ * @brief Output queue entry
+ */
+typedef struct OutItem {
+    struct OutItem *next;                 /**< Next entry */
+    ServerFrame *frame;                   /**< Frame to send */
+    uint32_t sent;                        /**< Bytes of it already sent */
+} OutItem;
+
+struct ServerConn {
+    uint8_t *in;                          /**< Parked partial input, NULL when none */
+    OutItem *out_head;                    /**< Output waiting for EPOLLOUT */
+    OutItem *out_tail;                    /**< Last queue entry */
+    uint32_t in_len;                      /**< Bytes parked in in */
+    uint32_t room;                        /**< Room joined, 0 for none */
+    uint8_t state;                        /**< CONN_* */
+    uint8_t player;                       /**< Seat in the room */
+    bool writing;                         /**< EPOLLOUT is armed */
+};
+
+/**
+ * @brief A handed-off seat whose client has not resumed yet
+ */
+typedef struct {
+    uint64_t token;                       /**< Secret part of the session, 0 when attached */
+    OutItem *held_head;                   /**< Output for the client once it resumes */
+    OutItem *held_tail;                   /**< Last held entry */
+} ServerSeat;
+
+struct ServerRoom {
+    ServerRoom *next;                     /**< Hash chain */
+    uint32_t id;                          /**< Room number chosen by clients */
+    uint8_t seats;                        /**< Players needed to start */
+    uint8_t joined;                       /**< Players in fds */
+    uint8_t waiting;                      /**< Seats waiting for RESUME */
+    int fds[SERVER_MAX_ROOM_PLAYERS];     /**< Members by seat, -1 while waiting */
+    ServerSeat detached[SERVER_MAX_ROOM_PLAYERS]; /**< Seats taken over in a handoff */
+    int64_t resume_deadline_ms;           /**< When waiting seats give up */
+    GameState *game;                      /**< Running game, NULL before the start */
+    const Question *current;              /**< Question waiting for an answer */
+    int round;                            /**< Questions answered so far */
+    int total_rounds;                     /**< questions_per_game times seats */
+    int64_t deadline_ms;                  /**< When the current question times out */
+    uint32_t timer_gen;                   /**< Bumped per question; stale timers are skipped */
+};
+
+struct ServerTimer {
+    int64_t due_ms;                       /**< Deadline */
+    uint32_t room;                        /**< Room id */
+    uint32_t gen;                         /**< Room timer_gen when armed, 0 for a resume check */
+};
+
+/**
+ * @brief JSON message being formatted into the server's format buffer
+ */
+typedef struct {
+    char *data;                           /**< Payload start (after header room) */
+    size_t len;                           /**< Bytes written */
+    size_t cap;                           /**< Bytes available */
+} MessageWriter;
+
+static void conn_close(Server *server, int fd);
+static void room_next(Server *server, ServerRoom *room);
+
+static int64_t now_ms(void) {
+    return (int64_t)monotonic_ms();
+}
+
+/**
+ * @brief Wall clock in milliseconds, for deadlines sent to another node
+ */
+static int64_t wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ---- Message formatting ---- */
+
+static void message_begin(Server *server, MessageWriter *w) {
+    w->data = server->format + WS_MAX_HEADER;
+    w->len = 0;
+    w->cap = SERVER_FORMAT_SIZE - WS_MAX_HEADER;
+}
+
+static void put_fmt(MessageWriter *w, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(w->data + w->len, w->cap - w->len, format, args);
+    va_end(args);
+    if (n > 0) {
+        w->len += (size_t)n < w->cap - w->len ? (size_t)n : w->cap - w->len - 1;
+    }
+}
+
+/**
+ * @brief Append a JSON string, escaped by export_json_escape()
+ */
+static void put_json_string(MessageWriter *w, const char *s) {
+    size_t len = strlen(s);
+    if (w->len + len * 6 + 3 > w->cap) {
+        return;
+    }
+    w->data[w->len++] = '"';
+    w->len += export_json_escape(w->data + w->len, s, len);
+    w->data[w->len++] = '"';
+}
+
+/**
+ * @brief Write the text frame header in front of the payload
+ *
+ * @return uint8_t* Start of the frame, which is *len bytes long
+ */
+static const uint8_t* message_frame(MessageWriter *w, size_t *len) {
+    uint8_t header[WS_MAX_HEADER];
+    size_t header_len = ws_encode_header(header, WS_OP_TEXT, w->len, NULL);
+    uint8_t *start = (uint8_t*)w->data - header_len;
+    memcpy(start, header, header_len);
+    *len = header_len + w->len;
+    return start;
+}
+
+/* ---- Output ---- */
+
+static void frame_unref(Server *server, ServerFrame *frame) {
+    if (--frame->refs == 0) {
+        session_pool_release(&server->pool, frame);
+    }
+}
+
+/**
+ * @brief Drop a connection after a send error
+ *
+ * Closing is left to the loop (the hang-up arrives as an event), because
+ * the caller may be walking a room that this connection belongs to.
+ */
+static void conn_fail(Server *server, int fd) {
+    server->conns[fd].state = CONN_CLOSING;
+    shutdown(fd, SHUT_RDWR);
+}
+
+static void conn_watch(Server *server, int fd, bool writing) {
+    ServerConn *c = &server->conns[fd];
+    if (c->writing == writing) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (writing ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    c->writing = writing;
+}
+
+/**
+ * @brief Append a frame to an output queue, @p sent bytes of it already sent
+ *
+ * The frame is queued by reference to *shared, which is copied from
+ * @p data the first time any recipient needs it, so a broadcast is
+ * stored at most once however many members are slow.
+ *
+ * @param shared Frame shared by the recipients of one broadcast (may be NULL)
+ * @return int 0 on success, -1 if out of memory
+ */
+static int queue_frame(Server *server, OutItem **head, OutItem **tail, const uint8_t *data,
+                       size_t len, size_t sent, ServerFrame **shared) {
+    OutItem *item = (OutItem*)session_pool_alloc(&server->pool, sizeof(OutItem));
+    ServerFrame *frame = shared != NULL ? *shared : NULL;
+    if (item != NULL && frame == NULL) {
+        frame = (ServerFrame*)session_pool_alloc(&server->pool, sizeof(ServerFrame) + len);
+        if (frame != NULL) {
+            frame->refs = 0;
+            frame->len = (uint32_t)len;
+            memcpy(frame->data, data, len);
+            if (shared != NULL) {
+                *shared = frame;
+            }
+        }
+    }
+    if (item == NULL || frame == NULL) {
+        session_pool_release(&server->pool, item);
+        return -1;
+    }
+    frame->refs++;
+    item->next = NULL;
+    item->frame = frame;
+    item->sent = (uint32_t)sent;
+    if (*tail != NULL) {
+        (*tail)->next = item;
+    } else {
+        *head = item;
+    }
+    *tail = item;
+    server->queued_bytes += len - sent;
+    return 0;
+}
+
+/**
+ * @brief Drop every entry of an output queue
+ */
+static void queue_release(Server *server, OutItem **head, OutItem **tail) {
+    while (*head != NULL) {
+        OutItem *item = *head;
+        *head = item->next;
+        server->queued_bytes -= item->frame->len - item->sent;
+        frame_unref(server, item->frame);
+        session_pool_release(&server->pool, item);
+    }
+    *tail = NULL;
+}
+
+/**
+ * @brief Send a frame, queueing what the socket does not take
+ *
+ * Bytes are sent straight from @p data when nothing is queued ahead of
+ * them; see queue_frame() for the rest.
+ *
+ * @param shared Frame shared by the recipients of one broadcast (may be NULL)
+ */
+static void conn_send(Server *server, int fd, const uint8_t *data, size_t len,
+                      ServerFrame **shared) {
+    ServerConn *c = &server->conns[fd];
+    if (c->state != CONN_OPEN && c->state != CONN_HANDSHAKE) {
+        return;
+    }
+    server->stats.frames_out++;
+
+    size_t sent = 0;
+    if (c->out_head == NULL) {
+        ssize_t n = send(fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            conn_fail(server, fd);
+            return;
+        }
+        sent = n > 0 ? (size_t)n : 0;
+        if (sent == len) {
+            return;
+        }
+    }
+    if (queue_frame(server, &c->out_head, &c->out_tail, data, len, sent, shared) != 0) {
+        conn_fail(server, fd);
+        return;
+    }
+    conn_watch(server, fd, true);
+}
+
+/**
+ * @brief Send queued output after EPOLLOUT
+ */
+static void conn_flush(Server *server, int fd) {
+    ServerConn *c = &server->conns[fd];
+    while (c->out_head != NULL) {
+        OutItem *item = c->out_head;
+        ServerFrame *frame = item->frame;
+        ssize_t n = send(fd, frame->data + item->sent, frame->len - item->sent,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                conn_fail(server, fd);
+            }
+            return;
+        }
+        item->sent += (uint32_t)n;
+        server->queued_bytes -= (size_t)n;
+        if (item->sent < frame->len) {
+            return;
+        }
+        c->out_head = item->next;
+        frame_unref(server, frame);
+        session_pool_release(&server->pool, item);
+    }
+    c->out_tail = NULL;
+    conn_watch(server, fd, false);
+}
+
+static void send_message(Server *server, int fd, MessageWriter *w) {
+    size_t len;
+    const uint8_t *frame = message_frame(w, &len);
+    conn_send(server, fd, frame, len, NULL);
+}
+
+static void send_error(Server *server, int fd, const char *message) {
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"error\",\"message\":\"%s\"}", message);
+    send_message(server, fd, &w);
+}
+
+/**
+ * @brief Send a close frame and stop reading from the connection
+ */
+static void send_close(Server *server, int fd, uint16_t code) {
+    uint8_t frame[4] = { 0x80 | WS_OP_CLOSE, 2, (uint8_t)(code >> 8), (uint8_t)code };
+    conn_send(server, fd, frame, sizeof(frame), NULL);
+    server->conns[fd].state = CONN_CLOSING;
+}
+
+/**
+ * @brief Start a redirect message, leaving it open for more fields
+ *
+ * @param host Address to send the client to, NULL for the one it reached
+ *             this server on (the listener moved to another process)
+ */
+static void put_redirect(Server *server, MessageWriter *w, int fd, const char *host, int port) {
+    char local[INET_ADDRSTRLEN] = "127.0.0.1";
+    if (host == NULL) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        if (getsockname(fd, (struct sockaddr*)&addr, &addr_len) == 0 &&
+            addr.sin_family == AF_INET) {
+            inet_ntop(AF_INET, &addr.sin_addr, local, sizeof(local));
+        }
+        host = local;
+    }
+    message_begin(server, w);
+    put_fmt(w, "{\"type\":\"redirect\",\"host\":");
+    put_json_string(w, host);
+    put_fmt(w, ",\"port\":%d", port);
+}
+
+/**
+ * @brief Send a client with no seat to the process now holding the
+ *        listener, and hang up; it reconnects and joins again there
+ */
+static void drain_redirect(Server *server, int fd) {
+    MessageWriter w;
+    put_redirect(server, &w, fd, NULL, server->port);
+    put_fmt(&w, "}");
+    send_message(server, fd, &w);
+    send_close(server, fd, 1001);
+}
+
+/**
+ * @brief Send to the member in a seat, or hold the frame for a seat whose
+ *        client is still moving here after a handoff
+ */
+static void seat_send(Server *server, ServerRoom *room, int seat, const uint8_t *data,
+                      size_t len, ServerFrame **shared) {
+    if (room->fds[seat] >= 0) {
+        conn_send(server, room->fds[seat], data, len, shared);
+        return;
+    }
+    ServerSeat *s = &room->detached[seat];
+    server->stats.frames_out++;
+    queue_frame(server, &s->held_head, &s->held_tail, data, len, 0, shared);
+}
+
+/* ---- Rooms ---- */
+
+static size_t room_bucket(const Server *server, uint32_t id) {
+    return (size_t)(id * 2654435761u) & (server->room_buckets - 1);
+}
+
+static ServerRoom* room_find(Server *server, uint32_t id) {
+    ServerRoom *room = server->rooms[room_bucket(server, id)];
+    while (room != NULL && room->id != id) {
+        room = room->next;
+    }
+    return room;
+}
+
+static ServerRoom* room_create(Server *server, uint32_t id, int seats) {
+    if (server->room_count >= server->room_buckets) {
+        size_t buckets = server->room_buckets * 2;
+        ServerRoom **table = (ServerRoom**)calloc(buckets, sizeof(ServerRoom*));
+        if (table == NULL) {
+            return NULL;
+        }
+        for (size_t b = 0; b < server->room_buckets; b++) {
+            ServerRoom *room = server->rooms[b];
+            while (room != NULL) {
+                ServerRoom *next = room->next;
+                size_t slot = (size_t)(room->id * 2654435761u) & (buckets - 1);
+                room->next = table[slot];
+                table[slot] = room;
+                room = next;
+            }
+        }
+        free(server->rooms);
+        server->rooms = table;
+        server->room_buckets = buckets;
+    }
+
+    ServerRoom *room = (ServerRoom*)session_pool_alloc(&server->pool, sizeof(ServerRoom));
+    if (room == NULL) {
+        return NULL;
+    }
+    memset(room, 0, sizeof(*room));
+    room->id = id;
+    room->seats = (uint8_t)seats;
+    size_t slot = room_bucket(server, id);
+    room->next = server->rooms[slot];
+    server->rooms[slot] = room;
+    server->room_count++;
+    return room;
+}
+
+static void room_destroy(Server *server, ServerRoom *room) {
+    ServerRoom **link = &server->rooms[room_bucket(server, room->id)];
+    while (*link != room) {
+        link = &(*link)->next;
+    }
+    *link = room->next;
+    for (int i = 0; i < room->joined; i++) {
+        if (room->fds[i] >= 0) {
+            server->conns[room->fds[i]].room = 0;
+        } else {
+            queue_release(server, &room->detached[i].held_head, &room->detached[i].held_tail);
+        }
+    }
+    game_destroy(room->game);
+    session_pool_release(&server->pool, room);
+    server->room_count--;
+}
+
+static void room_broadcast(Server *server, ServerRoom *room, MessageWriter *w) {
+    size_t len;
+    const uint8_t *frame = message_frame(w, &len);
+    ServerFrame *shared = NULL;
+    for (int i = 0; i < room->joined; i++) {
+        seat_send(server, room, i, frame, len, &shared);
+    }
+    server->stats.broadcasts++;
+}
+
+static void timer_push(Server *server, int64_t due_ms, uint32_t room, uint32_t gen) {
+    if (server->timer_len == server->timer_cap) {
+        int cap = server->timer_cap > 0 ? server->timer_cap * 2 : 64;
+        ServerTimer *timers = (ServerTimer*)realloc(server->timers, (size_t)cap * sizeof(ServerTimer));
+        if (timers == NULL) {
+            return;
+        }
+        server->timers = timers;
+        server->timer_cap = cap;
+    }
+    ServerTimer t = { due_ms, room, gen };
+    int i = server->timer_len++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (server->timers[parent].due_ms <= due_ms) {
+            break;
+        }
+        server->timers[i] = server->timers[parent];
+        i = parent;
+    }
+    server->timers[i] = t;
+}
+
+static ServerTimer timer_pop(Server *server) {
+    ServerTimer top = server->timers[0];
+    ServerTimer last = server->timers[--server->timer_len];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= server->timer_len) {
+            break;
+        }
+        if (child + 1 < server->timer_len &&
+            server->timers[child + 1].due_ms < server->timers[child].due_ms) {
+            child++;
+        }
+        if (last.due_ms <= server->timers[child].due_ms) {
+            break;
+        }
+        server->timers[i] = server->timers[child];
+        i = child;
+    }
+    if (server->timer_len > 0) {
+        server->timers[i] = last;
+    }
+    return top;
+}
+
+static void put_scores(MessageWriter *w, const GameState *game) {
+    put_fmt(w, "[");
+    int players = game->config.num_players;
+    for (int i = 0; i < players; i++) {
+        const int score = players > 1 ? game->players[i].score : game->stats.score;
+        put_fmt(w, i > 0 ? ",%d" : "%d", score);
+    }
+    put_fmt(w, "]");
+}
+
+/**
+ * @brief End the room's game, tell the members and remove the room
+ *
+ * @param completed Whether every round was played
+ */
+static void room_finish(Server *server, ServerRoom *room, bool completed) {
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"end\",\"room\":%u,\"completed\":%s,\"scores\":",
+            room->id, completed ? "true" : "false");
+    put_scores(&w, room->game);
+    put_fmt(&w, "}");
+    room_broadcast(server, room, &w);
+    if (completed) {
+        server->stats.games_finished++;
+    }
+    int fds[SERVER_MAX_ROOM_PLAYERS];
+    int joined = room->joined;
+    memcpy(fds, room->fds, sizeof(fds));
+    room_destroy(server, room);
+    for (int i = 0; server->draining && i < joined; i++) {
+        if (fds[i] >= 0 && server->conns[fds[i]].state == CONN_OPEN) {
+            drain_redirect(server, fds[i]);
+        }
+    }
+}
+
+static void room_start(Server *server, ServerRoom *room) {
+    GameConfig config;
+    config.questions_per_game = server->opts.questions_per_game;
+    config.time_per_question = server->opts.time_limit_s;
+    config.difficulty = (Difficulty)server->opts.difficulty;
+    config.use_timer = false;
+    config.num_players = room->seats;
+    config.shuffle_options = true;
+
+    room->game = game_create(&server->pool, server->bank, &config);
+    if (room->game == NULL) {
+        for (int i = 0; i < room->joined; i++) {
+            if (room->fds[i] >= 0) {
+                send_error(server, room->fds[i], "could not start game");
+            }
+        }
+        room_destroy(server, room);
+        return;
+    }
+    room->game->game_active = true;
+    room->round = 0;
+    room->total_rounds = config.questions_per_game * room->seats;
+    server->stats.games_started++;
+
+    for (int i = 0; i < room->joined; i++) {
+        MessageWriter w;
+        message_begin(server, &w);
+        put_fmt(&w, "{\"type\":\"start\",\"room\":%u,\"player\":%d,\"players\":%d}",
+                room->id, i, room->seats);
+        size_t len;
+        const uint8_t *frame = message_frame(&w, &len);
+        seat_send(server, room, i, frame, len, NULL);
+    }
+    room_next(server, room);
+}
+
+/**
+ * @brief Ask the next question, or end the game when none are left
+ */
+static void room_next(Server *server, ServerRoom *room) {
+    const Question *q = room->round < room->total_rounds ? game_draw_question(room->game) : NULL;
+    if (q == NULL) {
+        room_finish(server, room, true);
+        return;
+    }
+    room->current = q;
+    room->deadline_ms = now_ms() + (int64_t)server->opts.time_limit_s * 1000;
+    room->timer_gen++;
+
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"question\",\"room\":%u,\"round\":%d,\"player\":%d,"
+            "\"time_limit\":%d,\"text\":",
+            room->id, room->round, room->game->current_player, server->opts.time_limit_s);
+    put_json_string(&w, q->question);
+    put_fmt(&w, ",\"options\":[");
+    int options = question_option_count(q);
+    for (int slot = 0; slot < options; slot++) {
+        if (slot > 0) {
+            put_fmt(&w, ",");
+        }
+        put_json_string(&w, q->options[room->game->option_order[slot]]);
+    }
+    put_fmt(&w, "]}");
+    room_broadcast(server, room, &w);
+    timer_push(server, room->deadline_ms, room->id, room->timer_gen);
+}
+
+/**
+ * @brief Grade the current player's answer (0 on timeout) and move on
+ */
+static void room_answer(Server *server, ServerRoom *room, int choice) {
+    GameState *game = room->game;
+    const Question *q = room->current;
+    int64_t left_ms = room->deadline_ms - now_ms();
+    int time_remaining = left_ms > 0 ? (int)((left_ms + 999) / 1000) : 0;
+    int points = game_submit_answer(game, q, choice, time_remaining);
+    int correct_choice = game_option_choice(game, q->correct_answer);
+
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"result\",\"round\":%d,\"player\":%d,\"choice\":%d,"
+            "\"correct_choice\":%d,\"points\":%d}",
+            room->round, game->current_player, choice, correct_choice, points > 0 ? points : 0);
+    room_broadcast(server, room, &w);
+
+    room->current = NULL;
+    room->round++;
+    game_next_player(game);
+    room_next(server, room);
+}
+
+/**
+ * @brief Close the gap a freed seat leaves
+ */
+static void room_remove_seat(Server *server, ServerRoom *room, int seat) {
+    room->joined--;
+    for (int i = seat; i < room->joined; i++) {
+        room->fds[i] = room->fds[i + 1];
+        room->detached[i] = room->detached[i + 1];
+        if (room->fds[i] >= 0) {
+            server->conns[room->fds[i]].player = (uint8_t)i;
+        }
+    }
+    memset(&room->detached[room->joined], 0, sizeof(ServerSeat));
+}
+
+/**
+ * @brief Settle a room that just lost members
+ */
+static void room_leave_finish(Server *server, ServerRoom *room) {
+    if (room->game != NULL) {
+        room_finish(server, room, false);
+        return;
+    }
+    if (room->joined == 0) {
+        room_destroy(server, room);
+        return;
+    }
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"joined\",\"room\":%u,\"joined\":%d,\"seats\":%d}",
+            room->id, room->joined, room->seats);
+    room_broadcast(server, room, &w);
+}
+
+/**
+ * @brief Take a connection out of its room
+ *
+ * Leaving a running game ends it for everyone; leaving a waiting room
+ * frees the seat.
+ */
+static void room_leave(Server *server, int fd) {
+    ServerConn *c = &server->conns[fd];
+    ServerRoom *room = c->room != 0 ? room_find(server, c->room) : NULL;
+    c->room = 0;
+    if (room == NULL) {
+        return;
+    }
+    room_remove_seat(server, room, c->player);
+    room_leave_finish(server, room);
+}
+
+/**
+ * @brief Give up on seats whose client did not resume in time
+ *
+ * Like leaving: a running game ends, a waiting room frees the seats.
+ */
+static void room_expire(Server *server, ServerRoom *room) {
+    if (room->waiting == 0 || now_ms() < room->resume_deadline_ms) {
+        return;
+    }
+    server->stats.resume_expired += room->waiting;
+    room->waiting = 0;
+    for (int i = room->joined - 1; i >= 0; i--) {
+        if (room->fds[i] < 0) {
+            queue_release(server, &room->detached[i].held_head, &room->detached[i].held_tail);
+            room_remove_seat(server, room, i);
+        }
+    }
+    room_leave_finish(server, room);
+}
+
+/* ---- Client messages ---- */
+
+static void handle_join(Server *server, int fd, const char *args) {
+    ServerConn *c = &server->conns[fd];
+    char *end = NULL;
+    unsigned long id = strtoul(args, &end, 10);
+    long seats = SERVER_DEFAULT_SEATS;
+    if (end != args && *end == ' ') {
+        seats = strtol(end + 1, &end, 10);
+    }
+    if (end == args || *end != '\0' || id == 0 || id > UINT32_MAX ||
+        seats < 1 || seats > SERVER_MAX_ROOM_PLAYERS) {
+        send_error(server, fd, "usage: JOIN <room> [seats]");
+        return;
+    }
+    if (c->room != 0) {
+        send_error(server, fd, "already in a room");
+        return;
+    }
+
+    ServerRoom *room = room_find(server, (uint32_t)id);
+    if (room == NULL) {
+        room = room_create(server, (uint32_t)id, (int)seats);
+        if (room == NULL) {
+            send_error(server, fd, "could not create room");
+            return;
+        }
+    } else if (room->game != NULL || room->joined >= room->seats) {
+        send_error(server, fd, "room is full");
+        return;
+    }
+    c->room = room->id;
+    c->player = room->joined;
+    room->fds[room->joined++] = fd;
+
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"joined\",\"room\":%u,\"joined\":%d,\"seats\":%d}",
+            room->id, room->joined, room->seats);
+    room_broadcast(server, room, &w);
+    if (room->joined == room->seats) {
+        room_start(server, room);
+    }
+}
+
+static void handle_answer(Server *server, int fd, const char *args) {
+    ServerConn *c = &server->conns[fd];
+    ServerRoom *room = c->room != 0 ? room_find(server, c->room) : NULL;
+    int choice = 0;
+    if (room == NULL || room->game == NULL || room->current == NULL) {
+        send_error(server, fd, "no question to answer");
+        return;
+    }
+    if (c->player != room->game->current_player) {
+        send_error(server, fd, "not your turn");
+        return;
+    }
+    if (!is_valid_integer(args, &choice) || choice < 1 ||
+        choice > question_option_count(room->current)) {
+        send_error(server, fd, "usage: ANSWER <choice>");
+        return;
+    }
+    room_answer(server, room, choice);
+}
+
+/**
+ * @brief Give a seat held since a handoff to the client that was redirected here
+ *
+ * The client gets "resumed", then everything sent to the seat meanwhile.
+ */
+static void handle_resume(Server *server, int fd, const char *args) {
+    ServerConn *c = &server->conns[fd];
+    unsigned long id = 0;
+    unsigned long seat = 0;
+    unsigned long long token = 0;
+    char extra;
+    if (sscanf(args, "%lu-%lu-%llx%c", &id, &seat, &token, &extra) != 3 || id == 0 ||
+        id > UINT32_MAX) {
+        send_error(server, fd, "usage: RESUME <session>");
+        return;
+    }
+    if (c->room != 0) {
+        send_error(server, fd, "already in a room");
+        return;
+    }
+    ServerRoom *room = room_find(server, (uint32_t)id);
+    if (room == NULL || seat >= room->joined || room->fds[seat] >= 0 || token == 0 ||
+        room->detached[seat].token != token) {
+        send_error(server, fd, "unknown session");
+        return;
+    }
+    ServerSeat *held = &room->detached[seat];
+    room->fds[seat] = fd;
+    room->waiting--;
+    held->token = 0;
+    c->room = room->id;
+    c->player = (uint8_t)seat;
+    server->stats.resumed++;
+
+    MessageWriter w;
+    message_begin(server, &w);
+    put_fmt(&w, "{\"type\":\"resumed\",\"room\":%u,\"player\":%lu,\"players\":%d}",
+            room->id, seat, room->seats);
+    send_message(server, fd, &w);
+    if (held->held_head == NULL) {
+        return;
+    }
+    if (c->out_tail != NULL) {
+        c->out_tail->next = held->held_head;
+    } else {
+        c->out_head = held->held_head;
+    }
+    c->out_tail = held->held_tail;
+    held->held_head = NULL;
+    held->held_tail = NULL;
+    conn_watch(server, fd, true);
+    conn_flush(server, fd);
+}
+
+static void handle_message(Server *server, int fd, const uint8_t *payload, size_t len) {
+    char text[SERVER_MAX_MESSAGE + 1];
+    memcpy(text, payload, len);
+    text[len] = '\0';
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) {
+        text[--len] = '\0';
+    }
+    server->stats.messages_in++;
+
+    if (server->draining && server->conns[fd].room == 0 && strncmp(text, "RESUME ", 7) != 0) {
+        drain_redirect(server, fd);
+        return;
+    }
+    if (strncmp(text, "JOIN ", 5) == 0) {
+        handle_join(server, fd, text + 5);
+    } else if (strncmp(text, "ANSWER ", 7) == 0) {
+        handle_answer(server, fd, text + 7);
+    } else if (strcmp(text, "LEAVE") == 0) {
+        room_leave(server, fd);
+    } else if (strncmp(text, "RESUME ", 7) == 0) {
+        handle_resume(server, fd, text + 7);
+    } else {
+        send_error(server, fd, "unknown command");
+    }
+}
+
+/* ---- Input ---- */
+
+/**
+ * @brief Answer the upgrade request at the start of data
+ *
+ * @return size_t Bytes consumed; 0 if the request is incomplete or was refused
+ */
+static size_t conn_handshake(Server *server, int fd, const uint8_t *data, size_t len) {
+    char key[WS_MAX_KEY];
+    size_t request_len = 0;
+    int r = ws_parse_handshake((const char*)data, len, key, &request_len);
+    if (r == 0 && len < SERVER_PARK_SIZE) {
+        return 0;
+    }
+    if (r <= 0) {
+        static const char bad[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n"
+                                  "Connection: close\r\n\r\n";
+        conn_send(server, fd, (const uint8_t*)bad, sizeof(bad) - 1, NULL);
+        server->conns[fd].state = CONN_CLOSING;
+        return 0;
+    }
+    char response[256];
+    int n = ws_handshake_response(key, response, sizeof(response));
+    conn_send(server, fd, (const uint8_t*)response, (size_t)n, NULL);
+    server->conns[fd].state = CONN_OPEN;
+    if (server->draining) {
+        drain_redirect(server, fd);
+    }
+    return request_len;
+}
+
+/**
+ * @brief Handle every complete handshake and frame in data
+ *
+ * Payloads are unmasked in place.
+ *
+ * @return size_t Bytes consumed; the rest is an incomplete frame
+ */
+static size_t conn_consume(Server *server, int fd, uint8_t *data, size_t len) {
+    ServerConn *c = &server->conns[fd];
+    size_t used = 0;
+    if (c->state == CONN_HANDSHAKE) {
+        used = conn_handshake(server, fd, data, len);
+        if (c->state != CONN_OPEN) {
+            return used;
+        }
+    }
+
+    while (c->state == CONN_OPEN && used < len) {
+        WsFrame frame;
+        int r = ws_parse_frame(data + used, len - used, &frame);
+        if (r == 0) {
+            break;
+        }
+        if (r < 0 || !frame.masked) {
+            send_close(server, fd, 1002);
+            break;
+        }
+        if (frame.payload_len > SERVER_MAX_MESSAGE) {
+            send_close(server, fd, 1009);
+            break;
+        }
+        size_t total = frame.header_len + (size_t)frame.payload_len;
+        if (len - used < total) {
+            break;
+        }
+        uint8_t *payload = data + used + frame.header_len;
+        size_t payload_len = (size_t)frame.payload_len;
+        ws_mask(payload, payload_len, frame.mask, 0);
+        used += total;
+
+        switch (frame.opcode) {
+            case WS_OP_TEXT:
+                if (!frame.fin) {
+                    /* Commands are short; fragmented messages are not accepted. */
+                    send_close(server, fd, 1009);
+                } else {
+                    handle_message(server, fd, payload, payload_len);
+                }
+                break;
+            case WS_OP_PING: {
+                uint8_t pong[WS_MAX_HEADER + 125];
+                size_t header_len = ws_encode_header(pong, WS_OP_PONG, payload_len, NULL);
+                memcpy(pong + header_len, payload, payload_len);
+                conn_send(server, fd, pong, header_len + payload_len, NULL);
+                break;
+            }
+            case WS_OP_PONG:
+                break;
+            case WS_OP_CLOSE:
+                send_close(server, fd, payload_len >= 2
+                           ? (uint16_t)((payload[0] << 8) | payload[1]) : 1000);
+                break;
+            default:
+                send_close(server, fd, 1003);
+                break;
+        }
+    }
+    return used;
+}
+
+/**
+ * @brief Read what the socket has and handle it
+ *
+ * Parked bytes are copied in front of the new ones in the shared scratch
+ * buffer; whatever is left incomplete is parked again.
+ */
+static void conn_read(Server *server, int fd) {
+    ServerConn *c = &server->conns[fd];
+    uint8_t *data = server->scratch;
+    size_t len = c->in_len;
+    if (len > 0) {
+        memcpy(data, c->in, len);
+    }
+    ssize_t n = recv(fd, data + len, SERVER_SCRATCH_SIZE - len, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        conn_close(server, fd);
+        return;
+    }
+    if (n < 0) {
+        return;
+    }
+    if (c->state == CONN_CLOSING) {
+        return;
+    }
+    len += (size_t)n;
+
+    size_t used = conn_consume(server, fd, data, len);
+    size_t rest = c->state == CONN_CLOSING ? 0 : len - used;
+    if (rest > 0 && c->in == NULL) {
+        c->in = (uint8_t*)session_pool_alloc(&server->pool, SERVER_PARK_SIZE);
+        if (c->in == NULL) {
+            conn_close(server, fd);
+            return;
+        }
+        server->parked_bytes += SERVER_PARK_SIZE;
+    }
+    if (rest > 0) {
+        memmove(c->in, data + used, rest);
+    } else if (c->in != NULL) {
+        session_pool_release(&server->pool, c->in);
+        server->parked_bytes -= SERVER_PARK_SIZE;
+        c->in = NULL;
+    }
+    c->in_len = (uint32_t)rest;
+
+    if (c->state == CONN_CLOSING && c->out_head == NULL) {
+        conn_close(server, fd);
+    }
+}
+
+/* ---- Connections ---- */
+
+static int conn_reserve(Server *server, int fd) {
+    if (fd < server->conn_cap) {
+        return 0;
+    }
+    int cap = server->conn_cap;
+    while (cap <= fd) {
+        cap *= 2;
+    }
+    ServerConn *conns = (ServerConn*)realloc(server->conns, (size_t)cap * sizeof(ServerConn));
+    if (conns == NULL) {
+        return -1;
+    }
+    memset(conns + server->conn_cap, 0, (size_t)(cap - server->conn_cap) * sizeof(ServerConn));
+    server->conns = conns;
+    server->conn_cap = cap;
+    return 0;
+}
+
+static void conn_accept(Server *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (server->conn_count >= server->opts.max_connections || conn_reserve(server, fd) != 0) {
+            server->stats.rejected++;
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            server->stats.rejected++;
+            close(fd);
+            continue;
+        }
+        ServerConn *c = &server->conns[fd];
+        memset(c, 0, sizeof(*c));
+        c->state = CONN_HANDSHAKE;
+        server->conn_count++;
+        server->stats.accepted++;
+    }
+}
+
+static void conn_release(Server *server, ServerConn *c) {
+    while (c->out_head != NULL) {
+        OutItem *item = c->out_head;
+        c->out_head = item->next;
+        server->queued_bytes -= item->frame->len - item->sent;
+        frame_unref(server, item->frame);
+        session_pool_release(&server->pool, item);
+    }
+    c->out_tail = NULL;
+    if (c->in != NULL) {
+        session_pool_release(&server->pool, c->in);
+        server->parked_bytes -= SERVER_PARK_SIZE;
+        c->in = NULL;
+    }
+    c->in_len = 0;
+    c->state = CONN_FREE;
+}
+
+static void conn_close(Server *server, int fd) {
+    ServerConn *c = &server->conns[fd];
+    if (c->state == CONN_FREE) {
+        return;
+    }
+    /* Leave first: ending a game broadcasts, which skips this connection. */
+    c->state = CONN_CLOSING;
+    room_leave(server, fd);
+    conn_release(server, c);
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    server->conn_count--;
+    server->stats.closed++;
+}
+
+/**
+ * @brief Treat every question whose deadline passed as unanswered, and
+ *        give up on seats not resumed in time
+ */
+static void run_timers(Server *server) {
+    int64_t now = now_ms();
+    while (server->timer_len > 0 && server->timers[0].due_ms <= now) {
+        ServerTimer t = timer_pop(server);
+        ServerRoom *room = room_find(server, t.room);
+        if (room == NULL) {
+            continue;
+        }
+        if (t.gen == 0) {
+            room_expire(server, room);
+        } else if (room->current != NULL && room->timer_gen == t.gen) {
+            room_answer(server, room, 0);
+        }
+    }
+}
+
+/* ---- Handoff ---- */
+
+/**
+ * @brief Start of a handoff stream, and of the reply with rooms set to
+ *        the number of rooms answered
+ */
+typedef struct {
+    uint32_t magic;                       /**< HANDOFF_MAGIC */
+    uint32_t version;                     /**< HANDOFF_VERSION */
+    uint32_t saved_game_size;             /**< game_saved_fixed_size() */
+    uint32_t player_size;                 /**< sizeof(Player) */
+    uint32_t bank_count;                  /**< Questions in the sender's bank */
+    uint32_t rooms;                       /**< Rooms that follow */
+    int32_t port;                         /**< Reply: WebSocket port to redirect to */
+} HandoffHeader;
+
+/**
+ * @brief Header of a handoff stream or reply from this build
+ */
+static HandoffHeader handoff_header(const Server *server, uint32_t rooms, int32_t port) {
+    HandoffHeader header = {
+        HANDOFF_MAGIC, HANDOFF_VERSION, (uint32_t)game_saved_fixed_size(),
+        (uint32_t)sizeof(Player), (uint32_t)server->bank->count, rooms, port
+    };
+    return header;
+}
+
+/**
+ * @brief Whether a peer's header describes rooms this build can read
+ *
+ * Saved games and rooms are raw struct bytes, so both sides must agree on
+ * the format and on the layout of the structs inside it.
+ */
+static bool handoff_compatible(const HandoffHeader *peer) {
+    return peer->magic == HANDOFF_MAGIC && peer->version == HANDOFF_VERSION &&
+           peer->saved_game_size == (uint32_t)game_saved_fixed_size() &&
+           peer->player_size == (uint32_t)sizeof(Player);
+}
+
+/**
+ * @brief One room in a handoff stream; the saved game and then each
+ *        seat's pending output follow
+ */
+typedef struct {
+    uint32_t id;                          /**< Room number */
+    uint8_t seats;                        /**< Players needed to start */
+    uint8_t joined;                       /**< Seats taken */
+    uint8_t has_current;                  /**< Whether a question is waiting */
+    uint8_t reserved;                     /**< Zero */
+    int32_t round;                        /**< Questions answered so far */
+    int32_t total_rounds;                 /**< Questions in the game */
+    uint32_t current_index;               /**< Bank index of the question */
+    uint32_t current_id;                  /**< Its pack ID, to check the banks match */
+    int64_t deadline_wall_ms;             /**< Its deadline on the wall clock */
+    uint32_t game_len;                    /**< game_save() bytes, 0 before the start */
+    uint32_t pending_len[SERVER_MAX_ROOM_PLAYERS]; /**< Frame bytes owed to each seat */
+} HandoffRoom;
+
+static int handoff_write(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int handoff_read(int fd, void *out, size_t len) {
+    uint8_t *data = (uint8_t*)out;
+    while (len > 0) {
+        ssize_t n = recv(fd, data, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void handoff_timeouts(int fd) {
+    struct timeval tv = { HANDOFF_IO_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief Make room in a growable buffer
+ */
+static int buffer_reserve(uint8_t **buf, size_t *cap, size_t need) {
+    if (need <= *cap) {
+        return 0;
+    }
+    size_t grown = *cap > 0 ? *cap : HANDOFF_CHUNK;
+    while (grown < need) {
+        grown *= 2;
+    }
+    uint8_t *data = (uint8_t*)realloc(*buf, grown);
+    if (data == NULL) {
+        return -1;
+    }
+    *buf = data;
+    *cap = grown;
+    return 0;
+}
+
+/**
+ * @brief Output owed to a member that can move: every queued frame but a
+ *        partly sent one, which has to finish on this socket
+ */
+static OutItem* handoff_pending(ServerConn *c, uint32_t *len) {
+    OutItem *first = c->out_head;
+    if (first != NULL && first->sent > 0) {
+        first = first->next;
+    }
+    size_t total = 0;
+    for (OutItem *item = first; item != NULL; item = item->next) {
+        total += item->frame->len;
+    }
+    *len = (uint32_t)total;
+    return first;
+}
+
+/**
+ * @brief Whether a room can move: every seat attached and open
+ */
+static bool handoff_movable(const Server *server, const ServerRoom *room) {
+    if (room->waiting > 0) {
+        return false;
+    }
+    for (int i = 0; i < room->joined; i++) {
+        if (server->conns[room->fds[i]].state != CONN_OPEN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Append a room's record to the stream buffer
+ */
+static int handoff_put_room(Server *server, ServerRoom *room, uint8_t **buf, size_t *cap,
+                            size_t *len) {
+    HandoffRoom h;
+    memset(&h, 0, sizeof(h));
+    h.id = room->id;
+    h.seats = room->seats;
+    h.joined = room->joined;
+    h.round = room->round;
+    h.total_rounds = room->total_rounds;
+    if (room->current != NULL) {
+        h.has_current = 1;
+        h.current_index = (uint32_t)(room->current - server->bank->questions);
+        h.current_id = room->current->id;
+        h.deadline_wall_ms = wall_ms() + (room->deadline_ms - now_ms());
+    }
+    h.game_len = room->game != NULL ? (uint32_t)game_saved_size(room->game) : 0;
+    size_t need = sizeof(h) + h.game_len;
+    OutItem *pending[SERVER_MAX_ROOM_PLAYERS];
+    for (int i = 0; i < room->joined; i++) {
+        pending[i] = handoff_pending(&server->conns[room->fds[i]], &h.pending_len[i]);
+        need += h.pending_len[i];
+    }
+    if (buffer_reserve(buf, cap, *len + need) != 0) {
+        return -1;
+    }
+    uint8_t *out = *buf + *len;
+    memcpy(out, &h, sizeof(h));
+    out += sizeof(h);
+    if (h.game_len > 0 && game_save(room->game, out, h.game_len) != h.game_len) {
+        return -1;
+    }
+    out += h.game_len;
+    for (int i = 0; i < room->joined; i++) {
+        for (OutItem *item = pending[i]; item != NULL; item = item->next) {
+            memcpy(out, item->frame->data, item->frame->len);
+            out += item->frame->len;
+        }
+    }
+    *len += need;
+    return 0;
+}
+
+/**
+ * @brief Point a member at the node now holding its seat and hang up
+ *
+ * Queued frames went along with the room, except a partly sent one,
+ * which finishes here ahead of the redirect.
+ *
+ * @param host That node's address, NULL if it took over this listener
+ */
+static void handoff_redirect(Server *server, ServerRoom *room, int seat, const char *host,
+                             int port, uint64_t token) {
+    int fd = room->fds[seat];
+    ServerConn *c = &server->conns[fd];
+    OutItem *keep = c->out_head != NULL && c->out_head->sent > 0 ? c->out_head : NULL;
+    if (keep != NULL) {
+        queue_release(server, &keep->next, &c->out_tail);
+        c->out_tail = keep;
+    } else {
+        queue_release(server, &c->out_head, &c->out_tail);
+        conn_watch(server, fd, false);
+    }
+
+    MessageWriter w;
+    put_redirect(server, &w, fd, host, port);
+    put_fmt(&w, ",\"session\":\"%u-%d-%016llx\"}", room->id, seat, (unsigned long long)token);
+    send_message(server, fd, &w);
+    send_close(server, fd, 1001);
+}
+
+/**
+ * @brief Send every movable room down a connected handoff stream, then
+ *        redirect the members of each room the other side took
+ *
+ * Blocks the loop for the transfer: this runs once per deploy, and
+ * answering members in between would change what is being sent.
+ *
+ * @param host Address the other side's clients connect to, NULL for this
+ *             server's own (a new process took over the listener)
+ * @return int 0 if the other side replied, -1 if every room stays here
+ */
+static int handoff_send(Server *server, int fd, const char *host) {
+    ServerRoom **rooms = (ServerRoom**)malloc((server->room_count + 1) * sizeof(ServerRoom*));
+    if (rooms == NULL) {
+        return -1;
+    }
+    uint64_t *tokens = NULL;
+    uint8_t *buf = NULL;
+    size_t cap = 0;
+    uint32_t count = 0;
+    for (size_t b = 0; b < server->room_buckets; b++) {
+        for (ServerRoom *room = server->rooms[b]; room != NULL; room = room->next) {
+            if (handoff_movable(server, room)) {
+                rooms[count++] = room;
+            }
+        }
+    }
+    HandoffHeader header = handoff_header(server, count, 0);
+    size_t len = sizeof(header);
+    int result = buffer_reserve(&buf, &cap, len);
+    if (result == 0) {
+        memcpy(buf, &header, sizeof(header));
+    }
+    for (uint32_t i = 0; i < count && result == 0; i++) {
+        result = handoff_put_room(server, rooms[i], &buf, &cap, &len);
+        if (result == 0 && len >= HANDOFF_CHUNK) {
+            result = handoff_write(fd, buf, len);
+            len = 0;
+        }
+    }
+    if (result == 0) {
+        result = handoff_write(fd, buf, len);
+    }
+
+    HandoffHeader reply;
+    tokens = (uint64_t*)malloc((count + 1) * SERVER_MAX_ROOM_PLAYERS * sizeof(uint64_t));
+    if (result != 0 || tokens == NULL || handoff_read(fd, &reply, sizeof(reply)) != 0 ||
+        !handoff_compatible(&reply) || reply.rooms != count ||
+        handoff_read(fd, tokens, count * SERVER_MAX_ROOM_PLAYERS * sizeof(uint64_t)) != 0) {
+        result = -1;
+        count = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ServerRoom *room = rooms[i];
+        const uint64_t *seat_tokens = &tokens[(size_t)i * SERVER_MAX_ROOM_PLAYERS];
+        if (seat_tokens[0] == 0) {
+            continue;
+        }
+        for (int seat = 0; seat < room->joined; seat++) {
+            handoff_redirect(server, room, seat, host, reply.port, seat_tokens[seat]);
+        }
+        room_destroy(server, room);
+        server->stats.rooms_out++;
+    }
+    free(tokens);
+    free(buf);
+    free(rooms);
+    return result;
+}
+
+/**
+ * @brief Send every movable room to the node named in server_handoff()
+ */
+static void handoff_run(Server *server) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)server->handoff_target);
+    if (server->handoff_host == NULL ||
+        inet_pton(AF_INET, server->handoff_host, &addr.sin_addr) != 1) {
+        print_error("Invalid handoff address");
+        return;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        print_error("Failed to start handoff");
+        return;
+    }
+    handoff_timeouts(fd);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        print_error("Failed to connect to %s:%d for handoff: %s", server->handoff_host,
+                    server->handoff_target, strerror(errno));
+    } else if (handoff_send(server, fd, server->handoff_host) != 0) {
+        print_error("Handoff to %s:%d failed; keeping every room", server->handoff_host,
+                    server->handoff_target);
+    }
+    close(fd);
+}
+
+/**
+ * @brief Take over one room from a handoff stream
+ *
+ * Seats are held under fresh tokens until their clients resume; a
+ * running question keeps its wall-clock deadline.
+ *
+ * @param tokens Seat tokens to reply with, left zero if the room is refused
+ * @param taken Set to the room's id if it was taken, else 0
+ * @return int 0 if the stream can go on, -1 if it is broken
+ */
+static int handoff_take_room(Server *server, int fd, uint8_t **buf, size_t *cap,
+                             uint64_t *tokens, uint32_t *taken) {
+    HandoffRoom h;
+    *taken = 0;
+    if (handoff_read(fd, &h, sizeof(h)) != 0 || h.joined < 1 || h.joined > h.seats ||
+        h.seats > SERVER_MAX_ROOM_PLAYERS) {
+        return -1;
+    }
+    size_t len = h.game_len;
+    for (int i = 0; i < h.joined; i++) {
+        len += h.pending_len[i];
+    }
+    if (buffer_reserve(buf, cap, len) != 0 || handoff_read(fd, *buf, len) != 0) {
+        return -1;
+    }
+
+    QuestionBank *bank = server->bank;
+    bool current_ok = !h.has_current ||
+                      (h.current_index < bank->count &&
+                       bank->questions[h.current_index].id == h.current_id);
+    if (h.id == 0 || room_find(server, h.id) != NULL || !current_ok ||
+        (h.has_current && h.game_len == 0)) {
+        return 0;
+    }
+    ServerRoom *room = room_create(server, h.id, h.seats);
+    if (room == NULL) {
+        return 0;
+    }
+    if (h.game_len > 0) {
+        /* A game starts once every seat is taken, with one player per
+         * seat; anything else could never reach a seat's turn. */
+        room->game = game_restore(&server->pool, bank, *buf, h.game_len);
+        if (room->game == NULL || room->game->config.num_players != h.seats ||
+            h.joined != h.seats) {
+            room_destroy(server, room);
+            return 0;
+        }
+    }
+    room->joined = h.joined;
+    room->waiting = h.joined;
+    room->resume_deadline_ms = now_ms() + SERVER_RESUME_MS;
+    room->round = h.round;
+    room->total_rounds = h.total_rounds;
+
+    const uint8_t *pending = *buf + h.game_len;
+    for (int i = 0; i < h.joined; i++) {
+        ServerSeat *seat = &room->detached[i];
+        room->fds[i] = -1;
+        if (getrandom(&seat->token, sizeof(seat->token), 0) != (ssize_t)sizeof(seat->token) ||
+            seat->token == 0) {
+            seat->token = ((uint64_t)wall_ms() << 20) ^ (uint64_t)(uintptr_t)seat ^ 1u;
+        }
+        if (h.pending_len[i] > 0) {
+            queue_frame(server, &seat->held_head, &seat->held_tail, pending, h.pending_len[i],
+                        0, NULL);
+            pending += h.pending_len[i];
+        }
+    }
+    if (h.has_current) {
+        room->current = &bank->questions[h.current_index];
+        room->deadline_ms = now_ms() + (h.deadline_wall_ms - wall_ms());
+        room->timer_gen++;
+        timer_push(server, room->deadline_ms, room->id, room->timer_gen);
+    }
+    timer_push(server, room->resume_deadline_ms, room->id, 0);
+    for (int i = 0; i < h.joined; i++) {
+        tokens[i] = room->detached[i].token;
+    }
+    *taken = room->id;
+    server->stats.rooms_in++;
+    return 0;
+}
+
+/**
+ * @brief Receive rooms from a node or process that is going away
+ *
+ * @param fd Blocking handoff stream, left open
+ */
+static void handoff_receive(Server *server, int fd) {
+    HandoffHeader header;
+    if (handoff_read(fd, &header, sizeof(header)) != 0 || header.magic != HANDOFF_MAGIC) {
+        print_error("Malformed handoff stream");
+        return;
+    }
+    if (!handoff_compatible(&header)) {
+        /* The sender gets no reply and lets its rooms finish where they are. */
+        print_error("Refusing handoff: stream format %u (game %u, player %u bytes), "
+                    "this build %u (game %zu, player %zu bytes)",
+                    header.version, header.saved_game_size, header.player_size,
+                    HANDOFF_VERSION, game_saved_fixed_size(), sizeof(Player));
+        return;
+    }
+    if (header.bank_count != server->bank->count) {
+        print_error("Refusing handoff: sender has %u questions, this node %zu",
+                    header.bank_count, server->bank->count);
+        return;
+    }
+
+    size_t token_len = ((size_t)header.rooms + 1) * SERVER_MAX_ROOM_PLAYERS * sizeof(uint64_t);
+    HandoffHeader reply = handoff_header(server, 0, server->port);
+    uint64_t *tokens = (uint64_t*)calloc(1, token_len);
+    uint32_t *taken = (uint32_t*)calloc((size_t)header.rooms + 1, sizeof(uint32_t));
+    uint8_t *buf = NULL;
+    size_t cap = 0;
+    int result = tokens != NULL && taken != NULL ? 0 : -1;
+    for (; result == 0 && reply.rooms < header.rooms; reply.rooms++) {
+        result = handoff_take_room(server, fd, &buf, &cap,
+                                   &tokens[(size_t)reply.rooms * SERVER_MAX_ROOM_PLAYERS],
+                                   &taken[reply.rooms]);
+    }
+    size_t reply_len = (size_t)reply.rooms * SERVER_MAX_ROOM_PLAYERS * sizeof(uint64_t);
+    if (result == 0 && (handoff_write(fd, (const uint8_t*)&reply, sizeof(reply)) != 0 ||
+                        handoff_write(fd, (const uint8_t*)tokens, reply_len) != 0)) {
+        result = -1;
+    }
+    if (result != 0) {
+        /* The sender keeps every room; drop what was taken so far. */
+        print_error("Handoff stream broke after %u rooms", reply.rooms);
+        for (uint32_t i = 0; taken != NULL && i < reply.rooms; i++) {
+            ServerRoom *room = taken[i] != 0 ? room_find(server, taken[i]) : NULL;
+            if (room != NULL) {
+                room_destroy(server, room);
+                server->stats.rooms_in--;
+            }
+        }
+    }
+    free(taken);
+    free(tokens);
+    free(buf);
+}
+
+static void handoff_accept(Server *server) {
+    int fd = accept4(server->handoff_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    handoff_timeouts(fd);
+    handoff_receive(server, fd);
+    close(fd);
+}
+
+/* ---- Upgrade ---- */
+
+/**
+ * @brief First message on an upgrade channel; the listeners ride along as
+ *        SCM_RIGHTS: the WebSocket one, the handoff one if any, then the
+ *        caller's extra descriptors
+ */
+typedef struct {
+    uint32_t magic;                       /**< UPGRADE_MAGIC */
+    uint32_t has_handoff;                 /**< Whether a handoff listener follows */
+    uint32_t extra_count;                 /**< Extra descriptors after the listeners */
+    uint32_t reserved;                    /**< Zero */
+} UpgradeHello;
+
+/**
+ * @brief Control buffer big enough for every descriptor an upgrade passes
+ */
+typedef union {
+    struct cmsghdr align;
+    char data[CMSG_SPACE(sizeof(int) * (2 + SERVER_UPGRADE_MAX_FDS))];
+} UpgradeControl;
+
+static int upgrade_send_hello(int channel, const UpgradeHello *hello, const int *fds, int count) {
+    UpgradeControl control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { (void*)hello, sizeof(*hello) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)count);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)count);
+    ssize_t n;
+    do {
+        n = sendmsg(channel, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)sizeof(*hello) ? 0 : -1;
+}
+
+/**
+ * @brief Stop listening here; the descriptors live on in the new process
+ */
+static void upgrade_release_listener(Server *server, int *fd) {
+    if (*fd >= 0) {
+        /* The registration follows the shared socket, not this descriptor. */
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, *fd, NULL);
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+/**
+ * @brief Pass the listeners to a new process, hand it every movable room
+ *        and start draining
+ *
+ * Until the new process answers READY nothing changes here, so a binary
+ * that fails to start leaves this one serving as before.
+ */
+static void upgrade_run(Server *server) {
+    if (server->draining || server->upgrade_spawn == NULL) {
+        return;
+    }
+    int fds[2 + SERVER_UPGRADE_MAX_FDS];
+    int count = 0;
+    fds[count++] = server->listen_fd;
+    if (server->handoff_fd >= 0) {
+        fds[count++] = server->handoff_fd;
+    }
+    for (int i = 0; i < server->upgrade_fd_count; i++) {
+        fds[count++] = server->upgrade_fds[i];
+    }
+    int channel = server->upgrade_spawn(server->upgrade_ctx);
+    if (channel < 0) {
+        print_error("Failed to start the new server process");
+        return;
+    }
+    handoff_timeouts(channel);
+    UpgradeHello hello = { UPGRADE_MAGIC, server->handoff_fd >= 0,
+                           (uint32_t)server->upgrade_fd_count, 0 };
+    UpgradeHello ready;
+    if (upgrade_send_hello(channel, &hello, fds, count) != 0 ||
+        handoff_read(channel, &ready, sizeof(ready)) != 0 || ready.magic != UPGRADE_MAGIC) {
+        print_error("New server process did not take over; still serving");
+        close(channel);
+        return;
+    }
+
+    upgrade_release_listener(server, &server->listen_fd);
+    upgrade_release_listener(server, &server->handoff_fd);
+    server->draining = true;
+    server->drain_deadline_ms = now_ms() + SERVER_DRAIN_MS;
+    server->stats.upgrades++;
+    if (handoff_send(server, channel, NULL) != 0) {
+        print_error("New server process refused the rooms; finishing them here");
+    }
+    close(channel);
+    for (int fd = 0; fd < server->conn_cap; fd++) {
+        if (server->conns[fd].state == CONN_OPEN && server->conns[fd].room == 0) {
+            drain_redirect(server, fd);
+        }
+    }
+}
+
+/**
+ * @brief Take ownership of a listener passed in by an upgrade
+ *
+ * @param bound Set to the port it listens on
+ * @return int The descriptor, or -1 (closed) if it is not a usable listener
+ */
+static int listen_adopt(int fd, int *bound) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addr_len) != 0 || addr.sin_family != AF_INET) {
+        print_error("Inherited listener %d is not usable", fd);
+        close(fd);
+        return -1;
+    }
+    *bound = ntohs(addr.sin_port);
+    return fd;
+}
+
+/* ---- Public API ---- */
+
+void server_options_init(ServerOptions *opts) {
+    if (opts == NULL) {
+        return;
+    }
+    opts->host = "0.0.0.0";
+    opts->port = 8080;
+    opts->max_connections = 50000;
+    opts->questions_per_game = 5;
+    opts->time_limit_s = 30;
+    opts->difficulty = -1;
+    opts->handoff_port = -1;
+    opts->listen_fd = -1;
+    opts->handoff_listen_fd = -1;
+}
+
+/**
+ * @brief Open a non-blocking listener
+ *
+ * @param bound Set to the port bound (port 0 picks one)
+ * @return int Socket, or -1 on error
+ */
+static int listen_on(const char *host, int port, int *bound) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host != NULL ? host : "0.0.0.0", &addr.sin_addr) != 1) {
+        print_error("Invalid listen address: %s", host);
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        print_error("Failed to listen on port %d: %s", port, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(fd, (struct sockaddr*)&addr, &addr_len);
+    *bound = ntohs(addr.sin_port);
+    return fd;
+}
+
+int server_init(Server *server, QuestionBank *bank, const ServerOptions *opts) {
+    if (server == NULL || bank == NULL || opts == NULL) {
+        return -1;
+    }
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->handoff_fd = -1;
+    if (opts->port < 0 || opts->port > 65535 || opts->handoff_port > 65535 ||
+        opts->max_connections < 1 || opts->questions_per_game < 1 || opts->time_limit_s < 1) {
+        print_error("Invalid server options");
+        return -1;
+    }
+    server->opts = *opts;
+    server->bank = bank;
+    if (session_pool_init(&server->pool, POOL_DEFAULT_MAX_CACHED) != 0) {
+        return -1;
+    }
+
+    server->conn_cap = 1024;
+    server->conns = (ServerConn*)calloc((size_t)server->conn_cap, sizeof(ServerConn));
+    server->room_buckets = SERVER_ROOM_BUCKETS;
+    server->rooms = (ServerRoom**)calloc(server->room_buckets, sizeof(ServerRoom*));
+    server->scratch = (uint8_t*)malloc(SERVER_SCRATCH_SIZE);
+    server->format = (char*)malloc(SERVER_FORMAT_SIZE);
+    if (server->conns == NULL || server->rooms == NULL || server->scratch == NULL ||
+        server->format == NULL) {
+        print_error("Failed to allocate server buffers");
+        server_destroy(server);
+        return -1;
+    }
+
+    server->listen_fd = opts->listen_fd >= 0 ? listen_adopt(opts->listen_fd, &server->port)
+                                             : listen_on(opts->host, opts->port, &server->port);
+    if (server->listen_fd < 0) {
+        server_destroy(server);
+        return -1;
+    }
+    if (opts->handoff_listen_fd >= 0) {
+        server->handoff_fd = listen_adopt(opts->handoff_listen_fd, &server->handoff_port);
+        if (server->handoff_fd < 0) {
+            server_destroy(server);
+            return -1;
+        }
+    } else if (opts->handoff_port >= 0) {
+        server->handoff_fd = listen_on(opts->host, opts->handoff_port, &server->handoff_port);
+        if (server->handoff_fd < 0) {
+            server_destroy(server);
+            return -1;
+        }
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = server->listen_fd;
+    int added = server->epoll_fd >= 0 && server->wake_fd >= 0
+                ? epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) : -1;
+    ev.data.fd = server->wake_fd;
+    if (added == 0) {
+        added = epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev);
+    }
+    ev.data.fd = server->handoff_fd;
+    if (added == 0 && server->handoff_fd >= 0) {
+        added = epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->handoff_fd, &ev);
+    }
+    if (added != 0) {
+        print_error("Failed to set up the event loop: %s", strerror(errno));
+        server_destroy(server);
+        return -1;
+    }
+    return 0;
+}
+
+int server_run(Server *server) {
+    if (server == NULL || server->epoll_fd < 0) {
+        return -1;
+    }
+    struct epoll_event events[SERVER_EVENTS];
+    while (!server->stopping) {
+        int timeout = -1;
+        if (server->timer_len > 0 || server->draining) {
+            int64_t due = server->timer_len > 0 ? server->timers[0].due_ms
+                                                : server->drain_deadline_ms;
+            if (server->draining && server->drain_deadline_ms < due) {
+                due = server->drain_deadline_ms;
+            }
+            int64_t wait = due - now_ms();
+            timeout = wait > 0 ? (int)wait : 0;
+        }
+        int n = epoll_wait(server->epoll_fd, events, SERVER_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            print_error("epoll_wait failed: %s", strerror(errno));
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+            if (fd == server->listen_fd) {
+                conn_accept(server);
+                continue;
+            }
+            if (fd == server->wake_fd) {
+                uint64_t value;
+                while (read(server->wake_fd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            if (fd == server->handoff_fd) {
+                handoff_accept(server);
+                continue;
+            }
+            if (fd >= server->conn_cap || server->conns[fd].state == CONN_FREE) {
+                continue;
+            }
+            if (ev & EPOLLOUT) {
+                conn_flush(server, fd);
+                if (server->conns[fd].state == CONN_CLOSING && server->conns[fd].out_head == NULL) {
+                    conn_close(server, fd);
+                    continue;
+                }
+            }
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                conn_read(server, fd);
+            }
+        }
+        if (server->handoff_requested) {
+            server->handoff_requested = 0;
+            handoff_run(server);
+        }
+        if (server->upgrade_requested) {
+            server->upgrade_requested = 0;
+            upgrade_run(server);
+        }
+        run_timers(server);
+        if (server->draining && ((server->conn_count == 0 && server->room_count == 0) ||
+                                 now_ms() >= server->drain_deadline_ms)) {
+            break;
+        }
+    }
+    return 0;
+}
+
+void server_handoff(Server *server, const char *host, int port) {
+    if (server == NULL) {
+        return;
+    }
+    server->handoff_host = host;
+    server->handoff_target = port;
+    server->handoff_requested = 1;
+    if (server->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void server_upgrade(Server *server, ServerSpawnFn spawn, void *ctx, const int *extra_fds,
+                    int extra_count) {
+    if (server == NULL || extra_count < 0 || extra_count > SERVER_UPGRADE_MAX_FDS) {
+        return;
+    }
+    server->upgrade_spawn = spawn;
+    server->upgrade_ctx = ctx;
+    server->upgrade_fds = extra_fds;
+    server->upgrade_fd_count = extra_count;
+    server->upgrade_requested = 1;
+    if (server->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+int server_inherit(int channel, ServerOptions *opts, int *extra_fds, int *extra_count) {
+    if (channel < 0 || opts == NULL) {
+        return -1;
+    }
+    handoff_timeouts(channel);
+    UpgradeHello hello;
+    UpgradeControl control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { &hello, sizeof(hello) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+    ssize_t n;
+    do {
+        n = recvmsg(channel, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+
+    int fds[2 + SERVER_UPGRADE_MAX_FDS];
+    int count = 0;
+    for (struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL; cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t got = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < got; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (count < 2 + SERVER_UPGRADE_MAX_FDS) {
+                    fds[count++] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+    if (n != (ssize_t)sizeof(hello) || hello.magic != UPGRADE_MAGIC ||
+        hello.extra_count > SERVER_UPGRADE_MAX_FDS ||
+        count != 1 + (hello.has_handoff ? 1 : 0) + (int)hello.extra_count) {
+        print_error("Malformed upgrade hello");
+        for (int i = 0; i < count; i++) {
+            close(fds[i]);
+        }
+        return -1;
+    }
+    opts->listen_fd = fds[0];
+    opts->handoff_listen_fd = hello.has_handoff ? fds[1] : -1;
+    int first = hello.has_handoff ? 2 : 1;
+    int room = extra_count != NULL && extra_fds != NULL ? *extra_count : 0;
+    for (int i = 0; i < (int)hello.extra_count; i++) {
+        if (i < room) {
+            extra_fds[i] = fds[first + i];
+        } else {
+            close(fds[first + i]);
+        }
+    }
+    if (extra_count != NULL) {
+        *extra_count = (int)hello.extra_count < room ? (int)hello.extra_count : room;
+    }
+    return 0;
+}
+
+int server_take_over(Server *server, int channel) {
+    if (server == NULL || channel < 0 || server->epoll_fd < 0) {
+        return -1;
+    }
+    handoff_timeouts(channel);
+    UpgradeHello ready = { UPGRADE_MAGIC, 0, 0, 0 };
+    if (handoff_write(channel, (const uint8_t*)&ready, sizeof(ready)) != 0) {
+        print_error("Failed to tell the old server process to hand over");
+        return -1;
+    }
+    handoff_receive(server, channel);
+    return 0;
+}
+
+void server_stop(Server *server) {
+    if (server == NULL) {
+        return;
+    }
+    server->stopping = 1;
+    if (server->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+size_t server_connection_bytes(const Server *server) {
+    if (server == NULL) {
+        return 0;
+    }
+    return (size_t)server->conn_cap * sizeof(ServerConn) +
+           server->parked_bytes + server->queued_bytes;
+}
+
+void server_publish_metrics(const Server *server) {
+    if (server == NULL) {
+        return;
+    }
+    metrics_set("server.connections", (double)server->conn_count);
+    metrics_set("server.accepted", (double)server->stats.accepted);
+    metrics_set("server.rejected", (double)server->stats.rejected);
+    metrics_set("server.messages_in", (double)server->stats.messages_in);
+    metrics_set("server.frames_out", (double)server->stats.frames_out);
+    metrics_set("server.broadcasts", (double)server->stats.broadcasts);
+    metrics_set("server.games_started", (double)server->stats.games_started);
+    metrics_set("server.games_finished", (double)server->stats.games_finished);
+    metrics_set("server.rooms_out", (double)server->stats.rooms_out);
+    metrics_set("server.rooms_in", (double)server->stats.rooms_in);
+    metrics_set("server.resumed", (double)server->stats.resumed);
+    metrics_set("server.resume_expired", (double)server->stats.resume_expired);
+    metrics_set("server.upgrades", (double)server->stats.upgrades);
+    metrics_set("server.connection_bytes", (double)server_connection_bytes(server));
+    session_pool_publish(&server->pool);
+}
+
+void server_destroy(Server *server) {
+    if (server == NULL) {
+        return;
+    }
+    if (server->rooms != NULL) {
+        for (size_t b = 0; b < server->room_buckets; b++) {
+            while (server->rooms[b] != NULL) {
+                room_destroy(server, server->rooms[b]);
+            }
+        }
+    }
+    for (int fd = 0; server->conns != NULL && fd < server->conn_cap; fd++) {
+        if (server->conns[fd].state != CONN_FREE) {
+            conn_release(server, &server->conns[fd]);
+            close(fd);
+        }
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0) {
+        close(server->wake_fd);
+    }
+    if (server->handoff_fd >= 0) {
+        close(server->handoff_fd);
+    }
+    free(server->conns);
+    free(server->rooms);
+    free(server->timers);
+    free(server->scratch);
+    free(server->format);
+    session_pool_destroy(&server->pool);
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->handoff_fd = -1;
+}
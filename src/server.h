@@ -0,0 +1,284 @@
+/**
+ * @file server.h
+ * @brief Game server: WebSocket clients playing rooms on one epoll loop
+ *
+ * One thread accepts connections, speaks WebSocket to them and runs the
+ * rooms' games through the engine (game_create() on the server's
+ * SessionPool). Clients send text commands:
+ *
+ *   JOIN <room> [seats]   join or create a room; the game starts when full
+ *   ANSWER <choice>       answer the current question (1-4)
+ *   LEAVE                 leave the room
+ *   RESUME <session>      take back a seat after a redirect (see below)
+ *
+ * and receive JSON text messages (joined, start, question, result, end,
+ * error, redirect, resumed).
+ *
+ * Messages meant for a whole room are framed once into a reference-counted
+ * ServerFrame that every member's output queue points at, so broadcasting
+ * to N players costs one serialization, not N. An idle connection holds no
+ * buffers: received bytes go through a shared scratch buffer, and only a
+ * partial frame is parked in a pooled per-connection buffer.
+ *
+ * Handoff moves live rooms to another node, for rolling deploys. The old
+ * node connects to the new node's handoff port and sends each room: the
+ * saved game (game_save()), the current question and its deadline, and
+ * every seat's output not yet written to its socket. The new node holds
+ * each seat under a random session token and keeps the game going, so a
+ * countdown that was running ends when it would have. Each client then
+ * gets {"type":"redirect","host":...,"port":...,"session":...}, after the
+ * frames it was already being sent. It reconnects and sends RESUME, and
+ * the new node replies "resumed" followed by everything held for the
+ * seat. Seats not resumed within SERVER_RESUME_MS end their game. Rooms
+ * still waiting for resumes of their own are not handed on.
+ *
+ * An upgrade replaces the running binary without closing its port. The
+ * old process starts the new one (server_upgrade()) and passes it the
+ * listening sockets over a Unix socket (server_inherit()); connections
+ * keep queueing on them throughout, so none is refused. Once the new
+ * process is ready (server_take_over()) the old one stops accepting,
+ * hands it every movable room as above, and drains: idle clients get a
+ * redirect without a session and join again, other rooms play out here,
+ * and server_run() returns when the last connection has gone or after
+ * SERVER_DRAIN_MS.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <signal.h>
+#include "pool.h"
+#include "questions.h"
+
+/**
+ * @brief Most players in one room
+ */
+#define SERVER_MAX_ROOM_PLAYERS 8
+
+/**
+ * @brief Largest client message payload accepted
+ */
+#define SERVER_MAX_MESSAGE 1024
+
+/**
+ * @brief Milliseconds a handed-off seat waits for its client to resume
+ */
+#define SERVER_RESUME_MS 10000
+
+/**
+ * @brief Longest an upgraded-away process keeps serving its remaining clients
+ */
+#define SERVER_DRAIN_MS 60000
+
+/**
+ * @brief Most extra descriptors passed along in an upgrade
+ */
+#define SERVER_UPGRADE_MAX_FDS 4
+
+/**
+ * @brief Server settings
+ */
+typedef struct {
+    const char *host;                     /**< IPv4 address to listen on */
+    int port;                             /**< WebSocket port, 0 picks a free one */
+    int max_connections;                  /**< Connections accepted at once */
+    int questions_per_game;               /**< Questions per player */
+    int time_limit_s;                     /**< Seconds to answer each question */
+    int difficulty;                       /**< Difficulty filter, -1 for any */
+    int handoff_port;                     /**< Port taking rooms from other nodes, -1 for none */
+    int listen_fd;                        /**< Listener inherited in an upgrade, -1 to bind */
+    int handoff_listen_fd;                /**< Handoff listener inherited likewise, -1 for none */
+} ServerOptions;
+
+/**
+ * @brief Running totals
+ */
+typedef struct {
+    uint64_t accepted;                    /**< Connections accepted */
+    uint64_t rejected;                    /**< Connections refused (limit reached) */
+    uint64_t closed;                      /**< Connections closed */
+    uint64_t messages_in;                 /**< Client messages handled */
+    uint64_t frames_out;                  /**< Frames queued or sent to clients */
+    uint64_t broadcasts;                  /**< Room messages framed once and shared */
+    uint64_t games_started;               /**< Games started */
+    uint64_t games_finished;              /**< Games played to the end */
+    uint64_t rooms_out;                   /**< Rooms handed off to another node */
+    uint64_t rooms_in;                    /**< Rooms taken over from another node */
+    uint64_t resumed;                     /**< Seats resumed after a handoff */
+    uint64_t resume_expired;              /**< Seats whose client never resumed */
+    uint64_t upgrades;                    /**< Times the listeners went to a new process */
+} ServerStats;
+
+typedef struct ServerConn ServerConn;
+typedef struct ServerRoom ServerRoom;
+typedef struct ServerTimer ServerTimer;
+
+/**
+ * @brief Start the process taking over in an upgrade
+ *
+ * @param ctx Context given to server_upgrade()
+ * @return int This end of a connected Unix stream socket whose other end
+ *             the new process passes to server_inherit(), or -1
+ */
+typedef int (*ServerSpawnFn)(void *ctx);
+
+/**
+ * @brief Server state; owned by the thread that calls server_run()
+ */
+typedef struct {
+    ServerOptions opts;                   /**< Settings */
+    QuestionBank *bank;                   /**< Shared read-only bank */
+    int listen_fd;                        /**< WebSocket listener */
+    int epoll_fd;                         /**< Event loop */
+    int wake_fd;                          /**< eventfd that interrupts the loop */
+    int port;                             /**< Bound WebSocket port */
+    int handoff_fd;                       /**< Listener for incoming rooms, -1 if none */
+    int handoff_port;                     /**< Bound handoff port */
+    const char *handoff_host;             /**< Node to hand rooms to */
+    int handoff_target;                   /**< That node's handoff port */
+    volatile sig_atomic_t handoff_requested; /**< Set by server_handoff() */
+    ServerSpawnFn upgrade_spawn;          /**< Starts the new process in an upgrade */
+    void *upgrade_ctx;                    /**< Its context */
+    const int *upgrade_fds;               /**< Extra descriptors to pass along */
+    int upgrade_fd_count;                 /**< Number of them */
+    volatile sig_atomic_t upgrade_requested; /**< Set by server_upgrade() */
+    bool draining;                        /**< Listeners gone to a new process */
+    int64_t drain_deadline_ms;            /**< When a draining server_run() gives up */
+    volatile sig_atomic_t stopping;       /**< Set by server_stop() */
+    ServerConn *conns;                    /**< Connections indexed by fd */
+    int conn_cap;                         /**< Length of conns */
+    int conn_count;                       /**< Open connections */
+    ServerRoom **rooms;                   /**< Room hash buckets */
+    size_t room_buckets;                  /**< Number of buckets (power of two) */
+    size_t room_count;                    /**< Rooms that exist */
+    ServerTimer *timers;                  /**< Min-heap of question deadlines */
+    int timer_len;                        /**< Entries in the heap */
+    int timer_cap;                        /**< Heap capacity */
+    uint8_t *scratch;                     /**< Shared receive buffer */
+    char *format;                         /**< Outgoing messages are formatted here */
+    size_t parked_bytes;                  /**< Pooled input buffers held by connections */
+    size_t queued_bytes;                  /**< Output bytes waiting for writable sockets */
+    SessionPool pool;                     /**< Games, rooms, frames and parked input */
+    ServerStats stats;                    /**< Running totals */
+} Server;
+
+/**
+ * @brief Fill in default options (port 8080, 50000 connections, 5 questions)
+ *
+ * @param opts Options to fill
+ */
+void server_options_init(ServerOptions *opts);
+
+/**
+ * @brief Bind the listener and set up the event loop
+ *
+ * @param server Server to initialize
+ * @param bank Loaded question bank (read-only while the server runs)
+ * @param opts Settings
+ * @return int 0 on success, -1 on error
+ */
+int server_init(Server *server, QuestionBank *bank, const ServerOptions *opts);
+
+/**
+ * @brief Run the event loop until server_stop() is called or an upgrade
+ *        has drained
+ *
+ * @param server Initialized server
+ * @return int 0 on a clean stop, -1 on error
+ */
+int server_run(Server *server);
+
+/**
+ * @brief Ask the loop to stop; safe from signal handlers and other threads
+ *
+ * @param server Server
+ */
+void server_stop(Server *server);
+
+/**
+ * @brief Hand every room to another node and redirect its clients
+ *
+ * Safe from signal handlers and other threads; the loop does the work.
+ * Rooms the other node refuses, or all of them if it cannot be reached,
+ * stay here.
+ *
+ * @param server Server
+ * @param host IPv4 address of the other node (must stay valid)
+ * @param port Its handoff port
+ */
+void server_handoff(Server *server, const char *host, int port);
+
+/**
+ * @brief Replace this process with a new one serving on the same listeners
+ *
+ * Safe from signal handlers and other threads; the loop calls @p spawn,
+ * passes the listeners and @p extra_fds to the new process, hands it the
+ * movable rooms and drains. If the new process does not answer, this one
+ * keeps serving.
+ *
+ * @param server Server
+ * @param spawn Starts the new process (called on the loop thread)
+ * @param ctx Passed to spawn
+ * @param extra_fds Other descriptors for the new process, such as the
+ *                  admin API listener (must stay valid)
+ * @param extra_count Number of them, at most SERVER_UPGRADE_MAX_FDS
+ */
+void server_upgrade(Server *server, ServerSpawnFn spawn, void *ctx, const int *extra_fds,
+                    int extra_count);
+
+/**
+ * @brief In the new process of an upgrade, receive the listeners
+ *
+ * Sets opts->listen_fd and opts->handoff_listen_fd for server_init().
+ *
+ * @param channel The socket the old process's spawn function returned
+ *                the other end of
+ * @param opts Options to fill in
+ * @param extra_fds Receives the extra descriptors
+ * @param extra_count Room in extra_fds; set to the number received
+ * @return int 0 on success, -1 on error
+ */
+int server_inherit(int channel, ServerOptions *opts, int *extra_fds, int *extra_count);
+
+/**
+ * @brief In the new process, tell the old one to stop accepting and take
+ *        over its rooms
+ *
+ * Call after server_init() and before server_run(). The old process
+ * keeps rooms this one refuses.
+ *
+ * @param server Server initialized with the inherited listeners
+ * @param channel Same socket as for server_inherit()
+ * @return int 0 once the old process has been told, -1 on error
+ */
+int server_take_over(Server *server, int channel);
+
+/**
+ * @brief Bytes of server memory attributable to connections
+ *
+ * The connection table plus parked input and queued output; kernel
+ * socket buffers are not included.
+ *
+ * @param server Server
+ * @return size_t Bytes
+ */
+size_t server_connection_bytes(const Server *server);
+
+/**
+ * @brief Publish the server totals and pool hit rate as metrics
+ *
+ * @param server Server
+ */
+void server_publish_metrics(const Server *server);
+
+/**
+ * @brief Close every connection and free the server
+ *
+ * @param server Server (after server_run() has returned)
+ */
+void server_destroy(Server *server);
+
+#endif /* SERVER_H */
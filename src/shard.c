@@ -0,0 +1,1347 @@
+/**
+ * @file shard.c
+ * @brief Question bank sharded across local processes, with a batching router
+ */
+
+#define _GNU_SOURCE
+
+#include "shard.h"
+#include "pack.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+/**
+ * @brief Events taken per epoll_wait()
+ */
+#define SHARD_EVENTS 64
+
+/**
+ * @brief Largest reply a client accepts: every question at full length
+ */
+#define SHARD_MAX_REPLY ((size_t)SHARD_MAX_QUESTIONS * \
+                         (sizeof(Question) + 16) + (1u << 16))
+
+/**
+ * @brief Seconds a client waits on a shard before giving up
+ */
+#define SHARD_IO_TIMEOUT_S 10
+
+/**
+ * @brief Growable byte buffer
+ */
+typedef struct {
+    char *data;                           /**< Bytes */
+    size_t len;                           /**< Bytes used */
+    size_t cap;                           /**< Bytes allocated */
+} ShardBuf;
+
+struct ShardConn {
+    bool open;                            /**< Slot in use */
+    bool writing;                         /**< EPOLLOUT is armed */
+    bool queued;                          /**< Listed for the current round */
+    ShardBuf in;                          /**< Received bytes */
+    ShardBuf out;                         /**< Reply bytes not yet sent */
+    size_t out_sent;                      /**< Bytes of out already sent */
+    size_t draw_first;                    /**< First batch entry of its pending DRAW */
+    size_t draw_count;                    /**< Draws of its pending DRAW, 0 if none */
+};
+
+/* ---- Buffers and encoding ---- */
+
+static int buf_reserve(ShardBuf *buf, size_t extra) {
+    if (buf->len + extra <= buf->cap) {
+        return 0;
+    }
+    size_t cap = buf->cap > 0 ? buf->cap : 4096;
+    while (cap < buf->len + extra) {
+        cap *= 2;
+    }
+    char *data = (char*)realloc(buf->data, cap);
+    if (data == NULL) {
+        return -1;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
+
+static int buf_put(ShardBuf *buf, const void *data, size_t len) {
+    if (buf_reserve(buf, len) != 0) {
+        return -1;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+static void buf_free(ShardBuf *buf) {
+    free(buf->data);
+    memset(buf, 0, sizeof(*buf));
+}
+
+/**
+ * @brief Start a message; message_end() fills in the length
+ *
+ * @return size_t Offset of the header in buf
+ */
+static size_t message_begin(ShardBuf *buf, ShardMessageType type) {
+    size_t at = buf->len;
+    ShardHeader header = { 0, (uint32_t)type };
+    buf_put(buf, &header, sizeof(header));
+    return at;
+}
+
+static void message_end(ShardBuf *buf, size_t at) {
+    uint32_t len = (uint32_t)(buf->len - at - sizeof(ShardHeader));
+    memcpy(buf->data + at, &len, sizeof(len));
+}
+
+static int put_text(ShardBuf *buf, const char *text) {
+    uint16_t len = (uint16_t)strlen(text);
+    return buf_put(buf, &len, sizeof(len)) != 0 ? -1 : buf_put(buf, text, len);
+}
+
+static int put_question(ShardBuf *buf, const Question *q) {
+    uint8_t options = (uint8_t)question_option_count(q);
+    uint8_t fields[4] = { (uint8_t)q->correct_answer, (uint8_t)q->difficulty,
+                          (uint8_t)q->category, options };
+    if (buf_put(buf, &q->id, sizeof(q->id)) != 0 || buf_put(buf, fields, sizeof(fields)) != 0 ||
+        put_text(buf, q->question) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < options; i++) {
+        if (put_text(buf, q->options[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Cursor over a received payload
+ */
+typedef struct {
+    const char *at;                       /**< Next byte */
+    const char *end;                      /**< End of payload */
+} ShardCursor;
+
+static int take(ShardCursor *c, void *out, size_t len) {
+    if ((size_t)(c->end - c->at) < len) {
+        return -1;
+    }
+    memcpy(out, c->at, len);
+    c->at += len;
+    return 0;
+}
+
+static int take_text(ShardCursor *c, char *out, size_t cap) {
+    uint16_t len = 0;
+    if (take(c, &len, sizeof(len)) != 0 || len >= cap || take(c, out, len) != 0) {
+        return -1;
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+static int take_question(ShardCursor *c, Question *q) {
+    uint8_t fields[4];
+    memset(q, 0, sizeof(*q));
+    if (take(c, &q->id, sizeof(q->id)) != 0 || take(c, fields, sizeof(fields)) != 0 ||
+        fields[1] >= DIFFICULTY_COUNT || fields[2] >= CATEGORY_COUNT || fields[3] > MAX_OPTIONS ||
+        take_text(c, q->question, sizeof(q->question)) != 0) {
+        return -1;
+    }
+    q->correct_answer = fields[0];
+    q->difficulty = (Difficulty)fields[1];
+    q->category = (Category)fields[2];
+    for (int i = 0; i < fields[3]; i++) {
+        if (take_text(c, q->options[i], sizeof(q->options[i])) != 0) {
+            return -1;
+        }
+    }
+    question_compute_widths(q);
+    return 0;
+}
+
+/* ---- Maps ---- */
+
+int shard_map_parse(ShardMap *map, const char *spec) {
+    if (map == NULL || spec == NULL || strlen(spec) >= sizeof(map->spec)) {
+        return -1;
+    }
+    memset(map, 0, sizeof(*map));
+    snprintf(map->spec, sizeof(map->spec), "%s", spec);
+
+    if (strncmp(spec, "category:", 9) == 0) {
+        int count = 0;
+        if (!is_valid_integer(spec + 9, &count) || count < 1 || count > CATEGORY_COUNT) {
+            return -1;
+        }
+        map->scheme = SHARD_BY_CATEGORY;
+        map->count = count;
+        return 0;
+    }
+    if (strncmp(spec, "id:", 3) == 0) {
+        map->scheme = SHARD_BY_ID;
+        map->count = 1;
+        const char *p = spec + 3;
+        while (*p != '\0') {
+            char *end = NULL;
+            errno = 0;
+            unsigned long bound = strtoul(p, &end, 10);
+            if (end == p || errno != 0 || bound > UINT32_MAX || (*end != ',' && *end != '\0') ||
+                (*end == ',' && end[1] == '\0') ||
+                map->count == SHARD_MAX ||
+                (map->count > 1 && bound <= map->bounds[map->count - 2])) {
+                return -1;
+            }
+            map->bounds[map->count - 1] = (uint32_t)bound;
+            map->count++;
+            p = *end == ',' ? end + 1 : end;
+        }
+        return map->count > 1 ? 0 : -1;
+    }
+    return -1;
+}
+
+int shard_of(const ShardMap *map, const Question *question) {
+    if (map->scheme == SHARD_BY_CATEGORY) {
+        return (int)question->category % map->count;
+    }
+    int shard = 0;
+    while (shard < map->count - 1 && question->id >= map->bounds[shard]) {
+        shard++;
+    }
+    return shard;
+}
+
+long shard_bank_retain(QuestionBank *bank, const ShardMap *map, int shard) {
+    if (bank == NULL || map == NULL || shard < 0 || shard >= map->count) {
+        return -1;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < bank->count; i++) {
+        if (shard_of(map, &bank->questions[i]) == shard) {
+            if (kept != i) {
+                bank->questions[kept] = bank->questions[i];
+            }
+            kept++;
+        }
+    }
+    bank->count = kept;
+    size_t capacity = kept > 0 ? kept : 1;
+    Question *questions = (Question*)realloc(bank->questions, capacity * sizeof(Question));
+    if (questions != NULL) {
+        bank->questions = questions;
+        bank->capacity = capacity;
+    }
+    if (question_bank_build_index(bank) != 0) {
+        return -1;
+    }
+    return (long)kept;
+}
+
+/**
+ * @brief Where shard_bank_load() puts the questions it keeps
+ */
+typedef struct {
+    QuestionBank *bank;
+    const ShardMap *map;
+    int shard;
+    size_t seen;
+} ShardLoad;
+
+static int keep_own_question(ShardLoad *load, const Question *q) {
+    load->seen++;
+    if (shard_of(load->map, q) != load->shard) {
+        return 1;
+    }
+    return question_bank_add(load->bank, q);
+}
+
+static int keep_own_object(const char *object, void *ctx) {
+    Question q;
+    if (question_parse_object(object, &q) != 0) {
+        return -1;
+    }
+    return keep_own_question((ShardLoad*)ctx, &q);
+}
+
+long shard_bank_load(QuestionBank *bank, const char *filename, const ShardMap *map,
+                     int shard, size_t *seen) {
+    if (bank == NULL || filename == NULL || map == NULL || shard < 0 || shard >= map->count) {
+        return -1;
+    }
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    PackMapping mapping;
+    int rc = pack_map(&mapping, fd, false);
+    close(fd);
+    if (rc != 0) {
+        print_error("Failed to map questions file: %s", filename);
+        return -1;
+    }
+
+    ShardLoad load = { bank, map, shard, 0 };
+    long kept = 0;
+    if (pack_is_pack(mapping.data, mapping.len)) {
+        int count = pack_check(mapping.data, mapping.len);
+        if (count < 0) {
+            print_error("Malformed question pack");
+            kept = -1;
+        }
+        for (int i = 0; i < count && kept >= 0; i++) {
+            Question q;
+            pack_read_question(mapping.data, (size_t)i, &q);
+            rc = keep_own_question(&load, &q);
+            if (rc < 0) {
+                kept = -1;
+            } else if (rc == 0) {
+                kept++;
+            }
+        }
+    } else {
+        kept = question_scan_objects((const char*)mapping.data, mapping.len,
+                                     keep_own_object, &load);
+    }
+    pack_unmap(&mapping);
+
+    if (seen != NULL) {
+        *seen = load.seen;
+    }
+    if (kept > 0 && question_bank_build_index(bank) != 0) {
+        return -1;
+    }
+    return kept;
+}
+
+/* ---- Drawing from a store ---- */
+
+static uint32_t next_random(uint32_t *seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static size_t random_below(uint32_t *seed, size_t n) {
+    return (size_t)(((uint64_t)next_random(seed) * n) >> 32);
+}
+
+static int filter_slot(int value, int count) {
+    return value >= 0 && value < count ? value : count;
+}
+
+int shard_store_init(ShardStore *store, QuestionBank *bank, const ShardMap *map, int shard) {
+    if (store == NULL || bank == NULL || map == NULL || bank->count > UINT32_MAX) {
+        return -1;
+    }
+    memset(store, 0, sizeof(*store));
+    store->bank = bank;
+    store->map = *map;
+    store->shard = shard;
+
+    for (size_t i = 0; i < bank->count; i++) {
+        const Question *q = &bank->questions[i];
+        int d = filter_slot((int)q->difficulty, DIFFICULTY_COUNT);
+        int c = filter_slot((int)q->category, CATEGORY_COUNT);
+        store->list_len[d][c]++;
+        store->list_len[d][CATEGORY_COUNT]++;
+        store->list_len[DIFFICULTY_COUNT][c]++;
+        store->list_len[DIFFICULTY_COUNT][CATEGORY_COUNT]++;
+    }
+    for (int d = 0; d <= DIFFICULTY_COUNT; d++) {
+        for (int c = 0; c <= CATEGORY_COUNT; c++) {
+            size_t n = store->list_len[d][c];
+            store->lists[d][c] = (uint32_t*)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+            if (store->lists[d][c] == NULL) {
+                print_error("Failed to allocate shard index");
+                shard_store_free(store);
+                return -1;
+            }
+            store->list_len[d][c] = 0;
+        }
+    }
+    for (size_t i = 0; i < bank->count; i++) {
+        const Question *q = &bank->questions[i];
+        int d = filter_slot((int)q->difficulty, DIFFICULTY_COUNT);
+        int c = filter_slot((int)q->category, CATEGORY_COUNT);
+        store->lists[d][c][store->list_len[d][c]++] = (uint32_t)i;
+        store->lists[d][CATEGORY_COUNT][store->list_len[d][CATEGORY_COUNT]++] = (uint32_t)i;
+        store->lists[DIFFICULTY_COUNT][c][store->list_len[DIFFICULTY_COUNT][c]++] = (uint32_t)i;
+        store->lists[DIFFICULTY_COUNT][CATEGORY_COUNT]
+                    [store->list_len[DIFFICULTY_COUNT][CATEGORY_COUNT]++] = (uint32_t)i;
+    }
+    return 0;
+}
+
+int shard_store_draw(const ShardStore *store, const ShardDraw *draw, const Question **out) {
+    int d = filter_slot(draw->difficulty, DIFFICULTY_COUNT);
+    int c = filter_slot(draw->category, CATEGORY_COUNT);
+    const uint32_t *list = store->lists[d][c];
+    size_t n = store->list_len[d][c];
+    size_t want = draw->count < n ? draw->count : n;
+    uint32_t seed = draw->seed != 0 ? draw->seed : 0x9e3779b9u;
+    size_t picked = 0;
+
+    if (want * 2 >= n) {
+        /* Small list: selection sampling keeps each entry with the right odds. */
+        for (size_t i = 0; i < n && picked < want; i++) {
+            if (random_below(&seed, n - i) < want - picked) {
+                out[picked++] = &store->bank->questions[list[i]];
+            }
+        }
+        for (size_t i = picked; i > 1; i--) {
+            size_t j = random_below(&seed, i);
+            const Question *tmp = out[i - 1];
+            out[i - 1] = out[j];
+            out[j] = tmp;
+        }
+    } else {
+        /* Large list: rejection-sample, at most SHARD_MAX_DRAW to compare against. */
+        while (picked < want) {
+            const Question *q = &store->bank->questions[list[random_below(&seed, n)]];
+            bool seen = false;
+            for (size_t i = 0; i < picked && !seen; i++) {
+                seen = out[i] == q;
+            }
+            if (!seen) {
+                out[picked++] = q;
+            }
+        }
+    }
+    return (int)picked;
+}
+
+void shard_store_free(ShardStore *store) {
+    if (store == NULL) {
+        return;
+    }
+    for (int d = 0; d <= DIFFICULTY_COUNT; d++) {
+        for (int c = 0; c <= CATEGORY_COUNT; c++) {
+            free(store->lists[d][c]);
+            store->lists[d][c] = NULL;
+            store->list_len[d][c] = 0;
+        }
+    }
+}
+
+/* ---- Replies ---- */
+
+void shard_reply_init(ShardReply *reply) {
+    if (reply != NULL) {
+        memset(reply, 0, sizeof(*reply));
+    }
+}
+
+void shard_reply_clear(ShardReply *reply) {
+    reply->count = 0;
+    reply->draws = 0;
+}
+
+void shard_reply_free(ShardReply *reply) {
+    if (reply == NULL) {
+        return;
+    }
+    free(reply->questions);
+    free(reply->drawn);
+    memset(reply, 0, sizeof(*reply));
+}
+
+/**
+ * @brief Open a new draw in the reply
+ */
+static int reply_begin_draw(ShardReply *reply) {
+    if (reply->draws == reply->draw_cap) {
+        size_t cap = reply->draw_cap > 0 ? reply->draw_cap * 2 : 64;
+        uint16_t *drawn = (uint16_t*)realloc(reply->drawn, cap * sizeof(uint16_t));
+        if (drawn == NULL) {
+            return -1;
+        }
+        reply->drawn = drawn;
+        reply->draw_cap = cap;
+    }
+    reply->drawn[reply->draws++] = 0;
+    return 0;
+}
+
+/**
+ * @brief Make room for a question in the reply's last draw
+ *
+ * @return Question* Slot to fill, or NULL when out of memory
+ */
+static Question* reply_add(ShardReply *reply) {
+    if (reply->count == reply->capacity) {
+        size_t cap = reply->capacity > 0 ? reply->capacity * 2 : 64;
+        Question *questions = (Question*)realloc(reply->questions, cap * sizeof(Question));
+        if (questions == NULL) {
+            return NULL;
+        }
+        reply->questions = questions;
+        reply->capacity = cap;
+    }
+    reply->drawn[reply->draws - 1]++;
+    return &reply->questions[reply->count++];
+}
+
+const Question* shard_reply_draw(const ShardReply *reply, size_t draw, size_t *count) {
+    size_t first = 0;
+    for (size_t i = 0; i < draw && i < reply->draws; i++) {
+        first += reply->drawn[i];
+    }
+    *count = draw < reply->draws ? reply->drawn[draw] : 0;
+    return *count > 0 ? &reply->questions[first] : NULL;
+}
+
+/**
+ * @brief Decode a DRAW reply payload into @p reply
+ */
+static int decode_draw_reply(const char *payload, size_t len, size_t expected, ShardReply *reply) {
+    ShardCursor c = { payload, payload + len };
+    uint32_t n = 0;
+    if (take(&c, &n, sizeof(n)) != 0 || n != expected) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t drawn = 0;
+        if (take(&c, &drawn, sizeof(drawn)) != 0 || drawn > SHARD_MAX_DRAW ||
+            reply_begin_draw(reply) != 0) {
+            return -1;
+        }
+        for (uint16_t k = 0; k < drawn; k++) {
+            Question *q = reply_add(reply);
+            if (q == NULL || take_question(&c, q) != 0) {
+                return -1;
+            }
+        }
+    }
+    return c.at == c.end ? 0 : -1;
+}
+
+/* ---- Blocking client side ---- */
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void *out, size_t len) {
+    char *at = (char*)out;
+    while (len > 0) {
+        ssize_t n = recv(fd, at, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        at += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read one message into @p payload
+ *
+ * @return int Message type, -1 on error
+ */
+static int read_message(int fd, ShardBuf *payload) {
+    ShardHeader header;
+    if (read_full(fd, &header, sizeof(header)) != 0 || header.len > SHARD_MAX_REPLY) {
+        return -1;
+    }
+    payload->len = 0;
+    if (buf_reserve(payload, (size_t)header.len + 1) != 0 ||
+        read_full(fd, payload->data, header.len) != 0) {
+        return -1;
+    }
+    payload->len = header.len;
+    payload->data[header.len] = '\0';
+    if (header.type == SHARD_MSG_ERROR) {
+        print_error("Shard error: %s", payload->data + (header.len >= 2 ? 2 : 0));
+        return -1;
+    }
+    return (int)header.type;
+}
+
+static int encode_draws(ShardBuf *buf, const ShardDraw *draws, size_t n) {
+    size_t at = message_begin(buf, SHARD_MSG_DRAW);
+    uint32_t count = (uint32_t)n;
+    if (buf_put(buf, &count, sizeof(count)) != 0 ||
+        buf_put(buf, draws, n * sizeof(ShardDraw)) != 0) {
+        return -1;
+    }
+    message_end(buf, at);
+    return 0;
+}
+
+int shard_connect(const char *host, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (host == NULL || inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        print_error("Invalid shard address: %s", host != NULL ? host : "(null)");
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval timeout = { SHARD_IO_TIMEOUT_S, 0 };
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        print_error("Failed to connect to shard %s:%d: %s", host, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int shard_call_draw(int fd, const ShardDraw *draws, size_t n, ShardReply *reply) {
+    if (fd < 0 || draws == NULL || reply == NULL) {
+        return -1;
+    }
+    ShardBuf buf = { NULL, 0, 0 };
+    int result = -1;
+    if (encode_draws(&buf, draws, n) == 0 && write_all(fd, buf.data, buf.len) == 0 &&
+        read_message(fd, &buf) == SHARD_MSG_DRAW &&
+        decode_draw_reply(buf.data, buf.len, n, reply) == 0) {
+        result = 0;
+    }
+    buf_free(&buf);
+    return result;
+}
+
+/* ---- Router ---- */
+
+int shard_router_connect(ShardRouter *router, const char *const *addrs, int n) {
+    if (router == NULL || addrs == NULL || n < 1 || n > SHARD_MAX) {
+        return -1;
+    }
+    memset(router, 0, sizeof(*router));
+    for (int s = 0; s < SHARD_MAX; s++) {
+        router->fds[s] = -1;
+    }
+    ShardBuf buf = { NULL, 0, 0 };
+    for (int i = 0; i < n; i++) {
+        char host[64];
+        const char *colon = strrchr(addrs[i], ':');
+        int port = 0;
+        if (colon == NULL || (size_t)(colon - addrs[i]) >= sizeof(host) ||
+            !is_valid_integer(colon + 1, &port)) {
+            print_error("Invalid shard address (want host:port): %s", addrs[i]);
+            goto fail;
+        }
+        memcpy(host, addrs[i], (size_t)(colon - addrs[i]));
+        host[colon - addrs[i]] = '\0';
+        int fd = shard_connect(host, port);
+        if (fd < 0) {
+            goto fail;
+        }
+
+        ShardHeader hello = { 0, SHARD_MSG_HELLO };
+        uint32_t shard = 0;
+        uint8_t spec_len = 0;
+        char spec[SHARD_MAX_SPEC];
+        uint32_t counts[DIFFICULTY_COUNT][CATEGORY_COUNT];
+        ShardCursor c;
+        if (write_all(fd, (const char*)&hello, sizeof(hello)) != 0 ||
+            read_message(fd, &buf) != SHARD_MSG_HELLO) {
+            print_error("Shard %s did not answer HELLO", addrs[i]);
+            close(fd);
+            goto fail;
+        }
+        c.at = buf.data;
+        c.end = buf.data + buf.len;
+        if (take(&c, &shard, sizeof(shard)) != 0 || take(&c, &spec_len, sizeof(spec_len)) != 0 ||
+            spec_len >= sizeof(spec) || take(&c, spec, spec_len) != 0 ||
+            take(&c, counts, sizeof(counts)) != 0) {
+            print_error("Bad HELLO from shard %s", addrs[i]);
+            close(fd);
+            goto fail;
+        }
+        spec[spec_len] = '\0';
+        if (i == 0 && (shard_map_parse(&router->map, spec) != 0 || router->map.count != n)) {
+            print_error("Shards use map %s, which needs a different number of shards", spec);
+            close(fd);
+            goto fail;
+        }
+        if (strcmp(spec, router->map.spec) != 0 || shard >= (uint32_t)n ||
+            router->fds[shard] >= 0) {
+            print_error("Shard %s (%u of %s) does not fit the map %s", addrs[i], shard, spec,
+                        router->map.spec);
+            close(fd);
+            goto fail;
+        }
+        router->fds[shard] = fd;
+        memcpy(router->counts[shard], counts, sizeof(counts));
+    }
+    buf_free(&buf);
+    return 0;
+
+fail:
+    buf_free(&buf);
+    shard_router_close(router);
+    return -1;
+}
+
+/**
+ * @brief Questions on a shard that match a draw's filters
+ */
+static uint32_t router_weight(const ShardRouter *router, int shard, const ShardDraw *draw) {
+    uint32_t total = 0;
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        if (draw->difficulty >= 0 && draw->difficulty != d) {
+            continue;
+        }
+        for (int c = 0; c < CATEGORY_COUNT; c++) {
+            if (draw->category < 0 || draw->category == c) {
+                total += router->counts[shard][d][c];
+            }
+        }
+    }
+    return total;
+}
+
+int shard_router_draw(ShardRouter *router, const ShardDraw *draws, size_t n, ShardReply *reply) {
+    if (router == NULL || draws == NULL || reply == NULL) {
+        return -1;
+    }
+    int shards = router->map.count;
+    /* split[i * shards + s]: questions of draw i asked of shard s. */
+    uint16_t *split = (uint16_t*)calloc(n * (size_t)shards + 1, sizeof(uint16_t));
+    ShardDraw *sub = (ShardDraw*)malloc((n * (size_t)shards + 1) * sizeof(ShardDraw));
+    size_t sub_len[SHARD_MAX] = { 0 };
+    ShardBuf buf = { NULL, 0, 0 };
+    int result = -1;
+    if (split == NULL || sub == NULL) {
+        goto done;
+    }
+
+    /* Split each draw across shards in proportion to their remaining
+     * matching questions, which draws uniformly from the whole bank. */
+    for (size_t i = 0; i < n; i++) {
+        uint32_t left[SHARD_MAX];
+        uint64_t total = 0;
+        for (int s = 0; s < shards; s++) {
+            left[s] = router_weight(router, s, &draws[i]);
+            total += left[s];
+        }
+        uint32_t seed = draws[i].seed != 0 ? draws[i].seed : 0x9e3779b9u;
+        for (uint16_t k = 0; k < draws[i].count && total > 0; k++) {
+            uint64_t pick = ((uint64_t)next_random(&seed) * total) >> 32;
+            int s = 0;
+            while (pick >= left[s]) {
+                pick -= left[s];
+                s++;
+            }
+            split[i * (size_t)shards + (size_t)s]++;
+            left[s]--;
+            total--;
+        }
+    }
+    for (int s = 0; s < shards; s++) {
+        for (size_t i = 0; i < n; i++) {
+            uint16_t count = split[i * (size_t)shards + (size_t)s];
+            if (count > 0) {
+                ShardDraw *d = &sub[(size_t)s * n + sub_len[s]++];
+                *d = draws[i];
+                d->count = count;
+                d->seed = (draws[i].seed ^ (0x85ebca6bu * (uint32_t)(s + 1))) | 1u;
+            }
+        }
+    }
+
+    /* One message per shard, all sent before any reply is read. */
+    for (int s = 0; s < shards; s++) {
+        if (sub_len[s] == 0) {
+            continue;
+        }
+        buf.len = 0;
+        if (encode_draws(&buf, &sub[(size_t)s * n], sub_len[s]) != 0 ||
+            write_all(router->fds[s], buf.data, buf.len) != 0) {
+            print_error("Failed to send draws to shard %d", s);
+            goto done;
+        }
+        router->messages++;
+    }
+    for (int s = 0; s < shards; s++) {
+        shard_reply_clear(&router->replies[s]);
+        if (sub_len[s] > 0 &&
+            (read_message(router->fds[s], &buf) != SHARD_MSG_DRAW ||
+             decode_draw_reply(buf.data, buf.len, sub_len[s], &router->replies[s]) != 0)) {
+            print_error("Bad reply from shard %d", s);
+            goto done;
+        }
+    }
+
+    /* Reassemble in draw order and shuffle each draw's questions. */
+    size_t cursor[SHARD_MAX] = { 0 };
+    size_t next_question[SHARD_MAX] = { 0 };
+    for (size_t i = 0; i < n; i++) {
+        if (reply_begin_draw(reply) != 0) {
+            goto done;
+        }
+        size_t first = reply->count;
+        for (int s = 0; s < shards; s++) {
+            if (split[i * (size_t)shards + (size_t)s] == 0) {
+                continue;
+            }
+            const ShardReply *part = &router->replies[s];
+            uint16_t drawn = part->drawn[cursor[s]++];
+            for (uint16_t k = 0; k < drawn; k++) {
+                Question *q = reply_add(reply);
+                if (q == NULL) {
+                    goto done;
+                }
+                *q = part->questions[next_question[s]++];
+            }
+        }
+        uint32_t seed = draws[i].seed != 0 ? draws[i].seed : 0x9e3779b9u;
+        for (size_t k = reply->count - first; k > 1; k--) {
+            size_t j = random_below(&seed, k);
+            Question tmp = reply->questions[first + k - 1];
+            reply->questions[first + k - 1] = reply->questions[first + j];
+            reply->questions[first + j] = tmp;
+        }
+    }
+    router->rounds++;
+    router->draws += n;
+    result = 0;
+
+done:
+    if (result != 0) {
+        /* A shard's stream may be out of step now; later draws fail fast. */
+        for (int s = 0; s < shards; s++) {
+            if (router->fds[s] >= 0) {
+                close(router->fds[s]);
+                router->fds[s] = -1;
+            }
+        }
+    }
+    free(split);
+    free(sub);
+    buf_free(&buf);
+    return result;
+}
+
+void shard_router_close(ShardRouter *router) {
+    if (router == NULL) {
+        return;
+    }
+    for (int s = 0; s < SHARD_MAX; s++) {
+        if (router->fds[s] >= 0) {
+            close(router->fds[s]);
+            router->fds[s] = -1;
+        }
+        shard_reply_free(&router->replies[s]);
+    }
+}
+
+/* ---- Server ---- */
+
+static void conn_close(ShardServer *server, int fd) {
+    ShardConn *c = &server->conns[fd];
+    if (!c->open) {
+        return;
+    }
+    buf_free(&c->in);
+    buf_free(&c->out);
+    memset(c, 0, sizeof(*c));
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+}
+
+static void send_error(ShardConn *c, const char *text) {
+    size_t at = message_begin(&c->out, SHARD_MSG_ERROR);
+    put_text(&c->out, text);
+    message_end(&c->out, at);
+}
+
+static void send_hello(ShardServer *server, ShardConn *c) {
+    uint32_t shard = SHARD_ALL;
+    const char *spec = "";
+    uint32_t counts[DIFFICULTY_COUNT][CATEGORY_COUNT];
+    memset(counts, 0, sizeof(counts));
+    if (server->store != NULL) {
+        shard = (uint32_t)server->store->shard;
+        spec = server->store->map.spec;
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            for (int k = 0; k < CATEGORY_COUNT; k++) {
+                counts[d][k] = server->store->list_len[d][k];
+            }
+        }
+    } else {
+        spec = server->router->map.spec;
+        for (int s = 0; s < server->router->map.count; s++) {
+            for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+                for (int k = 0; k < CATEGORY_COUNT; k++) {
+                    counts[d][k] += server->router->counts[s][d][k];
+                }
+            }
+        }
+    }
+    uint8_t spec_len = (uint8_t)strlen(spec);
+    size_t at = message_begin(&c->out, SHARD_MSG_HELLO);
+    buf_put(&c->out, &shard, sizeof(shard));
+    buf_put(&c->out, &spec_len, sizeof(spec_len));
+    buf_put(&c->out, spec, spec_len);
+    buf_put(&c->out, counts, sizeof(counts));
+    message_end(&c->out, at);
+}
+
+/**
+ * @brief Handle the complete messages of a connection up to its first DRAW
+ *
+ * A DRAW is parked in the round's batch; later messages wait for the
+ * round so replies keep their order.
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int conn_parse(ShardServer *server, ShardConn *c, size_t *round_questions) {
+    size_t used = 0;
+    int result = 0;
+    while (c->draw_count == 0 && c->in.len - used >= sizeof(ShardHeader)) {
+        ShardHeader header;
+        memcpy(&header, c->in.data + used, sizeof(header));
+        if (header.len > SHARD_MAX_REQUEST) {
+            result = -1;
+            break;
+        }
+        if (c->in.len - used < sizeof(header) + header.len) {
+            break;
+        }
+        const char *payload = c->in.data + used + sizeof(header);
+        if (header.type == SHARD_MSG_HELLO) {
+            send_hello(server, c);
+            server->stats.requests++;
+        } else if (header.type == SHARD_MSG_DRAW) {
+            uint32_t n = 0;
+            size_t questions = 0;
+            if (header.len >= sizeof(n)) {
+                memcpy(&n, payload, sizeof(n));
+            }
+            bool valid = header.len == sizeof(n) + (size_t)n * sizeof(ShardDraw);
+            for (uint32_t i = 0; valid && i < n; i++) {
+                ShardDraw draw;
+                memcpy(&draw, payload + sizeof(n) + i * sizeof(ShardDraw), sizeof(draw));
+                valid = draw.count >= 1 && draw.count <= SHARD_MAX_DRAW &&
+                        draw.difficulty < DIFFICULTY_COUNT && draw.category < CATEGORY_COUNT;
+                questions += draw.count;
+            }
+            if (!valid || questions > SHARD_MAX_QUESTIONS) {
+                send_error(c, "invalid draw");
+                server->stats.requests++;
+            } else {
+                /* A full round goes first; this one waits for the next. */
+                if (*round_questions + questions > SHARD_MAX_QUESTIONS) {
+                    break;
+                }
+                if (server->batch_len + n > server->batch_cap) {
+                    size_t cap = server->batch_cap > 0 ? server->batch_cap : 256;
+                    while (cap < server->batch_len + n) {
+                        cap *= 2;
+                    }
+                    ShardDraw *batch = (ShardDraw*)realloc(server->batch, cap * sizeof(ShardDraw));
+                    if (batch == NULL) {
+                        result = -1;
+                        break;
+                    }
+                    server->batch = batch;
+                    server->batch_cap = cap;
+                }
+                memcpy(server->batch + server->batch_len, payload + sizeof(n),
+                       (size_t)n * sizeof(ShardDraw));
+                c->draw_first = server->batch_len;
+                c->draw_count = n;
+                server->batch_len += n;
+                *round_questions += questions;
+                if (n == 0) {
+                    /* Nothing to draw; answer in place. */
+                    c->draw_count = 0;
+                    size_t at = message_begin(&c->out, SHARD_MSG_DRAW);
+                    buf_put(&c->out, &n, sizeof(n));
+                    message_end(&c->out, at);
+                    server->stats.requests++;
+                }
+            }
+        } else {
+            send_error(c, "unknown message type");
+            server->stats.requests++;
+        }
+        used += sizeof(header) + header.len;
+    }
+    if (used > 0) {
+        memmove(c->in.data, c->in.data + used, c->in.len - used);
+        c->in.len -= used;
+    }
+    return result;
+}
+
+/**
+ * @brief Draw every parked DRAW of the round and queue the replies
+ */
+static void run_round(ShardServer *server, const int *fds, int count) {
+    if (server->batch_len == 0) {
+        return;
+    }
+    ShardReply *reply = &server->reply;
+    shard_reply_clear(reply);
+    int result = 0;
+    if (server->store != NULL) {
+        const Question *picked[SHARD_MAX_DRAW];
+        for (size_t i = 0; i < server->batch_len && result == 0; i++) {
+            int drawn = shard_store_draw(server->store, &server->batch[i], picked);
+            result = reply_begin_draw(reply);
+            for (int k = 0; k < drawn && result == 0; k++) {
+                Question *q = reply_add(reply);
+                if (q == NULL) {
+                    result = -1;
+                } else {
+                    *q = *picked[k];
+                }
+            }
+        }
+    } else {
+        result = shard_router_draw(server->router, server->batch, server->batch_len, reply);
+    }
+    server->stats.batches++;
+
+    /* Questions of draw i start at first[i]; draws are in batch order. */
+    size_t first = 0;
+    size_t draw = 0;
+    for (int i = 0; i < count; i++) {
+        ShardConn *c = &server->conns[fds[i]];
+        if (!c->open || c->draw_count == 0) {
+            continue;
+        }
+        if (result != 0) {
+            send_error(c, "draw failed");
+        } else {
+            while (draw < c->draw_first) {
+                first += reply->drawn[draw++];
+            }
+            size_t at = message_begin(&c->out, SHARD_MSG_DRAW);
+            uint32_t n = (uint32_t)c->draw_count;
+            buf_put(&c->out, &n, sizeof(n));
+            for (size_t k = 0; k < c->draw_count; k++, draw++) {
+                uint16_t drawn = reply->drawn[draw];
+                buf_put(&c->out, &drawn, sizeof(drawn));
+                for (uint16_t q = 0; q < drawn; q++) {
+                    put_question(&c->out, &reply->questions[first++]);
+                }
+                server->stats.questions += drawn;
+            }
+            message_end(&c->out, at);
+            server->stats.draws += c->draw_count;
+        }
+        server->stats.requests++;
+        c->draw_count = 0;
+    }
+    server->batch_len = 0;
+}
+
+/**
+ * @brief Send queued output; watch for writability while some is left
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int conn_flush(ShardServer *server, int fd) {
+    ShardConn *c = &server->conns[fd];
+    while (c->out_sent < c->out.len) {
+        ssize_t n = send(fd, c->out.data + c->out_sent, c->out.len - c->out_sent,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            break;
+        }
+        c->out_sent += (size_t)n;
+    }
+    if (c->out_sent == c->out.len) {
+        c->out.len = 0;
+        c->out_sent = 0;
+    }
+    bool writing = c->out.len > 0;
+    if (writing != c->writing) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+        ev.data.fd = fd;
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+        c->writing = writing;
+    }
+    return 0;
+}
+
+static void conn_accept(ShardServer *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fd >= server->conn_cap) {
+            int cap = server->conn_cap;
+            while (cap <= fd) {
+                cap *= 2;
+            }
+            ShardConn *conns = (ShardConn*)realloc(server->conns, (size_t)cap * sizeof(ShardConn));
+            if (conns == NULL) {
+                close(fd);
+                continue;
+            }
+            memset(conns + server->conn_cap, 0, (size_t)(cap - server->conn_cap) * sizeof(ShardConn));
+            server->conns = conns;
+            server->conn_cap = cap;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        memset(&server->conns[fd], 0, sizeof(ShardConn));
+        server->conns[fd].open = true;
+        server->stats.accepted++;
+    }
+}
+
+/**
+ * @brief Read everything available on a connection
+ *
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int conn_read(ShardConn *c, int fd) {
+    for (;;) {
+        if (buf_reserve(&c->in, 65536) != 0) {
+            return -1;
+        }
+        ssize_t n = recv(fd, c->in.data + c->in.len, c->in.cap - c->in.len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->in.len += (size_t)n;
+            if (c->in.len > SHARD_MAX_REQUEST + sizeof(ShardHeader) + 65536) {
+                /* Requests pile up faster than rounds run; read the rest later. */
+                return 0;
+            }
+            continue;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    }
+}
+
+int shard_server_init(ShardServer *server, const char *host, int port,
+                      ShardStore *store, ShardRouter *router) {
+    if (server == NULL || (store == NULL) == (router == NULL)) {
+        return -1;
+    }
+    memset(server, 0, sizeof(*server));
+    server->store = store;
+    server->router = router;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    shard_reply_init(&server->reply);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host != NULL ? host : "127.0.0.1", &addr.sin_addr) != 1) {
+        print_error("Invalid listen address: %s", host);
+        return -1;
+    }
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (server->listen_fd < 0 ||
+        setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, SOMAXCONN) != 0) {
+        print_error("Failed to listen on port %d: %s", port, strerror(errno));
+        shard_server_destroy(server);
+        return -1;
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len);
+    server->port = ntohs(addr.sin_port);
+
+    server->conn_cap = 64;
+    server->conns = (ShardConn*)calloc((size_t)server->conn_cap, sizeof(ShardConn));
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = server->listen_fd;
+    int added = server->conns != NULL && server->epoll_fd >= 0 && server->wake_fd >= 0
+                ? epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) : -1;
+    ev.data.fd = server->wake_fd;
+    if (added != 0 || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev) != 0) {
+        print_error("Failed to set up the shard event loop");
+        shard_server_destroy(server);
+        return -1;
+    }
+    return 0;
+}
+
+int shard_server_run(ShardServer *server) {
+    if (server == NULL || server->epoll_fd < 0) {
+        return -1;
+    }
+    struct epoll_event events[SHARD_EVENTS];
+    int ready[SHARD_EVENTS];
+    while (!server->stopping) {
+        int n = epoll_wait(server->epoll_fd, events, SHARD_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            print_error("epoll_wait failed: %s", strerror(errno));
+            return -1;
+        }
+        int ready_count = 0;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server->listen_fd) {
+                conn_accept(server);
+                continue;
+            }
+            if (fd == server->wake_fd) {
+                uint64_t value;
+                while (read(server->wake_fd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            if (fd >= server->conn_cap || !server->conns[fd].open) {
+                continue;
+            }
+            ShardConn *c = &server->conns[fd];
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0 && !(events[i].events & EPOLLIN)) {
+                conn_close(server, fd);
+                continue;
+            }
+            if ((events[i].events & EPOLLIN) && conn_read(c, fd) != 0) {
+                conn_close(server, fd);
+                continue;
+            }
+            if (!c->queued) {
+                c->queued = true;
+                ready[ready_count++] = fd;
+            }
+        }
+
+        /* Rounds: every ready connection contributes its next DRAW, the
+         * round is drawn in one go, and this repeats until nothing that
+         * arrived is left unanswered. */
+        bool pending = ready_count > 0;
+        while (pending) {
+            pending = false;
+            size_t round_questions = 0;
+            for (int i = 0; i < ready_count; i++) {
+                ShardConn *c = &server->conns[ready[i]];
+                if (c->open && conn_parse(server, c, &round_questions) != 0) {
+                    conn_close(server, ready[i]);
+                }
+            }
+            run_round(server, ready, ready_count);
+            for (int i = 0; i < ready_count; i++) {
+                ShardConn *c = &server->conns[ready[i]];
+                if (c->open && c->in.len >= sizeof(ShardHeader)) {
+                    ShardHeader header;
+                    memcpy(&header, c->in.data, sizeof(header));
+                    pending = pending || c->in.len >= sizeof(header) + header.len;
+                }
+            }
+        }
+        for (int i = 0; i < ready_count; i++) {
+            int fd = ready[i];
+            if (server->conns[fd].open) {
+                server->conns[fd].queued = false;
+                if (conn_flush(server, fd) != 0) {
+                    conn_close(server, fd);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+void shard_server_stop(ShardServer *server) {
+    if (server == NULL) {
+        return;
+    }
+    server->stopping = 1;
+    if (server->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void shard_server_destroy(ShardServer *server) {
+    if (server == NULL) {
+        return;
+    }
+    for (int fd = 0; server->conns != NULL && fd < server->conn_cap; fd++) {
+        conn_close(server, fd);
+    }
+    free(server->conns);
+    free(server->batch);
+    shard_reply_free(&server->reply);
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0) {
+        close(server->wake_fd);
+    }
+    server->conns = NULL;
+    server->batch = NULL;
+    server->conn_cap = 0;
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+}
@@ -0,0 +1,377 @@
+/**
+ * @file shard.h
+ * @brief Question bank sharded across local processes, with a batching router
+ *
+ * A ShardMap splits the bank by category ("category:N", category modulo
+ * N) or by ID range ("id:1000,5000" gives three shards: below 1000, below
+ * 5000, the rest). Each shard process reads the pack but adds only its own
+ * questions to its bank (shard_bank_load()) and serves draws over TCP with
+ * a ShardServer. A router is a ShardServer backed by a ShardRouter instead
+ * of a bank: it speaks the same protocol to its clients, so a client
+ * cannot tell a router from a single shard.
+ *
+ * Wire format (same host, native byte order): every message is a
+ * ShardHeader followed by its payload.
+ *
+ *   HELLO  request empty; reply u32 shard, u8 spec length, map spec,
+ *          u32 counts[DIFFICULTY_COUNT][CATEGORY_COUNT] (a router reports
+ *          shard SHARD_ALL and the counts summed over its shards)
+ *   DRAW   request u32 n, then n ShardDraw; reply u32 n, then per draw
+ *          u16 drawn followed by that many encoded questions
+ *   ERROR  reply text
+ *
+ * The router batches: every DRAW that arrives from any client while it
+ * waits on the shards goes out in the next round, as one message per
+ * shard, and the shards are asked in parallel.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <signal.h>
+#include "questions.h"
+
+/**
+ * @brief Most shards in a map
+ */
+#define SHARD_MAX 16
+
+/**
+ * @brief Shard index a router reports in its HELLO reply
+ */
+#define SHARD_ALL UINT32_MAX
+
+/**
+ * @brief Longest map spec, e.g. "id:1000,5000"
+ */
+#define SHARD_MAX_SPEC 200
+
+/**
+ * @brief Most questions one draw asks for
+ */
+#define SHARD_MAX_DRAW 64
+
+/**
+ * @brief Most questions asked for by one DRAW message
+ */
+#define SHARD_MAX_QUESTIONS 4096
+
+/**
+ * @brief Largest request message accepted
+ */
+#define SHARD_MAX_REQUEST (1u << 20)
+
+/**
+ * @brief Message types
+ */
+typedef enum {
+    SHARD_MSG_HELLO = 1,
+    SHARD_MSG_DRAW = 2,
+    SHARD_MSG_ERROR = 3
+} ShardMessageType;
+
+/**
+ * @brief How questions are assigned to shards
+ */
+typedef enum {
+    SHARD_BY_CATEGORY,                    /**< Category modulo shard count */
+    SHARD_BY_ID                           /**< Ascending ID ranges */
+} ShardScheme;
+
+/**
+ * @brief Assignment of questions to shards
+ */
+typedef struct {
+    ShardScheme scheme;                   /**< Scheme */
+    int count;                            /**< Number of shards */
+    uint32_t bounds[SHARD_MAX - 1];       /**< SHARD_BY_ID: shard i holds IDs below bounds[i] */
+    char spec[SHARD_MAX_SPEC];            /**< Spec the map was parsed from */
+} ShardMap;
+
+/**
+ * @brief Message header
+ */
+typedef struct {
+    uint32_t len;                         /**< Payload bytes after the header */
+    uint32_t type;                        /**< ShardMessageType */
+} ShardHeader;
+
+/**
+ * @brief One draw: up to count distinct questions matching the filters
+ */
+typedef struct {
+    int8_t difficulty;                    /**< Difficulty, -1 for any */
+    int8_t category;                      /**< Category, -1 for any */
+    uint16_t count;                       /**< Questions wanted (1..SHARD_MAX_DRAW) */
+    uint32_t seed;                        /**< Non-zero RNG seed for the draw */
+} ShardDraw;
+
+/**
+ * @brief Questions returned for a batch of draws, in draw order
+ */
+typedef struct {
+    Question *questions;                  /**< Questions of every draw, back to back */
+    size_t count;                         /**< Questions held */
+    size_t capacity;                      /**< Allocated questions */
+    uint16_t *drawn;                      /**< Questions returned per draw */
+    size_t draws;                         /**< Draws answered */
+    size_t draw_cap;                      /**< Allocated entries in drawn */
+} ShardReply;
+
+/**
+ * @brief A shard's questions, indexed for drawing
+ */
+typedef struct {
+    QuestionBank *bank;                   /**< Questions of this shard only */
+    ShardMap map;                         /**< Map the shard belongs to */
+    int shard;                            /**< This shard's index */
+    uint32_t *lists[DIFFICULTY_COUNT + 1][CATEGORY_COUNT + 1]; /**< Indices per filter, last = any */
+    uint32_t list_len[DIFFICULTY_COUNT + 1][CATEGORY_COUNT + 1]; /**< Length of each list */
+} ShardStore;
+
+/**
+ * @brief Connections from a router to every shard of a map
+ */
+typedef struct {
+    ShardMap map;                         /**< Map reported by the shards */
+    int fds[SHARD_MAX];                   /**< Connection to each shard, by index */
+    uint32_t counts[SHARD_MAX][DIFFICULTY_COUNT][CATEGORY_COUNT]; /**< Questions per shard */
+    uint64_t rounds;                      /**< Batches sent to the shards */
+    uint64_t draws;                       /**< Client draws forwarded */
+    uint64_t messages;                    /**< DRAW messages sent to shards */
+    ShardReply replies[SHARD_MAX];        /**< Per-shard scratch for one round */
+} ShardRouter;
+
+typedef struct ShardConn ShardConn;
+
+/**
+ * @brief Running totals of a ShardServer
+ */
+typedef struct {
+    uint64_t accepted;                    /**< Connections accepted */
+    uint64_t requests;                    /**< Messages answered */
+    uint64_t draws;                       /**< Draws answered */
+    uint64_t questions;                   /**< Questions sent */
+    uint64_t batches;                     /**< Rounds of draws handled together */
+} ShardServerStats;
+
+/**
+ * @brief Serves a ShardStore or a ShardRouter on one epoll loop
+ */
+typedef struct {
+    ShardStore *store;                    /**< Local questions, or NULL */
+    ShardRouter *router;                  /**< Upstream shards, or NULL */
+    int listen_fd;                        /**< Listener */
+    int epoll_fd;                         /**< Event loop */
+    int wake_fd;                          /**< eventfd that interrupts the loop */
+    int port;                             /**< Bound port */
+    volatile sig_atomic_t stopping;       /**< Set by shard_server_stop() */
+    ShardConn *conns;                     /**< Connections indexed by fd */
+    int conn_cap;                         /**< Length of conns */
+    ShardDraw *batch;                     /**< Draws of the current round */
+    size_t batch_len;                     /**< Draws in batch */
+    size_t batch_cap;                     /**< Allocated draws */
+    ShardReply reply;                     /**< Questions for the current round */
+    ShardServerStats stats;               /**< Running totals */
+} ShardServer;
+
+/**
+ * @brief Parse a map spec: "category:N" or "id:B1,B2,..." (ascending)
+ *
+ * @param map Map to fill
+ * @param spec Spec text
+ * @return int 0 on success, -1 if the spec is invalid
+ */
+int shard_map_parse(ShardMap *map, const char *spec);
+
+/**
+ * @brief Shard a question belongs to
+ *
+ * @param map Map
+ * @param question Question
+ * @return int Shard index
+ */
+int shard_of(const ShardMap *map, const Question *question);
+
+/**
+ * @brief Drop every question that belongs to another shard
+ *
+ * The bank's storage is shrunk to fit and its difficulty index rebuilt.
+ * For a bank already in memory; shard processes load with
+ * shard_bank_load() instead.
+ *
+ * @param bank Loaded bank
+ * @param map Map
+ * @param shard Shard to keep
+ * @return long Questions kept, -1 on error
+ */
+long shard_bank_retain(QuestionBank *bank, const ShardMap *map, int shard);
+
+/**
+ * @brief Load only one shard's questions from a JSON file or binary pack
+ *
+ * The file is mapped and scanned; questions of other shards are parsed
+ * and dropped without ever entering @p bank, so a shard process never
+ * holds the whole bank. The difficulty index is built on success.
+ *
+ * @param bank Initialized bank to add to
+ * @param filename JSON questions file or binary pack
+ * @param map Map
+ * @param shard Shard to keep
+ * @param seen Receives the number of questions in the file (may be NULL)
+ * @return long Questions kept, -1 on error
+ */
+long shard_bank_load(QuestionBank *bank, const char *filename, const ShardMap *map,
+                     int shard, size_t *seen);
+
+/**
+ * @brief Index a shard's bank for drawing
+ *
+ * @param store Store to initialize
+ * @param bank Bank holding only this shard's questions (borrowed)
+ * @param map Map
+ * @param shard This shard's index
+ * @return int 0 on success, -1 on error
+ */
+int shard_store_init(ShardStore *store, QuestionBank *bank, const ShardMap *map, int shard);
+
+/**
+ * @brief Draw distinct questions from a store
+ *
+ * @param store Store
+ * @param draw Filters, count and seed
+ * @param out Receives pointers to the drawn questions (draw->count entries)
+ * @return int Questions drawn (fewer if the shard runs short)
+ */
+int shard_store_draw(const ShardStore *store, const ShardDraw *draw, const Question **out);
+
+/**
+ * @brief Free a store's index lists (not the bank)
+ *
+ * @param store Store
+ */
+void shard_store_free(ShardStore *store);
+
+/**
+ * @brief Initialize an empty reply
+ *
+ * @param reply Reply
+ */
+void shard_reply_init(ShardReply *reply);
+
+/**
+ * @brief Empty a reply, keeping its storage
+ *
+ * @param reply Reply
+ */
+void shard_reply_clear(ShardReply *reply);
+
+/**
+ * @brief Free a reply's storage
+ *
+ * @param reply Reply
+ */
+void shard_reply_free(ShardReply *reply);
+
+/**
+ * @brief Questions returned for one draw
+ *
+ * @param reply Reply
+ * @param draw Draw index
+ * @param count Receives the number of questions
+ * @return const Question* First question of the draw
+ */
+const Question* shard_reply_draw(const ShardReply *reply, size_t draw, size_t *count);
+
+/**
+ * @brief Connect to a shard or router
+ *
+ * @param host IPv4 address
+ * @param port Port
+ * @return int Connected socket, -1 on error
+ */
+int shard_connect(const char *host, int port);
+
+/**
+ * @brief Send a batch of draws and wait for the questions
+ *
+ * @param fd Connection from shard_connect()
+ * @param draws Draws
+ * @param n Number of draws
+ * @param reply Receives the questions (appended)
+ * @return int 0 on success, -1 on error
+ */
+int shard_call_draw(int fd, const ShardDraw *draws, size_t n, ShardReply *reply);
+
+/**
+ * @brief Connect to every shard and learn the map from their HELLO replies
+ *
+ * @param router Router to initialize
+ * @param addrs "host:port" of each shard, in any order
+ * @param n Number of shards
+ * @return int 0 on success, -1 if a shard is unreachable or the shards disagree
+ */
+int shard_router_connect(ShardRouter *router, const char *const *addrs, int n);
+
+/**
+ * @brief Route a batch of draws to the shards and gather the questions
+ *
+ * Each draw goes to the one shard that holds its category, or is split
+ * across shards in proportion to their matching questions. Every shard
+ * involved gets one message for the whole batch, and all of them are
+ * sent before any reply is read.
+ *
+ * @param router Connected router
+ * @param draws Draws
+ * @param n Number of draws
+ * @param reply Receives the questions (appended), in draw order
+ * @return int 0 on success, -1 on error
+ */
+int shard_router_draw(ShardRouter *router, const ShardDraw *draws, size_t n, ShardReply *reply);
+
+/**
+ * @brief Close the router's shard connections
+ *
+ * @param router Router
+ */
+void shard_router_close(ShardRouter *router);
+
+/**
+ * @brief Bind the listener for a store or a router (exactly one non-NULL)
+ *
+ * @param server Server to initialize
+ * @param host IPv4 address to listen on
+ * @param port Port, 0 picks a free one
+ * @param store Local questions, or NULL
+ * @param router Upstream shards, or NULL
+ * @return int 0 on success, -1 on error
+ */
+int shard_server_init(ShardServer *server, const char *host, int port,
+                      ShardStore *store, ShardRouter *router);
+
+/**
+ * @brief Serve until shard_server_stop() is called
+ *
+ * @param server Initialized server
+ * @return int 0 on a clean stop, -1 on error
+ */
+int shard_server_run(ShardServer *server);
+
+/**
+ * @brief Ask the loop to stop; safe from signal handlers and other threads
+ *
+ * @param server Server
+ */
+void shard_server_stop(ShardServer *server);
+
+/**
+ * @brief Close connections and free the server
+ *
+ * @param server Server
+ */
+void shard_server_destroy(ShardServer *server);
+
+#endif /* SHARD_H */
@@ -4,7 +4,8 @@
  */
 
 #include "timer.h"
-#include <unistd.h>
+#include "probes.h"
+#include <errno.h>
 #include <stdlib.h>
 
 /**
@@ -12,6 +13,8 @@
  * 
  * This function runs in a separate thread and counts down the timer.
  * It demonstrates the use of pthreads for concurrent operations.
+ * Each tick is a timed wait on the timer's condition variable, so
+ * timer_stop() can wake the thread without waiting out the second.
  * 
  * @param arg Pointer to Timer structure
  * @return void* Always NULL
@@ -22,27 +25,25 @@ static void* timer_thread_func(void *arg) {
         return NULL;
     }
     
-    pthread_mutex_lock(&timer->mutex);
-    timer->running = true;
-    timer->expired = false;
-    timer->remaining = timer->seconds;
-    pthread_mutex_unlock(&timer->mutex);
+    struct timespec tick;
+    clock_gettime(CLOCK_MONOTONIC, &tick);
     
-    while (timer->remaining > 0) {
-        sleep(1);
-        
-        pthread_mutex_lock(&timer->mutex);
+    pthread_mutex_lock(&timer->mutex);
+    while (timer->running && timer->remaining > 0) {
+        tick.tv_sec += 1;
+        int rc = 0;
+        while (timer->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&timer->cond, &timer->mutex, &tick);
+        }
         if (!timer->running) {
-            pthread_mutex_unlock(&timer->mutex);
             break;
         }
         timer->remaining--;
-        pthread_mutex_unlock(&timer->mutex);
     }
     
-    pthread_mutex_lock(&timer->mutex);
     if (timer->remaining == 0) {
         timer->expired = true;
+        TRIVIA_PROBE2(timer_expired, timer, timer->seconds);
     }
     timer->running = false;
     pthread_mutex_unlock(&timer->mutex);
@@ -63,11 +64,22 @@ int timer_init(Timer *timer, int seconds) {
     timer->remaining = seconds;
     timer->running = false;
     timer->expired = false;
+    timer->joinable = false;
     
     if (pthread_mutex_init(&timer->mutex, NULL) != 0) {
         return -1;
     }
     
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int rc = pthread_cond_init(&timer->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc != 0) {
+        pthread_mutex_destroy(&timer->mutex);
+        return -1;
+    }
+    
     return 0;
 }
 
@@ -81,12 +93,25 @@ int timer_start(Timer *timer) {
         pthread_mutex_unlock(&timer->mutex);
         return -1; // Already running
     }
+    timer->running = true;
+    timer->expired = false;
+    timer->remaining = timer->seconds;
     pthread_mutex_unlock(&timer->mutex);
     
+    // A countdown that expired on its own has exited but was never joined
+    if (timer->joinable) {
+        pthread_join(timer->thread, NULL);
+        timer->joinable = false;
+    }
+    
     // Create thread
     if (pthread_create(&timer->thread, NULL, timer_thread_func, timer) != 0) {
+        pthread_mutex_lock(&timer->mutex);
+        timer->running = false;
+        pthread_mutex_unlock(&timer->mutex);
         return -1;
     }
+    timer->joinable = true;
     
     return 0;
 }
@@ -98,9 +123,13 @@ int timer_stop(Timer *timer) {
     
     pthread_mutex_lock(&timer->mutex);
     timer->running = false;
+    pthread_cond_signal(&timer->cond);
     pthread_mutex_unlock(&timer->mutex);
     
-    pthread_join(timer->thread, NULL);
+    if (timer->joinable) {
+        pthread_join(timer->thread, NULL);
+        timer->joinable = false;
+    }
     
     return 0;
 }
@@ -134,7 +163,7 @@ int timer_reset(Timer *timer, int seconds) {
         return -1;
     }
     
-    if (timer->running) {
+    if (timer->joinable) {
         timer_stop(timer);
     }
     
@@ -152,10 +181,11 @@ void timer_cleanup(Timer *timer) {
         return;
     }
     
-    if (timer->running) {
+    if (timer->joinable) {
         timer_stop(timer);
     }
     
+    pthread_cond_destroy(&timer->cond);
     pthread_mutex_destroy(&timer->mutex);
 }
 
@@ -22,7 +22,9 @@ typedef struct {
     int remaining;             /**< Remaining seconds */
     bool running;              /**< Whether timer is running */
     bool expired;              /**< Whether timer has expired */
+    bool joinable;             /**< Whether a thread was started and not yet joined */
     pthread_mutex_t mutex;     /**< Mutex for thread-safe access */
+    pthread_cond_t cond;       /**< Signalled by timer_stop to wake the countdown early */
 } Timer;
 
 /**
@@ -45,6 +47,9 @@ int timer_start(Timer *timer);
 /**
  * @brief Stop the timer
  * 
+ * Wakes the countdown thread immediately and joins it, so the call
+ * returns without waiting for the current one-second tick to finish.
+ * 
  * @param timer Pointer to Timer structure
  * @return int 0 on success, -1 on error
  */
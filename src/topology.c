@@ -0,0 +1,225 @@
+/**
+ * @file topology.c
+ * @brief Implementation of NUMA node discovery and thread placement
+ */
+
+#define _GNU_SOURCE
+#include "topology.h"
+#include "utils.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define NODE_SYSFS "/sys/devices/system/node"
+
+static void mask_set(CpuMask *mask, int cpu) {
+    mask->bits[cpu / 64] |= 1ull << (cpu % 64);
+}
+
+static int mask_count(const CpuMask *mask) {
+    int count = 0;
+    for (int w = 0; w < TOPOLOGY_CPU_WORDS; w++) {
+        count += __builtin_popcountll(mask->bits[w]);
+    }
+    return count;
+}
+
+int topology_parse_cpulist(const char *list, CpuMask *set) {
+    memset(set, 0, sizeof(*set));
+    const char *p = list;
+    while (*p != '\0' && *p != '\n') {
+        char *end = NULL;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= TOPOLOGY_MAX_CPUS) {
+            return -1;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last >= TOPOLOGY_MAX_CPUS) {
+                return -1;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            mask_set(set, (int)cpu);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0' && *p != '\n') {
+            return -1;
+        }
+    }
+    return mask_count(set);
+}
+
+/**
+ * @brief Read a short sysfs file into @p buf
+ */
+static int read_sysfs(const char *path, char *buf, size_t size) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t len = fread(buf, 1, size - 1, file);
+    fclose(file);
+    buf[len] = '\0';
+    return len > 0 ? 0 : -1;
+}
+
+/**
+ * @brief CPUs the process may run on
+ */
+static int allowed_cpus(CpuMask *mask) {
+    memset(mask, 0, sizeof(*mask));
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < TOPOLOGY_MAX_CPUS; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            mask_set(mask, cpu);
+        }
+    }
+    return mask_count(mask);
+}
+
+int topology_load(Topology *topo) {
+    if (topo == NULL) {
+        return -1;
+    }
+    memset(topo, 0, sizeof(*topo));
+    CpuMask allowed;
+    if (allowed_cpus(&allowed) <= 0) {
+        print_error("Failed to read the CPU affinity mask");
+        return -1;
+    }
+
+    char buf[4096];
+    CpuMask online;
+    if (read_sysfs(NODE_SYSFS "/online", buf, sizeof(buf)) == 0 &&
+        topology_parse_cpulist(buf, &online) > 0) {
+        for (int node = 0; node < TOPOLOGY_MAX_CPUS && topo->node_count < TOPOLOGY_MAX_NODES;
+             node++) {
+            if ((online.bits[node / 64] & (1ull << (node % 64))) == 0) {
+                continue;
+            }
+            char path[128];
+            CpuMask cpus;
+            snprintf(path, sizeof(path), NODE_SYSFS "/node%d/cpulist", node);
+            if (read_sysfs(path, buf, sizeof(buf)) != 0 ||
+                topology_parse_cpulist(buf, &cpus) <= 0) {
+                continue;
+            }
+            for (int w = 0; w < TOPOLOGY_CPU_WORDS; w++) {
+                cpus.bits[w] &= allowed.bits[w];
+            }
+            int count = mask_count(&cpus);
+            if (count == 0) {
+                continue;               /* Memory-only node or outside our cpuset */
+            }
+            int n = topo->node_count++;
+            topo->node_ids[n] = node;
+            topo->cpus[n] = cpus;
+            topo->cpu_count[n] = count;
+        }
+    }
+
+    if (topo->node_count == 0) {
+        topo->node_count = 1;
+        topo->node_ids[0] = 0;
+        topo->cpus[0] = allowed;
+        topo->cpu_count[0] = mask_count(&allowed);
+    }
+    return topo->node_count;
+}
+
+int topology_node_for_worker(const Topology *topo, int worker, int workers) {
+    if (topo == NULL || topo->node_count <= 1 || workers <= 0 || worker < 0) {
+        return 0;
+    }
+    int node = (int)((long)worker * topo->node_count / workers);
+    return node < topo->node_count ? node : topo->node_count - 1;
+}
+
+int topology_bind_thread(const Topology *topo, int node) {
+    if (topo == NULL || node < 0 || node >= topo->node_count) {
+        return -1;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < TOPOLOGY_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (topo->cpus[node].bits[cpu / 64] & (1ull << (cpu % 64))) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Arguments of a task run on a node
+ */
+typedef struct {
+    const Topology *topo;
+    int node;
+    TopologyTask task;
+    void *arg;
+    int result;
+} NodeTask;
+
+static void* node_task_main(void *arg) {
+    NodeTask *t = (NodeTask*)arg;
+    t->result = topology_bind_thread(t->topo, t->node);
+    if (t->result == 0) {
+        t->task(t->arg);
+    }
+    return NULL;
+}
+
+int topology_run_on_node(const Topology *topo, int node, TopologyTask task, void *arg) {
+    NodeTask t = { topo, node, task, arg, -1 };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, node_task_main, &t) != 0) {
+        return -1;
+    }
+    pthread_join(thread, NULL);
+    return t.result;
+}
+
+/**
+ * @brief Arguments of one replica copy
+ */
+typedef struct {
+    const QuestionBank *src;
+    QuestionBank *dst;
+    int result;
+} ReplicaTask;
+
+static void copy_replica(void *arg) {
+    ReplicaTask *t = (ReplicaTask*)arg;
+    t->result = question_bank_copy(t->dst, t->src);
+}
+
+int topology_replicate_bank(const Topology *topo, const QuestionBank *src,
+                            QuestionBank *replicas) {
+    if (topo == NULL || src == NULL || replicas == NULL) {
+        return -1;
+    }
+    for (int node = 0; node < topo->node_count; node++) {
+        ReplicaTask t = { src, &replicas[node], -1 };
+        if (topology_run_on_node(topo, node, copy_replica, &t) != 0 || t.result != 0) {
+            print_error("Failed to replicate the question bank on node %d",
+                        topo->node_ids[node]);
+            for (int n = 0; n < node; n++) {
+                question_bank_free(&replicas[n]);
+            }
+            if (t.result == 0) {
+                question_bank_free(&replicas[node]);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
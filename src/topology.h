@@ -0,0 +1,123 @@
+/**
+ * @file topology.h
+ * @brief NUMA node discovery and node-local thread placement
+ *
+ * Nodes and their CPUs are read from sysfs, so no NUMA library is needed.
+ * Memory placement relies on the kernel's default first-touch policy: a
+ * thread bound to a node's CPUs that allocates and writes memory gets it
+ * from that node. Hosts without NUMA (or without sysfs) appear as a single
+ * node holding every CPU the process may run on.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "questions.h"
+
+/**
+ * @brief Most NUMA nodes tracked
+ */
+#define TOPOLOGY_MAX_NODES 16
+
+/**
+ * @brief Highest CPU number + 1 tracked
+ */
+#define TOPOLOGY_MAX_CPUS 1024
+
+/**
+ * @brief Words in a CPU mask
+ */
+#define TOPOLOGY_CPU_WORDS (TOPOLOGY_MAX_CPUS / 64)
+
+/**
+ * @brief Set of CPUs, one bit per CPU number
+ */
+typedef struct {
+    uint64_t bits[TOPOLOGY_CPU_WORDS];       /**< Bit c % 64 of word c / 64 is CPU c */
+} CpuMask;
+
+/**
+ * @brief NUMA nodes that have CPUs this process may use
+ */
+typedef struct {
+    int node_count;                          /**< Number of usable nodes */
+    int node_ids[TOPOLOGY_MAX_NODES];        /**< Kernel node number of each node */
+    CpuMask cpus[TOPOLOGY_MAX_NODES];        /**< Usable CPUs of each node */
+    int cpu_count[TOPOLOGY_MAX_NODES];       /**< Number of usable CPUs per node */
+} Topology;
+
+/**
+ * @brief Work run by topology_run_on_node()
+ */
+typedef void (*TopologyTask)(void *arg);
+
+/**
+ * @brief Parse a kernel CPU list such as "0-3,8,10-11"
+ *
+ * @param list CPU list text (a trailing newline is allowed)
+ * @param set Receives the CPUs
+ * @return int Number of CPUs, -1 if the list is malformed
+ */
+int topology_parse_cpulist(const char *list, CpuMask *set);
+
+/**
+ * @brief Discover the NUMA nodes and their usable CPUs
+ *
+ * Falls back to a single node when sysfs has no node information.
+ *
+ * @param topo Pointer to Topology to fill
+ * @return int Number of nodes (at least 1), -1 on error
+ */
+int topology_load(Topology *topo);
+
+/**
+ * @brief Node for a worker when workers are spread evenly over the nodes
+ *
+ * Consecutive workers share a node, so a node's workers are contiguous.
+ *
+ * @param topo Pointer to Topology
+ * @param worker Worker index
+ * @param workers Number of workers
+ * @return int Node index (0 to node_count - 1)
+ */
+int topology_node_for_worker(const Topology *topo, int worker, int workers);
+
+/**
+ * @brief Restrict the calling thread to the CPUs of a node
+ *
+ * @param topo Pointer to Topology
+ * @param node Node index
+ * @return int 0 on success, -1 on error
+ */
+int topology_bind_thread(const Topology *topo, int node);
+
+/**
+ * @brief Run a task on a thread bound to a node and wait for it
+ *
+ * Memory the task allocates and writes is placed on that node.
+ *
+ * @param topo Pointer to Topology
+ * @param node Node index
+ * @param task Work to run
+ * @param arg Argument passed to the task
+ * @return int 0 on success, -1 if the thread could not be started or bound
+ */
+int topology_run_on_node(const Topology *topo, int node, TopologyTask task, void *arg);
+
+/**
+ * @brief Copy a bank onto every node
+ *
+ * The replicas are read-only copies whose questions and index live on
+ * their node, so draws never cross the interconnect.
+ *
+ * @param topo Pointer to Topology
+ * @param src Bank to copy
+ * @param replicas Array of node_count banks to initialize (free each one)
+ * @return int 0 on success, -1 on error (no replica is left allocated)
+ */
+int topology_replicate_bank(const Topology *topo, const QuestionBank *src,
+                            QuestionBank *replicas);
+
+#endif /* TOPOLOGY_H */
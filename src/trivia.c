@@ -0,0 +1,300 @@
+/**
+ * @file trivia.c
+ * @brief libtrivia: the public API over QuestionBank and GameState
+ */
+
+#include "trivia.h"
+#include "game.h"
+#include "pack.h"
+#include "questions.h"
+#include "utf8.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct TriviaBank {
+    QuestionBank questions;               /**< Questions and difficulty index */
+    pthread_mutex_t lock;                 /**< Serializes the index rebuild */
+    bool dirty;                           /**< Questions added since the last rebuild */
+};
+
+struct TriviaSession {
+    GameState game;                       /**< Engine state (players, flags, RNG) */
+    const Question *pending;              /**< Drawn and not yet answered */
+    int round;                            /**< Questions answered so far */
+    int total_rounds;                     /**< questions_per_game times players */
+};
+
+int trivia_api_version(void) {
+    return TRIVIA_API_VERSION;
+}
+
+const char* trivia_status_string(TriviaStatus status) {
+    switch (status) {
+        case TRIVIA_OK: return "ok";
+        case TRIVIA_DONE: return "game over";
+        case TRIVIA_ERR_ARGUMENT: return "invalid argument";
+        case TRIVIA_ERR_MEMORY: return "out of memory";
+        case TRIVIA_ERR_IO: return "file could not be read";
+        case TRIVIA_ERR_FORMAT: return "no playable questions";
+        case TRIVIA_ERR_STATE: return "no question drawn";
+        default: return "unknown status";
+    }
+}
+
+TriviaStatus trivia_bank_create(TriviaBank **out) {
+    if (out == NULL) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    *out = NULL;
+    TriviaBank *bank = (TriviaBank*)malloc(sizeof(TriviaBank));
+    if (bank == NULL) {
+        return TRIVIA_ERR_MEMORY;
+    }
+    if (question_bank_init(&bank->questions) != 0) {
+        free(bank);
+        return TRIVIA_ERR_MEMORY;
+    }
+    if (pthread_mutex_init(&bank->lock, NULL) != 0) {
+        question_bank_free(&bank->questions);
+        free(bank);
+        return TRIVIA_ERR_MEMORY;
+    }
+    bank->dirty = false;
+    *out = bank;
+    return TRIVIA_OK;
+}
+
+/**
+ * @brief Drop duplicates and unplayable questions after a bulk load
+ */
+static TriviaStatus finish_load(TriviaBank *bank, int loaded) {
+    if (loaded < 0) {
+        return TRIVIA_ERR_FORMAT;
+    }
+    if (question_bank_prepare(&bank->questions, NULL) < 0) {
+        bank->dirty = true;
+        return TRIVIA_ERR_MEMORY;
+    }
+    bank->dirty = false;
+    return bank->questions.count > 0 ? TRIVIA_OK : TRIVIA_ERR_FORMAT;
+}
+
+TriviaStatus trivia_bank_load_buffer(TriviaBank *bank, const void *data, size_t len) {
+    if (bank == NULL || (data == NULL && len > 0)) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    int loaded = pack_is_pack(data, len)
+                 ? pack_load_from_buffer(&bank->questions, data, len)
+                 : question_bank_load_from_buffer(&bank->questions, (const char*)data, len);
+    return finish_load(bank, loaded);
+}
+
+TriviaStatus trivia_bank_load_file(TriviaBank *bank, const char *path) {
+    if (bank == NULL || path == NULL) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return TRIVIA_ERR_IO;
+    }
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(file, &data, &len);
+    fclose(file);
+    if (err != UTILS_SUCCESS) {
+        return TRIVIA_ERR_IO;
+    }
+    TriviaStatus status = trivia_bank_load_buffer(bank, data, len);
+    free(data);
+    return status;
+}
+
+TriviaStatus trivia_bank_add(TriviaBank *bank, const char *text,
+                             const char *const *options, int option_count,
+                             int correct, int difficulty) {
+    if (bank == NULL || text == NULL || text[0] == '\0' || options == NULL ||
+        option_count < 2 || option_count > MAX_OPTIONS ||
+        correct < 0 || correct >= option_count ||
+        difficulty < 0 || difficulty >= DIFFICULTY_COUNT) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+
+    Question q;
+    memset(&q, 0, sizeof(q));
+    strncpy(q.question, text, MAX_QUESTION_LEN - 1);
+    utf8_trim_partial(q.question);
+    for (int i = 0; i < option_count; i++) {
+        if (options[i] == NULL || options[i][0] == '\0') {
+            return TRIVIA_ERR_ARGUMENT;
+        }
+        strncpy(q.options[i], options[i], MAX_ANSWER_LEN - 1);
+        utf8_trim_partial(q.options[i]);
+    }
+    q.correct_answer = correct;
+    q.difficulty = (Difficulty)difficulty;
+    if (question_bank_add(&bank->questions, &q) != 0) {
+        return TRIVIA_ERR_MEMORY;
+    }
+    bank->dirty = true;
+    return TRIVIA_OK;
+}
+
+size_t trivia_bank_count(const TriviaBank *bank) {
+    return bank != NULL ? bank->questions.count : 0;
+}
+
+void trivia_bank_destroy(TriviaBank *bank) {
+    if (bank == NULL) {
+        return;
+    }
+    question_bank_free(&bank->questions);
+    pthread_mutex_destroy(&bank->lock);
+    free(bank);
+}
+
+void trivia_session_config_default(TriviaSessionConfig *config) {
+    if (config == NULL) {
+        return;
+    }
+    config->questions_per_game = 5;
+    config->players = 1;
+    config->difficulty = -1;
+    config->shuffle_options = 1;
+}
+
+TriviaStatus trivia_session_create(TriviaBank *bank, const TriviaSessionConfig *config,
+                                   TriviaSession **out) {
+    if (bank == NULL || out == NULL) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    *out = NULL;
+    TriviaSessionConfig defaults;
+    if (config == NULL) {
+        trivia_session_config_default(&defaults);
+        config = &defaults;
+    }
+    if (config->questions_per_game < 1 || config->players < 1 ||
+        config->difficulty < -1 || config->difficulty >= DIFFICULTY_COUNT) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+
+    /* First session after a load or add rebuilds the difficulty index;
+     * later ones only read the bank. */
+    pthread_mutex_lock(&bank->lock);
+    int indexed = 0;
+    if (bank->dirty) {
+        indexed = question_bank_build_index(&bank->questions);
+        bank->dirty = indexed != 0;
+    }
+    pthread_mutex_unlock(&bank->lock);
+    if (indexed != 0) {
+        return TRIVIA_ERR_MEMORY;
+    }
+
+    TriviaSession *session = (TriviaSession*)malloc(sizeof(TriviaSession));
+    if (session == NULL) {
+        return TRIVIA_ERR_MEMORY;
+    }
+    GameConfig game_config;
+    game_config.questions_per_game = config->questions_per_game;
+    game_config.time_per_question = 30;
+    game_config.difficulty = (Difficulty)config->difficulty;
+    game_config.use_timer = false;
+    game_config.num_players = config->players;
+    game_config.shuffle_options = config->shuffle_options != 0;
+    if (game_init(&session->game, &bank->questions, &game_config) != 0) {
+        game_cleanup(&session->game);
+        free(session);
+        return TRIVIA_ERR_MEMORY;
+    }
+    session->game.game_active = true;
+    session->pending = NULL;
+    session->round = 0;
+    session->total_rounds = config->questions_per_game * config->players;
+    *out = session;
+    return TRIVIA_OK;
+}
+
+TriviaStatus trivia_session_draw(TriviaSession *session, TriviaQuestion *out) {
+    if (session == NULL || out == NULL) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    session->pending = NULL;
+    if (session->round >= session->total_rounds) {
+        return TRIVIA_DONE;
+    }
+    const Question *q = game_draw_question(&session->game);
+    if (q == NULL) {
+        session->total_rounds = session->round;
+        return TRIVIA_DONE;
+    }
+    session->pending = q;
+
+    out->id = q->id;
+    out->difficulty = (int)q->difficulty;
+    out->player = session->game.current_player;
+    out->round = session->round;
+    out->text = q->question;
+    out->option_count = question_option_count(q);
+    for (int slot = 0; slot < TRIVIA_MAX_OPTIONS; slot++) {
+        out->options[slot] = slot < out->option_count
+                             ? q->options[session->game.option_order[slot]] : NULL;
+    }
+    return TRIVIA_OK;
+}
+
+TriviaStatus trivia_session_answer(TriviaSession *session, int choice,
+                                   int time_remaining, TriviaResult *out) {
+    if (session == NULL || choice < 0 || choice > TRIVIA_MAX_OPTIONS) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    const Question *q = session->pending;
+    if (q == NULL) {
+        return TRIVIA_ERR_STATE;
+    }
+    int points = game_submit_answer(&session->game, q, choice, time_remaining);
+    if (points < 0) {
+        return TRIVIA_ERR_STATE;
+    }
+    int correct_choice = game_option_choice(&session->game, q->correct_answer);
+    if (out != NULL) {
+        out->correct = choice != 0 && choice == correct_choice;
+        out->points = points;
+        out->correct_choice = correct_choice;
+    }
+    game_next_player(&session->game);
+    session->pending = NULL;
+    session->round++;
+    return TRIVIA_OK;
+}
+
+TriviaStatus trivia_session_score(const TriviaSession *session, int player, TriviaScore *out) {
+    if (session == NULL || out == NULL || player < 0 ||
+        player >= session->game.config.num_players) {
+        return TRIVIA_ERR_ARGUMENT;
+    }
+    if (session->game.config.num_players > 1) {
+        const Player *p = &session->game.players[player];
+        out->score = p->score;
+        out->correct = p->correct_answers;
+        out->wrong = p->wrong_answers;
+        out->timeouts = p->timeouts;
+    } else {
+        const GameStats *s = &session->game.stats;
+        out->score = s->score;
+        out->correct = s->correct_answers;
+        out->wrong = s->wrong_answers;
+        out->timeouts = s->timeouts;
+    }
+    return TRIVIA_OK;
+}
+
+void trivia_session_destroy(TriviaSession *session) {
+    if (session == NULL) {
+        return;
+    }
+    game_cleanup(&session->game);
+    free(session);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file trivia.h
+ * @brief libtrivia: stable C API for hosting trivia sessions in-process
+ *
+ * Banks and sessions are opaque handles. The library keeps no global
+ * state and does no terminal I/O: errors come back as TriviaStatus codes
+ * and question text is handed out as read-only views into the bank.
+ *
+ * A loaded bank is read-only and may be shared by any number of sessions
+ * on any number of threads. A session must only be used by one thread at
+ * a time. Destroy every session of a bank before the bank itself.
+ *
+ * The API is versioned by TRIVIA_API_VERSION. Within a version, functions
+ * are only added and public structs only grow at the end.
+ */
+
+#ifndef TRIVIA_H
+#define TRIVIA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define TRIVIA_API __attribute__((visibility("default")))
+#else
+#define TRIVIA_API
+#endif
+
+/**
+ * @brief Version of this API, also returned by trivia_api_version()
+ */
+#define TRIVIA_API_VERSION 1
+
+/**
+ * @brief Most options a question can have
+ */
+#define TRIVIA_MAX_OPTIONS 4
+
+/**
+ * @brief Result codes
+ */
+typedef enum {
+    TRIVIA_OK = 0,                        /**< Success */
+    TRIVIA_DONE = 1,                      /**< The game is over; nothing was drawn */
+    TRIVIA_ERR_ARGUMENT = -1,             /**< NULL handle or value out of range */
+    TRIVIA_ERR_MEMORY = -2,               /**< Allocation failed */
+    TRIVIA_ERR_IO = -3,                   /**< File could not be opened or read */
+    TRIVIA_ERR_FORMAT = -4,               /**< No playable questions in the input */
+    TRIVIA_ERR_STATE = -5                 /**< Call out of order (e.g. answer before draw) */
+} TriviaStatus;
+
+/**
+ * @brief Question bank handle
+ */
+typedef struct TriviaBank TriviaBank;
+
+/**
+ * @brief Game session handle
+ */
+typedef struct TriviaSession TriviaSession;
+
+/**
+ * @brief Session settings; initialize with trivia_session_config_default()
+ */
+typedef struct {
+    int questions_per_game;               /**< Questions per player */
+    int players;                          /**< Players taking turns (1 or more) */
+    int difficulty;                       /**< 0 easy, 1 medium, 2 hard, -1 any */
+    int shuffle_options;                  /**< Non-zero to shuffle the options of each ask */
+} TriviaSessionConfig;
+
+/**
+ * @brief A drawn question, options in the order they are shown
+ *
+ * The strings point into the bank and stay valid while the bank lives.
+ */
+typedef struct {
+    uint32_t id;                          /**< Stable ID from the pack (0 if none) */
+    int difficulty;                       /**< 0 easy, 1 medium, 2 hard */
+    int player;                           /**< Player to answer (0-based) */
+    int round;                            /**< Question number in the game (0-based) */
+    const char *text;                     /**< Question text (UTF-8) */
+    int option_count;                     /**< Options shown */
+    const char *options[TRIVIA_MAX_OPTIONS]; /**< Option text by choice (1-based choice - 1) */
+} TriviaQuestion;
+
+/**
+ * @brief Outcome of an answer
+ */
+typedef struct {
+    int correct;                          /**< Non-zero if the choice was right */
+    int points;                           /**< Points awarded */
+    int correct_choice;                   /**< Choice (1-4) that was right */
+} TriviaResult;
+
+/**
+ * @brief Running totals of one player
+ */
+typedef struct {
+    int score;                            /**< Total points */
+    int correct;                          /**< Correct answers */
+    int wrong;                            /**< Wrong answers */
+    int timeouts;                         /**< Unanswered questions */
+} TriviaScore;
+
+/**
+ * @brief API version the library was built with
+ *
+ * @return int TRIVIA_API_VERSION of the library
+ */
+TRIVIA_API int trivia_api_version(void);
+
+/**
+ * @brief Short English description of a status code
+ *
+ * @param status Status code
+ * @return const char* Static string
+ */
+TRIVIA_API const char* trivia_status_string(TriviaStatus status);
+
+/**
+ * @brief Create an empty bank
+ *
+ * @param out Receives the bank
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_bank_create(TriviaBank **out);
+
+/**
+ * @brief Load a JSON file or binary pack into a bank
+ *
+ * Duplicate and invalid questions are dropped.
+ *
+ * @param bank Bank with no sessions yet
+ * @param path File to load
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_bank_load_file(TriviaBank *bank, const char *path);
+
+/**
+ * @brief Load JSON or binary pack bytes into a bank
+ *
+ * @param bank Bank with no sessions yet
+ * @param data Input bytes (copied as needed; may be freed afterwards)
+ * @param len Length of data
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_bank_load_buffer(TriviaBank *bank, const void *data, size_t len);
+
+/**
+ * @brief Add one question to a bank
+ *
+ * @param bank Bank with no sessions yet
+ * @param text Question text (UTF-8)
+ * @param options Option texts
+ * @param option_count Number of options (2-4)
+ * @param correct Index of the right option (0-based)
+ * @param difficulty 0 easy, 1 medium, 2 hard
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_bank_add(TriviaBank *bank, const char *text,
+                                        const char *const *options, int option_count,
+                                        int correct, int difficulty);
+
+/**
+ * @brief Number of questions in a bank
+ *
+ * @param bank Bank (NULL gives 0)
+ * @return size_t Question count
+ */
+TRIVIA_API size_t trivia_bank_count(const TriviaBank *bank);
+
+/**
+ * @brief Free a bank
+ *
+ * @param bank Bank with no live sessions (NULL is ignored)
+ */
+TRIVIA_API void trivia_bank_destroy(TriviaBank *bank);
+
+/**
+ * @brief Fill a config with the defaults (5 questions, 1 player, any difficulty)
+ *
+ * @param config Config to fill
+ */
+TRIVIA_API void trivia_session_config_default(TriviaSessionConfig *config);
+
+/**
+ * @brief Start a game over a bank
+ *
+ * @param bank Bank to draw from
+ * @param config Settings (NULL for the defaults)
+ * @param out Receives the session
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_session_create(TriviaBank *bank, const TriviaSessionConfig *config,
+                                              TriviaSession **out);
+
+/**
+ * @brief Draw the next question for the player whose turn it is
+ *
+ * Drawing again before answering skips the pending question.
+ *
+ * @param session Session
+ * @param out Receives the question
+ * @return TriviaStatus TRIVIA_OK, TRIVIA_DONE when the game is over, or an error
+ */
+TRIVIA_API TriviaStatus trivia_session_draw(TriviaSession *session, TriviaQuestion *out);
+
+/**
+ * @brief Grade an answer to the drawn question and pass the turn
+ *
+ * @param session Session
+ * @param choice Shown position chosen (1-4), 0 for a timeout
+ * @param time_remaining Seconds left on the host's clock, for the time bonus
+ * @param out Receives the outcome (may be NULL)
+ * @return TriviaStatus TRIVIA_OK, or TRIVIA_ERR_STATE with no question drawn
+ */
+TRIVIA_API TriviaStatus trivia_session_answer(TriviaSession *session, int choice,
+                                              int time_remaining, TriviaResult *out);
+
+/**
+ * @brief Totals of one player
+ *
+ * @param session Session
+ * @param player Player index (0-based)
+ * @param out Receives the totals
+ * @return TriviaStatus TRIVIA_OK, or an error
+ */
+TRIVIA_API TriviaStatus trivia_session_score(const TriviaSession *session, int player,
+                                             TriviaScore *out);
+
+/**
+ * @brief End a game and free the session
+ *
+ * @param session Session (NULL is ignored)
+ */
+TRIVIA_API void trivia_session_destroy(TriviaSession *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRIVIA_H */
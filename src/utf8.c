@@ -0,0 +1,250 @@
+/**
+ * @file utf8.c
+ * @brief Implementation of UTF-8 validation and display widths
+ */
+
+#include "utf8.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Inclusive code point range
+ */
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} CodepointRange;
+
+/** Combining marks and format characters drawn in zero columns. */
+static const CodepointRange ZERO_WIDTH[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0902 }, { 0x093A, 0x093A },
+    { 0x093C, 0x093C }, { 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 },
+    { 0x0962, 0x0963 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E },
+    { 0x1160, 0x11FF }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F },
+    { 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0x302A, 0x302D },
+    { 0x3099, 0x309A }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF },
+    { 0xE0100, 0xE01EF }
+};
+
+/** East Asian wide and fullwidth characters and emoji, drawn in two columns. */
+static const CodepointRange DOUBLE_WIDTH[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+    { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+    { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+    { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+    { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+    { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+    { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 },
+    { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x1F004, 0x1F004 },
+    { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 },
+    { 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF }, { 0x1F7E0, 0x1F7EB }, { 0x1F900, 0x1F9FF },
+    { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+static bool in_ranges(uint32_t cp, const CodepointRange *ranges, size_t count) {
+    if (cp < ranges[0].first || cp > ranges[count - 1].last) {
+        return false;
+    }
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cp > ranges[mid].last) {
+            lo = mid + 1;
+        } else if (cp < ranges[mid].first) {
+            hi = mid;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Length of the leading run of ASCII bytes
+ */
+static size_t ascii_prefix(const unsigned char *s, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(s + i));
+        if (_mm_movemask_epi8(chunk) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0) {
+            break;
+        }
+    }
+    while (i < len && s[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+bool utf8_validate(const char *s, size_t len) {
+    if (s == NULL) {
+        return len == 0;
+    }
+
+    const unsigned char *p = (const unsigned char*)s;
+    size_t i = 0;
+    while (i < len) {
+        i += ascii_prefix(p + i, len - i);
+        if (i >= len) {
+            break;
+        }
+
+        unsigned char c = p[i];
+        size_t need;
+        uint32_t cp;
+        uint32_t min;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1;
+            cp = c & 0x1F;
+            min = 0x80;
+        } else if ((c & 0xF0) == 0xE0) {
+            need = 2;
+            cp = c & 0x0F;
+            min = 0x800;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3;
+            cp = c & 0x07;
+            min = 0x10000;
+        } else {
+            return false;
+        }
+        if (len - i <= need) {
+            return false;
+        }
+        for (size_t k = 1; k <= need; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return false;
+        }
+        i += need + 1;
+    }
+    return true;
+}
+
+size_t utf8_decode(const char *s, uint32_t *cp) {
+    const unsigned char *p = (const unsigned char*)s;
+    if (p[0] < 0x80) {
+        *cp = p[0];
+        return 1;
+    }
+    if ((p[0] & 0xE0) == 0xC0 && (p[1] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if ((p[0] & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(p[0] & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    if ((p[0] & 0xF8) == 0xF0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80 &&
+        (p[3] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(p[0] & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) |
+              ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        return 4;
+    }
+    /* Stray byte: treat it as one replacement character. */
+    *cp = 0xFFFD;
+    return 1;
+}
+
+int utf8_codepoint_width(uint32_t cp) {
+    if (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) {
+        return 0;
+    }
+    if (cp < 0x300) {
+        return 1;
+    }
+    if (in_ranges(cp, ZERO_WIDTH, sizeof(ZERO_WIDTH) / sizeof(ZERO_WIDTH[0]))) {
+        return 0;
+    }
+    if (in_ranges(cp, DOUBLE_WIDTH, sizeof(DOUBLE_WIDTH) / sizeof(DOUBLE_WIDTH[0]))) {
+        return 2;
+    }
+    return 1;
+}
+
+int utf8_display_width(const char *s) {
+    if (s == NULL) {
+        return 0;
+    }
+
+    const unsigned char *p = (const unsigned char*)s;
+    size_t len = strlen(s);
+    size_t i = 0;
+    int width = 0;
+    while (i < len) {
+        size_t run = ascii_prefix(p + i, len - i);
+        for (size_t k = 0; k < run; k++) {
+            width += p[i + k] >= 0x20 && p[i + k] != 0x7F;
+        }
+        i += run;
+        if (i < len) {
+            uint32_t cp;
+            i += utf8_decode(s + i, &cp);
+            width += utf8_codepoint_width(cp);
+        }
+    }
+    return width;
+}
+
+size_t utf8_fit_width(const char *s, int max_cols, int *cols) {
+    size_t i = 0;
+    int used = 0;
+    while (s != NULL && s[i] != '\0') {
+        uint32_t cp;
+        size_t n = utf8_decode(s + i, &cp);
+        int w = utf8_codepoint_width(cp);
+        if (used + w > max_cols) {
+            break;
+        }
+        used += w;
+        i += n;
+    }
+    if (cols != NULL) {
+        *cols = used;
+    }
+    return i;
+}
+
+void utf8_trim_partial(char *s) {
+    if (s == NULL) {
+        return;
+    }
+    size_t len = strlen(s);
+    size_t start = len;
+    /* Walk back over at most three continuation bytes to the lead byte. */
+    while (start > 0 && len - start < 3 && ((unsigned char)s[start - 1] & 0xC0) == 0x80) {
+        start--;
+    }
+    if (start == 0) {
+        return;
+    }
+    unsigned char lead = (unsigned char)s[start - 1];
+    size_t expected = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    if (lead >= 0x80 && len - (start - 1) < expected) {
+        s[start - 1] = '\0';
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file utf8.h
+ * @brief UTF-8 validation and terminal display widths
+ * 
+ * This module handles:
+ * - Strict UTF-8 validation with an ASCII fast path (SSE2 when available,
+ *   eight bytes at a time otherwise)
+ * - Terminal column widths of code points (wide CJK, zero-width marks)
+ * - Fitting text into a number of columns at code point boundaries
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Check that a buffer is well-formed UTF-8
+ * 
+ * Rejects overlong encodings, surrogates and code points above U+10FFFF.
+ * 
+ * @param s Bytes to check
+ * @param len Number of bytes
+ * @return true if the buffer is valid UTF-8
+ */
+bool utf8_validate(const char *s, size_t len);
+
+/**
+ * @brief Decode one code point from valid UTF-8
+ * 
+ * @param s Pointer to the first byte of a sequence
+ * @param cp Receives the code point
+ * @return size_t Bytes consumed (1-4)
+ */
+size_t utf8_decode(const char *s, uint32_t *cp);
+
+/**
+ * @brief Terminal columns used by a code point
+ * 
+ * @param cp Code point
+ * @return int 0 for controls and combining marks, 2 for wide characters, else 1
+ */
+int utf8_codepoint_width(uint32_t cp);
+
+/**
+ * @brief Terminal columns used by a NUL-terminated valid UTF-8 string
+ * 
+ * @param s String to measure
+ * @return int Display width in columns
+ */
+int utf8_display_width(const char *s);
+
+/**
+ * @brief Longest prefix of a string that fits in a number of columns
+ * 
+ * Zero-width code points after the last fitting character are included,
+ * so combining marks stay with their base character.
+ * 
+ * @param s NUL-terminated valid UTF-8 string
+ * @param max_cols Available columns
+ * @param cols Receives the width of the prefix (may be NULL)
+ * @return size_t Length of the prefix in bytes
+ */
+size_t utf8_fit_width(const char *s, int max_cols, int *cols);
+
+/**
+ * @brief Drop an incomplete sequence left at the end of a truncated string
+ * 
+ * @param s NUL-terminated string, modified in place
+ */
+void utf8_trim_partial(char *s);
+
+#endif /* UTF8_H */
@@ -6,6 +6,7 @@
 #include "utils.h"
 #include <stdarg.h>
 #include <limits.h>
+#include <time.h>
 
 UtilsError read_input(char *buffer, size_t size) {
     if (buffer == NULL) {
@@ -70,13 +71,64 @@ int is_valid_integer(const char *str, int *value) {
     return 1;
 }
 
+UtilsError read_stream(FILE *file, char **data, size_t *len) {
+    if (file == NULL || data == NULL || len == NULL) {
+        return UTILS_ERROR_NULL_POINTER;
+    }
+    
+    size_t capacity = 64 * 1024;
+    size_t used = 0;
+    char *buffer = (char*)malloc(capacity);
+    if (buffer == NULL) {
+        return UTILS_ERROR_IO_FAILED;
+    }
+    
+    for (;;) {
+        if (used + 1 >= capacity) {
+            char *grown = (char*)realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                free(buffer);
+                return UTILS_ERROR_IO_FAILED;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        size_t n = fread(buffer + used, 1, capacity - used - 1, file);
+        used += n;
+        if (n == 0) {
+            break;
+        }
+    }
+    
+    if (ferror(file)) {
+        free(buffer);
+        return UTILS_ERROR_IO_FAILED;
+    }
+    
+    buffer[used] = '\0';
+    *data = buffer;
+    *len = used;
+    return UTILS_SUCCESS;
+}
+
+double monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
 void print_error(const char *format, ...) {
+#ifdef TRIVIA_LIBRARY
+    /* libtrivia reports errors through TriviaStatus, never on stderr. */
+    (void)format;
+#else
     va_list args;
     va_start(args, format);
     fprintf(stderr, "[ERROR] ");
     vfprintf(stderr, format, args);
     fprintf(stderr, "\n");
     va_end(args);
+#endif
 }
 
 void print_success(const char *format, ...) {
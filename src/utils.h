@@ -63,9 +63,31 @@ UtilsError sanitize_input(char *str);
  */
 int is_valid_integer(const char *str, int *value);
 
+/**
+ * @brief Read the remainder of a stream into a newly allocated buffer
+ * 
+ * The buffer is NUL-terminated (not counted in len) and must be freed
+ * by the caller.
+ * 
+ * @param file Stream to read
+ * @param data Receives the buffer
+ * @param len Receives the number of bytes read
+ * @return UtilsError UTILS_SUCCESS on success, error code otherwise
+ */
+UtilsError read_stream(FILE *file, char **data, size_t *len);
+
+/**
+ * @brief Monotonic clock reading in milliseconds
+ * 
+ * @return double Milliseconds since an arbitrary fixed point
+ */
+double monotonic_ms(void);
+
 /**
  * @brief Print an error message to stderr
  * 
+ * Silent in library builds (TRIVIA_LIBRARY).
+ * 
  * @param format printf-style format string
  * @param ... Variable arguments
  */
@@ -0,0 +1,570 @@
+/**
+ * @file websocket.c
+ * @brief Implementation of WebSocket framing, handshake and client
+ */
+
+#include "websocket.h"
+#include "utils.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/**
+ * @brief Largest upgrade request accepted
+ */
+#define WS_MAX_REQUEST 8192
+
+/**
+ * @brief Largest control frame payload (RFC 6455 5.5)
+ */
+#define WS_MAX_CONTROL 125
+
+int ws_parse_frame(const uint8_t *data, size_t len, WsFrame *frame) {
+    if (len < 2) {
+        return 0;
+    }
+    if ((data[0] & 0x70) != 0) {
+        return -1;
+    }
+    frame->fin = (data[0] & 0x80) != 0;
+    frame->opcode = data[0] & 0x0F;
+    frame->masked = (data[1] & 0x80) != 0;
+
+    uint64_t payload = data[1] & 0x7F;
+    if (frame->opcode >= WS_OP_CLOSE) {
+        if (!frame->fin || payload > WS_MAX_CONTROL || frame->opcode > WS_OP_PONG) {
+            return -1;
+        }
+    } else if (frame->opcode > WS_OP_BINARY) {
+        return -1;
+    }
+
+    size_t pos = 2;
+    if (payload == 126) {
+        if (len < 4) {
+            return 0;
+        }
+        payload = ((uint64_t)data[2] << 8) | data[3];
+        pos = 4;
+    } else if (payload == 127) {
+        if (len < 10) {
+            return 0;
+        }
+        payload = 0;
+        for (int i = 0; i < 8; i++) {
+            payload = (payload << 8) | data[2 + i];
+        }
+        if (payload >> 63) {
+            return -1;
+        }
+        pos = 10;
+    }
+
+    if (frame->masked) {
+        if (len < pos + 4) {
+            return 0;
+        }
+        memcpy(frame->mask, data + pos, 4);
+        pos += 4;
+    }
+    frame->payload_len = payload;
+    frame->header_len = pos;
+    return 1;
+}
+
+size_t ws_encode_header(uint8_t *out, uint8_t opcode, uint64_t payload_len, const uint8_t *mask) {
+    size_t pos = 2;
+    out[0] = (uint8_t)(0x80 | (opcode & 0x0F));
+    uint8_t mask_bit = mask != NULL ? 0x80 : 0;
+    if (payload_len < 126) {
+        out[1] = (uint8_t)(mask_bit | payload_len);
+    } else if (payload_len <= 0xFFFF) {
+        out[1] = (uint8_t)(mask_bit | 126);
+        out[2] = (uint8_t)(payload_len >> 8);
+        out[3] = (uint8_t)payload_len;
+        pos = 4;
+    } else {
+        out[1] = (uint8_t)(mask_bit | 127);
+        for (int i = 0; i < 8; i++) {
+            out[2 + i] = (uint8_t)(payload_len >> (56 - 8 * i));
+        }
+        pos = 10;
+    }
+    if (mask != NULL) {
+        memcpy(out + pos, mask, 4);
+        pos += 4;
+    }
+    return pos;
+}
+
+void ws_mask(uint8_t *data, size_t len, const uint8_t mask[4], uint64_t offset) {
+    /* Key bytes in the order they apply from data[0]. */
+    uint8_t key[4];
+    for (int i = 0; i < 4; i++) {
+        key[i] = mask[(offset + (uint64_t)i) & 3];
+    }
+    size_t i = 0;
+#if defined(__SSE2__)
+    if (len >= 16) {
+        uint32_t word;
+        memcpy(&word, key, 4);
+        const __m128i k = _mm_set1_epi32((int)word);
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v, k));
+        }
+    }
+#else
+    if (len >= 8) {
+        uint64_t word;
+        memcpy(&word, key, 4);
+        memcpy((uint8_t*)&word + 4, key, 4);
+        for (; i + 8 <= len; i += 8) {
+            uint64_t v;
+            memcpy(&v, data + i, 8);
+            v ^= word;
+            memcpy(data + i, &v, 8);
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        data[i] ^= key[i & 3];
+    }
+}
+
+/**
+ * @brief SHA-1 of a short message (the handshake needs nothing longer)
+ */
+static void sha1(const uint8_t *msg, size_t len, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u };
+    uint64_t bits = (uint64_t)len * 8;
+    size_t total = ((len + 8) / 64 + 1) * 64;
+
+    for (size_t block = 0; block < total; block += 64) {
+        uint8_t chunk[64];
+        for (size_t i = 0; i < 64; i++) {
+            size_t pos = block + i;
+            if (pos < len) {
+                chunk[i] = msg[pos];
+            } else if (pos == len) {
+                chunk[i] = 0x80;
+            } else if (pos >= total - 8) {
+                chunk[i] = (uint8_t)(bits >> (8 * (total - 1 - pos)));
+            } else {
+                chunk[i] = 0;
+            }
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)chunk[4 * i] << 24) | ((uint32_t)chunk[4 * i + 1] << 16) |
+                   ((uint32_t)chunk[4 * i + 2] << 8) | chunk[4 * i + 3];
+        }
+        for (int i = 16; i < 80; i++) {
+            uint32_t x = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (x << 1) | (x >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999u;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1u;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDCu;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6u;
+            }
+            uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i] = (uint8_t)(h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+/**
+ * @brief Base64-encode @p len bytes; out needs 4 * ceil(len / 3) + 1 bytes
+ */
+static void base64_encode(const uint8_t *data, size_t len, char *out) {
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) {
+            v |= (uint32_t)data[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= data[i + 2];
+        }
+        out[o++] = table[(v >> 18) & 63];
+        out[o++] = table[(v >> 12) & 63];
+        out[o++] = i + 1 < len ? table[(v >> 6) & 63] : '=';
+        out[o++] = i + 2 < len ? table[v & 63] : '=';
+    }
+    out[o] = '\0';
+}
+
+void ws_accept_key(const char *key, char out[WS_ACCEPT_LEN]) {
+    char joined[WS_MAX_KEY + sizeof(WS_GUID)];
+    int n = snprintf(joined, sizeof(joined), "%s%s", key, WS_GUID);
+    uint8_t digest[20];
+    sha1((const uint8_t*)joined, n > 0 ? (size_t)n : 0, digest);
+    base64_encode(digest, sizeof(digest), out);
+}
+
+/**
+ * @brief Whether a header value contains @p token (case-insensitive)
+ */
+static bool header_has_token(const char *value, size_t len, const char *token) {
+    size_t tlen = strlen(token);
+    for (size_t i = 0; i + tlen <= len; i++) {
+        if (strncasecmp(value + i, token, tlen) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ws_parse_handshake(const char *request, size_t len, char key[WS_MAX_KEY],
+                       size_t *request_len) {
+    const char *end = NULL;
+    for (size_t i = 0; i + 4 <= len; i++) {
+        if (memcmp(request + i, "\r\n\r\n", 4) == 0) {
+            end = request + i + 4;
+            break;
+        }
+    }
+    if (end == NULL) {
+        return len >= WS_MAX_REQUEST ? -1 : 0;
+    }
+    if (len < 4 || strncmp(request, "GET ", 4) != 0) {
+        return -1;
+    }
+
+    bool upgrade = false;
+    bool version = false;
+    key[0] = '\0';
+    const char *line = memchr(request, '\n', (size_t)(end - request));
+    while (line != NULL && line + 1 < end) {
+        line++;
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        if (eol == NULL) {
+            break;
+        }
+        const char *colon = memchr(line, ':', (size_t)(eol - line));
+        if (colon != NULL) {
+            size_t name_len = (size_t)(colon - line);
+            const char *value = colon + 1;
+            while (value < eol && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            size_t value_len = (size_t)(eol - value);
+            while (value_len > 0 && (value[value_len - 1] == '\r' || value[value_len - 1] == ' ')) {
+                value_len--;
+            }
+            if (name_len == 7 && strncasecmp(line, "Upgrade", 7) == 0) {
+                upgrade = header_has_token(value, value_len, "websocket");
+            } else if (name_len == 21 && strncasecmp(line, "Sec-WebSocket-Version", 21) == 0) {
+                version = value_len == 2 && strncmp(value, "13", 2) == 0;
+            } else if (name_len == 17 && strncasecmp(line, "Sec-WebSocket-Key", 17) == 0) {
+                if (value_len == 0 || value_len >= WS_MAX_KEY) {
+                    return -1;
+                }
+                memcpy(key, value, value_len);
+                key[value_len] = '\0';
+            }
+        }
+        line = eol;
+    }
+
+    *request_len = (size_t)(end - request);
+    return upgrade && version && key[0] != '\0' ? 1 : -1;
+}
+
+int ws_handshake_response(const char *key, char *out, size_t cap) {
+    char accept[WS_ACCEPT_LEN];
+    ws_accept_key(key, accept);
+    int n = snprintf(out, cap,
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    return n > 0 && (size_t)n < cap ? n : -1;
+}
+
+/**
+ * @brief Whether @p needle occurs in the first @p len bytes of @p data
+ */
+static bool contains(const uint8_t *data, size_t len, const char *needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(data + i, needle, n) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write all of @p len bytes to a blocking socket
+ */
+static int send_all(int fd, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read more bytes into the client buffer
+ *
+ * @return int 1 if bytes arrived, 0 on timeout, -1 on close or error
+ */
+static int client_fill(WsClient *client, int timeout_ms) {
+    if (client->len == client->cap) {
+        size_t cap = client->cap * 2;
+        uint8_t *grown = (uint8_t*)realloc(client->buf, cap);
+        if (grown == NULL) {
+            return -1;
+        }
+        client->buf = grown;
+        client->cap = cap;
+    }
+    struct pollfd pfd = { client->fd, POLLIN, 0 };
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    if (ready <= 0) {
+        return ready;
+    }
+    ssize_t n = recv(client->fd, client->buf + client->len, client->cap - client->len, 0);
+    if (n <= 0) {
+        return -1;
+    }
+    client->len += (size_t)n;
+    return 1;
+}
+
+static uint32_t client_random(WsClient *client) {
+    uint32_t x = client->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    client->rng = x;
+    return x;
+}
+
+int ws_client_connect(WsClient *client, const char *host, int port) {
+    client->fd = -1;
+    client->len = 0;
+    client->cap = 4096;
+    client->buf = (uint8_t*)malloc(client->cap);
+    client->rng = (uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16) ^ (uint32_t)(uintptr_t)client;
+    if (client->rng == 0) {
+        client->rng = 0x9e3779b9u;
+    }
+    if (client->buf == NULL) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        print_error("Invalid address: %s", host);
+        ws_client_close(client);
+        return -1;
+    }
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client->fd < 0 || connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ws_client_close(client);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t nonce[16];
+    for (int i = 0; i < 16; i += 4) {
+        uint32_t r = client_random(client);
+        memcpy(nonce + i, &r, 4);
+    }
+    char key[WS_MAX_KEY];
+    base64_encode(nonce, sizeof(nonce), key);
+    char request[256];
+    int n = snprintf(request, sizeof(request),
+                     "GET /play HTTP/1.1\r\n"
+                     "Host: %s:%d\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n\r\n", host, port, key);
+    if (send_all(client->fd, request, (size_t)n) != 0) {
+        ws_client_close(client);
+        return -1;
+    }
+
+    char expected[WS_ACCEPT_LEN];
+    ws_accept_key(key, expected);
+    for (;;) {
+        uint8_t *end = NULL;
+        for (size_t i = 0; i + 4 <= client->len; i++) {
+            if (memcmp(client->buf + i, "\r\n\r\n", 4) == 0) {
+                end = client->buf + i + 4;
+                break;
+            }
+        }
+        if (end != NULL) {
+            size_t header_len = (size_t)(end - client->buf);
+            bool ok = header_len > 12 && memcmp(client->buf, "HTTP/1.1 101", 12) == 0 &&
+                      contains(client->buf, header_len, expected);
+            if (!ok) {
+                ws_client_close(client);
+                return -1;
+            }
+            memmove(client->buf, end, client->len - header_len);
+            client->len -= header_len;
+            return 0;
+        }
+        if (client_fill(client, 5000) <= 0) {
+            ws_client_close(client);
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Send one masked frame of any opcode
+ */
+static int client_send_frame(WsClient *client, uint8_t opcode, const void *payload, size_t len) {
+    uint8_t mask[4];
+    uint32_t r = client_random(client);
+    memcpy(mask, &r, 4);
+    uint8_t header[WS_MAX_HEADER];
+    size_t header_len = ws_encode_header(header, opcode, len, mask);
+
+    uint8_t stack[512];
+    uint8_t *frame = header_len + len <= sizeof(stack) ? stack : (uint8_t*)malloc(header_len + len);
+    if (frame == NULL) {
+        return -1;
+    }
+    memcpy(frame, header, header_len);
+    if (len > 0) {
+        memcpy(frame + header_len, payload, len);
+    }
+    ws_mask(frame + header_len, len, mask, 0);
+    int rc = send_all(client->fd, frame, header_len + len);
+    if (frame != stack) {
+        free(frame);
+    }
+    return rc;
+}
+
+int ws_client_send_text(WsClient *client, const char *text, size_t len) {
+    if (client == NULL || client->fd < 0) {
+        return -1;
+    }
+    return client_send_frame(client, WS_OP_TEXT, text, len);
+}
+
+int ws_client_recv(WsClient *client, char *out, size_t cap, int timeout_ms) {
+    if (client == NULL || client->fd < 0 || cap == 0) {
+        return -1;
+    }
+    for (;;) {
+        WsFrame frame;
+        int parsed = ws_parse_frame(client->buf, client->len, &frame);
+        if (parsed < 0) {
+            return -1;
+        }
+        if (parsed > 0 && client->len >= frame.header_len + frame.payload_len) {
+            uint8_t *payload = client->buf + frame.header_len;
+            size_t plen = (size_t)frame.payload_len;
+            if (frame.masked) {
+                ws_mask(payload, plen, frame.mask, 0);
+            }
+            int result = -2;
+            if (frame.opcode == WS_OP_TEXT || frame.opcode == WS_OP_BINARY) {
+                size_t n = plen < cap - 1 ? plen : cap - 1;
+                memcpy(out, payload, n);
+                out[n] = '\0';
+                result = (int)n;
+            } else if (frame.opcode == WS_OP_PING) {
+                client_send_frame(client, WS_OP_PONG, payload, plen);
+            } else if (frame.opcode == WS_OP_CLOSE) {
+                result = -1;
+            }
+            size_t used = frame.header_len + plen;
+            memmove(client->buf, client->buf + used, client->len - used);
+            client->len -= used;
+            if (result != -2) {
+                return result;
+            }
+            continue;
+        }
+        int filled = client_fill(client, timeout_ms);
+        if (filled <= 0) {
+            return filled;
+        }
+    }
+}
+
+void ws_client_close(WsClient *client) {
+    if (client == NULL) {
+        return;
+    }
+    if (client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+    }
+    free(client->buf);
+    client->buf = NULL;
+    client->len = 0;
+    client->cap = 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file websocket.h
+ * @brief WebSocket (RFC 6455) framing, handshake and a minimal client
+ *
+ * Frame headers are parsed from and encoded into caller buffers without
+ * allocating, and payloads are masked or unmasked in place, 16 bytes at a
+ * time with SSE2 where available. The client half is what the loopback
+ * tests and trivia-wsclient use to talk to trivia-server.
+ */
+
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Longest frame header (2 + 8 byte length + 4 byte mask)
+ */
+#define WS_MAX_HEADER 14
+
+/**
+ * @brief Length of a Sec-WebSocket-Accept value plus its NUL
+ */
+#define WS_ACCEPT_LEN 29
+
+/**
+ * @brief Longest Sec-WebSocket-Key accepted (base64 of 16 bytes is 24)
+ */
+#define WS_MAX_KEY 64
+
+/**
+ * @brief Frame opcodes
+ */
+typedef enum {
+    WS_OP_CONTINUATION = 0x0,
+    WS_OP_TEXT = 0x1,
+    WS_OP_BINARY = 0x2,
+    WS_OP_CLOSE = 0x8,
+    WS_OP_PING = 0x9,
+    WS_OP_PONG = 0xA
+} WsOpcode;
+
+/**
+ * @brief Parsed frame header
+ */
+typedef struct {
+    bool fin;                             /**< Final fragment */
+    uint8_t opcode;                       /**< WsOpcode */
+    bool masked;                          /**< Payload is masked (client to server) */
+    uint8_t mask[4];                      /**< Masking key when masked */
+    uint64_t payload_len;                 /**< Payload bytes after the header */
+    size_t header_len;                    /**< Header bytes */
+} WsFrame;
+
+/**
+ * @brief Parse a frame header at the start of a buffer
+ *
+ * @param data Received bytes
+ * @param len Number of bytes available
+ * @param frame Receives the header
+ * @return int 1 when the header is complete, 0 if more bytes are needed,
+ *         -1 on a protocol error (reserved bits, bad control frame)
+ */
+int ws_parse_frame(const uint8_t *data, size_t len, WsFrame *frame);
+
+/**
+ * @brief Encode a final frame header
+ *
+ * @param out Buffer of at least WS_MAX_HEADER bytes
+ * @param opcode WsOpcode
+ * @param payload_len Payload bytes that will follow
+ * @param mask Masking key (clients), NULL for an unmasked server frame
+ * @return size_t Header bytes written
+ */
+size_t ws_encode_header(uint8_t *out, uint8_t opcode, uint64_t payload_len, const uint8_t *mask);
+
+/**
+ * @brief XOR a payload with its masking key in place
+ *
+ * Masking and unmasking are the same operation. @p offset is the position
+ * of data[0] within the payload, so a payload can be unmasked in pieces
+ * as it arrives.
+ *
+ * @param data Payload bytes
+ * @param len Number of bytes
+ * @param mask Masking key
+ * @param offset Payload position of data[0]
+ */
+void ws_mask(uint8_t *data, size_t len, const uint8_t mask[4], uint64_t offset);
+
+/**
+ * @brief Compute the Sec-WebSocket-Accept value for a client key
+ *
+ * @param key Sec-WebSocket-Key from the request
+ * @param out Receives the NUL-terminated base64 value
+ */
+void ws_accept_key(const char *key, char out[WS_ACCEPT_LEN]);
+
+/**
+ * @brief Parse an HTTP upgrade request
+ *
+ * @param request Received bytes (need not be NUL-terminated)
+ * @param len Number of bytes available
+ * @param key Receives the Sec-WebSocket-Key (WS_MAX_KEY bytes)
+ * @param request_len Receives the request length including the blank line
+ * @return int 1 for a complete upgrade request, 0 if the headers are not
+ *         complete yet, -1 if it is not a valid WebSocket upgrade
+ */
+int ws_parse_handshake(const char *request, size_t len, char key[WS_MAX_KEY],
+                       size_t *request_len);
+
+/**
+ * @brief Format the 101 Switching Protocols response
+ *
+ * @param key Client key from the request
+ * @param out Output buffer
+ * @param cap Size of out
+ * @return int Response length, -1 if it does not fit
+ */
+int ws_handshake_response(const char *key, char *out, size_t cap);
+
+/**
+ * @brief Blocking WebSocket client connection
+ */
+typedef struct {
+    int fd;                               /**< Connected socket, -1 when closed */
+    uint8_t *buf;                         /**< Received bytes not yet returned */
+    size_t len;                           /**< Bytes in buf */
+    size_t cap;                           /**< Size of buf */
+    uint32_t rng;                         /**< Masking key generator state */
+} WsClient;
+
+/**
+ * @brief Connect and complete the opening handshake
+ *
+ * @param client Client to initialize
+ * @param host IPv4 address to connect to
+ * @param port TCP port
+ * @return int 0 on success, -1 on error
+ */
+int ws_client_connect(WsClient *client, const char *host, int port);
+
+/**
+ * @brief Send one masked text frame
+ *
+ * @param client Connected client
+ * @param text Payload
+ * @param len Payload length
+ * @return int 0 on success, -1 on error
+ */
+int ws_client_send_text(WsClient *client, const char *text, size_t len);
+
+/**
+ * @brief Receive the next text message, answering pings on the way
+ *
+ * @param client Connected client
+ * @param out Receives the NUL-terminated payload
+ * @param cap Size of out
+ * @param timeout_ms Milliseconds to wait, -1 to wait forever
+ * @return int Payload length, 0 on timeout, -1 on close or error
+ */
+int ws_client_recv(WsClient *client, char *out, size_t cap, int timeout_ms);
+
+/**
+ * @brief Close the connection and free the client's buffer
+ *
+ * @param client Client (safe to call twice)
+ */
+void ws_client_close(WsClient *client);
+
+#endif /* WEBSOCKET_H */
@@ -0,0 +1,207 @@
+/**
+ * @file test_events.c
+ * @brief Unit tests for the MPSC event queues
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../src/events.h"
+
+#define EVENT_TEST_PRODUCERS 4
+#define EVENT_TEST_PER_PRODUCER 50000
+
+/**
+ * @brief Test single-threaded order, capacity and batching
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_event_queue_basic(void) {
+    int failures = 0;
+    EventQueue queue;
+    if (event_queue_init(&queue, 6) != 0) {
+        printf("  ❌ test_event_queue_basic: Failed to create queue\n");
+        return 1;
+    }
+    
+    GameEvent event = { 0, EVENT_ANSWER, 0, 0, 0 };
+    int pushed = 0;
+    for (int i = 0; i < 10; i++) {
+        event.value = i;
+        pushed += event_queue_push(&queue, &event);
+    }
+    if (pushed != 8) {
+        printf("  ❌ test_event_queue_basic: Capacity not rounded to 8 (%d pushed)\n", pushed);
+        failures++;
+    }
+    
+    GameEvent out[8];
+    size_t n = event_queue_pop(&queue, out, 3);
+    if (n != 3 || out[0].value != 0 || out[2].value != 2) {
+        printf("  ❌ test_event_queue_basic: Batch of 3 popped wrong\n");
+        failures++;
+    }
+    /* Freed cells are reusable after wrapping around. */
+    for (int i = 8; i < 11; i++) {
+        event.value = i;
+        if (!event_queue_push(&queue, &event)) {
+            printf("  ❌ test_event_queue_basic: Freed cell not reused\n");
+            failures++;
+            break;
+        }
+    }
+    n = event_queue_pop(&queue, out, 8);
+    for (size_t i = 0; i < n; i++) {
+        if (out[i].value != (int32_t)i + 3) {
+            printf("  ❌ test_event_queue_basic: Events out of order after wrap\n");
+            failures++;
+            break;
+        }
+    }
+    if (n != 8 || event_queue_wait(&queue, out, 8, 10) != 0) {
+        printf("  ❌ test_event_queue_basic: Wrong count or wait did not time out\n");
+        failures++;
+    }
+    
+    event_queue_destroy(&queue);
+    if (failures == 0) {
+        printf("  ✅ test_event_queue_basic: PASSED\n");
+    }
+    return failures;
+}
+
+typedef struct {
+    EventQueue *queue;
+    uint32_t id;
+} Producer;
+
+static void* producer_main(void *arg) {
+    Producer *p = (Producer*)arg;
+    GameEvent event = { 0, EVENT_ANSWER, 0, 0, p->id };
+    for (int i = 0; i < EVENT_TEST_PER_PRODUCER; i++) {
+        event.value = i;
+        while (!event_queue_push(p->queue, &event)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Test concurrent producers against a sleeping consumer
+ * 
+ * Every event must arrive exactly once and each producer's events in
+ * the order they were pushed.
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_event_queue_producers(void) {
+    int failures = 0;
+    EventQueue queue;
+    if (event_queue_init(&queue, 256) != 0) {
+        printf("  ❌ test_event_queue_producers: Failed to create queue\n");
+        return 1;
+    }
+    
+    Producer producers[EVENT_TEST_PRODUCERS];
+    pthread_t threads[EVENT_TEST_PRODUCERS];
+    for (int p = 0; p < EVENT_TEST_PRODUCERS; p++) {
+        producers[p].queue = &queue;
+        producers[p].id = (uint32_t)p;
+        pthread_create(&threads[p], NULL, producer_main, &producers[p]);
+    }
+    
+    int32_t next[EVENT_TEST_PRODUCERS] = { 0 };
+    long received = 0;
+    long expected = (long)EVENT_TEST_PRODUCERS * EVENT_TEST_PER_PRODUCER;
+    int idle = 0;
+    GameEvent batch[32];
+    while (received < expected && idle < 50) {
+        size_t n = event_queue_wait(&queue, batch, 32, 100);
+        idle = n == 0 ? idle + 1 : 0;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t id = batch[i].source;
+            if (id >= EVENT_TEST_PRODUCERS || batch[i].value != next[id]) {
+                failures++;
+                continue;
+            }
+            next[id]++;
+        }
+        received += (long)n;
+    }
+    for (int p = 0; p < EVENT_TEST_PRODUCERS; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    
+    if (failures > 0) {
+        printf("  ❌ test_event_queue_producers: %d event(s) lost, repeated or reordered\n",
+               failures);
+    } else if (received != expected) {
+        printf("  ❌ test_event_queue_producers: Received %ld of %ld events\n",
+               received, expected);
+        failures++;
+    }
+    
+    event_queue_destroy(&queue);
+    if (failures == 0) {
+        printf("  ✅ test_event_queue_producers: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test events reach the queue of the session's owner
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_event_router(void) {
+    int failures = 0;
+    EventRouter router;
+    if (event_router_init(&router, 3, 16) != 0) {
+        printf("  ❌ test_event_router: Failed to create router\n");
+        return 1;
+    }
+    
+    for (uint32_t session = 0; session < 9; session++) {
+        GameEvent event = { session, EVENT_CONNECT, 0, 0, 0 };
+        event_router_send(&router, &event);
+    }
+    for (int w = 0; w < 3; w++) {
+        GameEvent out[16];
+        size_t n = event_queue_pop(&router.queues[w], out, 16);
+        if (n != 3) {
+            printf("  ❌ test_event_router: Worker %d got %zu events\n", w, n);
+            failures++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (event_router_owner(&router, out[i].session) != w) {
+                printf("  ❌ test_event_router: Session %u reached the wrong worker\n",
+                       out[i].session);
+                failures++;
+            }
+        }
+    }
+    
+    event_router_destroy(&router);
+    if (failures == 0) {
+        printf("  ✅ test_event_router: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all event queue tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_events(void) {
+    int failures = 0;
+    
+    failures += test_event_queue_basic();
+    failures += test_event_queue_producers();
+    failures += test_event_router();
+    
+    return failures;
+}
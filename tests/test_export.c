@@ -0,0 +1,361 @@
+/**
+ * @file test_export.c
+ * @brief Unit tests for bank export and binary packs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/questions.h"
+#include "../src/export.h"
+#include "../src/pack.h"
+
+static const char *const EXPORT_SOURCE =
+    "[\n"
+    "  {\"id\": 7, \"question\": \"What is 2 + 2?\", \"options\": [\"3\", \"4\"],"
+    " \"correct\": 1, \"difficulty\": \"easy\"},\n"
+    "  {\"id\": 8, \"question\": \"Symbol for gold?\", \"options\": [\"Au\", \"Ag\", \"Fe\"],"
+    " \"correct\": 0, \"difficulty\": \"hard\", \"category\": \"science\"},\n"
+    "  {\"id\": 9, \"question\": \"Año de la caída de Constantinopla?\","
+    " \"options\": [\"1453\", \"1492\", \"1204\", \"1071\"], \"correct\": 0,"
+    " \"difficulty\": \"hard\", \"category\": \"history\"}\n"
+    "]\n";
+
+/**
+ * @brief Export a bank into a temporary file and read it back
+ *
+ * @return char* Exported bytes (caller frees), NULL on error
+ */
+static char* export_to_memory(const QuestionBank *bank, const ExportFilter *filter,
+                              ExportFormat format, long *count, size_t *len) {
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        return NULL;
+    }
+    /* A small buffer forces several flushes even for a tiny bank. */
+    ExportWriter writer;
+    if (export_writer_init(&writer, 1) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    *count = export_bank(&writer, fileno(file), bank, filter, format);
+    *len = (size_t)writer.written;
+    export_writer_free(&writer);
+
+    char *data = (char*)malloc(*len + 1);
+    if (data == NULL || *count < 0 || pread(fileno(file), data, *len, 0) != (ssize_t)*len) {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    data[*len] = '\0';
+    fclose(file);
+    return data;
+}
+
+static bool same_question(const Question *a, const Question *b) {
+    if (a->id != b->id || strcmp(a->question, b->question) != 0 ||
+        a->correct_answer != b->correct_answer || a->difficulty != b->difficulty ||
+        a->category != b->category || a->question_width != b->question_width) {
+        return false;
+    }
+    for (int i = 0; i < MAX_OPTIONS; i++) {
+        if (strcmp(a->options[i], b->options[i]) != 0 ||
+            a->option_widths[i] != b->option_widths[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_bank(const QuestionBank *a, const QuestionBank *b) {
+    if (a->count != b->count) {
+        return false;
+    }
+    for (size_t i = 0; i < a->count; i++) {
+        if (!same_question(&a->questions[i], &b->questions[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Test that every format reloads to the same questions
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_export_round_trip(void) {
+    static const char *const names[] = { "json", "jsonl", "pack" };
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0 ||
+        question_bank_load_from_buffer(&bank, EXPORT_SOURCE, strlen(EXPORT_SOURCE)) != 3) {
+        printf("  ❌ test_export_round_trip: Failed to load source\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    int failures = 0;
+    if (bank.questions[1].category != CATEGORY_SCIENCE ||
+        bank.questions[2].category != CATEGORY_HISTORY) {
+        printf("  ❌ test_export_round_trip: Categories not loaded\n");
+        failures++;
+    }
+    
+    for (int format = EXPORT_JSON; format <= EXPORT_PACK; format++) {
+        long count = 0;
+        size_t len = 0;
+        char *data = export_to_memory(&bank, NULL, (ExportFormat)format, &count, &len);
+        QuestionBank copy;
+        question_bank_init(&copy);
+        int loaded = -1;
+        if (data != NULL) {
+            loaded = format == EXPORT_PACK ? pack_load_from_buffer(&copy, data, len)
+                                           : question_bank_load_from_buffer(&copy, data, len);
+        }
+        if (count != 3 || loaded != 3 || !same_bank(&bank, &copy)) {
+            printf("  ❌ test_export_round_trip: %s export does not reload\n", names[format]);
+            failures++;
+        }
+        free(data);
+        question_bank_free(&copy);
+    }
+    
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_export_round_trip: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that bank text is escaped into valid JSON string content
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_export_json_escape(void) {
+    static const char *const cases[][2] = {
+        { "plain text", "plain text" },
+        { "kept \\n and \\u00e9 and \\\\", "kept \\n and \\u00e9 and \\\\" },
+        { "stray \\q", "stray \\\\q" },
+        { "bad \\u00g9", "bad \\\\u00g9" },
+        { "ends in \\", "ends in \\\\" },
+        { "ends in \\\\\\", "ends in \\\\\\\\" },
+        { "say \"hi\"", "say \\\"hi\\\"" },
+        { "tab\there", "tab\\u0009here" },
+        { "sixteen bytes ok then \\x", "sixteen bytes ok then \\\\x" },
+    };
+    int failures = 0;
+    char out[256];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t n = export_json_escape(out, cases[i][0], strlen(cases[i][0]));
+        out[n] = '\0';
+        if (strcmp(out, cases[i][1]) != 0) {
+            printf("  ❌ test_export_json_escape: \"%s\" gave \"%s\"\n", cases[i][0], out);
+            failures++;
+        }
+    }
+
+    /* Negative answers are written signed, not wrapped to 4294967295. */
+    QuestionBank bank;
+    question_bank_init(&bank);
+    question_bank_load_from_buffer(&bank, EXPORT_SOURCE, strlen(EXPORT_SOURCE));
+    bank.questions[0].correct_answer = -1;
+    long count = 0;
+    size_t len = 0;
+    char *data = export_to_memory(&bank, NULL, EXPORT_JSONL, &count, &len);
+    if (data == NULL || strstr(data, "\"correct\":-1,") == NULL) {
+        printf("  ❌ test_export_json_escape: Negative answer not written signed\n");
+        failures++;
+    }
+    free(data);
+    question_bank_free(&bank);
+
+    if (failures == 0) {
+        printf("  ✅ test_export_json_escape: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test difficulty, category and ID filters
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_export_filters(void) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    question_bank_load_from_buffer(&bank, EXPORT_SOURCE, strlen(EXPORT_SOURCE));
+    
+    int failures = 0;
+    ExportFilter filter;
+    long count = 0;
+    size_t len = 0;
+    
+    export_filter_init(&filter);
+    filter.difficulty = DIFFICULTY_HARD;
+    char *data = export_to_memory(&bank, &filter, EXPORT_JSONL, &count, &len);
+    if (data == NULL || count != 2 || strstr(data, "\"id\":8") == NULL ||
+        strstr(data, "\"id\":7") != NULL) {
+        printf("  ❌ test_export_filters: Difficulty filter\n");
+        failures++;
+    }
+    free(data);
+    
+    filter.category = CATEGORY_HISTORY;
+    data = export_to_memory(&bank, &filter, EXPORT_JSONL, &count, &len);
+    if (data == NULL || count != 1 || strstr(data, "\"id\":9") == NULL) {
+        printf("  ❌ test_export_filters: Category filter\n");
+        failures++;
+    }
+    free(data);
+    
+    const uint32_t ids[] = { 9, 7, 42 };
+    export_filter_init(&filter);
+    filter.ids = ids;
+    filter.id_count = 3;
+    data = export_to_memory(&bank, &filter, EXPORT_PACK, &count, &len);
+    if (data == NULL || count != 2 || pack_check(data, len) != 2) {
+        printf("  ❌ test_export_filters: ID filter\n");
+        failures++;
+    } else {
+        Question q;
+        pack_read_question(data, 1, &q);
+        if (q.id != 9 || strcmp(q.options[3], "1071") != 0) {
+            printf("  ❌ test_export_filters: ID filter kept the wrong questions\n");
+            failures++;
+        }
+    }
+    free(data);
+    
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_export_filters: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that damaged packs are rejected
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_pack_rejects_damage(void) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    question_bank_load_from_buffer(&bank, EXPORT_SOURCE, strlen(EXPORT_SOURCE));
+    long count = 0;
+    size_t len = 0;
+    char *data = export_to_memory(&bank, NULL, EXPORT_PACK, &count, &len);
+    question_bank_free(&bank);
+    if (data == NULL || pack_check(data, len) != 3) {
+        printf("  ❌ test_pack_rejects_damage: Export failed\n");
+        free(data);
+        return -1;
+    }
+    
+    int failures = 0;
+    if (pack_check(data, len - 1) != -1) {
+        printf("  ❌ test_pack_rejects_damage: Truncated pack accepted\n");
+        failures++;
+    }
+    PackRecord *records = (PackRecord*)(data + sizeof(PackHeader));
+    records[1].correct = 5;
+    if (pack_check(data, len) != -1) {
+        printf("  ❌ test_pack_rejects_damage: Out-of-range answer accepted\n");
+        failures++;
+    }
+    records[1].correct = 0;
+    records[2].lengths[0]++;
+    if (pack_check(data, len) != -1) {
+        printf("  ❌ test_pack_rejects_damage: Wrong string length accepted\n");
+        failures++;
+    }
+    
+    free(data);
+    if (failures == 0) {
+        printf("  ✅ test_pack_rejects_damage: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test mapping a pack with huge-page alignment and prefaulting
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_pack_mapping(void) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    question_bank_load_from_buffer(&bank, EXPORT_SOURCE, strlen(EXPORT_SOURCE));
+    FILE *file = tmpfile();
+    ExportWriter writer;
+    if (file == NULL || export_writer_init(&writer, 0) != 0) {
+        printf("  ❌ test_pack_mapping: Setup failed\n");
+        question_bank_free(&bank);
+        if (file != NULL) {
+            fclose(file);
+        }
+        return -1;
+    }
+    export_bank(&writer, fileno(file), &bank, NULL, EXPORT_PACK);
+    export_writer_free(&writer);
+    
+    int failures = 0;
+    PackMapping map;
+    if (pack_map(&map, fileno(file), true) != 0) {
+        printf("  ❌ test_pack_mapping: Failed to map pack\n");
+        question_bank_free(&bank);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    if ((uintptr_t)map.data % PACK_HUGE_PAGE_SIZE != 0) {
+        printf("  ❌ test_pack_mapping: Mapping not aligned for huge pages\n");
+        failures++;
+    }
+    /* The kernel may refuse huge pages; the mapping must stay usable. */
+    pack_map_huge_pages(&map);
+    if (pack_map_prefault_start(&map) != 0) {
+        printf("  ❌ test_pack_mapping: Prefault thread not started\n");
+        failures++;
+    }
+    
+    QuestionBank copy;
+    question_bank_init(&copy);
+    if (pack_load_from_buffer(&copy, map.data, map.len) != 3 || !same_bank(&bank, &copy)) {
+        printf("  ❌ test_pack_mapping: Mapped pack loaded wrong\n");
+        failures++;
+    }
+    pack_map_prefault_wait(&map);
+    if (map.prefaulting || map.prefault_ms < 0.0) {
+        printf("  ❌ test_pack_mapping: Prefault thread not joined\n");
+        failures++;
+    }
+    pack_unmap(&map);
+    
+    question_bank_free(&copy);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_pack_mapping: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all export tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_export(void) {
+    int failures = 0;
+    
+    failures += test_export_round_trip();
+    failures += test_export_json_escape();
+    failures += test_export_filters();
+    failures += test_pack_rejects_damage();
+    failures += test_pack_mapping();
+    
+    return failures;
+}
@@ -0,0 +1,281 @@
+/**
+ * @file test_game.c
+ * @brief Unit tests for the game engine
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/game.h"
+
+/**
+ * @brief Build a bank of questions with the given option count
+ */
+static int make_bank(QuestionBank *bank, int count, int options) {
+    if (question_bank_init(bank) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Question %d?", i);
+        for (int o = 0; o < options; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Option %d", o);
+        }
+        q.correct_answer = i % options;
+        q.difficulty = DIFFICULTY_EASY;
+        if (question_bank_add(bank, &q) != 0) {
+            return -1;
+        }
+    }
+    return question_bank_build_index(bank);
+}
+
+/**
+ * @brief Test that shuffled options are graded by displayed position
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_game_option_shuffle(void) {
+    QuestionBank bank;
+    if (make_bank(&bank, 2000, MAX_OPTIONS) != 0) {
+        printf("  ❌ test_game_option_shuffle: Failed to build bank\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    GameConfig config;
+    memset(&config, 0, sizeof(config));
+    config.questions_per_game = 2000;
+    config.time_per_question = 30;
+    config.difficulty = (Difficulty)-1;
+    config.num_players = 1;
+    config.shuffle_options = true;
+    GameState game;
+    if (game_init(&game, &bank, &config) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    int failures = 0;
+    bool seen[MAX_OPTIONS][MAX_OPTIONS] = { { false } };
+    int first_slot_correct = 0;
+    for (int i = 0; i < 2000 && failures == 0; i++) {
+        Question *q = game_draw_question(&game);
+        if (q == NULL) {
+            printf("  ❌ test_game_option_shuffle: Ran out of questions\n");
+            failures++;
+            break;
+        }
+        for (int slot = 0; slot < MAX_OPTIONS; slot++) {
+            int option = game.option_order[slot];
+            if (game_option_choice(&game, option) != slot + 1) {
+                printf("  ❌ test_game_option_shuffle: Order and slot maps disagree\n");
+                failures++;
+            }
+            seen[slot][option] = true;
+        }
+        int choice = game_option_choice(&game, q->correct_answer);
+        first_slot_correct += choice == 1;
+        int wrong = choice == 1 ? 2 : 1;
+        if (game_submit_answer(&game, q, choice, 10) <= 0 ||
+            game_submit_answer(&game, q, wrong, 10) != 0) {
+            printf("  ❌ test_game_option_shuffle: Answer graded by original position\n");
+            failures++;
+        }
+    }
+    for (int slot = 0; slot < MAX_OPTIONS; slot++) {
+        for (int option = 0; option < MAX_OPTIONS; option++) {
+            if (!seen[slot][option]) {
+                printf("  ❌ test_game_option_shuffle: Option %d never shown in slot %d\n",
+                       option, slot + 1);
+                failures++;
+            }
+        }
+    }
+    /* The correct answer lands in the first slot about a quarter of the time. */
+    if (first_slot_correct < 350 || first_slot_correct > 650) {
+        printf("  ❌ test_game_option_shuffle: Skewed order (%d of 2000 in slot 1)\n",
+               first_slot_correct);
+        failures++;
+    }
+    
+    game_cleanup(&game);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_game_option_shuffle: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that questions with fewer options only use their slots
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_game_shuffle_short_questions(void) {
+    QuestionBank bank;
+    if (make_bank(&bank, 200, 2) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    GameConfig config;
+    memset(&config, 0, sizeof(config));
+    config.questions_per_game = 200;
+    config.difficulty = (Difficulty)-1;
+    config.num_players = 1;
+    config.shuffle_options = true;
+    GameState game;
+    if (game_init(&game, &bank, &config) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    int failures = 0;
+    int swapped = 0;
+    for (int i = 0; i < 200; i++) {
+        Question *q = game_draw_question(&game);
+        if (q == NULL || game.option_order[0] > 1 || game.option_order[1] > 1 ||
+            game.option_order[2] != 2 || game.option_order[3] != 3) {
+            failures++;
+            break;
+        }
+        swapped += game.option_order[0] == 1;
+    }
+    if (failures > 0 || swapped == 0 || swapped == 200) {
+        printf("  ❌ test_game_shuffle_short_questions: Two options not shuffled in place\n");
+        failures++;
+    }
+    
+    game_cleanup(&game);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_game_shuffle_short_questions: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that a restored game carries on exactly as the saved one
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_game_save_restore(void) {
+    QuestionBank bank;
+    QuestionBank other;
+    SessionPool pool;
+    if (make_bank(&bank, 50, MAX_OPTIONS) != 0 || make_bank(&other, 49, MAX_OPTIONS) != 0 ||
+        session_pool_init(&pool, POOL_DEFAULT_MAX_CACHED) != 0) {
+        printf("  ❌ test_game_save_restore: Setup failed\n");
+        question_bank_free(&bank);
+        question_bank_free(&other);
+        return 1;
+    }
+    
+    GameConfig config;
+    memset(&config, 0, sizeof(config));
+    config.questions_per_game = 25;
+    config.time_per_question = 30;
+    config.difficulty = (Difficulty)-1;
+    config.num_players = 2;
+    config.shuffle_options = true;
+    GameState *game = game_create(&pool, &bank, &config);
+    int failures = 0;
+    bool asked[50] = { false };
+    for (int i = 0; game != NULL && i < 20; i++) {
+        Question *q = game_draw_question(game);
+        asked[q - bank.questions] = true;
+        game_submit_answer(game, q, game_option_choice(game, q->correct_answer), 10 + i);
+        game_next_player(game);
+    }
+    uint8_t saved[1024];
+    size_t len = game != NULL ? game_save(game, saved, sizeof(saved)) : 0;
+    GameState *copy = len > 0 ? game_restore(&pool, &bank, saved, len) : NULL;
+    if (len != game_saved_size(game) || copy == NULL ||
+        game_restore(&pool, &other, saved, len) != NULL ||
+        game_restore(&pool, &bank, saved, len - 1) != NULL) {
+        printf("  ❌ test_game_save_restore: Save or restore failed\n");
+        failures++;
+    }
+    
+    for (int i = 0; copy != NULL && i < 30; i++) {
+        Question *a = game_draw_question(game);
+        Question *b = game_draw_question(copy);
+        if (a != b || memcmp(game->option_order, copy->option_order, MAX_OPTIONS) != 0) {
+            printf("  ❌ test_game_save_restore: Draw %d differs after restore\n", i);
+            failures++;
+            break;
+        }
+        if (b != NULL && asked[b - bank.questions]) {
+            printf("  ❌ test_game_save_restore: Question asked twice\n");
+            failures++;
+            break;
+        }
+    }
+    if (copy != NULL && (copy->current_player != game->current_player ||
+                         copy->players[0].score != game->players[0].score ||
+                         copy->players[1].score <= 0)) {
+        printf("  ❌ test_game_save_restore: Scores or turn not restored\n");
+        failures++;
+    }
+    
+    /* A name saved without its NUL comes back terminated. */
+    if (copy != NULL) {
+        memset(copy->players[1].name, 'x', sizeof(copy->players[1].name));
+        len = game_save(copy, saved, sizeof(saved));
+        GameState *named = game_restore(&pool, &bank, saved, len);
+        if (named == NULL ||
+            strlen(named->players[1].name) != sizeof(named->players[1].name) - 1) {
+            printf("  ❌ test_game_save_restore: Unterminated name not fixed up\n");
+            failures++;
+        }
+        game_destroy(named);
+    }
+    
+    /* Saves whose fields the game could not run with are refused. */
+    for (int c = 0; copy != NULL && c < 4; c++) {
+        GameConfig kept = copy->config;
+        uint8_t slot = copy->option_slot[0];
+        switch (c) {
+            case 0: copy->config.difficulty = (Difficulty)DIFFICULTY_COUNT; break;
+            case 1: copy->config.questions_per_game = 0; break;
+            case 2: copy->config.time_per_question = -1; break;
+            case 3: copy->option_slot[0] = copy->option_slot[0] == 0 ? 1 : 0; break;
+        }
+        len = game_save(copy, saved, sizeof(saved));
+        GameState *bad = game_restore(&pool, &bank, saved, len);
+        if (bad != NULL) {
+            printf("  ❌ test_game_save_restore: Malformed save %d restored\n", c);
+            failures++;
+            game_destroy(bad);
+        }
+        copy->config = kept;
+        copy->option_slot[0] = slot;
+    }
+    
+    game_destroy(copy);
+    game_destroy(game);
+    session_pool_destroy(&pool);
+    question_bank_free(&bank);
+    question_bank_free(&other);
+    if (failures == 0) {
+        printf("  ✅ test_game_save_restore: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all game engine tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_game(void) {
+    int failures = 0;
+    
+    failures += test_game_option_shuffle();
+    failures += test_game_shuffle_short_questions();
+    failures += test_game_save_restore();
+    
+    return failures;
+}
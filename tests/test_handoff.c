@@ -0,0 +1,745 @@
+/**
+ * @file test_handoff.c
+ * @brief Tests for moving live rooms between game server processes, and
+ *        for upgrading a server in place
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "../src/game.h"
+#include "../src/server.h"
+#include "../src/utils.h"
+#include "../src/websocket.h"
+
+#define HANDOFF_TEST_QUESTIONS 100
+#define HANDOFF_TEST_SESSIONS 10000
+#define HANDOFF_TEST_FLOODERS 2
+#define HANDOFF_TEST_FLOOD 200000
+#define HANDOFF_TEST_MESSAGE 1024
+#define HANDOFF_TEST_STORM 200
+
+static Server *child_server = NULL;
+static int child_target = 0;
+static QuestionBank *upgrade_bank = NULL;
+static int upgrade_report_fd = -1;
+
+static void handle_handoff(int sig) {
+    (void)sig;
+    server_handoff(child_server, "127.0.0.1", child_target);
+}
+
+/**
+ * @brief Stand-in for exec'ing a new binary: a child that keeps only the
+ *        channel (as exec would with every other descriptor close-on-exec),
+ *        reports its pid and takes over
+ */
+static int spawn_upgrade(void *ctx) {
+    (void)ctx;
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct rlimit limit;
+        getrlimit(RLIMIT_NOFILE, &limit);
+        for (int fd = 3; fd < (int)limit.rlim_cur; fd++) {
+            if (fd != pair[1] && fd != upgrade_report_fd) {
+                close(fd);
+            }
+        }
+        pid_t self = getpid();
+        ssize_t written = write(upgrade_report_fd, &self, sizeof(self));
+        close(upgrade_report_fd);
+        ServerOptions opts;
+        server_options_init(&opts);
+        Server server;
+        if (written == (ssize_t)sizeof(self) && server_inherit(pair[1], &opts, NULL, NULL) == 0 &&
+            server_init(&server, upgrade_bank, &opts) == 0) {
+            if (server_take_over(&server, pair[1]) == 0) {
+                close(pair[1]);
+                server_run(&server);
+            }
+            server_destroy(&server);
+        }
+        _exit(0);
+    }
+    close(pair[1]);
+    if (pid < 0) {
+        close(pair[0]);
+        return -1;
+    }
+    return pair[0];
+}
+
+static void handle_upgrade(int sig) {
+    (void)sig;
+    server_upgrade(child_server, spawn_upgrade, NULL, NULL, 0);
+}
+
+/**
+ * @brief Fill a bank whose correct option always reads "Right"
+ */
+static int build_bank(QuestionBank *bank) {
+    if (question_bank_init(bank) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < HANDOFF_TEST_QUESTIONS; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Handoff question %d?", i);
+        q.correct_answer = i % MAX_OPTIONS;
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]),
+                     o == q.correct_answer ? "Right" : "Wrong %d", o);
+        }
+        q.id = (uint32_t)i + 1;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        question_bank_add(bank, &q);
+    }
+    question_bank_build_index(bank);
+    return 0;
+}
+
+/**
+ * @brief Start a server in a child process
+ *
+ * The server is created in the child, which reports its WebSocket and
+ * handoff ports through a pipe. SIGUSR1 hands its rooms to @p target;
+ * SIGUSR2 upgrades it, the new process writing its pid to @p report.
+ *
+ * @param target Handoff port to send rooms to, 0 for none
+ * @param report Pipe for the upgraded process's pid, -1 for none
+ * @param ports Receives the WebSocket port and the handoff port
+ * @return pid_t Child, or -1 on error
+ */
+static pid_t start_server(QuestionBank *bank, int time_limit_s, int questions, int target,
+                          int report, int ports[2]) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        ServerOptions opts;
+        server_options_init(&opts);
+        opts.host = "127.0.0.1";
+        opts.port = 0;
+        opts.handoff_port = 0;
+        opts.time_limit_s = time_limit_s;
+        opts.questions_per_game = questions;
+        Server server;
+        int bound[2] = { -1, -1 };
+        if (server_init(&server, bank, &opts) == 0) {
+            bound[0] = server.port;
+            bound[1] = server.handoff_port;
+            child_server = &server;
+            child_target = target;
+            signal(SIGUSR1, handle_handoff);
+            upgrade_bank = bank;
+            upgrade_report_fd = report;
+            signal(SIGUSR2, handle_upgrade);
+        }
+        ssize_t written = write(fds[1], bound, sizeof(bound));
+        close(fds[1]);
+        if (bound[0] > 0 && written == (ssize_t)sizeof(bound)) {
+            server_run(&server);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    ssize_t got = pid > 0 ? read(fds[0], ports, 2 * sizeof(int)) : -1;
+    close(fds[0]);
+    if (pid > 0 && (got != (ssize_t)(2 * sizeof(int)) || ports[0] <= 0)) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+static void stop_server(pid_t pid) {
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+}
+
+static bool is_type(const char *message, const char *type) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"type\":\"%s\"", type);
+    return strstr(message, pattern) != NULL;
+}
+
+static int json_int(const char *message, const char *field) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", field);
+    const char *at = strstr(message, pattern);
+    return at != NULL ? atoi(at + strlen(pattern)) : -1;
+}
+
+/**
+ * @brief Read until a message of the given type, counting error messages
+ *
+ * @return int 0 when found, -1 on close or timeout
+ */
+static int expect(WsClient *client, const char *type, char *out, long *errors) {
+    for (;;) {
+        if (ws_client_recv(client, out, HANDOFF_TEST_MESSAGE, 10000) <= 0) {
+            return -1;
+        }
+        if (is_type(out, type)) {
+            return 0;
+        }
+        if (errors != NULL && is_type(out, "error")) {
+            (*errors)++;
+        }
+    }
+}
+
+/**
+ * @brief Leave for the node a redirect names and send RESUME there
+ */
+static int resume_elsewhere(WsClient *client, const char *redirect) {
+    const char *session = strstr(redirect, "\"session\":\"");
+    int port = json_int(redirect, "port");
+    if (session == NULL || port <= 0) {
+        return -1;
+    }
+    session += strlen("\"session\":\"");
+    char command[96];
+    int n = snprintf(command, sizeof(command), "RESUME %.*s",
+                     (int)strcspn(session, "\""), session);
+    ws_client_close(client);
+    if (ws_client_connect(client, "127.0.0.1", port) != 0) {
+        return -1;
+    }
+    return ws_client_send_text(client, command, (size_t)n);
+}
+
+/**
+ * @brief The choice (1-4) showing "Right" in a question message
+ */
+static int right_choice(const char *question) {
+    const char *options = strstr(question, "\"options\":[");
+    const char *right = options != NULL ? strstr(options, "\"Right\"") : NULL;
+    if (right == NULL) {
+        return 1;
+    }
+    int choice = 1;
+    for (const char *p = options; p < right; p++) {
+        choice += *p == ',';
+    }
+    return choice;
+}
+
+/**
+ * @brief Test that a countdown keeps running across a handoff and the
+ *        score carries over
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_handoff_countdown(QuestionBank *bank) {
+    int failures = 0;
+    int b_ports[2];
+    int a_ports[2];
+    pid_t b = start_server(bank, 2, 2, 0, -1, b_ports);
+    pid_t a = b > 0 ? start_server(bank, 2, 2, b_ports[1], -1, a_ports) : -1;
+    if (a < 0) {
+        printf("  ❌ test_handoff_countdown: Failed to start servers\n");
+        stop_server(b);
+        return 1;
+    }
+
+    char *message = (char*)malloc(HANDOFF_TEST_MESSAGE);
+    WsClient client = { .fd = -1 };
+    WsClient stranger = { .fd = -1 };
+    int points = -1;
+    double asked = 0;
+    if (message == NULL || ws_client_connect(&client, "127.0.0.1", a_ports[0]) != 0 ||
+        ws_client_send_text(&client, "JOIN 7 1", 8) != 0 ||
+        expect(&client, "question", message, NULL) != 0) {
+        printf("  ❌ test_handoff_countdown: No first question\n");
+        failures++;
+        goto done;
+    }
+    char answer[16];
+    int n = snprintf(answer, sizeof(answer), "ANSWER %d", right_choice(message));
+    if (ws_client_send_text(&client, answer, (size_t)n) != 0 ||
+        expect(&client, "result", message, NULL) != 0) {
+        printf("  ❌ test_handoff_countdown: No first result\n");
+        failures++;
+        goto done;
+    }
+    points = json_int(message, "points");
+    if (expect(&client, "question", message, NULL) != 0) {
+        printf("  ❌ test_handoff_countdown: No second question\n");
+        failures++;
+        goto done;
+    }
+    asked = monotonic_ms();
+
+    /* Move 0.8 s into the 2 s countdown. */
+    usleep(800 * 1000);
+    kill(a, SIGUSR1);
+    if (expect(&client, "redirect", message, NULL) != 0 ||
+        json_int(message, "port") != b_ports[0]) {
+        printf("  ❌ test_handoff_countdown: No redirect to the other node\n");
+        failures++;
+        goto done;
+    }
+    char refused[HANDOFF_TEST_MESSAGE];
+    if (ws_client_connect(&stranger, "127.0.0.1", b_ports[0]) != 0 ||
+        ws_client_send_text(&stranger, "RESUME 7-0-1", 12) != 0 ||
+        expect(&stranger, "error", refused, NULL) != 0 ||
+        strstr(refused, "unknown session") == NULL) {
+        printf("  ❌ test_handoff_countdown: A guessed session was accepted\n");
+        failures++;
+    }
+    if (resume_elsewhere(&client, message) != 0 ||
+        expect(&client, "resumed", message, NULL) != 0 ||
+        json_int(message, "player") != 0) {
+        printf("  ❌ test_handoff_countdown: Resume failed\n");
+        failures++;
+        goto done;
+    }
+    if (expect(&client, "result", message, NULL) != 0) {
+        printf("  ❌ test_handoff_countdown: Question never timed out\n");
+        failures++;
+        goto done;
+    }
+    double waited = monotonic_ms() - asked;
+    if (waited < 1600 || waited > 2400 || json_int(message, "choice") != 0) {
+        printf("  ❌ test_handoff_countdown: Timed out after %.0f ms, expected about 2000\n",
+               waited);
+        failures++;
+    }
+    char expected[32];
+    snprintf(expected, sizeof(expected), "\"scores\":[%d]", points);
+    if (expect(&client, "end", message, NULL) != 0 || points <= 0 ||
+        strstr(message, expected) == NULL) {
+        printf("  ❌ test_handoff_countdown: End lost the first answer's %d points\n", points);
+        failures++;
+    }
+
+done:
+    ws_client_close(&stranger);
+    ws_client_close(&client);
+    free(message);
+    stop_server(a);
+    stop_server(b);
+    if (failures == 0) {
+        printf("  ✅ test_handoff_countdown: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test moving 10k one-player sessions, with output still queued
+ *        for some of them
+ *
+ * The first clients send commands without reading, so their error
+ * replies back up on the old node; every one must arrive exactly once,
+ * some from the old node and the rest, after the resume, from the new.
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_handoff_sessions(QuestionBank *bank) {
+    int failures = 0;
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    int sessions = HANDOFF_TEST_SESSIONS;
+    if ((long)limit.rlim_cur < sessions + 64) {
+        sessions = (int)limit.rlim_cur - 64;
+        printf("  Note: open-file limit %ld allows %d sessions\n", (long)limit.rlim_cur, sessions);
+    }
+
+    int b_ports[2];
+    int a_ports[2];
+    pid_t b = start_server(bank, 60, 1, 0, -1, b_ports);
+    pid_t a = b > 0 ? start_server(bank, 60, 1, b_ports[1], -1, a_ports) : -1;
+    WsClient *clients = (WsClient*)calloc((size_t)sessions, sizeof(WsClient));
+    char *message = (char*)malloc(HANDOFF_TEST_MESSAGE);
+    if (a < 0 || clients == NULL || message == NULL) {
+        printf("  ❌ test_handoff_sessions: Failed to start servers\n");
+        stop_server(a);
+        stop_server(b);
+        free(clients);
+        free(message);
+        return 1;
+    }
+
+    int connected = 0;
+    char command[32];
+    while (connected < sessions &&
+           ws_client_connect(&clients[connected], "127.0.0.1", a_ports[0]) == 0) {
+        int n = snprintf(command, sizeof(command), "JOIN %d 1", connected + 1);
+        if (ws_client_send_text(&clients[connected], command, (size_t)n) != 0) {
+            break;
+        }
+        connected++;
+    }
+    int started = 0;
+    for (int i = 0; i < connected; i++) {
+        started += expect(&clients[i], "question", message, NULL) == 0;
+    }
+    if (connected != sessions || started != sessions) {
+        printf("  ❌ test_handoff_sessions: %d of %d sessions connected, %d started\n",
+               connected, sessions, started);
+        failures++;
+        goto done;
+    }
+
+    for (int i = 0; i < HANDOFF_TEST_FLOODERS; i++) {
+        for (int k = 0; k < HANDOFF_TEST_FLOOD; k++) {
+            ws_client_send_text(&clients[i], "X", 1);
+        }
+    }
+    /* Let the old node work through the commands before it hands off. */
+    usleep(1000 * 1000);
+    kill(a, SIGUSR1);
+
+    long errors_before = 0;
+    long errors_after = 0;
+    int redirected = 0;
+    for (int i = 0; i < sessions; i++) {
+        if (expect(&clients[i], "redirect", message, &errors_before) == 0 &&
+            resume_elsewhere(&clients[i], message) == 0) {
+            redirected++;
+        }
+    }
+    int resumed = 0;
+    for (int i = 0; i < sessions; i++) {
+        if (expect(&clients[i], "resumed", message, NULL) == 0 &&
+            ws_client_send_text(&clients[i], "ANSWER 1", 8) == 0) {
+            resumed++;
+        }
+    }
+    int answered = 0;
+    for (int i = 0; i < sessions; i++) {
+        if (expect(&clients[i], "result", message, &errors_after) == 0 &&
+            json_int(message, "choice") == 1) {
+            answered++;
+        }
+    }
+    if (redirected != sessions || resumed != sessions || answered != sessions) {
+        printf("  ❌ test_handoff_sessions: %d redirected, %d resumed, %d answered of %d\n",
+               redirected, resumed, answered, sessions);
+        failures++;
+    }
+    long flood = (long)HANDOFF_TEST_FLOODERS * HANDOFF_TEST_FLOOD;
+    if (errors_before + errors_after != flood || errors_after == 0) {
+        printf("  ❌ test_handoff_sessions: %ld replies before and %ld after the move, "
+               "expected %ld with some after\n", errors_before, errors_after, flood);
+        failures++;
+    }
+
+done:
+    for (int i = 0; i < sessions; i++) {
+        if (clients[i].buf != NULL || clients[i].fd > 0) {
+            ws_client_close(&clients[i]);
+        }
+    }
+    free(clients);
+    free(message);
+    stop_server(a);
+    stop_server(b);
+    if (failures == 0) {
+        printf("  ✅ test_handoff_sessions: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Follow a redirect from a draining server: resume the seat it
+ *        names, or join again if it names none
+ */
+static int follow_upgrade(WsClient *client, const char *redirect, const char *join) {
+    if (strstr(redirect, "\"session\"") != NULL) {
+        return resume_elsewhere(client, redirect);
+    }
+    int port = json_int(redirect, "port");
+    ws_client_close(client);
+    if (port <= 0 || ws_client_connect(client, "127.0.0.1", port) != 0) {
+        return -1;
+    }
+    return ws_client_send_text(client, join, strlen(join));
+}
+
+/**
+ * @brief Read until a message of the given type, following redirects
+ *
+ * @return int 0 when found, -1 on close or timeout
+ */
+static int expect_following(WsClient *client, const char *type, char *out, const char *join) {
+    for (;;) {
+        if (ws_client_recv(client, out, HANDOFF_TEST_MESSAGE, 10000) <= 0) {
+            return -1;
+        }
+        if (is_type(out, type)) {
+            return 0;
+        }
+        if (is_type(out, "redirect") && follow_upgrade(client, out, join) != 0) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Send a bare handoff header with no rooms and read the reply
+ *
+ * The words mirror HandoffHeader in server.c: magic, version, saved game
+ * size, player size, bank count, rooms, port.
+ *
+ * @return ssize_t Reply bytes before the node closed the stream, -1 on error
+ */
+static ssize_t send_handoff_header(int port, uint32_t player_size) {
+    uint32_t header[7] = {
+        0x48565254u, 2, (uint32_t)game_saved_fixed_size(), player_size,
+        HANDOFF_TEST_QUESTIONS, 0, 0
+    };
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        send(fd, header, sizeof(header), MSG_NOSIGNAL) != (ssize_t)sizeof(header)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    uint32_t reply[8];
+    ssize_t got = 0;
+    for (;;) {
+        ssize_t n = recv(fd, (char*)reply + got, sizeof(reply) - (size_t)got, 0);
+        if (n <= 0 || (got += n) == (ssize_t)sizeof(reply)) {
+            break;
+        }
+    }
+    close(fd);
+    return got;
+}
+
+/**
+ * @brief Test that a node refuses a handoff from a build whose saved
+ *        games have another layout, and answers one from its own
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_handoff_layout(QuestionBank *bank) {
+    int failures = 0;
+    int ports[2];
+    pid_t pid = start_server(bank, 60, 1, 0, -1, ports);
+    if (pid < 0) {
+        printf("  ❌ test_handoff_layout: Failed to start server\n");
+        return 1;
+    }
+
+    ssize_t same = send_handoff_header(ports[1], (uint32_t)sizeof(Player));
+    ssize_t other = send_handoff_header(ports[1], (uint32_t)sizeof(Player) + 8);
+    if (same != 7 * (ssize_t)sizeof(uint32_t)) {
+        printf("  ❌ test_handoff_layout: Matching stream got %zd reply bytes\n", same);
+        failures++;
+    }
+    if (other != 0) {
+        printf("  ❌ test_handoff_layout: Stream with another Player size got %zd reply bytes\n",
+               other);
+        failures++;
+    }
+
+    stop_server(pid);
+    if (failures == 0) {
+        printf("  ✅ test_handoff_layout: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test upgrading a server in place: the new process takes the
+ *        listener and the running game, no connection is refused, idle
+ *        clients move over and the old process exits
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_handoff_upgrade(QuestionBank *bank) {
+    int failures = 0;
+    int report[2];
+    int ports[2];
+    pid_t old = -1;
+    pid_t upgraded = -1;
+    if (pipe(report) == 0) {
+        old = start_server(bank, 2, 2, 0, report[1], ports);
+        close(report[1]);
+    }
+    WsClient *storm = (WsClient*)calloc(HANDOFF_TEST_STORM, sizeof(WsClient));
+    char *message = (char*)malloc(HANDOFF_TEST_MESSAGE);
+    for (int i = 0; storm != NULL && i < HANDOFF_TEST_STORM; i++) {
+        storm[i].fd = -1;
+    }
+    if (old < 0 || storm == NULL || message == NULL) {
+        printf("  ❌ test_handoff_upgrade: Failed to start the server\n");
+        stop_server(old);
+        free(storm);
+        free(message);
+        return 1;
+    }
+
+    WsClient player = { .fd = -1 };
+    WsClient idle = { .fd = -1 };
+    int points = -1;
+    double asked = 0;
+    char answer[16];
+    int n = 0;
+    if (ws_client_connect(&idle, "127.0.0.1", ports[0]) != 0 ||
+        ws_client_connect(&player, "127.0.0.1", ports[0]) != 0 ||
+        ws_client_send_text(&player, "JOIN 9 1", 8) != 0 ||
+        expect(&player, "question", message, NULL) != 0 ||
+        (n = snprintf(answer, sizeof(answer), "ANSWER %d", right_choice(message))) <= 0 ||
+        ws_client_send_text(&player, answer, (size_t)n) != 0 ||
+        expect(&player, "result", message, NULL) != 0 ||
+        (points = json_int(message, "points")) <= 0 ||
+        expect(&player, "question", message, NULL) != 0) {
+        printf("  ❌ test_handoff_upgrade: Game did not start\n");
+        failures++;
+        goto done;
+    }
+    asked = monotonic_ms();
+
+    /* Upgrade 0.8 s into the 2 s countdown, connecting all the while. */
+    usleep(800 * 1000);
+    kill(old, SIGUSR2);
+    int connected = 0;
+    char joins[HANDOFF_TEST_STORM][24];
+    for (int i = 0; i < HANDOFF_TEST_STORM; i++) {
+        n = snprintf(joins[i], sizeof(joins[i]), "JOIN %d 1", 1000 + i);
+        if (ws_client_connect(&storm[i], "127.0.0.1", ports[0]) == 0 &&
+            ws_client_send_text(&storm[i], joins[i], (size_t)n) == 0) {
+            connected++;
+        }
+    }
+    if (read(report[0], &upgraded, sizeof(upgraded)) != (ssize_t)sizeof(upgraded)) {
+        upgraded = -1;
+    }
+    if (upgraded <= 0 || connected != HANDOFF_TEST_STORM) {
+        printf("  ❌ test_handoff_upgrade: %d of %d connections made during the upgrade\n",
+               connected, HANDOFF_TEST_STORM);
+        failures++;
+        goto done;
+    }
+
+    if (expect(&player, "redirect", message, NULL) != 0 ||
+        json_int(message, "port") != ports[0] ||
+        strstr(message, "\"host\":\"127.0.0.1\"") == NULL ||
+        resume_elsewhere(&player, message) != 0 ||
+        expect(&player, "resumed", message, NULL) != 0) {
+        printf("  ❌ test_handoff_upgrade: Player did not resume on the new process\n");
+        failures++;
+        goto done;
+    }
+    if (expect(&player, "result", message, NULL) != 0) {
+        printf("  ❌ test_handoff_upgrade: Question never timed out\n");
+        failures++;
+        goto done;
+    }
+    double waited = monotonic_ms() - asked;
+    if (waited < 1600 || waited > 2400 || json_int(message, "choice") != 0) {
+        printf("  ❌ test_handoff_upgrade: Timed out after %.0f ms, expected about 2000\n",
+               waited);
+        failures++;
+    }
+    char expected[32];
+    snprintf(expected, sizeof(expected), "\"scores\":[%d]", points);
+    if (expect(&player, "end", message, NULL) != 0 || strstr(message, expected) == NULL) {
+        printf("  ❌ test_handoff_upgrade: End lost the first answer's %d points\n", points);
+        failures++;
+    }
+
+    if (expect(&idle, "redirect", message, NULL) != 0 ||
+        strstr(message, "\"session\"") != NULL ||
+        follow_upgrade(&idle, message, "JOIN 20 1") != 0 ||
+        expect_following(&idle, "question", message, "JOIN 20 1") != 0) {
+        printf("  ❌ test_handoff_upgrade: Idle client did not move over\n");
+        failures++;
+    }
+    int playing = 0;
+    for (int i = 0; i < HANDOFF_TEST_STORM; i++) {
+        playing += expect_following(&storm[i], "question", message, joins[i]) == 0;
+    }
+    if (playing != HANDOFF_TEST_STORM) {
+        printf("  ❌ test_handoff_upgrade: %d of %d clients joining during the upgrade play\n",
+               playing, HANDOFF_TEST_STORM);
+        failures++;
+    }
+
+    int status = 0;
+    pid_t exited = 0;
+    for (int i = 0; i < 100 && exited == 0; i++) {
+        exited = waitpid(old, &status, WNOHANG);
+        if (exited == 0) {
+            usleep(50 * 1000);
+        }
+    }
+    if (exited != old) {
+        printf("  ❌ test_handoff_upgrade: Old process still running after its clients left\n");
+        failures++;
+    } else {
+        old = -1;
+    }
+
+done:
+    for (int i = 0; i < HANDOFF_TEST_STORM; i++) {
+        ws_client_close(&storm[i]);
+    }
+    ws_client_close(&idle);
+    ws_client_close(&player);
+    free(storm);
+    free(message);
+    close(report[0]);
+    stop_server(old);
+    if (upgraded > 0) {
+        kill(upgraded, SIGTERM);
+    }
+    if (failures == 0) {
+        printf("  ✅ test_handoff_upgrade: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all handoff tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_handoff(void) {
+    int failures = 0;
+    QuestionBank bank;
+    if (build_bank(&bank) != 0) {
+        printf("  ❌ test_handoff: Failed to build bank\n");
+        return 1;
+    }
+
+    failures += test_handoff_countdown(&bank);
+    failures += test_handoff_sessions(&bank);
+    failures += test_handoff_layout(&bank);
+    failures += test_handoff_upgrade(&bank);
+
+    question_bank_free(&bank);
+    return failures;
+}
@@ -0,0 +1,348 @@
+/**
+ * @file test_http.c
+ * @brief Unit tests for the admin HTTP query API over loopback
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../src/http.h"
+
+#define HTTP_TEST_QUESTIONS 20
+
+/**
+ * @brief A response read off a test connection
+ */
+typedef struct {
+    int status;                           /**< Status code */
+    bool close;                           /**< Connection: close was sent */
+    char body[65536];                     /**< Body, NUL-terminated */
+} TestResponse;
+
+static int connect_api(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static int send_all(int fd, const char *data) {
+    size_t len = strlen(data);
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read bytes with a timeout
+ *
+ * @return ssize_t Bytes read, 0 on close, -1 on error or timeout
+ */
+static ssize_t read_some(int fd, char *buf, size_t cap) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, 5000) != 1) {
+        return -1;
+    }
+    return recv(fd, buf, cap, 0);
+}
+
+/**
+ * @brief Read one response; bytes past it stay in the carry buffer
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int read_response(int fd, char *carry, size_t *carry_len, TestResponse *out) {
+    for (;;) {
+        carry[*carry_len] = '\0';
+        char *head_end = strstr(carry, "\r\n\r\n");
+        if (head_end != NULL) {
+            size_t head_len = (size_t)(head_end - carry) + 4;
+            const char *length = strstr(carry, "Content-Length: ");
+            if (length == NULL || length > head_end) {
+                return -1;
+            }
+            size_t body_len = (size_t)atol(length + 16);
+            if (body_len >= sizeof(out->body)) {
+                return -1;
+            }
+            if (*carry_len >= head_len + body_len) {
+                out->status = atoi(carry + 9);
+                const char *connection = strstr(carry, "Connection: close");
+                out->close = connection != NULL && connection < head_end;
+                memcpy(out->body, carry + head_len, body_len);
+                out->body[body_len] = '\0';
+                *carry_len -= head_len + body_len;
+                memmove(carry, carry + head_len + body_len, *carry_len);
+                return 0;
+            }
+        }
+        if (*carry_len >= 2 * sizeof(out->body)) {
+            return -1;
+        }
+        ssize_t n = read_some(fd, carry + *carry_len, 2 * sizeof(out->body) - *carry_len);
+        if (n <= 0) {
+            return -1;
+        }
+        *carry_len += (size_t)n;
+    }
+}
+
+/**
+ * @brief Send one request and read its response on a fresh connection
+ */
+static int request(int port, const char *target, TestResponse *out) {
+    int fd = connect_api(port);
+    if (fd < 0) {
+        return -1;
+    }
+    char text[1024];
+    snprintf(text, sizeof(text), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", target);
+    static char carry[2 * sizeof(out->body) + 1];
+    size_t carry_len = 0;
+    int result = send_all(fd, text) == 0 ? read_response(fd, carry, &carry_len, out) : -1;
+    close(fd);
+    return result;
+}
+
+static int count_occurrences(const char *text, const char *pattern) {
+    int count = 0;
+    for (const char *at = strstr(text, pattern); at != NULL; at = strstr(at + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static void build_bank(QuestionBank *bank) {
+    question_bank_init(bank);
+    for (int i = 0; i < HTTP_TEST_QUESTIONS; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Admin question %d about %s?", i,
+                 i % 2 == 0 ? "planets" : "rivers");
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Choice %d", o);
+        }
+        q.correct_answer = i % MAX_OPTIONS;
+        q.id = (uint32_t)i + 100;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        q.category = (Category)(i % CATEGORY_COUNT);
+        question_bank_add(bank, &q);
+    }
+    /* One question whose text needs escaping on the way out. */
+    Question q;
+    memset(&q, 0, sizeof(q));
+    snprintf(q.question, sizeof(q.question), "Tab\there?");
+    snprintf(q.options[0], sizeof(q.options[0]), "Yes");
+    snprintf(q.options[1], sizeof(q.options[1]), "No");
+    q.id = 7;
+    question_bank_add(bank, &q);
+    question_bank_build_index(bank);
+}
+
+/**
+ * @brief Test lookups, listings, search and errors on separate connections
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_http_endpoints(void) {
+    int failures = 0;
+    QuestionBank bank;
+    build_bank(&bank);
+    HttpOptions opts;
+    http_options_init(&opts);
+    opts.port = 0;
+    HttpServer server;
+    if (http_server_start(&server, &bank, &opts) != 0) {
+        printf("  ❌ test_http_endpoints: Failed to start the API\n");
+        question_bank_free(&bank);
+        return 1;
+    }
+
+    static TestResponse r;
+    if (request(server.port, "/questions/105", &r) != 0 || r.status != 200 ||
+        strstr(r.body, "\"id\":105,\"question\":\"Admin question 5 about rivers?\"") == NULL ||
+        strstr(r.body, "\"options\":[\"Choice 0\",\"Choice 1\",\"Choice 2\",\"Choice 3\"]") == NULL ||
+        strstr(r.body, "\"correct\":1,\"difficulty\":\"hard\",\"category\":\"general\"") == NULL) {
+        printf("  ❌ test_http_endpoints: Lookup by ID wrong: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/questions/7", &r) != 0 || r.status != 200 ||
+        strstr(r.body, "\"Tab\\u0009here?\"") == NULL ||
+        strstr(r.body, "\"options\":[\"Yes\",\"No\"]") == NULL) {
+        printf("  ❌ test_http_endpoints: Control character not escaped: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/questions/4", &r) != 0 || r.status != 404 ||
+        request(server.port, "/nowhere", &r) != 0 || r.status != 404) {
+        printf("  ❌ test_http_endpoints: Missing question or path not 404\n");
+        failures++;
+    }
+
+    if (request(server.port, "/questions?difficulty=easy&category=general&limit=1", &r) != 0 ||
+        r.status != 200 || strstr(r.body, "\"total\":3") == NULL ||
+        count_occurrences(r.body, "\"id\":") != 1 || strstr(r.body, "\"id\":100") == NULL) {
+        printf("  ❌ test_http_endpoints: Filtered listing wrong: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/questions?offset=20", &r) != 0 || r.status != 200 ||
+        strstr(r.body, "\"total\":21,\"offset\":20") == NULL ||
+        count_occurrences(r.body, "\"id\":") != 1) {
+        printf("  ❌ test_http_endpoints: Offset not applied: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/questions?difficulty=brutal", &r) != 0 || r.status != 400 ||
+        request(server.port, "/questions?limit=-3", &r) != 0 || r.status != 400) {
+        printf("  ❌ test_http_endpoints: Bad parameters not refused\n");
+        failures++;
+    }
+
+    if (request(server.port, "/search?q=admin+rivers", &r) != 0 || r.status != 200 ||
+        strstr(r.body, "\"total\":10}") == NULL || count_occurrences(r.body, "\"id\":") != 10 ||
+        strstr(r.body, "planets") != NULL) {
+        printf("  ❌ test_http_endpoints: Search wrong: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/search?q=%22question%2013%22&limit=5", &r) != 0 ||
+        r.status != 200 || strstr(r.body, "\"total\":1}") == NULL ||
+        strstr(r.body, "\"id\":113") == NULL) {
+        printf("  ❌ test_http_endpoints: Encoded phrase search wrong: %s\n", r.body);
+        failures++;
+    }
+    if (request(server.port, "/health", &r) != 0 || r.status != 200 ||
+        strstr(r.body, "\"questions\":21") == NULL) {
+        printf("  ❌ test_http_endpoints: Health wrong: %s\n", r.body);
+        failures++;
+    }
+
+    http_server_stop(&server);
+    if (server.stats.requests != 11 || server.stats.errors != 4 ||
+        server.stats.bank_bytes == 0 || server.stats.accepted != 11) {
+        printf("  ❌ test_http_endpoints: Stats off (%llu requests, %llu errors, %llu accepted)\n",
+               (unsigned long long)server.stats.requests,
+               (unsigned long long)server.stats.errors,
+               (unsigned long long)server.stats.accepted);
+        failures++;
+    }
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_http_endpoints: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test keep-alive, pipelining in one write, and Connection: close
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_http_pipelining(void) {
+    int failures = 0;
+    QuestionBank bank;
+    build_bank(&bank);
+    HttpOptions opts;
+    http_options_init(&opts);
+    opts.port = 0;
+    HttpServer server;
+    if (http_server_start(&server, &bank, &opts) != 0) {
+        printf("  ❌ test_http_pipelining: Failed to start the API\n");
+        question_bank_free(&bank);
+        return 1;
+    }
+
+    static char carry[2 * sizeof(((TestResponse*)0)->body) + 1];
+    size_t carry_len = 0;
+    static TestResponse r;
+    int fd = connect_api(server.port);
+    const char batch[] = "GET /questions/101 HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /health HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /questions/119 HTTP/1.1\r\nHost: a\r\n\r\n";
+    if (fd < 0 || send_all(fd, batch) != 0) {
+        printf("  ❌ test_http_pipelining: Could not send the batch\n");
+        failures++;
+    } else {
+        const char *expected[] = { "\"id\":101", "\"questions\":21", "\"id\":119" };
+        for (int i = 0; i < 3; i++) {
+            if (read_response(fd, carry, &carry_len, &r) != 0 || r.status != 200 || r.close ||
+                strstr(r.body, expected[i]) == NULL) {
+                printf("  ❌ test_http_pipelining: Response %d out of order or missing\n", i);
+                failures++;
+            }
+        }
+
+        /* A request split across writes, then one that ends the connection. */
+        send_all(fd, "GET /questions/10");
+        usleep(20000);
+        send_all(fd, "2 HTTP/1.1\r\nHost: a\r\n\r\nGET /health HTTP/1.1\r\n"
+                     "Connection: close\r\n\r\nGET /health HTTP/1.1\r\n\r\n");
+        if (read_response(fd, carry, &carry_len, &r) != 0 || strstr(r.body, "\"id\":102") == NULL ||
+            read_response(fd, carry, &carry_len, &r) != 0 || !r.close) {
+            printf("  ❌ test_http_pipelining: Split request or close not handled\n");
+            failures++;
+        }
+        char extra[64];
+        if (carry_len != 0 || read_some(fd, extra, sizeof(extra)) != 0) {
+            printf("  ❌ test_http_pipelining: Connection stayed open after close\n");
+            failures++;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    /* Bodies are refused and end the connection. */
+    fd = connect_api(server.port);
+    carry_len = 0;
+    if (fd < 0 || send_all(fd, "POST /questions HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}") != 0 ||
+        read_response(fd, carry, &carry_len, &r) != 0 || r.status != 400 || !r.close) {
+        printf("  ❌ test_http_pipelining: Request body not refused\n");
+        failures++;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    http_server_stop(&server);
+    if (server.stats.accepted != 2 || server.stats.requests != 6) {
+        printf("  ❌ test_http_pipelining: Stats off (%llu accepted, %llu requests)\n",
+               (unsigned long long)server.stats.accepted,
+               (unsigned long long)server.stats.requests);
+        failures++;
+    }
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_http_pipelining: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all HTTP API tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_http(void) {
+    int failures = 0;
+
+    failures += test_http_endpoints();
+    failures += test_http_pipelining();
+
+    return failures;
+}
@@ -0,0 +1,481 @@
+/**
+ * @file test_leaderboard.c
+ * @brief Unit tests for the leaderboard, and a primary with replica processes
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "../src/replication.h"
+#include "../src/utils.h"
+
+#define LEADERBOARD_TEST_PLAYERS 50
+#define LEADERBOARD_TEST_SUBMITS 1000
+#define LEADERBOARD_TEST_LOG 64
+#define LEADERBOARD_TEST_REPLICAS 3
+
+/**
+ * @brief Test totals, ranks with ties, and the order after updates
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_leaderboard_ranks(void) {
+    int failures = 0;
+    Leaderboard lb;
+    if (leaderboard_init(&lb) != 0) {
+        printf("  ❌ test_leaderboard_ranks: Init failed\n");
+        return 1;
+    }
+
+    int64_t total = 0;
+    leaderboard_set(&lb, "carol", 30);
+    leaderboard_set(&lb, "alice", 50);
+    leaderboard_set(&lb, "bob", 30);
+    leaderboard_add(&lb, "dave", 10, &total);
+    leaderboard_add(&lb, "dave", 5, &total);
+    if (total != 15 || lb.count != 4) {
+        printf("  ❌ test_leaderboard_ranks: dave has %lld of 4 players %zu\n",
+               (long long)total, lb.count);
+        failures++;
+    }
+
+    /* bob and carol tie for second; dave is fourth, not third. */
+    static const char *const names[] = { "alice", "bob", "carol", "dave", "erin" };
+    static const size_t ranks[] = { 1, 2, 2, 4, 0 };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        size_t rank = leaderboard_rank(&lb, names[i], NULL);
+        if (rank != ranks[i]) {
+            printf("  ❌ test_leaderboard_ranks: %s ranked %zu, expected %zu\n",
+                   names[i], rank, ranks[i]);
+            failures++;
+        }
+    }
+    size_t rank = 0;
+    const LeaderboardEntry *third = leaderboard_at(&lb, 2, &rank);
+    if (third == NULL || strcmp(third->name, "carol") != 0 || rank != 2 ||
+        leaderboard_at(&lb, 4, NULL) != NULL) {
+        printf("  ❌ test_leaderboard_ranks: Position 2 is not carol at rank 2\n");
+        failures++;
+    }
+
+    /* Moving down and up keeps one entry per player. */
+    leaderboard_add(&lb, "alice", -45, NULL);
+    leaderboard_set(&lb, "dave", 100);
+    if (leaderboard_rank(&lb, "alice", &total) != 4 || total != 5 ||
+        leaderboard_rank(&lb, "dave", NULL) != 1 || lb.count != 4) {
+        printf("  ❌ test_leaderboard_ranks: Order wrong after updates\n");
+        failures++;
+    }
+
+    /* A total that would overflow is refused and left as it was. */
+    leaderboard_set(&lb, "erin", INT64_MAX - 1);
+    if (leaderboard_add(&lb, "erin", 2, &total) == 0 || errno != ERANGE ||
+        leaderboard_rank(&lb, "erin", &total) != 1 || total != INT64_MAX - 1 ||
+        leaderboard_add(&lb, "erin", 1, &total) != 0 || total != INT64_MAX) {
+        printf("  ❌ test_leaderboard_ranks: Overflowing add not refused\n");
+        failures++;
+    }
+    leaderboard_set(&lb, "erin", 0);
+
+    static const char *const invalid[] = { "", "has space", "semi;colon",
+                                           "abcdefghijklmnopqrstuvwxyz0123456" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (leaderboard_set(&lb, invalid[i], 1) == 0) {
+            printf("  ❌ test_leaderboard_ranks: Invalid name '%s' accepted\n", invalid[i]);
+            failures++;
+        }
+    }
+
+    /* Enough players to grow the table several times, in a scrambled order. */
+    leaderboard_clear(&lb);
+    char name[LEADERBOARD_MAX_NAME];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(name, sizeof(name), "p%d", (i * 7919) % 5000);
+        leaderboard_add(&lb, name, (i * 7919) % 5000 / 10, NULL);
+    }
+    bool ordered = lb.count == 5000;
+    for (size_t i = 1; i < lb.count && ordered; i++) {
+        const LeaderboardEntry *a = leaderboard_at(&lb, i - 1, NULL);
+        const LeaderboardEntry *b = leaderboard_at(&lb, i, NULL);
+        ordered = a->total > b->total || (a->total == b->total && strcmp(a->name, b->name) < 0);
+    }
+    if (!ordered || leaderboard_rank(&lb, "p4999", NULL) != 1 ||
+        leaderboard_rank(&lb, "p4990", NULL) != 1 || leaderboard_rank(&lb, "p4989", NULL) != 11) {
+        printf("  ❌ test_leaderboard_ranks: 5000 players out of order\n");
+        failures++;
+    }
+
+    leaderboard_free(&lb);
+    if (failures == 0) {
+        printf("  ✅ test_leaderboard_ranks: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Start a node in a child process
+ *
+ * The node is created in the child, which reports its port through a pipe,
+ * so no epoll instance is shared with the parent.
+ *
+ * @param listen_port Port to listen on, 0 for any
+ * @return pid_t Child, or -1 on error; the node's port is stored in port
+ */
+static pid_t start_node(int primary_port, int listen_port, int *port) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        ReplicationOptions opts;
+        replication_options_init(&opts);
+        opts.port = listen_port;
+        opts.log_capacity = LEADERBOARD_TEST_LOG;
+        if (primary_port > 0) {
+            opts.primary_host = "127.0.0.1";
+            opts.primary_port = primary_port;
+        }
+        ReplicationNode node;
+        int bound = replication_node_init(&node, &opts) == 0 ? node.port : -1;
+        ssize_t written = write(fds[1], &bound, sizeof(bound));
+        close(fds[1]);
+        if (bound > 0 && written == (ssize_t)sizeof(bound)) {
+            replication_node_run(&node);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    ssize_t got = pid > 0 ? read(fds[0], port, sizeof(*port)) : -1;
+    close(fds[0]);
+    if (pid > 0 && (got != (ssize_t)sizeof(*port) || *port <= 0)) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+static FILE* node_connect(int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    FILE *f = fdopen(fd, "r+");
+    if (f == NULL) {
+        close(fd);
+    }
+    return f;
+}
+
+/**
+ * @brief Send one command and collect its whole reply (TOP spans lines)
+ *
+ * @return int 0 on success, -1 if the connection failed
+ */
+static int node_call(FILE *f, const char *command, char *reply, size_t cap) {
+    if (f == NULL || fprintf(f, "%s\n", command) < 0 || fflush(f) != 0) {
+        return -1;
+    }
+    size_t len = 0;
+    long lines = 1;
+    reply[0] = '\0';
+    for (long i = 0; i < lines; i++) {
+        if (fgets(reply + len, (int)(cap - len), f) == NULL) {
+            return -1;
+        }
+        long k = 0;
+        if (i == 0 && sscanf(reply, "TOP %ld", &k) == 1) {
+            lines += k;
+        }
+        len += strlen(reply + len);
+    }
+    return 0;
+}
+
+/**
+ * @brief Read one key=value number from a STATUS reply
+ */
+static long long status_value(FILE *f, const char *key) {
+    char reply[REPLICATION_MAX_LINE];
+    if (node_call(f, "STATUS", reply, sizeof(reply)) != 0) {
+        return -1;
+    }
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), " %s=", key);
+    const char *at = strstr(reply, pattern);
+    return at != NULL ? atoll(at + strlen(pattern)) : -1;
+}
+
+/**
+ * @brief Poll a node's STATUS until key reaches value (up to 5 s)
+ */
+static bool wait_for(FILE *f, const char *key, long long value) {
+    for (int i = 0; i < 500; i++) {
+        if (status_value(f, key) == value) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+/**
+ * @brief A primary and three replica processes: two follow the log from the
+ *        start, one joins after the log has wrapped and loads a snapshot
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_replication(void) {
+    int failures = 0;
+    int primary_port = 0;
+    int ports[LEADERBOARD_TEST_REPLICAS] = { 0 };
+    pid_t pids[LEADERBOARD_TEST_REPLICAS] = { -1, -1, -1 };
+    FILE *replicas[LEADERBOARD_TEST_REPLICAS] = { NULL, NULL, NULL };
+    pid_t primary_pid = start_node(0, 0, &primary_port);
+    FILE *primary = primary_pid > 0 ? node_connect(primary_port) : NULL;
+    for (int r = 0; r < 2 && primary != NULL; r++) {
+        pids[r] = start_node(primary_port, 0, &ports[r]);
+        replicas[r] = pids[r] > 0 ? node_connect(ports[r]) : NULL;
+    }
+    if (primary == NULL || replicas[0] == NULL || replicas[1] == NULL ||
+        !wait_for(primary, "replicas", 2)) {
+        printf("  ❌ test_replication: Failed to start the primary and two replicas\n");
+        failures++;
+    }
+
+    char command[REPLICATION_MAX_LINE];
+    char reply[REPLICATION_MAX_LINE * 64];
+    int64_t totals[LEADERBOARD_TEST_PLAYERS] = { 0 };
+    uint32_t seed = 12345;
+    for (int i = 0; i < LEADERBOARD_TEST_SUBMITS && failures == 0; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        int player = (int)(seed >> 8) % LEADERBOARD_TEST_PLAYERS;
+        int points = (int)(seed >> 20) % 100 - 20;
+        totals[player] += points;
+        snprintf(command, sizeof(command), "SUBMIT player%02d %d", player, points);
+        long long total = 0;
+        unsigned long long seq = 0;
+        if (node_call(primary, command, reply, sizeof(reply)) != 0 ||
+            sscanf(reply, "OK %lld %llu", &total, &seq) != 2 ||
+            total != totals[player] || seq != (unsigned long long)i + 1) {
+            printf("  ❌ test_replication: %s answered %s", command, reply);
+            failures++;
+        }
+    }
+
+    /* A submit that would overflow a total is refused and not logged. */
+    for (int p = 0; p < LEADERBOARD_TEST_PLAYERS && failures == 0; p++) {
+        if (totals[p] > 0) {
+            snprintf(command, sizeof(command), "SUBMIT player%02d %lld", p, (long long)INT64_MAX);
+            if (node_call(primary, command, reply, sizeof(reply)) != 0 ||
+                strncmp(reply, "ERR", 3) != 0 ||
+                status_value(primary, "seq") != LEADERBOARD_TEST_SUBMITS) {
+                printf("  ❌ test_replication: %s answered %s", command, reply);
+                failures++;
+            }
+            break;
+        }
+    }
+
+    /* The log holds 64 records, so the late replica must start from a snapshot. */
+    if (failures == 0) {
+        pids[2] = start_node(primary_port, 0, &ports[2]);
+        replicas[2] = pids[2] > 0 ? node_connect(ports[2]) : NULL;
+    }
+    for (int r = 0; r < LEADERBOARD_TEST_REPLICAS && failures == 0; r++) {
+        if (!wait_for(replicas[r], "seq", LEADERBOARD_TEST_SUBMITS) ||
+            status_value(replicas[r], "head") != LEADERBOARD_TEST_SUBMITS) {
+            printf("  ❌ test_replication: Replica %d stuck at seq %lld\n",
+                   r, status_value(replicas[r], "seq"));
+            failures++;
+        } else if (status_value(replicas[r], "snapshots") != (r == 2 ? 1 : 0)) {
+            printf("  ❌ test_replication: Replica %d loaded %lld snapshots\n",
+                   r, status_value(replicas[r], "snapshots"));
+            failures++;
+        }
+    }
+
+    /* Every replica answers exactly as the primary does. */
+    char expected[sizeof(reply)];
+    if (failures == 0 && node_call(primary, "TOP 50", expected, sizeof(expected)) != 0) {
+        failures++;
+    }
+    for (int r = 0; r < LEADERBOARD_TEST_REPLICAS && failures == 0; r++) {
+        if (node_call(replicas[r], "TOP 50", reply, sizeof(reply)) != 0 ||
+            strcmp(reply, expected) != 0) {
+            printf("  ❌ test_replication: Replica %d TOP differs from the primary\n", r);
+            failures++;
+        }
+        for (int p = 0; p < LEADERBOARD_TEST_PLAYERS && failures == 0; p += 7) {
+            char want[REPLICATION_MAX_LINE];
+            snprintf(command, sizeof(command), "RANK player%02d", p);
+            node_call(primary, command, want, sizeof(want));
+            if (node_call(replicas[r], command, reply, sizeof(reply)) != 0 ||
+                strcmp(reply, want) != 0) {
+                printf("  ❌ test_replication: Replica %d: %s gave %s", r, command, reply);
+                failures++;
+            }
+        }
+    }
+    if (failures == 0 &&
+        (node_call(replicas[0], "SUBMIT player01 5", reply, sizeof(reply)) != 0 ||
+         strncmp(reply, "ERR", 3) != 0 || !wait_for(primary, "lag", 0))) {
+        printf("  ❌ test_replication: Replica accepted a SUBMIT or lag stayed up\n");
+        failures++;
+    }
+
+    /* With the primary gone, replicas keep answering from what they have. */
+    if (primary != NULL) {
+        fclose(primary);
+    }
+    if (primary_pid > 0) {
+        kill(primary_pid, SIGTERM);
+        waitpid(primary_pid, NULL, 0);
+    }
+    if (failures == 0 &&
+        (!wait_for(replicas[1], "connected", 0) ||
+         node_call(replicas[1], "TOP 50", reply, sizeof(reply)) != 0 ||
+         strcmp(reply, expected) != 0)) {
+        printf("  ❌ test_replication: Replica stopped answering without its primary\n");
+        failures++;
+    }
+
+    for (int r = 0; r < LEADERBOARD_TEST_REPLICAS; r++) {
+        if (replicas[r] != NULL) {
+            fclose(replicas[r]);
+        }
+        if (pids[r] > 0) {
+            kill(pids[r], SIGTERM);
+            waitpid(pids[r], NULL, 0);
+        }
+    }
+    if (failures == 0) {
+        printf("  ✅ test_replication: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief A primary that restarts and takes new submits before its replica
+ *        reconnects: the replica must reload instead of resuming the log
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_replication_restart(void) {
+    int failures = 0;
+    int primary_port = 0;
+    int replica_port = 0;
+    pid_t primary_pid = start_node(0, 0, &primary_port);
+    pid_t replica_pid = primary_pid > 0 ? start_node(primary_port, 0, &replica_port) : -1;
+    FILE *primary = primary_pid > 0 ? node_connect(primary_port) : NULL;
+    FILE *replica = replica_pid > 0 ? node_connect(replica_port) : NULL;
+    char reply[REPLICATION_MAX_LINE * 64];
+    char expected[sizeof(reply)];
+    if (primary == NULL || replica == NULL || !wait_for(primary, "replicas", 1)) {
+        printf("  ❌ test_replication_restart: Failed to start the primary and a replica\n");
+        failures++;
+    }
+
+    for (int i = 0; i < 5 && failures == 0; i++) {
+        if (node_call(primary, "SUBMIT forgotten 7", reply, sizeof(reply)) != 0) {
+            failures++;
+        }
+    }
+    if (failures == 0 && !wait_for(replica, "seq", 5)) {
+        printf("  ❌ test_replication_restart: Replica did not reach seq 5\n");
+        failures++;
+    }
+
+    /* Hold the replica while the primary restarts on the same port and
+     * takes ten new submits, so sequence 5 means something else there. */
+    if (replica_pid > 0) {
+        kill(replica_pid, SIGSTOP);
+    }
+    if (primary != NULL) {
+        fclose(primary);
+        primary = NULL;
+    }
+    if (primary_pid > 0) {
+        kill(primary_pid, SIGTERM);
+        waitpid(primary_pid, NULL, 0);
+    }
+    int restarted_port = 0;
+    primary_pid = failures == 0 ? start_node(0, primary_port, &restarted_port) : -1;
+    primary = primary_pid > 0 ? node_connect(restarted_port) : NULL;
+    if (failures == 0 && primary == NULL) {
+        printf("  ❌ test_replication_restart: Primary did not restart on port %d\n",
+               primary_port);
+        failures++;
+    }
+    for (int i = 0; i < 10 && failures == 0; i++) {
+        char command[REPLICATION_MAX_LINE];
+        snprintf(command, sizeof(command), "SUBMIT newcomer%d %d", i, i + 1);
+        if (node_call(primary, command, reply, sizeof(reply)) != 0) {
+            failures++;
+        }
+    }
+    if (replica_pid > 0) {
+        kill(replica_pid, SIGCONT);
+    }
+
+    if (failures == 0 &&
+        (!wait_for(primary, "replicas", 1) || !wait_for(replica, "seq", 10) ||
+         node_call(primary, "TOP 50", expected, sizeof(expected)) != 0 ||
+         node_call(replica, "TOP 50", reply, sizeof(reply)) != 0 ||
+         strcmp(reply, expected) != 0 || status_value(replica, "snapshots") != 1)) {
+        printf("  ❌ test_replication_restart: Replica kept the old history:\n%s", reply);
+        failures++;
+    }
+
+    if (primary != NULL) {
+        fclose(primary);
+    }
+    if (replica != NULL) {
+        fclose(replica);
+    }
+    if (primary_pid > 0) {
+        kill(primary_pid, SIGTERM);
+        waitpid(primary_pid, NULL, 0);
+    }
+    if (replica_pid > 0) {
+        kill(replica_pid, SIGTERM);
+        waitpid(replica_pid, NULL, 0);
+    }
+    if (failures == 0) {
+        printf("  ✅ test_replication_restart: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all leaderboard tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_leaderboard(void) {
+    int failures = 0;
+
+    failures += test_leaderboard_ranks();
+    failures += test_replication();
+    failures += test_replication_restart();
+
+    return failures;
+}
@@ -11,6 +11,20 @@
 // Test function declarations
 extern int test_utils(void);
 extern int test_questions(void);
+extern int test_search(void);
+extern int test_neardup(void);
+extern int test_export(void);
+extern int test_game(void);
+extern int test_paged(void);
+extern int test_topology(void);
+extern int test_events(void);
+extern int test_pool(void);
+extern int test_trivia(void);
+extern int test_websocket(void);
+extern int test_http(void);
+extern int test_shard(void);
+extern int test_leaderboard(void);
+extern int test_handoff(void);
 
 /**
  * @brief Run all tests
@@ -29,6 +43,20 @@ int main(int argc, char *argv[]) {
     // Determine which tests to run
     bool run_utils = false;
     bool run_questions = false;
+    bool run_search = false;
+    bool run_neardup = false;
+    bool run_export = false;
+    bool run_game = false;
+    bool run_paged = false;
+    bool run_topology = false;
+    bool run_events = false;
+    bool run_pool = false;
+    bool run_trivia = false;
+    bool run_websocket = false;
+    bool run_http = false;
+    bool run_shard = false;
+    bool run_leaderboard = false;
+    bool run_handoff = false;
     bool run_all = false;
     
     if (argc > 1) {
@@ -38,6 +66,34 @@ int main(int argc, char *argv[]) {
             run_utils = true;
         } else if (strcmp(argv[1], "questions") == 0) {
             run_questions = true;
+        } else if (strcmp(argv[1], "search") == 0) {
+            run_search = true;
+        } else if (strcmp(argv[1], "neardup") == 0) {
+            run_neardup = true;
+        } else if (strcmp(argv[1], "export") == 0) {
+            run_export = true;
+        } else if (strcmp(argv[1], "game") == 0) {
+            run_game = true;
+        } else if (strcmp(argv[1], "paged") == 0) {
+            run_paged = true;
+        } else if (strcmp(argv[1], "topology") == 0) {
+            run_topology = true;
+        } else if (strcmp(argv[1], "events") == 0) {
+            run_events = true;
+        } else if (strcmp(argv[1], "pool") == 0) {
+            run_pool = true;
+        } else if (strcmp(argv[1], "trivia") == 0) {
+            run_trivia = true;
+        } else if (strcmp(argv[1], "websocket") == 0) {
+            run_websocket = true;
+        } else if (strcmp(argv[1], "http") == 0) {
+            run_http = true;
+        } else if (strcmp(argv[1], "shard") == 0) {
+            run_shard = true;
+        } else if (strcmp(argv[1], "leaderboard") == 0) {
+            run_leaderboard = true;
+        } else if (strcmp(argv[1], "handoff") == 0) {
+            run_handoff = true;
         }
     } else {
         run_all = true;
@@ -71,6 +127,202 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (run_all || run_search) {
+        printf("Running Search Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_search();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Search tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Search tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_neardup) {
+        printf("Running Near-Duplicate Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_neardup();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Near-duplicate tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Near-duplicate tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_export) {
+        printf("Running Export Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_export();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Export tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Export tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_game) {
+        printf("Running Game Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_game();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Game tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Game tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_paged) {
+        printf("Running Paged Bank Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_paged();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Paged bank tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Paged bank tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_topology) {
+        printf("Running Topology Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_topology();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Topology tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Topology tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_events) {
+        printf("Running Event Queue Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_events();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Event queue tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Event queue tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_pool) {
+        printf("Running Session Pool Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_pool();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Session pool tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Session pool tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_trivia) {
+        printf("Running Library API Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_trivia();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Library API tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Library API tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_websocket) {
+        printf("Running WebSocket Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_websocket();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ WebSocket tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ WebSocket tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_http) {
+        printf("Running HTTP API Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_http();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ HTTP API tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ HTTP API tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_shard) {
+        printf("Running Sharding Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_shard();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Sharding tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Sharding tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_leaderboard) {
+        printf("Running Leaderboard Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_leaderboard();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Leaderboard tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Leaderboard tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
+    if (run_all || run_handoff) {
+        printf("Running Handoff Tests...\n");
+        printf("─────────────────────────────────────────────────────\n");
+        int result = test_handoff();
+        total_tests++;
+        if (result == 0) {
+            printf("✅ Handoff tests PASSED\n\n");
+            passed_tests++;
+        } else {
+            printf("❌ Handoff tests FAILED\n\n");
+            failed_tests++;
+        }
+    }
+    
     // Summary
     printf("═══════════════════════════════════════════════════════\n");
     printf("Test Summary:\n");
@@ -0,0 +1,161 @@
+/**
+ * @file test_neardup.c
+ * @brief Unit tests for MinHash/LSH near-duplicate detection
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/questions.h"
+#include "../src/metrics.h"
+#include "../src/neardup.h"
+
+/**
+ * @brief Add a question whose first option is the correct answer
+ */
+static void add_question(QuestionBank *bank, const char *text,
+                         const char *answer, const char *other) {
+    Question q;
+    memset(&q, 0, sizeof(q));
+    strncpy(q.question, text, sizeof(q.question) - 1);
+    strncpy(q.options[0], answer, sizeof(q.options[0]) - 1);
+    strncpy(q.options[1], other, sizeof(q.options[1]) - 1);
+    q.correct_answer = 0;
+    q.difficulty = DIFFICULTY_EASY;
+    q.category = CATEGORY_GENERAL;
+    question_bank_add(bank, &q);
+}
+
+/**
+ * @brief Test that reworded questions cluster and distinct ones do not
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_neardup_clusters(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    add_question(&bank, "What is the capital of France?", "Paris", "Lyon");
+    add_question(&bank, "Which planet is known as the Red Planet?", "Mars", "Venus");
+    add_question(&bank, "France's capital city is?", "Paris", "Nice");
+    add_question(&bank, "What is the capital of Spain?", "Madrid", "Seville");
+    add_question(&bank, "Which planet is called the Red Planet?", "Mars", "Jupiter");
+    
+    NearDupResult result;
+    int failures = 0;
+    for (int threads = 1; threads <= 4; threads += 3) {
+        if (neardup_find_clusters(&bank, NEARDUP_DEFAULT_THRESHOLD, threads, &result) != 0) {
+            printf("  ❌ test_neardup_clusters: Clustering failed\n");
+            question_bank_free(&bank);
+            return -1;
+        }
+        if (result.cluster_of[2] != 0 || result.cluster_of[4] != 1 ||
+            result.cluster_of[3] != 3 || result.clusters != 2 || result.duplicates != 2) {
+            printf("  ❌ test_neardup_clusters: Wrong clusters with %d thread(s)\n", threads);
+            failures++;
+        }
+        neardup_result_free(&result);
+    }
+    
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_neardup_clusters: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test the similarity estimate of signatures
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_neardup_similarity(void) {
+    Question a, b, c;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&c, 0, sizeof(c));
+    strcpy(a.question, "Who painted the Mona Lisa?");
+    strcpy(a.options[0], "Leonardo da Vinci");
+    strcpy(b.question, "WHO PAINTED THE MONA LISA");
+    strcpy(b.options[0], "Leonardo da Vinci");
+    strcpy(c.question, "Who painted the Mona Lisa?");
+    strcpy(c.options[0], "Michelangelo");
+    
+    MinHashSignature sa, sb, sc;
+    minhash_signature(&a, &sa);
+    minhash_signature(&b, &sb);
+    minhash_signature(&c, &sc);
+    
+    int failures = 0;
+    if (minhash_similarity(&sa, &sb) != 1.0) {
+        printf("  ❌ test_neardup_similarity: Case and punctuation changed the signature\n");
+        failures++;
+    }
+    if (minhash_similarity(&sa, &sc) >= NEARDUP_DEFAULT_THRESHOLD) {
+        printf("  ❌ test_neardup_similarity: Different answers look like duplicates\n");
+        failures++;
+    }
+    
+    if (failures == 0) {
+        printf("  ✅ test_neardup_similarity: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that worker threads run at the same time
+ * 
+ * Each phase has enough work that a thread started before the calling
+ * thread's own share is still running when that share begins.
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_neardup_threads_overlap(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 4000; i++) {
+        char text[64];
+        char answer[32];
+        snprintf(text, sizeof(text), "Question number %d about topic %d?", i, i % 97);
+        snprintf(answer, sizeof(answer), "Answer %d", i);
+        add_question(&bank, text, answer, "Other");
+    }
+    
+    NearDupResult result;
+    int failures = 0;
+    if (neardup_find_clusters(&bank, NEARDUP_DEFAULT_THRESHOLD, 2, &result) != 0) {
+        printf("  ❌ test_neardup_threads_overlap: Clustering failed\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    double peak = metrics_get("neardup.peak_workers");
+    if (peak != 2.0) {
+        printf("  ❌ test_neardup_threads_overlap: %.0f of 2 workers ran at once\n", peak);
+        failures++;
+    }
+    neardup_result_free(&result);
+    
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_neardup_threads_overlap: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all near-duplicate tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_neardup(void) {
+    int failures = 0;
+    
+    failures += test_neardup_clusters();
+    failures += test_neardup_similarity();
+    failures += test_neardup_threads_overlap();
+    
+    return failures;
+}
@@ -0,0 +1,275 @@
+/**
+ * @file test_paged.c
+ * @brief Unit tests for the out-of-core question bank
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/questions.h"
+#include "../src/export.h"
+#include "../src/game.h"
+#include "../src/paged.h"
+
+#define PAGED_TEST_QUESTIONS 3000
+
+/**
+ * @brief Write a pack of numbered questions to a temporary file
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int write_test_pack(QuestionBank *bank, char *path) {
+    if (question_bank_init(bank) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < PAGED_TEST_QUESTIONS; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question),
+                 "Question number %d, padded so that a page holds only a few dozen of them?", i);
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Answer %d for question %d", o, i);
+        }
+        q.id = (uint32_t)i + 1;
+        q.correct_answer = i % MAX_OPTIONS;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        if (question_bank_add(bank, &q) != 0) {
+            return -1;
+        }
+    }
+
+    strcpy(path, "/tmp/trivia_paged_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    ExportWriter writer;
+    long written = -1;
+    if (export_writer_init(&writer, 0) == 0) {
+        written = export_bank(&writer, fd, bank, NULL, EXPORT_PACK);
+        export_writer_free(&writer);
+    }
+    close(fd);
+    return written == PAGED_TEST_QUESTIONS ? 0 : -1;
+}
+
+/**
+ * @brief Test reads through a cache much smaller than the pack
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_paged_bank_reads(void) {
+    QuestionBank bank;
+    char path[64];
+    if (write_test_pack(&bank, path) != 0) {
+        printf("  ❌ test_paged_bank_reads: Failed to write pack\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    int failures = 0;
+    PagedBank paged;
+    size_t cap = 512 * 1024;
+    if (paged_bank_open(&paged, path, cap) != PAGED_TEST_QUESTIONS) {
+        printf("  ❌ test_paged_bank_reads: Failed to open pack\n");
+        question_bank_free(&bank);
+        unlink(path);
+        return -1;
+    }
+    if (paged.resident_bytes > cap || paged.slot_count >= (int32_t)paged.page_count) {
+        printf("  ❌ test_paged_bank_reads: Cache not bounded by the cap\n");
+        failures++;
+    }
+    
+    /* Strided order: every read lands far from the previous one. */
+    for (size_t n = 0; n < PAGED_TEST_QUESTIONS && failures == 0; n++) {
+        size_t i = (n * 977) % PAGED_TEST_QUESTIONS;
+        Question q;
+        if (paged_bank_read(&paged, i, &q) != 0 ||
+            strcmp(q.question, bank.questions[i].question) != 0 ||
+            strcmp(q.options[3], bank.questions[i].options[3]) != 0 ||
+            q.correct_answer != bank.questions[i].correct_answer ||
+            q.question_width != bank.questions[i].question_width) {
+            printf("  ❌ test_paged_bank_reads: Question %zu read back wrong\n", i);
+            failures++;
+        }
+    }
+    
+    PagedStats stats;
+    paged_bank_stats(&paged, &stats);
+    if (stats.evictions == 0 || stats.misses == 0) {
+        printf("  ❌ test_paged_bank_reads: Expected misses and evictions\n");
+        failures++;
+    }
+    
+    paged_bank_close(&paged);
+    if (paged_bank_open(&paged, path, 1024) != -1) {
+        printf("  ❌ test_paged_bank_reads: Cap below the metadata size accepted\n");
+        paged_bank_close(&paged);
+        failures++;
+    }
+    
+    question_bank_free(&bank);
+    unlink(path);
+    if (failures == 0) {
+        printf("  ✅ test_paged_bank_reads: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test a bank opened over a mapping reads questions in place
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_paged_bank_mapped(void) {
+    QuestionBank bank;
+    char path[64];
+    if (write_test_pack(&bank, path) != 0) {
+        printf("  ❌ test_paged_bank_mapped: Failed to write pack\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    PackMapping map;
+    if (fd < 0 || pack_map(&map, fd, false) != 0) {
+        printf("  ❌ test_paged_bank_mapped: Failed to map pack\n");
+        if (fd >= 0) {
+            close(fd);
+        }
+        question_bank_free(&bank);
+        unlink(path);
+        return -1;
+    }
+    close(fd);
+    
+    int failures = 0;
+    PagedBank paged;
+    if (paged_bank_open_mapped(&paged, &map) != PAGED_TEST_QUESTIONS) {
+        printf("  ❌ test_paged_bank_mapped: Failed to open mapped pack\n");
+        pack_unmap(&map);
+        question_bank_free(&bank);
+        unlink(path);
+        return -1;
+    }
+    const char *begin = (const char*)map.data;
+    if ((const char*)paged.records < begin || (const char*)paged.records >= begin + map.len ||
+        paged.slot_count != 0 || paged.prefetcher_running) {
+        printf("  ❌ test_paged_bank_mapped: Records copied or cache set up\n");
+        failures++;
+    }
+    
+    for (size_t n = 0; n < PAGED_TEST_QUESTIONS && failures == 0; n++) {
+        size_t i = (n * 977) % PAGED_TEST_QUESTIONS;
+        Question q;
+        paged_bank_prefetch(&paged, i);
+        if (paged_bank_read(&paged, i, &q) != 0 ||
+            strcmp(q.question, bank.questions[i].question) != 0 ||
+            strcmp(q.options[3], bank.questions[i].options[3]) != 0 ||
+            q.correct_answer != bank.questions[i].correct_answer ||
+            q.question_width != bank.questions[i].question_width) {
+            printf("  ❌ test_paged_bank_mapped: Question %zu read back wrong\n", i);
+            failures++;
+        }
+    }
+    if (paged.difficulty_count[DIFFICULTY_HARD] != PAGED_TEST_QUESTIONS / DIFFICULTY_COUNT) {
+        printf("  ❌ test_paged_bank_mapped: Wrong difficulty index\n");
+        failures++;
+    }
+    
+    paged_bank_close(&paged);
+    pack_unmap(&map);
+    question_bank_free(&bank);
+    unlink(path);
+    if (failures == 0) {
+        printf("  ✅ test_paged_bank_mapped: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test a game over a paged bank prefetches the next question
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_paged_game_prefetch(void) {
+    QuestionBank bank;
+    char path[64];
+    if (write_test_pack(&bank, path) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    question_bank_free(&bank);
+    
+    PagedBank paged;
+    if (paged_bank_open(&paged, path, 512 * 1024) < 0) {
+        unlink(path);
+        return -1;
+    }
+    
+    GameConfig config;
+    memset(&config, 0, sizeof(config));
+    config.questions_per_game = 50;
+    config.difficulty = DIFFICULTY_HARD;
+    config.num_players = 1;
+    config.shuffle_options = true;
+    GameState game;
+    int failures = 0;
+    if (game_init_paged(&game, &paged, &config) != 0) {
+        paged_bank_close(&paged);
+        unlink(path);
+        return -1;
+    }
+    
+    for (int i = 0; i < 50 && failures == 0; i++) {
+        Question *q = game_draw_question(&game);
+        if (q == NULL || q->difficulty != DIFFICULTY_HARD || game.next_index == SIZE_MAX) {
+            printf("  ❌ test_paged_game_prefetch: Bad draw %d\n", i);
+            failures++;
+            break;
+        }
+        game_submit_answer(&game, q, game_option_choice(&game, q->correct_answer), 10);
+        /* A player takes longer to answer than a page takes to load. */
+        paged_bank_prefetch_wait(&paged);
+    }
+    if (failures == 0 && game.stats.correct_answers != 50) {
+        printf("  ❌ test_paged_game_prefetch: Answers graded wrong\n");
+        failures++;
+    }
+    
+    PagedStats stats;
+    paged_bank_stats(&paged, &stats);
+    /* Only the first question is read before anything could be prefetched. */
+    if (stats.prefetched == 0 || stats.misses > 1) {
+        printf("  ❌ test_paged_game_prefetch: Prefetch did not serve reads "
+               "(%llu misses, %llu prefetched)\n",
+               (unsigned long long)stats.misses, (unsigned long long)stats.prefetched);
+        failures++;
+    }
+    
+    game_cleanup(&game);
+    paged_bank_close(&paged);
+    unlink(path);
+    if (failures == 0) {
+        printf("  ✅ test_paged_game_prefetch: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all paged bank tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_paged(void) {
+    int failures = 0;
+    
+    failures += test_paged_bank_reads();
+    failures += test_paged_bank_mapped();
+    failures += test_paged_game_prefetch();
+    
+    return failures;
+}
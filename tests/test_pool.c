@@ -0,0 +1,194 @@
+/**
+ * @file test_pool.c
+ * @brief Unit tests for the per-worker session pools
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "../src/game.h"
+#include "../src/metrics.h"
+#include "../src/pool.h"
+
+#define POOL_TEST_QUESTIONS 50
+#define POOL_TEST_GAMES 100
+
+/**
+ * @brief Test block reuse, alignment, zeroing and the cache limit
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_pool_blocks(void) {
+    int failures = 0;
+    SessionPool pool;
+    if (session_pool_init(&pool, 2) != 0) {
+        printf("  ❌ test_pool_blocks: Failed to create pool\n");
+        return 1;
+    }
+
+    char *a = (char*)session_pool_alloc(&pool, 100);
+    if (a == NULL || (uintptr_t)a % _Alignof(max_align_t) != 0) {
+        printf("  ❌ test_pool_blocks: Block missing or misaligned\n");
+        session_pool_destroy(&pool);
+        return 1;
+    }
+    memset(a, 0xAB, 100);
+    session_pool_release(&pool, a);
+
+    char *b = (char*)session_pool_calloc(&pool, 120, 1);
+    if (b != a) {
+        printf("  ❌ test_pool_blocks: Same-class block not reused\n");
+        failures++;
+    }
+    for (int i = 0; b != NULL && i < 120; i++) {
+        if (b[i] != 0) {
+            printf("  ❌ test_pool_blocks: Reused block not zeroed\n");
+            failures++;
+            break;
+        }
+    }
+    if (pool.hits != 1 || pool.misses != 1 || session_pool_hit_rate(&pool) != 0.5) {
+        printf("  ❌ test_pool_blocks: Expected 1 hit and 1 miss, got %llu/%llu\n",
+               (unsigned long long)pool.hits, (unsigned long long)pool.misses);
+        failures++;
+    }
+
+    char *big = (char*)session_pool_alloc(&pool, 5000);
+    session_pool_release(&pool, big);
+    char *c = (char*)session_pool_alloc(&pool, 100);
+    if (c == b) {
+        printf("  ❌ test_pool_blocks: Block handed out twice\n");
+        failures++;
+    }
+
+    void *blocks[3];
+    for (int i = 0; i < 3; i++) {
+        blocks[i] = session_pool_alloc(&pool, 8);
+    }
+    for (int i = 0; i < 3; i++) {
+        session_pool_release(&pool, blocks[i]);
+    }
+    int cls = 0;
+    while (cls < POOL_SIZE_CLASSES && pool.free_lists[cls] == NULL) {
+        cls++;
+    }
+    if (cls == POOL_SIZE_CLASSES || pool.cached[cls] != 2) {
+        printf("  ❌ test_pool_blocks: Cache limit of 2 not applied\n");
+        failures++;
+    }
+    if (session_pool_calloc(&pool, SIZE_MAX / 2, 4) != NULL) {
+        printf("  ❌ test_pool_blocks: Overflowing calloc succeeded\n");
+        failures++;
+    }
+
+    session_pool_release(&pool, b);
+    session_pool_release(&pool, c);
+    session_pool_destroy(&pool);
+    if (failures == 0) {
+        printf("  ✅ test_pool_blocks: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test that games started and ended through a pool stop allocating
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_pool_games(void) {
+    int failures = 0;
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        printf("  ❌ test_pool_games: Failed to create bank\n");
+        return 1;
+    }
+    for (int i = 0; i < POOL_TEST_QUESTIONS; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Pooled question %d?", i);
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Option %d", o);
+        }
+        q.id = (uint32_t)i + 1;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        question_bank_add(&bank, &q);
+    }
+
+    GameConfig config;
+    config.questions_per_game = 5;
+    config.time_per_question = 30;
+    config.difficulty = (Difficulty)-1;
+    config.use_timer = false;
+    config.num_players = 3;
+    config.shuffle_options = false;
+
+    SessionPool pool;
+    session_pool_init(&pool, 0);
+    GameState *games[2];
+    for (int g = 0; g < POOL_TEST_GAMES && failures == 0; g++) {
+        for (int i = 0; i < 2; i++) {
+            games[i] = game_create(&pool, &bank, &config);
+            if (games[i] == NULL || games[i]->players == NULL) {
+                printf("  ❌ test_pool_games: game_create failed in game %d\n", g);
+                failures++;
+                break;
+            }
+            if (games[i]->used_questions[0] || games[i]->players[2].score != 0) {
+                printf("  ❌ test_pool_games: Recycled game not reset\n");
+                failures++;
+            }
+            Question *q = game_draw_question(games[i]);
+            game_submit_answer(games[i], q, game_option_choice(games[i], q->correct_answer), 20);
+            games[i]->used_questions[0] = true;
+        }
+        for (int i = 0; i < 2; i++) {
+            game_destroy(games[i]);
+        }
+    }
+
+    /* Two live games of three blocks each: six misses, the rest hits. */
+    if (failures == 0 && pool.misses != 6) {
+        printf("  ❌ test_pool_games: %llu allocator calls, expected 6\n",
+               (unsigned long long)pool.misses);
+        failures++;
+    }
+
+    metrics_reset();
+    session_pool_publish(&pool);
+    session_pool_publish(&pool);
+    if (metrics_get("pool.misses") != 12.0 ||
+        metrics_get("pool.hit_rate") != session_pool_hit_rate(&pool)) {
+        printf("  ❌ test_pool_games: Pool metrics not published\n");
+        failures++;
+    }
+
+    GameState plain;
+    if (game_init(&plain, &bank, &config) != 0 || plain.pool != NULL) {
+        printf("  ❌ test_pool_games: game_init should not use a pool\n");
+        failures++;
+    }
+    game_cleanup(&plain);
+
+    session_pool_destroy(&pool);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_pool_games: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all session pool tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_pool(void) {
+    int failures = 0;
+
+    failures += test_pool_blocks();
+    failures += test_pool_games();
+
+    return failures;
+}
@@ -6,7 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "../src/questions.h"
+#include "../src/utf8.h"
+#include "../src/locales.h"
 
 /**
  * @brief Test question bank initialization
@@ -137,6 +140,284 @@ static int test_question_bank_free(void) {
     return 0;
 }
 
+/**
+ * @brief Test parsing questions from an in-memory buffer
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_question_bank_load_from_buffer(void) {
+    const char *json =
+        "[\n"
+        "  {\"question\": \"Braces {inside} text?\", \"options\": [\"A\", \"B\", \"C\"],"
+        "   \"correct\": 2, \"difficulty\": \"hard\"},\n"
+        "  {\"question\": \"Bad index?\", \"options\": [\"A\", \"B\"], \"correct\": 5},\n"
+        "  {\"question\": \"Second?\", \"options\": [\"id\", \"Y\"], \"correct\": 0, \"id\": 7}\n"
+        "]\n";
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    
+    int loaded = question_bank_load_from_buffer(&bank, json, strlen(json));
+    if (loaded != 2 || bank.count != 2) {
+        printf("  ❌ test_question_bank_load_from_buffer: Expected 2 questions, got %d\n", loaded);
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    const Question *q = &bank.questions[0];
+    if (strcmp(q->question, "Braces {inside} text?") != 0 ||
+        q->correct_answer != 2 || q->difficulty != DIFFICULTY_HARD ||
+        question_option_count(q) != 3) {
+        printf("  ❌ test_question_bank_load_from_buffer: Parsed fields mismatch\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    /* An option reading "id" is text, not the key. */
+    if (bank.questions[1].id != 7 || strcmp(bank.questions[1].options[0], "id") != 0) {
+        printf("  ❌ test_question_bank_load_from_buffer: ID read from option text\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    question_bank_free(&bank);
+    printf("  ✅ test_question_bank_load_from_buffer: PASSED\n");
+    return 0;
+}
+
+/**
+ * @brief Test UTF-8 validation at load and precomputed display widths
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_question_bank_utf8_widths(void) {
+    const char *json =
+        "[{\"question\": \"日本の首都は?\", \"options\": [\"東京\", \"Café\"], \"correct\": 0},"
+        " {\"question\": \"Bad \xC0\xAF byte?\", \"options\": [\"A\", \"B\"], \"correct\": 0},"
+        " {\"question\": \"Cafe\xCC\x81?\", \"options\": [\"Yes\", \"No\"], \"correct\": 1}]";
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    
+    int loaded = question_bank_load_from_buffer(&bank, json, strlen(json));
+    if (loaded != 2) {
+        printf("  ❌ test_question_bank_utf8_widths: Loaded %d, expected 2\n", loaded);
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    const Question *q = &bank.questions[0];
+    if (q->question_width != 13 || q->option_widths[0] != 4 || q->option_widths[1] != 4 ||
+        bank.questions[1].question_width != 5) {
+        printf("  ❌ test_question_bank_utf8_widths: Wrong widths %u/%u/%u/%u\n",
+               q->question_width, q->option_widths[0], q->option_widths[1],
+               bank.questions[1].question_width);
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    char truncated[] = "abc\xE6\x97";
+    utf8_trim_partial(truncated);
+    if (strcmp(truncated, "abc") != 0 || utf8_validate("\xED\xA0\x80", 3) ||
+        !utf8_validate("plain ascii text longer than sixteen bytes ✓",
+                       strlen("plain ascii text longer than sixteen bytes ✓"))) {
+        printf("  ❌ test_question_bank_utf8_widths: Validation helpers failed\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    question_bank_free(&bank);
+    printf("  ✅ test_question_bank_utf8_widths: PASSED\n");
+    return 0;
+}
+
+/**
+ * @brief Test translated variants share the base question's metadata
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_locale_variants(void) {
+    const char *base_json =
+        "[{\"id\": 7, \"question\": \"Capital of France?\", \"options\": [\"Lyon\", \"Paris\"],"
+        " \"correct\": 1, \"difficulty\": \"hard\"},"
+        " {\"id\": 9, \"question\": \"Red planet?\", \"options\": [\"Mars\", \"Venus\"], \"correct\": 0}]";
+    const char *fr_json =
+        "[{\"id\": 9, \"question\": \"Planète rouge ?\", \"options\": [\"Mars\"]},"
+        " {\"id\": 7, \"question\": \"Capitale de la France ?\", \"options\": [\"Lyon\", \"Paris\"]},"
+        " {\"id\": 42, \"question\": \"Inconnue ?\", \"options\": [\"Oui\", \"Non\"]}]";
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    question_bank_load_from_buffer(&bank, base_json, strlen(base_json));
+    
+    LocaleBank fr;
+    int loaded = locale_bank_load_from_buffer(&fr, &bank, "fr", fr_json, strlen(fr_json));
+    Question scratch;
+    const Question *q0 = locale_resolve(&fr, &bank, 0, &scratch);
+    int failures = 0;
+    if (loaded != 1 || q0 != &scratch ||
+        strcmp(q0->question, "Capitale de la France ?") != 0 ||
+        q0->question_width != 23 || q0->correct_answer != 1 ||
+        q0->difficulty != DIFFICULTY_HARD || q0->id != 7) {
+        printf("  ❌ test_locale_variants: Wrong translated question (loaded %d)\n", loaded);
+        failures++;
+    }
+    if (locale_resolve(&fr, &bank, 1, &scratch) != &bank.questions[1]) {
+        printf("  ❌ test_locale_variants: Mismatched variant should fall back to base text\n");
+        failures++;
+    }
+    
+    locale_bank_free(&fr);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_locale_variants: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Fill a question with text and two options
+ */
+static void make_question(Question *q, const char *text, int correct, Difficulty difficulty) {
+    memset(q, 0, sizeof(*q));
+    strncpy(q->question, text, sizeof(q->question) - 1);
+    strncpy(q->options[0], "Yes", sizeof(q->options[0]) - 1);
+    strncpy(q->options[1], "No", sizeof(q->options[1]) - 1);
+    q->correct_answer = correct;
+    q->difficulty = difficulty;
+    q->category = CATEGORY_GENERAL;
+}
+
+/**
+ * @brief Test exact duplicate removal and validation
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_question_bank_dedup_validate(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    
+    Question q;
+    make_question(&q, "One?", 0, DIFFICULTY_EASY);
+    question_bank_add(&bank, &q);
+    make_question(&q, "Two?", 1, DIFFICULTY_MEDIUM);
+    question_bank_add(&bank, &q);
+    make_question(&q, "One?", 0, DIFFICULTY_EASY);
+    question_bank_add(&bank, &q);
+    make_question(&q, "Broken?", 3, DIFFICULTY_EASY);
+    question_bank_add(&bank, &q);
+    
+    QuestionPrepareReport report;
+    int prepared = question_bank_prepare(&bank, &report);
+    if (prepared != 2 || report.duplicates != 1 || report.invalid != 1 || bank.count != 2 ||
+        !bank.index_valid || strcmp(bank.questions[1].question, "Two?") != 0) {
+        printf("  ❌ test_question_bank_dedup_validate: Expected 1 duplicate and 1 invalid\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    question_bank_free(&bank);
+    printf("  ✅ test_question_bank_dedup_validate: PASSED\n");
+    return 0;
+}
+
+/**
+ * @brief Test a JSON file loads as written, duplicates and all
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_question_bank_load_from_json_keeps_order(void) {
+    const char *json =
+        "[{\"question\": \"One?\", \"options\": [\"Yes\", \"No\"], \"correct\": 0},"
+        " {\"question\": \"Two?\", \"options\": [\"Yes\", \"No\"], \"correct\": 1},"
+        " {\"question\": \"One?\", \"options\": [\"Yes\", \"No\"], \"correct\": 0}]";
+    char path[64];
+    strcpy(path, "/tmp/trivia_questions_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (file == NULL) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    fputs(json, file);
+    fclose(file);
+    
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        unlink(path);
+        return -1;
+    }
+    int loaded = question_bank_load_from_json(&bank, path);
+    unlink(path);
+    if (loaded != 3 || bank.count != 3 || !bank.index_valid ||
+        strcmp(bank.questions[2].question, "One?") != 0) {
+        printf("  ❌ test_question_bank_load_from_json_keeps_order: Loaded %d, expected 3\n",
+               loaded);
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    question_bank_free(&bank);
+    printf("  ✅ test_question_bank_load_from_json_keeps_order: PASSED\n");
+    return 0;
+}
+
+/**
+ * @brief Test indexed draws honour the difficulty filter and used flags
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_question_bank_indexed_draws(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    
+    Question q;
+    for (int i = 0; i < 30; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "Q%d?", i);
+        make_question(&q, text, 0, (Difficulty)(i % DIFFICULTY_COUNT));
+        question_bank_add(&bank, &q);
+    }
+    if (question_bank_build_index(&bank) != 0 || !bank.index_valid ||
+        bank.difficulty_count[DIFFICULTY_HARD] != 10) {
+        printf("  ❌ test_question_bank_indexed_draws: Index build failed\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    bool used[30] = { false };
+    for (int i = 0; i < 10; i++) {
+        Question *drawn = question_bank_get_random_unused(&bank, DIFFICULTY_HARD, used, 30);
+        size_t idx = drawn != NULL ? (size_t)(drawn - bank.questions) : 0;
+        if (drawn == NULL || drawn->difficulty != DIFFICULTY_HARD || used[idx]) {
+            printf("  ❌ test_question_bank_indexed_draws: Bad draw %d\n", i);
+            question_bank_free(&bank);
+            return -1;
+        }
+        used[idx] = true;
+    }
+    
+    if (question_bank_get_random_unused(&bank, DIFFICULTY_HARD, used, 30) != NULL) {
+        printf("  ❌ test_question_bank_indexed_draws: Drew a used question\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    question_bank_free(&bank);
+    printf("  ✅ test_question_bank_indexed_draws: PASSED\n");
+    return 0;
+}
+
 /**
  * @brief Run all questions tests
  * 
@@ -149,6 +430,12 @@ int test_questions(void) {
     failures += test_question_bank_add();
     failures += test_difficulty_category_strings();
     failures += test_question_bank_free();
+    failures += test_question_bank_load_from_buffer();
+    failures += test_question_bank_utf8_widths();
+    failures += test_locale_variants();
+    failures += test_question_bank_dedup_validate();
+    failures += test_question_bank_load_from_json_keeps_order();
+    failures += test_question_bank_indexed_draws();
     
     return failures;
 }
@@ -0,0 +1,141 @@
+/**
+ * @file test_search.c
+ * @brief Unit tests for the inverted full-text index
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/questions.h"
+#include "../src/search.h"
+
+/**
+ * @brief Add a question with the given text and options to a bank
+ */
+static void add_question(QuestionBank *bank, const char *text,
+                         const char *a, const char *b) {
+    Question q;
+    memset(&q, 0, sizeof(q));
+    strncpy(q.question, text, sizeof(q.question) - 1);
+    strncpy(q.options[0], a, sizeof(q.options[0]) - 1);
+    strncpy(q.options[1], b, sizeof(q.options[1]) - 1);
+    q.correct_answer = 0;
+    q.difficulty = DIFFICULTY_EASY;
+    q.category = CATEGORY_GENERAL;
+    question_bank_add(bank, &q);
+}
+
+/**
+ * @brief Test term and phrase queries on a small bank
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_search_terms_and_phrases(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    add_question(&bank, "Which planet is known as the Red Planet?", "Venus", "Mars");
+    add_question(&bank, "What is the capital of France?", "Paris", "Red Square");
+    add_question(&bank, "How many moons does MARS have?", "Two", "Planet red");
+    
+    SearchIndex index;
+    if (search_index_build(&index, &bank) != 0) {
+        printf("  ❌ test_search_terms_and_phrases: Build failed\n");
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    size_t results[8];
+    int failures = 0;
+    
+    long n = search_query(&index, "mars", results, 8);
+    if (n != 2 || results[0] != 0 || results[1] != 2) {
+        printf("  ❌ test_search_terms_and_phrases: Term query returned %ld\n", n);
+        failures++;
+    }
+    
+    n = search_query(&index, "\"red planet\"", results, 8);
+    if (n != 1 || results[0] != 0) {
+        printf("  ❌ test_search_terms_and_phrases: Phrase query returned %ld\n", n);
+        failures++;
+    }
+    
+    n = search_query(&index, "\"square what\"", results, 8);
+    if (n != 0) {
+        printf("  ❌ test_search_terms_and_phrases: Phrase matched across fields\n");
+        failures++;
+    }
+    
+    n = search_query(&index, "capital PARIS", results, 8);
+    if (n != 1 || results[0] != 1) {
+        printf("  ❌ test_search_terms_and_phrases: AND query returned %ld\n", n);
+        failures++;
+    }
+    
+    if (search_query(&index, "jupiter", results, 8) != 0 ||
+        search_query(&index, "  ?! ", results, 8) != -1) {
+        printf("  ❌ test_search_terms_and_phrases: Missing or empty query mismatch\n");
+        failures++;
+    }
+    
+    search_index_free(&index);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_search_terms_and_phrases: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test skip pointers on long posting lists
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_search_long_postings(void) {
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 5000; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "Common question %d %s", i, i % 1000 == 999 ? "rare" : "");
+        add_question(&bank, text, "Yes", "No");
+    }
+    
+    SearchIndex index;
+    if (search_index_build(&index, &bank) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    
+    size_t results[8];
+    long common = search_query(&index, "common", NULL, 0);
+    long rare = search_query(&index, "common rare", results, 8);
+    int failures = 0;
+    if (common != 5000 || rare != 5 || results[0] != 999 || results[4] != 4999) {
+        printf("  ❌ test_search_long_postings: Got %ld common, %ld rare\n", common, rare);
+        failures++;
+    }
+    
+    search_index_free(&index);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_search_long_postings: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all search tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_search(void) {
+    int failures = 0;
+    
+    failures += test_search_terms_and_phrases();
+    failures += test_search_long_postings();
+    
+    return failures;
+}
@@ -0,0 +1,407 @@
+/**
+ * @file test_shard.c
+ * @brief Unit tests for bank sharding, and shard processes behind a router
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/export.h"
+#include "../src/shard.h"
+
+#define SHARD_TEST_QUESTIONS 300
+#define SHARD_TEST_PROCESSES 3
+
+static void build_bank(QuestionBank *bank, int questions) {
+    question_bank_init(bank);
+    for (int i = 0; i < questions; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Shard question %d?", i);
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Answer %d", o);
+        }
+        q.correct_answer = i % MAX_OPTIONS;
+        q.id = (uint32_t)i + 1;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        q.category = (Category)((i / DIFFICULTY_COUNT) % CATEGORY_COUNT);
+        question_bank_add(bank, &q);
+    }
+    question_bank_build_index(bank);
+}
+
+/**
+ * @brief Whether a draw's questions are distinct and match its filters
+ */
+static bool draw_ok(const ShardDraw *draw, const Question *questions, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if ((draw->difficulty >= 0 && questions[i].difficulty != (Difficulty)draw->difficulty) ||
+            (draw->category >= 0 && questions[i].category != (Category)draw->category)) {
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (questions[j].id == questions[i].id) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Test map parsing and question assignment
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_shard_map(void) {
+    int failures = 0;
+    ShardMap map;
+    Question q;
+    memset(&q, 0, sizeof(q));
+
+    if (shard_map_parse(&map, "category:3") != 0 || map.count != 3 ||
+        map.scheme != SHARD_BY_CATEGORY) {
+        printf("  ❌ test_shard_map: category:3 not parsed\n");
+        failures++;
+    } else {
+        q.category = CATEGORY_SPORTS;
+        if (shard_of(&map, &q) != 0) {
+            printf("  ❌ test_shard_map: Sports (3) not on shard 0 of 3\n");
+            failures++;
+        }
+    }
+
+    if (shard_map_parse(&map, "id:100,200") != 0 || map.count != 3 || map.scheme != SHARD_BY_ID) {
+        printf("  ❌ test_shard_map: id:100,200 not parsed\n");
+        failures++;
+    } else {
+        static const uint32_t ids[] = { 0, 99, 100, 199, 200, 4000000000u };
+        static const int expected[] = { 0, 0, 1, 1, 2, 2 };
+        for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+            q.id = ids[i];
+            if (shard_of(&map, &q) != expected[i]) {
+                printf("  ❌ test_shard_map: ID %u on shard %d\n", ids[i], shard_of(&map, &q));
+                failures++;
+            }
+        }
+    }
+
+    static const char *const invalid[] = {
+        "category:0", "category:6", "id:", "id:200,100", "id:5,", "range:2", ""
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (shard_map_parse(&map, invalid[i]) == 0) {
+            printf("  ❌ test_shard_map: Invalid spec '%s' accepted\n", invalid[i]);
+            failures++;
+        }
+    }
+
+    if (failures == 0) {
+        printf("  ✅ test_shard_map: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test retaining one shard and drawing from it
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_shard_store(void) {
+    int failures = 0;
+    QuestionBank bank;
+    build_bank(&bank, 60);
+    ShardMap map;
+    shard_map_parse(&map, "category:2");
+
+    /* Shard 1 of 2 keeps science (1) and sports (3): 12 questions each. */
+    long kept = shard_bank_retain(&bank, &map, 1);
+    bool only_own = kept == 24 && bank.count == 24 && bank.capacity == 24 && bank.index_valid;
+    for (size_t i = 0; i < bank.count && only_own; i++) {
+        only_own = shard_of(&map, &bank.questions[i]) == 1;
+    }
+    if (!only_own) {
+        printf("  ❌ test_shard_store: Retained %ld questions, expected 24 of shard 1\n", kept);
+        failures++;
+    }
+
+    ShardStore store;
+    if (shard_store_init(&store, &bank, &map, 1) != 0) {
+        printf("  ❌ test_shard_store: Store not initialized\n");
+        question_bank_free(&bank);
+        return failures + 1;
+    }
+    const Question *picked[SHARD_MAX_DRAW];
+    ShardDraw draws[] = {
+        { -1, -1, 10, 12345 },                       /* large list: rejection */
+        { DIFFICULTY_HARD, CATEGORY_SPORTS, 3, 7 },  /* small list: selection */
+        { DIFFICULTY_EASY, CATEGORY_SCIENCE, 20, 9 },/* more than there are */
+        { -1, CATEGORY_HISTORY, 5, 11 }              /* another shard's category */
+    };
+    static const int expected[] = { 10, 3, 4, 0 };
+    for (size_t i = 0; i < sizeof(draws) / sizeof(draws[0]); i++) {
+        int drawn = shard_store_draw(&store, &draws[i], picked);
+        Question got[SHARD_MAX_DRAW];
+        for (int k = 0; k < drawn; k++) {
+            got[k] = *picked[k];
+        }
+        if (drawn != expected[i] || !draw_ok(&draws[i], got, (size_t)drawn)) {
+            printf("  ❌ test_shard_store: Draw %zu returned %d questions (expected %d)\n",
+                   i, drawn, expected[i]);
+            failures++;
+        }
+    }
+
+    /* The same seed draws the same questions. */
+    const Question *again[SHARD_MAX_DRAW];
+    shard_store_draw(&store, &draws[0], picked);
+    shard_store_draw(&store, &draws[0], again);
+    if (memcmp(picked, again, 10 * sizeof(picked[0])) != 0) {
+        printf("  ❌ test_shard_store: Draw not reproducible from its seed\n");
+        failures++;
+    }
+
+    shard_store_free(&store);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_shard_store: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test loading one shard straight from a JSON file and from a pack
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_shard_load(void) {
+    int failures = 0;
+    QuestionBank full;
+    build_bank(&full, 60);
+    ShardMap map;
+    shard_map_parse(&map, "category:2");
+
+    static const ExportFormat formats[] = { EXPORT_JSON, EXPORT_PACK };
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        char path[] = "/tmp/trivia_shard_XXXXXX";
+        int fd = mkstemp(path);
+        ExportWriter writer;
+        long written = -1;
+        if (fd >= 0 && export_writer_init(&writer, 0) == 0) {
+            written = export_bank(&writer, fd, &full, NULL, formats[f]);
+            export_writer_free(&writer);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (written != 60) {
+            printf("  ❌ test_shard_load: Failed to write format %d\n", (int)formats[f]);
+            failures++;
+            unlink(path);
+            continue;
+        }
+
+        QuestionBank bank;
+        question_bank_init(&bank);
+        size_t seen = 0;
+        long kept = shard_bank_load(&bank, path, &map, 1, &seen);
+        bool only_own = kept == 24 && seen == 60 && bank.count == 24 && bank.index_valid;
+        for (size_t i = 0; i < bank.count && only_own; i++) {
+            only_own = shard_of(&map, &bank.questions[i]) == 1;
+        }
+        if (!only_own) {
+            printf("  ❌ test_shard_load: Format %d kept %ld of %zu, expected 24 of 60\n",
+                   (int)formats[f], kept, seen);
+            failures++;
+        }
+        question_bank_free(&bank);
+        unlink(path);
+    }
+
+    question_bank_free(&full);
+    if (failures == 0) {
+        printf("  ✅ test_shard_load: PASSED\n");
+    }
+    return failures;
+}
+
+static void* run_router(void *arg) {
+    shard_server_run((ShardServer*)arg);
+    return NULL;
+}
+
+/**
+ * @brief Start one shard in a child process
+ *
+ * @return pid_t Child, or -1 on error; the shard's port is stored in port
+ */
+static pid_t start_shard(const ShardMap *map, int shard, int *port) {
+    QuestionBank bank;
+    build_bank(&bank, SHARD_TEST_QUESTIONS);
+    ShardStore store;
+    ShardServer server;
+    if (shard_bank_retain(&bank, map, shard) < 0 ||
+        shard_store_init(&store, &bank, map, shard) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    if (shard_server_init(&server, "127.0.0.1", 0, &store, NULL) != 0) {
+        shard_store_free(&store);
+        question_bank_free(&bank);
+        return -1;
+    }
+    *port = server.port;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        shard_server_run(&server);
+        _exit(0);
+    }
+    shard_server_destroy(&server);
+    shard_store_free(&store);
+    question_bank_free(&bank);
+    return pid;
+}
+
+/**
+ * @brief Three shard processes behind a router, with two clients over loopback
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_shard_router(void) {
+    int failures = 0;
+    static const char *const specs[] = { "category:3", "id:90,180" };
+    for (size_t m = 0; m < sizeof(specs) / sizeof(specs[0]); m++) {
+        ShardMap map;
+        shard_map_parse(&map, specs[m]);
+        pid_t pids[SHARD_TEST_PROCESSES];
+        char addr_text[SHARD_TEST_PROCESSES][32];
+        const char *addrs[SHARD_TEST_PROCESSES];
+        int started = 0;
+        for (int s = SHARD_TEST_PROCESSES - 1; s >= 0; s--) {
+            /* Started in reverse: the router orders shards by what they report. */
+            int port = 0;
+            pids[s] = start_shard(&map, s, &port);
+            if (pids[s] < 0) {
+                break;
+            }
+            snprintf(addr_text[started], sizeof(addr_text[started]), "127.0.0.1:%d", port);
+            addrs[started] = addr_text[started];
+            started++;
+        }
+
+        ShardRouter router;
+        ShardServer server;
+        pthread_t thread;
+        bool running = false;
+        if (started != SHARD_TEST_PROCESSES ||
+            shard_router_connect(&router, addrs, SHARD_TEST_PROCESSES) != 0 ||
+            shard_server_init(&server, "127.0.0.1", 0, NULL, &router) != 0 ||
+            pthread_create(&thread, NULL, run_router, &server) != 0) {
+            printf("  ❌ test_shard_router: %s: failed to start shards and router\n", specs[m]);
+            failures++;
+        } else {
+            running = true;
+        }
+
+        int clients[2] = { -1, -1 };
+        if (running) {
+            clients[0] = shard_connect("127.0.0.1", server.port);
+            clients[1] = shard_connect("127.0.0.1", server.port);
+        }
+        ShardDraw draws[CATEGORY_COUNT + 3];
+        size_t n = 0;
+        for (int c = 0; c < CATEGORY_COUNT; c++) {
+            draws[n++] = (ShardDraw){ -1, (int8_t)c, 8, (uint32_t)(c + 1) * 77u };
+        }
+        draws[n++] = (ShardDraw){ -1, -1, SHARD_MAX_DRAW, 4242 };
+        draws[n++] = (ShardDraw){ DIFFICULTY_MEDIUM, -1, 30, 99 };
+        draws[n++] = (ShardDraw){ DIFFICULTY_HARD, CATEGORY_HISTORY, 40, 5 };
+
+        /* Each batch of draws travels as one message; the clients take turns. */
+        for (int round = 0; running && round < 20; round++) {
+            ShardReply replies[2];
+            int ok = 0;
+            for (int k = 0; k < 2; k++) {
+                shard_reply_init(&replies[k]);
+            }
+            for (int k = 0; k < 2; k++) {
+                ok += shard_call_draw(clients[k], draws, n, &replies[k]) == 0;
+            }
+            for (int k = 0; k < 2 && ok == 2; k++) {
+                for (size_t i = 0; i < n; i++) {
+                    size_t count = 0;
+                    const Question *q = shard_reply_draw(&replies[k], i, &count);
+                    /* 300 questions: 20 per (difficulty, category). */
+                    size_t expected = i == n - 1 ? 20 : draws[i].count;
+                    if (count != expected || !draw_ok(&draws[i], q, count)) {
+                        printf("  ❌ test_shard_router: %s: draw %zu returned %zu questions\n",
+                               specs[m], i, count);
+                        failures++;
+                        round = 20;
+                        break;
+                    }
+                }
+            }
+            if (ok != 2) {
+                printf("  ❌ test_shard_router: %s: draw failed\n", specs[m]);
+                failures++;
+                round = 20;
+            }
+            shard_reply_free(&replies[0]);
+            shard_reply_free(&replies[1]);
+        }
+
+        for (int k = 0; k < 2; k++) {
+            if (clients[k] >= 0) {
+                close(clients[k]);
+            }
+        }
+        if (running) {
+            shard_server_stop(&server);
+            pthread_join(thread, NULL);
+            /* Each round of a whole batch is one message per shard at most. */
+            if (router.draws != 40 * n || router.rounds == 0 || router.rounds > 40 ||
+                router.messages > router.rounds * SHARD_TEST_PROCESSES ||
+                server.stats.draws != 40 * n) {
+                printf("  ❌ test_shard_router: %s: %llu draws in %llu rounds, %llu messages\n",
+                       specs[m], (unsigned long long)router.draws,
+                       (unsigned long long)router.rounds, (unsigned long long)router.messages);
+                failures++;
+            }
+            shard_server_destroy(&server);
+            shard_router_close(&router);
+        }
+        for (int s = 0; s < SHARD_TEST_PROCESSES; s++) {
+            if (s >= SHARD_TEST_PROCESSES - started) {
+                kill(pids[s], SIGTERM);
+                waitpid(pids[s], NULL, 0);
+            }
+        }
+    }
+
+    if (failures == 0) {
+        printf("  ✅ test_shard_router: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all sharding tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_shard(void) {
+    int failures = 0;
+
+    failures += test_shard_map();
+    failures += test_shard_store();
+    failures += test_shard_load();
+    failures += test_shard_router();
+
+    return failures;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file test_topology.c
+ * @brief Unit tests for NUMA node discovery and bank replication
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/questions.h"
+#include "../src/topology.h"
+
+static bool mask_has(const CpuMask *mask, int cpu) {
+    return (mask->bits[cpu / 64] >> (cpu % 64)) & 1u;
+}
+
+/**
+ * @brief Test parsing of kernel CPU lists
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_topology_parse_cpulist(void) {
+    int failures = 0;
+    CpuMask mask;
+    
+    if (topology_parse_cpulist("0-3,8,10-11\n", &mask) != 7 || !mask_has(&mask, 0) ||
+        !mask_has(&mask, 3) || mask_has(&mask, 4) || !mask_has(&mask, 8) ||
+        !mask_has(&mask, 11) || mask_has(&mask, 12)) {
+        printf("  ❌ test_topology_parse_cpulist: Ranges parsed wrong\n");
+        failures++;
+    }
+    if (topology_parse_cpulist("64-65", &mask) != 2 || !mask_has(&mask, 65)) {
+        printf("  ❌ test_topology_parse_cpulist: CPUs past 63 parsed wrong\n");
+        failures++;
+    }
+    if (topology_parse_cpulist("3-1", &mask) != -1 || topology_parse_cpulist("1,x", &mask) != -1 ||
+        topology_parse_cpulist("99999", &mask) != -1) {
+        printf("  ❌ test_topology_parse_cpulist: Malformed list accepted\n");
+        failures++;
+    }
+    
+    if (failures == 0) {
+        printf("  ✅ test_topology_parse_cpulist: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test node discovery and the worker-to-node spread
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_topology_load(void) {
+    int failures = 0;
+    Topology topo;
+    int nodes = topology_load(&topo);
+    if (nodes < 1 || nodes != topo.node_count) {
+        printf("  ❌ test_topology_load: No usable node found\n");
+        return 1;
+    }
+    for (int n = 0; n < nodes; n++) {
+        if (topo.cpu_count[n] < 1) {
+            printf("  ❌ test_topology_load: Node %d has no CPUs\n", topo.node_ids[n]);
+            failures++;
+        }
+    }
+    
+    int previous = 0;
+    for (int w = 0; w < 8; w++) {
+        int node = topology_node_for_worker(&topo, w, 8);
+        if (node < previous || node >= nodes) {
+            printf("  ❌ test_topology_load: Workers not spread in order\n");
+            failures++;
+            break;
+        }
+        previous = node;
+    }
+    if (topology_node_for_worker(&topo, 7, 8) != (nodes > 1 ? nodes - 1 : 0)) {
+        printf("  ❌ test_topology_load: Last worker not on the last node\n");
+        failures++;
+    }
+    
+    if (failures == 0) {
+        printf("  ✅ test_topology_load: PASSED (%d node(s))\n", nodes);
+    }
+    return failures;
+}
+
+static void count_call(void *arg) {
+    (*(int*)arg)++;
+}
+
+/**
+ * @brief Test per-node bank replicas are independent, indexed copies
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_topology_replicate_bank(void) {
+    int failures = 0;
+    Topology topo;
+    if (topology_load(&topo) < 1) {
+        printf("  ❌ test_topology_replicate_bank: No usable node found\n");
+        return 1;
+    }
+    
+    int calls = 0;
+    if (topology_run_on_node(&topo, 0, count_call, &calls) != 0 || calls != 1 ||
+        topology_run_on_node(&topo, topo.node_count, count_call, &calls) != -1 || calls != 1) {
+        printf("  ❌ test_topology_replicate_bank: Task not run exactly once on a valid node\n");
+        failures++;
+    }
+    
+    QuestionBank bank;
+    question_bank_init(&bank);
+    Question q;
+    memset(&q, 0, sizeof(q));
+    for (int i = 0; i < 30; i++) {
+        snprintf(q.question, sizeof(q.question), "Replica question %d?", i);
+        strcpy(q.options[0], "Yes");
+        strcpy(q.options[1], "No");
+        q.correct_answer = i % 2;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        question_bank_add(&bank, &q);
+    }
+    question_bank_build_index(&bank);
+    
+    QuestionBank replicas[TOPOLOGY_MAX_NODES];
+    if (topology_replicate_bank(&topo, &bank, replicas) != 0) {
+        printf("  ❌ test_topology_replicate_bank: Replication failed\n");
+        question_bank_free(&bank);
+        return failures + 1;
+    }
+    for (int n = 0; n < topo.node_count; n++) {
+        QuestionBank *r = &replicas[n];
+        if (r->questions == bank.questions || r->count != bank.count || !r->index_valid ||
+            r->difficulty_count[DIFFICULTY_HARD] != 10 ||
+            memcmp(r->questions, bank.questions, bank.count * sizeof(Question)) != 0) {
+            printf("  ❌ test_topology_replicate_bank: Replica %d differs\n", n);
+            failures++;
+        }
+        question_bank_free(r);
+    }
+    question_bank_free(&bank);
+    
+    if (failures == 0) {
+        printf("  ✅ test_topology_replicate_bank: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all topology tests
+ * 
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_topology(void) {
+    int failures = 0;
+    
+    failures += test_topology_parse_cpulist();
+    failures += test_topology_load();
+    failures += test_topology_replicate_bank();
+    
+    return failures;
+}
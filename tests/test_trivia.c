@@ -0,0 +1,284 @@
+/**
+ * @file test_trivia.c
+ * @brief Unit tests for the libtrivia public API
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/trivia.h"
+
+#define TRIVIA_TEST_QUESTIONS 40
+#define TRIVIA_TEST_THREADS 4
+#define TRIVIA_TEST_SESSIONS 500
+
+static const char TEST_JSON[] =
+    "[{\"id\": 7, \"question\": \"Largest planet?\", "
+    "\"options\": [\"Mars\", \"Jupiter\", \"Venus\"], \"correct\": 1, \"difficulty\": \"easy\"},"
+    " {\"id\": 8, \"question\": \"Largest planet?\", "
+    "\"options\": [\"Mars\", \"Jupiter\", \"Venus\"], \"correct\": 1, \"difficulty\": \"easy\"},"
+    " {\"id\": 9, \"question\": \"\", \"options\": [\"A\", \"B\"], \"correct\": 0}]";
+
+/**
+ * @brief Build a bank of numbered questions through trivia_bank_add()
+ */
+static TriviaBank* make_bank(void) {
+    TriviaBank *bank = NULL;
+    if (trivia_bank_create(&bank) != TRIVIA_OK) {
+        return NULL;
+    }
+    for (int i = 0; i < TRIVIA_TEST_QUESTIONS; i++) {
+        char text[64];
+        char opts[4][16];
+        const char *options[4];
+        snprintf(text, sizeof(text), "Question %d?", i);
+        for (int o = 0; o < 4; o++) {
+            snprintf(opts[o], sizeof(opts[o]), "Answer %d", o);
+            options[o] = opts[o];
+        }
+        if (trivia_bank_add(bank, text, options, 4, i % 4, i % 3) != TRIVIA_OK) {
+            trivia_bank_destroy(bank);
+            return NULL;
+        }
+    }
+    return bank;
+}
+
+/**
+ * @brief Test bank creation, loading and argument checks
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_trivia_bank(void) {
+    int failures = 0;
+
+    if (trivia_api_version() != TRIVIA_API_VERSION) {
+        printf("  ❌ test_trivia_bank: API version mismatch\n");
+        failures++;
+    }
+
+    TriviaBank *bank = NULL;
+    if (trivia_bank_create(&bank) != TRIVIA_OK || trivia_bank_count(bank) != 0) {
+        printf("  ❌ test_trivia_bank: Failed to create an empty bank\n");
+        return failures + 1;
+    }
+    if (trivia_bank_load_buffer(bank, TEST_JSON, strlen(TEST_JSON)) != TRIVIA_OK ||
+        trivia_bank_count(bank) != 1) {
+        printf("  ❌ test_trivia_bank: Expected 1 question after dedup and validation, got %zu\n",
+               trivia_bank_count(bank));
+        failures++;
+    }
+    if (trivia_bank_load_file(bank, "/nonexistent/questions.json") != TRIVIA_ERR_IO) {
+        printf("  ❌ test_trivia_bank: Missing file not reported as TRIVIA_ERR_IO\n");
+        failures++;
+    }
+
+    const char *options[2] = { "Yes", "No" };
+    if (trivia_bank_add(bank, "Bad?", options, 2, 2, 0) != TRIVIA_ERR_ARGUMENT ||
+        trivia_bank_add(bank, "Bad?", options, 1, 0, 0) != TRIVIA_ERR_ARGUMENT ||
+        trivia_bank_add(bank, "Bad?", options, 2, 0, 3) != TRIVIA_ERR_ARGUMENT ||
+        trivia_bank_add(NULL, "Bad?", options, 2, 0, 0) != TRIVIA_ERR_ARGUMENT) {
+        printf("  ❌ test_trivia_bank: Invalid question accepted\n");
+        failures++;
+    }
+    if (trivia_bank_add(bank, "Good?", options, 2, 0, 2) != TRIVIA_OK ||
+        trivia_bank_count(bank) != 2) {
+        printf("  ❌ test_trivia_bank: Valid question rejected\n");
+        failures++;
+    }
+
+    TriviaSession *session = NULL;
+    TriviaSessionConfig config;
+    trivia_session_config_default(&config);
+    config.players = 0;
+    if (trivia_session_create(bank, &config, &session) != TRIVIA_ERR_ARGUMENT || session != NULL) {
+        printf("  ❌ test_trivia_bank: Session with no players accepted\n");
+        failures++;
+    }
+    if (strcmp(trivia_status_string(TRIVIA_DONE), "game over") != 0) {
+        printf("  ❌ test_trivia_bank: Wrong status string\n");
+        failures++;
+    }
+
+    trivia_bank_destroy(bank);
+    if (failures == 0) {
+        printf("  ✅ test_trivia_bank: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test a two-player game through draw, answer and score
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_trivia_session(void) {
+    int failures = 0;
+    TriviaBank *bank = make_bank();
+    if (bank == NULL) {
+        printf("  ❌ test_trivia_session: Failed to build bank\n");
+        return 1;
+    }
+
+    TriviaSessionConfig config;
+    trivia_session_config_default(&config);
+    config.questions_per_game = 3;
+    config.players = 2;
+    TriviaSession *session = NULL;
+    if (trivia_session_create(bank, &config, &session) != TRIVIA_OK) {
+        printf("  ❌ test_trivia_session: Failed to create session\n");
+        trivia_bank_destroy(bank);
+        return 1;
+    }
+    if (trivia_session_answer(session, 1, 10, NULL) != TRIVIA_ERR_STATE) {
+        printf("  ❌ test_trivia_session: Answer before draw accepted\n");
+        failures++;
+    }
+
+    /* Player 0 always picks choice 1, player 1 lets the clock run out. */
+    TriviaQuestion q;
+    const char *seen[6];
+    int rounds = 0;
+    int expected_correct = 0;
+    int expected_points = 0;
+    while (rounds < 6 && trivia_session_draw(session, &q) == TRIVIA_OK) {
+        if (q.player != rounds % 2 || q.round != rounds || q.option_count != 4 ||
+            q.text == NULL || q.options[3] == NULL) {
+            printf("  ❌ test_trivia_session: Bad question view in round %d\n", rounds);
+            failures++;
+            break;
+        }
+        seen[rounds] = q.text;
+        TriviaResult result;
+        int choice = q.player == 0 ? 1 : 0;
+        if (trivia_session_answer(session, choice, 10, &result) != TRIVIA_OK ||
+            result.correct_choice < 1 || result.correct_choice > 4 ||
+            result.correct != (choice == result.correct_choice)) {
+            printf("  ❌ test_trivia_session: Bad result in round %d\n", rounds);
+            failures++;
+            break;
+        }
+        if (result.correct) {
+            expected_correct++;
+            expected_points += result.points;
+        }
+        rounds++;
+    }
+    if (rounds != 6 || trivia_session_draw(session, &q) != TRIVIA_DONE) {
+        printf("  ❌ test_trivia_session: Game did not end after 6 rounds (%d)\n", rounds);
+        failures++;
+    }
+    for (int i = 0; i < rounds; i++) {
+        for (int j = i + 1; j < rounds; j++) {
+            if (seen[i] == seen[j]) {
+                printf("  ❌ test_trivia_session: Question repeated within a game\n");
+                failures++;
+            }
+        }
+    }
+
+    TriviaScore first;
+    TriviaScore second;
+    if (trivia_session_score(session, 0, &first) != TRIVIA_OK ||
+        trivia_session_score(session, 1, &second) != TRIVIA_OK ||
+        first.correct != expected_correct || first.correct + first.wrong != 3 ||
+        first.score != expected_points || second.timeouts != 3 || second.score != 0) {
+        printf("  ❌ test_trivia_session: Scores do not match the answers\n");
+        failures++;
+    }
+    if (trivia_session_score(session, 2, &first) != TRIVIA_ERR_ARGUMENT) {
+        printf("  ❌ test_trivia_session: Out-of-range player accepted\n");
+        failures++;
+    }
+
+    trivia_session_destroy(session);
+    trivia_bank_destroy(bank);
+    if (failures == 0) {
+        printf("  ✅ test_trivia_session: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Arguments of one session-hosting thread
+ */
+typedef struct {
+    TriviaBank *bank;
+    int completed;
+    int answers;
+} HostThread;
+
+static void* host_sessions(void *arg) {
+    HostThread *t = (HostThread*)arg;
+    TriviaSessionConfig config;
+    trivia_session_config_default(&config);
+    for (int s = 0; s < TRIVIA_TEST_SESSIONS; s++) {
+        TriviaSession *session = NULL;
+        if (trivia_session_create(t->bank, &config, &session) != TRIVIA_OK) {
+            return NULL;
+        }
+        TriviaQuestion q;
+        while (trivia_session_draw(session, &q) == TRIVIA_OK) {
+            if (trivia_session_answer(session, 1 + s % 4, 5, NULL) == TRIVIA_OK) {
+                t->answers++;
+            }
+        }
+        trivia_session_destroy(session);
+        t->completed++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Test many sessions on several threads sharing one bank
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_trivia_threads(void) {
+    int failures = 0;
+    TriviaBank *bank = make_bank();
+    if (bank == NULL) {
+        printf("  ❌ test_trivia_threads: Failed to build bank\n");
+        return 1;
+    }
+
+    HostThread threads[TRIVIA_TEST_THREADS];
+    pthread_t ids[TRIVIA_TEST_THREADS];
+    for (int i = 0; i < TRIVIA_TEST_THREADS; i++) {
+        threads[i].bank = bank;
+        threads[i].completed = 0;
+        threads[i].answers = 0;
+        pthread_create(&ids[i], NULL, host_sessions, &threads[i]);
+    }
+    for (int i = 0; i < TRIVIA_TEST_THREADS; i++) {
+        pthread_join(ids[i], NULL);
+        if (threads[i].completed != TRIVIA_TEST_SESSIONS ||
+            threads[i].answers != TRIVIA_TEST_SESSIONS * 5) {
+            printf("  ❌ test_trivia_threads: Thread %d finished %d sessions, %d answers\n",
+                   i, threads[i].completed, threads[i].answers);
+            failures++;
+        }
+    }
+
+    trivia_bank_destroy(bank);
+    if (failures == 0) {
+        printf("  ✅ test_trivia_threads: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all library API tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_trivia(void) {
+    int failures = 0;
+
+    failures += test_trivia_bank();
+    failures += test_trivia_session();
+    failures += test_trivia_threads();
+
+    return failures;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file test_websocket.c
+ * @brief Unit tests for WebSocket framing and the game server over loopback
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "../src/server.h"
+#include "../src/websocket.h"
+
+#define WS_TEST_QUESTIONS 20
+#define WS_TEST_IDLE 50
+
+/**
+ * @brief Test the accept key and upgrade request parsing
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_websocket_handshake(void) {
+    int failures = 0;
+
+    /* Example from RFC 6455 section 1.3. */
+    char accept[WS_ACCEPT_LEN];
+    ws_accept_key("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    if (strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != 0) {
+        printf("  ❌ test_websocket_handshake: Wrong accept key %s\n", accept);
+        failures++;
+    }
+
+    const char request[] = "GET /play HTTP/1.1\r\nHost: localhost\r\n"
+                           "Upgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                           "Sec-WebSocket-Version: 13\r\n\r\nextra";
+    size_t request_len = strlen(request) - 5;
+    char key[WS_MAX_KEY];
+    size_t parsed_len = 0;
+    if (ws_parse_handshake(request, strlen(request), key, &parsed_len) != 1 ||
+        parsed_len != request_len || strcmp(key, "dGhlIHNhbXBsZSBub25jZQ==") != 0) {
+        printf("  ❌ test_websocket_handshake: Valid upgrade not parsed\n");
+        failures++;
+    }
+    if (ws_parse_handshake(request, request_len - 2, key, &parsed_len) != 0) {
+        printf("  ❌ test_websocket_handshake: Incomplete request not reported\n");
+        failures++;
+    }
+    const char plain[] = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (ws_parse_handshake(plain, strlen(plain), key, &parsed_len) != -1) {
+        printf("  ❌ test_websocket_handshake: Request without upgrade accepted\n");
+        failures++;
+    }
+
+    char response[256];
+    int n = ws_handshake_response("dGhlIHNhbXBsZSBub25jZQ==", response, sizeof(response));
+    if (n <= 0 || strstr(response, "101") == NULL ||
+        strstr(response, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == NULL ||
+        ws_handshake_response("dGhlIHNhbXBsZSBub25jZQ==", response, 16) != -1) {
+        printf("  ❌ test_websocket_handshake: Bad 101 response\n");
+        failures++;
+    }
+
+    if (failures == 0) {
+        printf("  ✅ test_websocket_handshake: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Test header encoding and parsing, and masking against a scalar XOR
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_websocket_frames(void) {
+    int failures = 0;
+    static const uint64_t lengths[] = { 0, 125, 126, 65535, 65536 };
+    static const size_t header_lens[] = { 6, 6, 8, 8, 14 };
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        uint8_t header[WS_MAX_HEADER];
+        size_t len = ws_encode_header(header, WS_OP_TEXT, lengths[i], mask);
+        WsFrame frame;
+        if (len != header_lens[i] || ws_parse_frame(header, len, &frame) != 1 ||
+            !frame.fin || frame.opcode != WS_OP_TEXT || !frame.masked ||
+            frame.payload_len != lengths[i] || frame.header_len != len ||
+            memcmp(frame.mask, mask, 4) != 0) {
+            printf("  ❌ test_websocket_frames: Header roundtrip failed for %llu bytes\n",
+                   (unsigned long long)lengths[i]);
+            failures++;
+        }
+        if (ws_parse_frame(header, len - 1, &frame) != 0) {
+            printf("  ❌ test_websocket_frames: Partial header not reported\n");
+            failures++;
+        }
+    }
+
+    WsFrame frame;
+    const uint8_t reserved[2] = { 0xC1, 0x00 };
+    const uint8_t long_ping[2] = { 0x89, 126 };
+    const uint8_t split_ping[2] = { 0x09, 0x00 };
+    if (ws_parse_frame(reserved, 2, &frame) != -1 || ws_parse_frame(long_ping, 2, &frame) != -1 ||
+        ws_parse_frame(split_ping, 2, &frame) != -1) {
+        printf("  ❌ test_websocket_frames: Invalid header accepted\n");
+        failures++;
+    }
+
+    uint8_t data[100];
+    uint8_t expected[100];
+    for (size_t len = 0; len <= 64; len++) {
+        for (uint64_t offset = 0; offset < 4; offset++) {
+            for (size_t i = 0; i < len; i++) {
+                data[i] = (uint8_t)(i * 7 + 3);
+                expected[i] = data[i] ^ mask[(offset + i) & 3];
+            }
+            ws_mask(data, len, mask, offset);
+            if (memcmp(data, expected, len) != 0) {
+                printf("  ❌ test_websocket_frames: Mask mismatch at length %zu offset %llu\n",
+                       len, (unsigned long long)offset);
+                failures++;
+            }
+        }
+    }
+
+    if (failures == 0) {
+        printf("  ✅ test_websocket_frames: PASSED\n");
+    }
+    return failures;
+}
+
+static void* run_server(void *arg) {
+    server_run((Server*)arg);
+    return NULL;
+}
+
+/**
+ * @brief Read messages until one of the given type arrives
+ */
+static int expect_message(WsClient *client, const char *type, char *out, size_t cap) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"type\":\"%s\"", type);
+    for (int i = 0; i < 16; i++) {
+        if (ws_client_recv(client, out, cap, 5000) <= 0) {
+            return -1;
+        }
+        if (strstr(out, pattern) != NULL) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int json_int(const char *message, const char *field) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", field);
+    const char *at = strstr(message, pattern);
+    return at != NULL ? atoi(at + strlen(pattern)) : -1;
+}
+
+static int send_command(WsClient *client, const char *command) {
+    return ws_client_send_text(client, command, strlen(command));
+}
+
+/**
+ * @brief Play a two-seat game over loopback, with idle and misbehaving clients
+ *
+ * @return int 0 on success, non-zero on failure
+ */
+static int test_websocket_server(void) {
+    int failures = 0;
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        printf("  ❌ test_websocket_server: Failed to create bank\n");
+        return 1;
+    }
+    for (int i = 0; i < WS_TEST_QUESTIONS; i++) {
+        Question q;
+        memset(&q, 0, sizeof(q));
+        snprintf(q.question, sizeof(q.question), "Socket question %d?", i);
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Option %d", o);
+        }
+        q.id = (uint32_t)i + 1;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        question_bank_add(&bank, &q);
+    }
+    question_bank_build_index(&bank);
+
+    ServerOptions opts;
+    server_options_init(&opts);
+    opts.host = "127.0.0.1";
+    opts.port = 0;
+    opts.questions_per_game = 2;
+    opts.time_limit_s = 1;
+    Server server;
+    pthread_t thread;
+    if (server_init(&server, &bank, &opts) != 0 ||
+        pthread_create(&thread, NULL, run_server, &server) != 0) {
+        printf("  ❌ test_websocket_server: Failed to start server\n");
+        question_bank_free(&bank);
+        return 1;
+    }
+
+    WsClient idle[WS_TEST_IDLE];
+    int idle_count = 0;
+    while (idle_count < WS_TEST_IDLE &&
+           ws_client_connect(&idle[idle_count], "127.0.0.1", server.port) == 0) {
+        idle_count++;
+    }
+    if (idle_count != WS_TEST_IDLE) {
+        printf("  ❌ test_websocket_server: Only %d idle clients connected\n", idle_count);
+        failures++;
+    }
+
+    WsClient players[2] = { { .fd = -1 }, { .fd = -1 } };
+    char message[4096];
+    if (ws_client_connect(&players[0], "127.0.0.1", server.port) != 0 ||
+        ws_client_connect(&players[1], "127.0.0.1", server.port) != 0) {
+        printf("  ❌ test_websocket_server: Players could not connect\n");
+        failures++;
+    } else {
+        send_command(&players[0], "JOIN 42 2");
+        if (expect_message(&players[0], "joined", message, sizeof(message)) != 0) {
+            printf("  ❌ test_websocket_server: JOIN not acknowledged\n");
+            failures++;
+        }
+        send_command(&players[1], "JOIN 42");
+        for (int p = 0; p < 2; p++) {
+            if (expect_message(&players[p], "start", message, sizeof(message)) != 0 ||
+                json_int(message, "player") != p || json_int(message, "players") != 2) {
+                printf("  ❌ test_websocket_server: Player %d not started\n", p);
+                failures++;
+            }
+        }
+
+        /* Four rounds: the first times out, in the second the wrong player
+         * answers first, the rest are answered in turn. */
+        for (int round = 0; round < 4 && failures == 0; round++) {
+            int turn = -1;
+            for (int p = 0; p < 2; p++) {
+                if (expect_message(&players[p], "question", message, sizeof(message)) != 0 ||
+                    json_int(message, "round") != round || strstr(message, "\"options\":[") == NULL) {
+                    printf("  ❌ test_websocket_server: No question for round %d\n", round);
+                    failures++;
+                }
+                turn = json_int(message, "player");
+            }
+            if (turn != round % 2) {
+                printf("  ❌ test_websocket_server: Turn %d in round %d\n", turn, round);
+                failures++;
+                break;
+            }
+            if (round == 1) {
+                send_command(&players[1 - turn], "ANSWER 1");
+                if (expect_message(&players[1 - turn], "error", message, sizeof(message)) != 0 ||
+                    strstr(message, "not your turn") == NULL) {
+                    printf("  ❌ test_websocket_server: Out-of-turn answer not refused\n");
+                    failures++;
+                }
+            }
+            if (round > 0) {
+                send_command(&players[turn], "ANSWER 2");
+            }
+            for (int p = 0; p < 2; p++) {
+                if (expect_message(&players[p], "result", message, sizeof(message)) != 0 ||
+                    json_int(message, "choice") != (round > 0 ? 2 : 0)) {
+                    printf("  ❌ test_websocket_server: Bad result for round %d\n", round);
+                    failures++;
+                }
+            }
+        }
+        for (int p = 0; p < 2; p++) {
+            if (expect_message(&players[p], "end", message, sizeof(message)) != 0 ||
+                strstr(message, "\"completed\":true") == NULL) {
+                printf("  ❌ test_websocket_server: Player %d did not see the end\n", p);
+                failures++;
+            }
+        }
+
+        /* An unmasked client frame is a protocol error and closes the connection. */
+        const uint8_t unmasked[] = { 0x81, 0x05, 'L', 'E', 'A', 'V', 'E' };
+        send(players[0].fd, unmasked, sizeof(unmasked), MSG_NOSIGNAL);
+        if (ws_client_recv(&players[0], message, sizeof(message), 5000) != -1) {
+            printf("  ❌ test_websocket_server: Unmasked frame not rejected\n");
+            failures++;
+        }
+    }
+
+    /* A round trip on a fresh connection ensures the server has caught up. */
+    WsClient probe;
+    if (ws_client_connect(&probe, "127.0.0.1", server.port) == 0) {
+        send_command(&probe, "HELLO");
+        if (expect_message(&probe, "error", message, sizeof(message)) != 0) {
+            printf("  ❌ test_websocket_server: Unknown command not answered\n");
+            failures++;
+        }
+        ws_client_close(&probe);
+    }
+
+    server_stop(&server);
+    pthread_join(thread, NULL);
+    if (server.stats.games_started != 1 || server.stats.games_finished != 1 ||
+        server.stats.accepted != (uint64_t)idle_count + 3 || server.room_count != 0) {
+        printf("  ❌ test_websocket_server: Stats off (%llu started, %llu finished, %llu accepted)\n",
+               (unsigned long long)server.stats.games_started,
+               (unsigned long long)server.stats.games_finished,
+               (unsigned long long)server.stats.accepted);
+        failures++;
+    }
+    if (server.parked_bytes != 0 || server.queued_bytes != 0) {
+        printf("  ❌ test_websocket_server: Idle connections hold %zu parked, %zu queued bytes\n",
+               server.parked_bytes, server.queued_bytes);
+        failures++;
+    }
+    if (server.stats.broadcasts == 0 || server.stats.frames_out <= server.stats.broadcasts) {
+        printf("  ❌ test_websocket_server: Broadcasts not counted\n");
+        failures++;
+    }
+
+    for (int i = 0; i < idle_count; i++) {
+        ws_client_close(&idle[i]);
+    }
+    ws_client_close(&players[0]);
+    ws_client_close(&players[1]);
+    server_destroy(&server);
+    question_bank_free(&bank);
+    if (failures == 0) {
+        printf("  ✅ test_websocket_server: PASSED\n");
+    }
+    return failures;
+}
+
+/**
+ * @brief Run all WebSocket tests
+ *
+ * @return int 0 if all tests pass, non-zero otherwise
+ */
+int test_websocket(void) {
+    int failures = 0;
+
+    failures += test_websocket_handshake();
+    failures += test_websocket_frames();
+    failures += test_websocket_server();
+
+    return failures;
+}
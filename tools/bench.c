@@ -0,0 +1,617 @@
+/**
+ * @file bench.c
+ * @brief Micro-benchmarks for the engine hot paths with a baseline gate
+ *
+ * Measures:
+ * - load_mb_s:            JSON pack load throughput
+ * - draws_per_s:          question_bank_get_random_unused() calls per second
+ * - draw_repeat_pct:      consecutive question_bank_get_random() draws that
+ *                         return the same question (catches RNG reseeding)
+ * - session_steps_per_s:  draw + grade steps per second through GameState
+ * - timer_stop_us:        latency of timer_stop() on a running timer
+ * - numa_local_steps_per_s / numa_remote_steps_per_s:
+ *                         session steps on a thread bound to the first
+ *                         NUMA node, with the bank and sessions on the same
+ *                         node or on the last node (equal on one-node hosts)
+ * - queue_events_per_s:   events through one MPSC event queue from four
+ *                         producer threads (--queue-sweep runs 1-32)
+ * - game_churn_per_s / pooled_game_churn_per_s:
+ *                         four-player games started and ended per second,
+ *                         with malloc or with a warm SessionPool
+ *
+ * With --baseline FILE each result is compared against the stored value
+ * and the program exits non-zero when a metric regresses beyond the
+ * tolerance, which is how CTest uses it as a performance gate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "events.h"
+#include "game.h"
+#include "pool.h"
+#include "questions.h"
+#include "timer.h"
+#include "topology.h"
+#include "utils.h"
+
+#define MAX_BASELINE_ENTRIES 32
+
+/**
+ * @brief Whether larger or smaller values are better for a metric
+ */
+typedef enum {
+    BETTER_HIGHER = 0,
+    BETTER_LOWER
+} BetterDirection;
+
+/**
+ * @brief One stored baseline value
+ */
+typedef struct {
+    char name[64];
+    double value;
+    BetterDirection better;
+    double tolerance;          /**< Per-metric tolerance, <0 uses the default */
+} BaselineEntry;
+
+/**
+ * @brief Benchmark sizes for full and --short runs
+ */
+typedef struct {
+    int load_questions;
+    int load_repeats;
+    int draw_bank_size;
+    int draws;
+    int session_games;
+    int timer_stops;
+    int queue_events;
+} BenchSizes;
+
+typedef double (*BenchFunc)(const BenchSizes *sizes);
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    BenchFunc run;
+} Benchmark;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int n) {
+    qsort(values, (size_t)n, sizeof(double), cmp_double);
+    return values[n / 2];
+}
+
+/**
+ * @brief Write a synthetic pack of @p count questions to @p path
+ *
+ * @return long File size in bytes, or -1 on error
+ */
+static long write_synthetic_pack(const char *path, int count) {
+    static const char *difficulties[] = { "easy", "medium", "hard" };
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fputs("[\n", f);
+    for (int i = 0; i < count; i++) {
+        fprintf(f,
+                "  {\n"
+                "    \"question\": \"Synthetic benchmark question number %d about topic %d?\",\n"
+                "    \"options\": [\"Answer A%d\", \"Answer B%d\", \"Answer C%d\", \"Answer D%d\"],\n"
+                "    \"correct\": %d,\n"
+                "    \"difficulty\": \"%s\"\n"
+                "  }%s\n",
+                i, i % 97, i, i, i, i, i % 4, difficulties[i % 3],
+                i + 1 < count ? "," : "");
+    }
+    fputs("]\n", f);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void fill_bank(QuestionBank *bank, int count) {
+    Question q;
+    memset(&q, 0, sizeof(q));
+    for (int i = 0; i < count; i++) {
+        snprintf(q.question, sizeof(q.question), "Question %d?", i);
+        for (int o = 0; o < MAX_OPTIONS; o++) {
+            snprintf(q.options[o], sizeof(q.options[o]), "Option %d", o);
+        }
+        q.correct_answer = i % MAX_OPTIONS;
+        q.difficulty = (Difficulty)(i % DIFFICULTY_COUNT);
+        q.category = CATEGORY_GENERAL;
+        question_bank_add(bank, &q);
+    }
+    question_bank_build_index(bank);
+}
+
+static double bench_load(const BenchSizes *sizes) {
+    char path[] = "/tmp/trivia-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1.0;
+    }
+    close(fd);
+
+    long bytes = write_synthetic_pack(path, sizes->load_questions);
+    if (bytes <= 0) {
+        unlink(path);
+        return -1.0;
+    }
+
+    double best = 0.0;
+    for (int r = 0; r < sizes->load_repeats; r++) {
+        QuestionBank bank;
+        question_bank_init(&bank);
+        double t0 = now_sec();
+        int loaded = question_bank_load_from_json(&bank, path);
+        double elapsed = now_sec() - t0;
+        question_bank_free(&bank);
+        if (loaded != sizes->load_questions) {
+            print_error("bench load: loaded %d of %d questions", loaded, sizes->load_questions);
+            unlink(path);
+            return -1.0;
+        }
+        double mb_s = (double)bytes / (1024.0 * 1024.0) / elapsed;
+        if (mb_s > best) {
+            best = mb_s;
+        }
+    }
+
+    unlink(path);
+    return best;
+}
+
+static double bench_draws(const BenchSizes *sizes) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    fill_bank(&bank, sizes->draw_bank_size);
+    bool *used = (bool*)calloc(bank.count, sizeof(bool));
+    if (used == NULL) {
+        question_bank_free(&bank);
+        return -1.0;
+    }
+
+    volatile size_t sink = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < sizes->draws; i++) {
+        Question *q = question_bank_get_random_unused(&bank, i % 4 == 3 ? -1 : i % 3,
+                                                      used, (int)bank.count);
+        sink += (size_t)(q - bank.questions);
+    }
+    double elapsed = now_sec() - t0;
+    (void)sink;
+
+    free(used);
+    question_bank_free(&bank);
+    return sizes->draws / elapsed;
+}
+
+static double bench_draw_repeats(const BenchSizes *sizes) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    fill_bank(&bank, sizes->draw_bank_size);
+
+    int repeats = 0;
+    Question *prev = NULL;
+    for (int i = 0; i < sizes->draws; i++) {
+        Question *q = question_bank_get_random(&bank, -1);
+        if (q == prev) {
+            repeats++;
+        }
+        prev = q;
+    }
+
+    question_bank_free(&bank);
+    return 100.0 * repeats / sizes->draws;
+}
+
+/**
+ * @brief Play @p games ten-question games and return steps per second
+ */
+static double run_session_steps(QuestionBank *bank, int games) {
+    GameConfig config;
+    config.questions_per_game = 10;
+    config.time_per_question = 30;
+    config.difficulty = (Difficulty)-1;
+    config.use_timer = false;
+    config.num_players = 1;
+    config.shuffle_options = true;
+
+    long steps = 0;
+    double t0 = now_sec();
+    for (int g = 0; g < games; g++) {
+        GameState game;
+        if (game_init(&game, bank, &config) != 0) {
+            return -1.0;
+        }
+        for (int i = 0; i < config.questions_per_game; i++) {
+            Question *q = game_draw_question(&game);
+            if (q == NULL) {
+                break;
+            }
+            int answer = (i % 2) ? game_option_choice(&game, q->correct_answer) : 1;
+            game_submit_answer(&game, q, answer, 20);
+            steps += 2;
+        }
+        game_cleanup(&game);
+    }
+    return steps / (now_sec() - t0);
+}
+
+/**
+ * @brief Start and end @p games four-player games, return games per second
+ *
+ * Each game draws one question so it touches its buffers. With a pool the
+ * GameState, flags and players are recycled; without one each game goes
+ * through malloc and free.
+ */
+static double run_game_churn(QuestionBank *bank, int games, SessionPool *pool) {
+    GameConfig config;
+    config.questions_per_game = 10;
+    config.time_per_question = 30;
+    config.difficulty = (Difficulty)-1;
+    config.use_timer = false;
+    config.num_players = 4;
+    config.shuffle_options = true;
+
+    double t0 = now_sec();
+    for (int g = 0; g < games; g++) {
+        GameState local;
+        GameState *game = pool != NULL ? game_create(pool, bank, &config) : &local;
+        if (game == NULL || (pool == NULL && game_init(game, bank, &config) != 0)) {
+            return -1.0;
+        }
+        game_draw_question(game);
+        if (pool != NULL) {
+            game_destroy(game);
+        } else {
+            game_cleanup(game);
+        }
+    }
+    return games / (now_sec() - t0);
+}
+
+static double bench_game_churn(const BenchSizes *sizes, bool pooled) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    fill_bank(&bank, sizes->draw_bank_size);
+    SessionPool pool;
+    session_pool_init(&pool, 0);
+    double result = run_game_churn(&bank, sizes->session_games * 10, pooled ? &pool : NULL);
+    session_pool_destroy(&pool);
+    question_bank_free(&bank);
+    return result;
+}
+
+static double bench_game_churn_malloc(const BenchSizes *sizes) {
+    return bench_game_churn(sizes, false);
+}
+
+static double bench_game_churn_pooled(const BenchSizes *sizes) {
+    return bench_game_churn(sizes, true);
+}
+
+static double bench_session_steps(const BenchSizes *sizes) {
+    QuestionBank bank;
+    question_bank_init(&bank);
+    fill_bank(&bank, sizes->draw_bank_size);
+    double result = run_session_steps(&bank, sizes->session_games);
+    question_bank_free(&bank);
+    return result;
+}
+
+/**
+ * @brief Shared state of the NUMA benchmark tasks
+ */
+typedef struct {
+    const BenchSizes *sizes;
+    QuestionBank bank;
+    double result;
+} NumaBench;
+
+static void numa_fill_bank(void *arg) {
+    NumaBench *b = (NumaBench*)arg;
+    question_bank_init(&b->bank);
+    fill_bank(&b->bank, b->sizes->draw_bank_size);
+}
+
+static void numa_run_steps(void *arg) {
+    NumaBench *b = (NumaBench*)arg;
+    b->result = run_session_steps(&b->bank, b->sizes->session_games);
+}
+
+/**
+ * @brief Session steps on node 0 against a bank built on @p remote's node
+ */
+static double bench_numa(const BenchSizes *sizes, bool remote) {
+    Topology topo;
+    if (topology_load(&topo) < 0) {
+        return -1.0;
+    }
+    int bank_node = remote ? topo.node_count - 1 : 0;
+    NumaBench b;
+    b.sizes = sizes;
+    b.result = -1.0;
+    if (topology_run_on_node(&topo, bank_node, numa_fill_bank, &b) != 0) {
+        return -1.0;
+    }
+    if (topology_run_on_node(&topo, 0, numa_run_steps, &b) != 0) {
+        b.result = -1.0;
+    }
+    question_bank_free(&b.bank);
+    return b.result;
+}
+
+static double bench_numa_local(const BenchSizes *sizes) {
+    return bench_numa(sizes, false);
+}
+
+static double bench_numa_remote(const BenchSizes *sizes) {
+    return bench_numa(sizes, true);
+}
+
+static double bench_timer_stop(const BenchSizes *sizes) {
+    double samples[64];
+    int n = sizes->timer_stops < 64 ? sizes->timer_stops : 64;
+
+    for (int i = 0; i < n; i++) {
+        Timer timer;
+        if (timer_init(&timer, 30) != 0 || timer_start(&timer) != 0) {
+            return -1.0;
+        }
+        usleep(2000);
+        double t0 = now_sec();
+        timer_stop(&timer);
+        samples[i] = (now_sec() - t0) * 1e6;
+        timer_cleanup(&timer);
+    }
+    return median(samples, n);
+}
+
+/**
+ * @brief Event queue benchmark shared state
+ */
+typedef struct {
+    EventQueue queue;
+    int per_producer;
+} QueueBench;
+
+typedef struct {
+    QueueBench *bench;
+    uint32_t id;
+} QueueProducer;
+
+static void* queue_producer_main(void *arg) {
+    QueueProducer *p = (QueueProducer*)arg;
+    GameEvent event = { 0, EVENT_ANSWER, 0, 0, p->id };
+    for (int i = 0; i < p->bench->per_producer; i++) {
+        event.session = (uint32_t)i;
+        event.value = i;
+        while (!event_queue_push(&p->bench->queue, &event)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Events per second through one queue from @p producers threads
+ */
+static double run_queue_bench(int producers, int total_events) {
+    QueueBench bench;
+    bench.per_producer = total_events / producers;
+    if (event_queue_init(&bench.queue, 4096) != 0) {
+        return -1.0;
+    }
+    QueueProducer args[32];
+    pthread_t threads[32];
+    int started = 0;
+    double t0 = now_sec();
+    for (int p = 0; p < producers && p < 32; p++) {
+        args[p].bench = &bench;
+        args[p].id = (uint32_t)p;
+        if (pthread_create(&threads[p], NULL, queue_producer_main, &args[p]) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    long expected = (long)started * bench.per_producer;
+    long received = 0;
+    GameEvent batch[64];
+    while (received < expected) {
+        received += (long)event_queue_wait(&bench.queue, batch, 64, 100);
+    }
+    double elapsed = now_sec() - t0;
+    for (int p = 0; p < started; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    event_queue_destroy(&bench.queue);
+    return started == producers ? (double)received / elapsed : -1.0;
+}
+
+static double bench_queue_events(const BenchSizes *sizes) {
+    return run_queue_bench(4, sizes->queue_events);
+}
+
+static const Benchmark BENCHMARKS[] = {
+    { "load_mb_s",                "MB/s",     bench_load },
+    { "draws_per_s",              "draws/s",  bench_draws },
+    { "draw_repeat_pct",          "%",        bench_draw_repeats },
+    { "session_steps_per_s",      "steps/s",  bench_session_steps },
+    { "timer_stop_us",            "us",       bench_timer_stop },
+    { "numa_local_steps_per_s",   "steps/s",  bench_numa_local },
+    { "numa_remote_steps_per_s",  "steps/s",  bench_numa_remote },
+    { "queue_events_per_s",       "events/s", bench_queue_events },
+    { "game_churn_per_s",         "games/s",  bench_game_churn_malloc },
+    { "pooled_game_churn_per_s",  "games/s",  bench_game_churn_pooled },
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0])))
+
+/**
+ * @brief Load "name value higher|lower [tolerance]" lines from @p path
+ *
+ * @return int Number of entries, or -1 on error
+ */
+static int load_baseline(const char *path, BaselineEntry *entries, int max) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        print_error("Failed to open baseline file: %s", path);
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    while (fgets(line, sizeof(line), f) != NULL && count < max) {
+        sanitize_input(line);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        char direction[16];
+        BaselineEntry *e = &entries[count];
+        e->tolerance = -1.0;
+        int fields = sscanf(line, "%63s %lf %15s %lf", e->name, &e->value, direction, &e->tolerance);
+        if (fields < 3) {
+            print_error("Malformed baseline line: %s", line);
+            fclose(f);
+            return -1;
+        }
+        e->better = strcmp(direction, "lower") == 0 ? BETTER_LOWER : BETTER_HIGHER;
+        count++;
+    }
+
+    fclose(f);
+    return count;
+}
+
+static const BaselineEntry* find_baseline(const BaselineEntry *entries, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--short] [--baseline FILE] [--tolerance F] [BENCH...]\n\n", prog);
+    printf("  --short          Reduced sizes suitable for CTest\n");
+    printf("  --baseline FILE  Compare against stored values, exit 1 on regression\n");
+    printf("  --tolerance F    Allowed relative regression (default 0.5)\n");
+    printf("  --queue-sweep    Event queue throughput at 1-32 producers, then exit\n\n");
+    printf("Benchmarks:");
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        printf(" %s", BENCHMARKS[i].name);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchSizes full = { 200000, 3, 20000, 2000000, 200000, 32, 4000000 };
+    BenchSizes quick = { 20000, 3, 5000, 200000, 20000, 15, 400000 };
+    const BenchSizes *sizes = &full;
+    const char *baseline_path = NULL;
+    double tolerance = 0.5;
+    bool queue_sweep = false;
+    bool selected[BENCHMARK_COUNT];
+    bool any_selected = false;
+    memset(selected, 0, sizeof(selected));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--short") == 0) {
+            sizes = &quick;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--queue-sweep") == 0) {
+            queue_sweep = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            bool found = false;
+            for (int b = 0; b < BENCHMARK_COUNT; b++) {
+                if (strcmp(argv[i], BENCHMARKS[b].name) == 0) {
+                    selected[b] = true;
+                    any_selected = true;
+                    found = true;
+                }
+            }
+            if (!found) {
+                print_error("Unknown argument: %s", argv[i]);
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (queue_sweep) {
+        printf("%-10s %14s\n", "producers", "events/s");
+        for (int producers = 1; producers <= 32; producers *= 2) {
+            printf("%-10d %14.0f\n", producers, run_queue_bench(producers, sizes->queue_events));
+        }
+        return EXIT_SUCCESS;
+    }
+
+    BaselineEntry baseline[MAX_BASELINE_ENTRIES];
+    int baseline_count = 0;
+    if (baseline_path != NULL) {
+        baseline_count = load_baseline(baseline_path, baseline, MAX_BASELINE_ENTRIES);
+        if (baseline_count < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    int regressions = 0;
+    for (int b = 0; b < BENCHMARK_COUNT; b++) {
+        if (any_selected && !selected[b]) {
+            continue;
+        }
+        const Benchmark *bench = &BENCHMARKS[b];
+        double value = bench->run(sizes);
+        if (value < 0.0) {
+            print_error("%s: benchmark failed to run", bench->name);
+            regressions++;
+            continue;
+        }
+        printf("%-22s %14.2f %s", bench->name, value, bench->unit);
+
+        const BaselineEntry *e = find_baseline(baseline, baseline_count, bench->name);
+        if (e == NULL) {
+            printf("\n");
+            continue;
+        }
+        double tol = e->tolerance >= 0.0 ? e->tolerance : tolerance;
+        double limit = e->better == BETTER_HIGHER ? e->value * (1.0 - tol) : e->value * (1.0 + tol);
+        bool regressed = e->better == BETTER_HIGHER ? value < limit : value > limit;
+        printf("   baseline %.2f, limit %s %.2f  %s\n", e->value,
+               e->better == BETTER_HIGHER ? ">=" : "<=", limit,
+               regressed ? "REGRESSION" : "ok");
+        if (regressed) {
+            regressions++;
+        }
+    }
+
+    return regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
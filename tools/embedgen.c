@@ -0,0 +1,183 @@
+/**
+ * @file embedgen.c
+ * @brief trivia-embedgen: compile a question pack into C source
+ *
+ * Loads a JSON or binary pack, drops duplicate and invalid questions and
+ * writes a C file defining the symbols declared in embedded.h: the pack's
+ * record table and string pool as const arrays. Linked into the game, the
+ * bank then needs no file and no parsing at startup.
+ *
+ *   trivia-embedgen data/questions.json embedded_bank.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "questions.h"
+#include "export.h"
+#include "pack.h"
+#include "utils.h"
+
+/**
+ * @brief Pool bytes written per line of generated source
+ */
+#define POOL_BYTES_PER_LINE 16
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s INPUT OUTPUT.c\n", prog);
+    printf("INPUT may be a JSON or binary pack.\n");
+}
+
+static int load_bank(QuestionBank *bank, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(file, &data, &len);
+    fclose(file);
+    if (err != UTILS_SUCCESS) {
+        print_error("Failed to read questions file: %s", filename);
+        return -1;
+    }
+
+    int loaded = pack_is_pack(data, len) ? pack_load_from_buffer(bank, data, len)
+                                         : question_bank_load_from_buffer(bank, data, len);
+    free(data);
+    return loaded;
+}
+
+/**
+ * @brief Export the bank as a binary pack held in memory
+ *
+ * @return char* Pack bytes (caller frees), NULL on error
+ */
+static char* build_pack(const QuestionBank *bank, size_t *len) {
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        print_error("Failed to create a temporary file");
+        return NULL;
+    }
+    ExportWriter writer;
+    long written = -1;
+    if (export_writer_init(&writer, 0) == 0) {
+        written = export_bank(&writer, fileno(file), bank, NULL, EXPORT_PACK);
+        *len = (size_t)writer.written;
+        export_writer_free(&writer);
+    }
+
+    char *data = written > 0 ? (char*)malloc(*len) : NULL;
+    if (data == NULL || pread(fileno(file), data, *len, 0) != (ssize_t)*len) {
+        print_error("Failed to build the pack");
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+static void write_record(FILE *out, const PackRecord *r) {
+    fprintf(out, "    {%u, %u, %u, %u, %u, %lluu, {", r->id, r->correct, r->difficulty,
+            r->category, r->option_count, (unsigned long long)r->text_offset);
+    for (int i = 0; i <= MAX_OPTIONS; i++) {
+        fprintf(out, i == 0 ? "%u" : ", %u", r->lengths[i]);
+    }
+    fprintf(out, "}, {");
+    for (int i = 0; i <= MAX_OPTIONS; i++) {
+        fprintf(out, i == 0 ? "%u" : ", %u", r->widths[i]);
+    }
+    fprintf(out, "}, 0},\n");
+}
+
+/**
+ * @brief Write the generated source for a checked pack
+ *
+ * @return int 0 on success, -1 on write error
+ */
+static int write_source(FILE *out, const char *input, const char *pack) {
+    PackHeader header;
+    memcpy(&header, pack, sizeof(header));
+    const PackRecord *records = (const PackRecord*)(pack + sizeof(PackHeader));
+    const unsigned char *pool = (const unsigned char*)pack + header.pool_offset;
+
+    fprintf(out, "/* Generated by trivia-embedgen from %s. Do not edit. */\n\n", input);
+    fprintf(out, "#include \"embedded.h\"\n\n");
+    fprintf(out, "const PackRecord embedded_records[] = {\n");
+    for (uint32_t i = 0; i < header.count; i++) {
+        write_record(out, &records[i]);
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "const size_t embedded_record_count = %uu;\n\n", header.count);
+
+    fprintf(out, "const unsigned char embedded_pool[] = {\n");
+    for (uint64_t i = 0; i < header.pool_len; i++) {
+        bool line_start = i % POOL_BYTES_PER_LINE == 0;
+        bool line_end = i % POOL_BYTES_PER_LINE == POOL_BYTES_PER_LINE - 1 ||
+                        i + 1 == header.pool_len;
+        fprintf(out, "%s0x%02x,%s", line_start ? "    " : " ", pool[i], line_end ? "\n" : "");
+    }
+    fprintf(out, "};\n");
+    return ferror(out) ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        print_usage(argv[0]);
+        return argc == 2 && strcmp(argv[1], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const char *input = argv[1];
+    const char *output = argv[2];
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (load_bank(&bank, input) < 0) {
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    QuestionPrepareReport report;
+    if (question_bank_prepare(&bank, &report) < 0) {
+        print_error("Failed to prepare %s", input);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    if (report.duplicates > 0 || report.invalid > 0) {
+        fprintf(stderr, "%s: dropped %d duplicate and %d invalid question(s)\n", input,
+                report.duplicates, report.invalid);
+    }
+    if (bank.count == 0) {
+        print_error("No playable questions in %s", input);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+
+    size_t len = 0;
+    char *pack = build_pack(&bank, &len);
+    question_bank_free(&bank);
+    if (pack == NULL || pack_check(pack, len) <= 0) {
+        free(pack);
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = fopen(output, "w");
+    if (out == NULL) {
+        print_error("Failed to create %s", output);
+        free(pack);
+        return EXIT_FAILURE;
+    }
+    int rc = write_source(out, input, pack);
+    if (fclose(out) != 0) {
+        rc = -1;
+    }
+    free(pack);
+    if (rc != 0) {
+        print_error("Failed to write %s", output);
+        remove(output);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file export.c
+ * @brief trivia-export: write a filtered bank as JSON, JSON Lines or a pack
+ *
+ * Reads a JSON pack or binary pack and writes the questions that pass the
+ * filters, for producing curated packs from a merged master bank.
+ *
+ *   trivia-export --bank master.json --difficulty hard --format pack -o hard.tqpk
+ *   trivia-export --bank master.tqpk --category science --ids 4,8,15 --format jsonl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "questions.h"
+#include "export.h"
+#include "pack.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--bank FILE] [--format json|jsonl|pack] [--output FILE]\n", prog);
+    printf("          [--difficulty LEVEL] [--category NAME] [--ids ID,ID,...] [--quiet]\n");
+    printf("FILE may be a JSON or binary pack; output defaults to stdout.\n");
+}
+
+/**
+ * @brief Parse a comma-separated ID list
+ *
+ * @return size_t Number of IDs parsed, 0 on error (*ids must be freed)
+ */
+static size_t parse_ids(const char *list, uint32_t **ids) {
+    size_t cap = 1;
+    for (const char *c = list; *c != '\0'; c++) {
+        cap += *c == ',';
+    }
+    *ids = (uint32_t*)malloc(cap * sizeof(uint32_t));
+    if (*ids == NULL) {
+        return 0;
+    }
+
+    size_t count = 0;
+    const char *p = list;
+    while (*p != '\0') {
+        char *end = NULL;
+        errno = 0;
+        unsigned long id = strtoul(p, &end, 10);
+        if (end == p || errno != 0 || id == 0 || id > UINT32_MAX ||
+            (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        (*ids)[count++] = (uint32_t)id;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static int load_bank(QuestionBank *bank, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        print_error("Failed to open questions file: %s", filename);
+        return -1;
+    }
+    char *data = NULL;
+    size_t len = 0;
+    UtilsError err = read_stream(file, &data, &len);
+    fclose(file);
+    if (err != UTILS_SUCCESS) {
+        print_error("Failed to read questions file: %s", filename);
+        return -1;
+    }
+
+    int loaded = pack_is_pack(data, len) ? pack_load_from_buffer(bank, data, len)
+                                         : question_bank_load_from_buffer(bank, data, len);
+    free(data);
+    return loaded;
+}
+
+int main(int argc, char *argv[]) {
+    const char *bank_file = DEFAULT_QUESTIONS_FILE;
+    const char *output = NULL;
+    int format = EXPORT_JSON;
+    bool quiet = false;
+    uint32_t *ids = NULL;
+    ExportFilter filter;
+    export_filter_init(&filter);
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--bank") == 0 && val != NULL) {
+            bank_file = val;
+            i++;
+        } else if ((strcmp(arg, "--output") == 0 || strcmp(arg, "-o") == 0) && val != NULL) {
+            output = val;
+            i++;
+        } else if (strcmp(arg, "--format") == 0 && val != NULL) {
+            format = export_format_from_name(val);
+            if (format < 0) {
+                print_error("Unknown format: %s", val);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(arg, "--difficulty") == 0 && val != NULL) {
+            filter.difficulty = difficulty_from_name(val);
+            if (filter.difficulty < 0) {
+                print_error("Unknown difficulty: %s", val);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(arg, "--category") == 0 && val != NULL) {
+            filter.category = category_from_name(val);
+            if (filter.category < 0) {
+                print_error("Unknown category: %s", val);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(arg, "--ids") == 0 && val != NULL) {
+            free(ids);
+            filter.id_count = parse_ids(val, &ids);
+            if (filter.id_count == 0) {
+                print_error("Invalid ID list: %s", val);
+                free(ids);
+                return EXIT_FAILURE;
+            }
+            filter.ids = ids;
+            i++;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            free(ids);
+            return EXIT_SUCCESS;
+        } else {
+            print_error("Unknown option: %s", arg);
+            print_usage(argv[0]);
+            free(ids);
+            return EXIT_FAILURE;
+        }
+    }
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        free(ids);
+        return EXIT_FAILURE;
+    }
+    double t0 = monotonic_ms();
+    if (load_bank(&bank, bank_file) < 0) {
+        question_bank_free(&bank);
+        free(ids);
+        return EXIT_FAILURE;
+    }
+    double t1 = monotonic_ms();
+
+    int fd = STDOUT_FILENO;
+    if (output != NULL) {
+        fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            print_error("Failed to create %s: %s", output, strerror(errno));
+            question_bank_free(&bank);
+            free(ids);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ExportWriter writer;
+    long written = -1;
+    if (export_writer_init(&writer, 0) == 0) {
+        written = export_bank(&writer, fd, &bank, &filter, (ExportFormat)format);
+    }
+    double t2 = monotonic_ms();
+    if (fd != STDOUT_FILENO && close(fd) != 0) {
+        print_error("Failed to close %s: %s", output, strerror(errno));
+        written = -1;
+    }
+
+    if (written >= 0 && !quiet) {
+        double secs = (t2 - t1) / 1000.0;
+        fprintf(stderr, "Loaded %zu questions in %.1f ms; exported %ld (%llu bytes) "
+                "in %.1f ms (%.0f MB/s)\n",
+                bank.count, t1 - t0, written, (unsigned long long)writer.written,
+                t2 - t1, secs > 0.0 ? (double)writer.written / 1e6 / secs : 0.0);
+    }
+
+    export_writer_free(&writer);
+    question_bank_free(&bank);
+    free(ids);
+    return written >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file leaderboard.c
+ * @brief trivia-leaderboard: run a leaderboard primary or replica, or query one
+ *
+ *   trivia-leaderboard primary --port 7000 --log-capacity 65536
+ *   trivia-leaderboard replica --port 7001 --primary 127.0.0.1:7000
+ *   trivia-leaderboard query --port 7001 --command "TOP 10"
+ *
+ * See replication.h for the protocol.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "replication.h"
+#include "utils.h"
+
+static ReplicationNode *running_node = NULL;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    replication_node_stop(running_node);
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s primary|replica|query [options]\n", prog);
+    printf("  primary: [--host ADDR] [--port N] [--log-capacity N]\n");
+    printf("  replica: --primary HOST:PORT [--host ADDR] [--port N]\n");
+    printf("  query:   [--host ADDR] [--port N] --command \"SUBMIT|RANK|TOP|STATUS ...\"\n");
+}
+
+/**
+ * @brief Options of every mode
+ */
+typedef struct {
+    ReplicationOptions node;
+    char *primary;
+    const char *command;
+} LeaderboardToolOptions;
+
+static int parse_args(int argc, char *argv[], LeaderboardToolOptions *opts) {
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        int ival = 0;
+        if (val == NULL) {
+            print_error("Missing value for %s", arg);
+            return -1;
+        }
+        i++;
+
+        if (strcmp(arg, "--host") == 0) {
+            opts->node.host = val;
+        } else if (strcmp(arg, "--port") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 0 && ival <= 65535) {
+            opts->node.port = ival;
+        } else if (strcmp(arg, "--log-capacity") == 0 && is_valid_integer(val, &ival) && ival >= 1) {
+            opts->node.log_capacity = (size_t)ival;
+        } else if (strcmp(arg, "--primary") == 0) {
+            opts->primary = argv[i];
+        } else if (strcmp(arg, "--command") == 0) {
+            opts->command = val;
+        } else {
+            print_error("Invalid option or value: %s %s", arg, val);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int run_node(LeaderboardToolOptions *opts, bool primary) {
+    if (!primary) {
+        char *colon = opts->primary != NULL ? strrchr(opts->primary, ':') : NULL;
+        int port = 0;
+        if (colon == NULL || !is_valid_integer(colon + 1, &port) || port < 1 || port > 65535) {
+            print_error("replica needs --primary HOST:PORT");
+            return -1;
+        }
+        *colon = '\0';
+        opts->node.primary_host = opts->primary;
+        opts->node.primary_port = port;
+    }
+    ReplicationNode node;
+    if (replication_node_init(&node, &opts->node) != 0) {
+        return -1;
+    }
+    running_node = &node;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+    if (primary) {
+        printf("trivia-leaderboard: primary keeping %zu records, listening on port %d\n",
+               opts->node.log_capacity, node.port);
+    } else {
+        printf("trivia-leaderboard: replica of %s:%d, listening on port %d\n",
+               opts->node.primary_host, opts->node.primary_port, node.port);
+    }
+    fflush(stdout);
+    int result = replication_node_run(&node);
+    printf("\n%llu connections, %llu commands, seq %llu, %zu players, %llu snapshots\n",
+           (unsigned long long)node.stats.accepted, (unsigned long long)node.stats.commands,
+           (unsigned long long)node.seq, node.board.count,
+           (unsigned long long)node.stats.snapshots);
+    replication_node_destroy(&node);
+    return result;
+}
+
+/**
+ * @brief Send one command and print its reply (a TOP reply spans lines)
+ */
+static int run_query(const LeaderboardToolOptions *opts) {
+    if (opts->command == NULL) {
+        print_error("query needs --command");
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)opts->node.port);
+    int fd = inet_pton(AF_INET, opts->node.host, &addr.sin_addr) == 1
+             ? socket(AF_INET, SOCK_STREAM, 0) : -1;
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        print_error("Failed to connect to %s:%d", opts->node.host, opts->node.port);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    FILE *in = fdopen(fd, "r+");
+    if (in == NULL) {
+        close(fd);
+        return -1;
+    }
+    fprintf(in, "%s\n", opts->command);
+    fflush(in);
+    char line[REPLICATION_MAX_LINE];
+    long lines = 1;
+    int result = -1;
+    for (long i = 0; i < lines && fgets(line, sizeof(line), in) != NULL; i++) {
+        fputs(line, stdout);
+        if (i == 0) {
+            long k = 0;
+            if (sscanf(line, "TOP %ld", &k) == 1) {
+                lines += k;
+            }
+            result = strncmp(line, "ERR", 3) == 0 ? -1 : 0;
+        }
+    }
+    fclose(in);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        print_usage(argv[0]);
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    LeaderboardToolOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    replication_options_init(&opts.node);
+    if (parse_args(argc, argv, &opts) != 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int result;
+    if (strcmp(argv[1], "primary") == 0) {
+        result = run_node(&opts, true);
+    } else if (strcmp(argv[1], "replica") == 0) {
+        result = run_node(&opts, false);
+    } else if (strcmp(argv[1], "query") == 0) {
+        result = run_query(&opts);
+    } else {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,767 @@
+/**
+ * @file loadgen.c
+ * @brief Load generator that plays many bot sessions against the game engine
+ *
+ * Each worker thread owns a slice of the bot sessions and drives them
+ * from a min-heap of due times, so thousands of bots can wait on think
+ * time and answer latency without one thread per bot. Sessions run
+ * in-process through game_draw_question()/game_submit_answer(), so no
+ * network or external service is needed.
+ *
+ * Reports step throughput and percentiles of the engine service time
+ * (draw or grade) and of the scheduling lag (how late a due step ran,
+ * which grows once the workers are saturated).
+ *
+ * With --numa the workers are spread over the NUMA nodes and bound to
+ * their node's CPUs, and each worker allocates its sessions itself so
+ * they are node-local. --replicate also gives every node its own copy of
+ * the question bank.
+ *
+ * Each worker recycles its games through its own SessionPool, so once
+ * warm, starting and ending games makes no allocator calls; the pool hit
+ * rate is reported with the results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "game.h"
+#include "metrics.h"
+#include "pool.h"
+#include "questions.h"
+#include "topology.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+
+/** Sub-buckets per power of two in the latency histogram (~3% error). */
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+/**
+ * @brief Shape of a randomized delay
+ */
+typedef enum {
+    DIST_FIXED = 0,
+    DIST_UNIFORM,
+    DIST_EXP
+} DistKind;
+
+/**
+ * @brief Delay distribution (mean in nanoseconds)
+ */
+typedef struct {
+    DistKind kind;
+    double mean_ns;
+} Distribution;
+
+/**
+ * @brief Load generator options
+ */
+typedef struct {
+    const char *bank_file;
+    int sessions;
+    int threads;
+    int games;                 /**< Games per session, 0 = until duration ends */
+    double duration_s;
+    int questions_per_game;
+    int players;
+    int difficulty;
+    int time_limit_s;
+    double accuracy;
+    Distribution think;
+    Distribution latency;
+    uint64_t seed;
+    bool numa;                 /**< Bind workers to nodes, node-local sessions */
+    bool replicate;            /**< One bank copy per node (implies numa) */
+} LoadgenOptions;
+
+/**
+ * @brief Log-linear latency histogram
+ */
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+typedef enum {
+    BOT_DRAW = 0,
+    BOT_ANSWER
+} BotPhase;
+
+/**
+ * @brief One simulated client
+ */
+typedef struct {
+    GameState *game;           /**< From the worker's pool while active */
+    Question *question;
+    BotPhase phase;
+    int round;
+    int total_rounds;
+    int games_done;
+    int64_t latency_ns;        /**< Sampled latency of the pending answer */
+    bool active;
+} Bot;
+
+typedef struct {
+    int64_t due_ns;
+    int bot;
+} HeapEntry;
+
+/**
+ * @brief Per-worker state
+ */
+typedef struct {
+    const LoadgenOptions *opts;
+    QuestionBank *bank;
+    const Topology *topo;      /**< Set when the worker is bound to a node */
+    int node;
+    Bot *bots;                 /**< Allocated by the worker itself */
+    SessionPool pool;          /**< Recycled games of this worker's bots */
+    int bot_count;
+    HeapEntry *heap;
+    int heap_len;
+    uint64_t rng;
+    int64_t start_ns;
+    int64_t end_ns;
+    uint64_t steps;
+    uint64_t answers;
+    uint64_t correct;
+    uint64_t timeouts;
+    uint64_t games;
+    uint64_t points;
+    Histogram service;
+    Histogram lag;
+    pthread_t thread;
+    bool started;
+    bool failed;
+} Worker;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *s = x;
+    return x;
+}
+
+static double rng_unit(uint64_t *s) {
+    return (double)(rng_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int64_t dist_sample(const Distribution *d, uint64_t *rng) {
+    switch (d->kind) {
+        case DIST_UNIFORM:
+            return (int64_t)(rng_unit(rng) * 2.0 * d->mean_ns);
+        case DIST_EXP:
+            return (int64_t)(-log(1.0 - rng_unit(rng)) * d->mean_ns);
+        case DIST_FIXED:
+        default:
+            return (int64_t)d->mean_ns;
+    }
+}
+
+static void hist_record(Histogram *h, uint64_t v) {
+    int idx;
+    if (v < HIST_SUB) {
+        idx = (int)v;
+    } else {
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - HIST_SUB_BITS;
+        idx = (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+    }
+    h->counts[idx]++;
+    h->total++;
+    if (v > h->max) {
+        h->max = v;
+    }
+}
+
+static uint64_t hist_bucket_value(int idx) {
+    if (idx < HIST_SUB) {
+        return (uint64_t)idx;
+    }
+    int shift = idx / HIST_SUB - 1;
+    uint64_t sub = (uint64_t)(idx % HIST_SUB);
+    return ((uint64_t)HIST_SUB + sub) << shift;
+}
+
+static uint64_t hist_percentile(const Histogram *h, double p) {
+    if (h->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * (double)h->total);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hist_bucket_value(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+static void hist_merge(Histogram *dst, const Histogram *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+static void heap_push(Worker *w, int64_t due, int bot) {
+    int i = w->heap_len++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (w->heap[parent].due_ns <= due) {
+            break;
+        }
+        w->heap[i] = w->heap[parent];
+        i = parent;
+    }
+    w->heap[i].due_ns = due;
+    w->heap[i].bot = bot;
+}
+
+static HeapEntry heap_pop(Worker *w) {
+    HeapEntry top = w->heap[0];
+    HeapEntry last = w->heap[--w->heap_len];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= w->heap_len) {
+            break;
+        }
+        if (child + 1 < w->heap_len && w->heap[child + 1].due_ns < w->heap[child].due_ns) {
+            child++;
+        }
+        if (w->heap[child].due_ns >= last.due_ns) {
+            break;
+        }
+        w->heap[i] = w->heap[child];
+        i = child;
+    }
+    w->heap[i] = last;
+    return top;
+}
+
+static int bot_start_game(Worker *w, Bot *bot) {
+    GameConfig config;
+    config.questions_per_game = w->opts->questions_per_game;
+    config.time_per_question = w->opts->time_limit_s;
+    config.difficulty = (Difficulty)w->opts->difficulty;
+    config.use_timer = false;
+    config.num_players = w->opts->players;
+    config.shuffle_options = true;
+
+    bot->game = game_create(&w->pool, w->bank, &config);
+    if (bot->game == NULL) {
+        return -1;
+    }
+    bot->game->game_active = true;
+    bot->phase = BOT_DRAW;
+    bot->round = 0;
+    bot->total_rounds = config.questions_per_game * (config.num_players > 1 ? config.num_players : 1);
+    bot->active = true;
+    return 0;
+}
+
+static void bot_end_game(Worker *w, Bot *bot) {
+    game_destroy(bot->game);
+    bot->game = NULL;
+    bot->active = false;
+    bot->games_done++;
+    w->games++;
+}
+
+/**
+ * @brief Run one due step of a bot and return its next due time (or -1)
+ */
+static int64_t bot_step(Worker *w, Bot *bot, int64_t now) {
+    const LoadgenOptions *opts = w->opts;
+
+    if (!bot->active) {
+        if (opts->games > 0 && bot->games_done >= opts->games) {
+            return -1;
+        }
+        if (bot_start_game(w, bot) != 0) {
+            return -1;
+        }
+    }
+
+    if (bot->phase == BOT_DRAW) {
+        int64_t t0 = now_ns();
+        bot->question = game_draw_question(bot->game);
+        hist_record(&w->service, (uint64_t)(now_ns() - t0));
+        w->steps++;
+        if (bot->question == NULL) {
+            bot_end_game(w, bot);
+            return now + dist_sample(&opts->think, &w->rng);
+        }
+        bot->latency_ns = dist_sample(&opts->latency, &w->rng);
+        bot->phase = BOT_ANSWER;
+        return now + bot->latency_ns;
+    }
+
+    const Question *q = bot->question;
+    int option_count = 0;
+    while (option_count < MAX_OPTIONS && q->options[option_count][0] != '\0') {
+        option_count++;
+    }
+
+    int answer;
+    int64_t limit_ns = (int64_t)opts->time_limit_s * 1000000000LL;
+    if (bot->latency_ns >= limit_ns) {
+        answer = 0;
+        w->timeouts++;
+    } else if (option_count <= 1 || rng_unit(&w->rng) < opts->accuracy) {
+        answer = game_option_choice(bot->game, q->correct_answer);
+    } else {
+        int wrong = (int)(rng_next(&w->rng) % (uint64_t)(option_count - 1));
+        if (wrong >= q->correct_answer) {
+            wrong++;
+        }
+        answer = game_option_choice(bot->game, wrong);
+    }
+    int time_remaining = (int)((limit_ns - bot->latency_ns) / 1000000000LL);
+    if (time_remaining < 0) {
+        time_remaining = 0;
+    }
+
+    int64_t t0 = now_ns();
+    int points = game_submit_answer(bot->game, q, answer, time_remaining);
+    game_next_player(bot->game);
+    hist_record(&w->service, (uint64_t)(now_ns() - t0));
+    w->steps++;
+    w->answers++;
+    if (answer != 0 && answer == game_option_choice(bot->game, q->correct_answer)) {
+        w->correct++;
+    }
+    if (points > 0) {
+        w->points += (uint64_t)points;
+    }
+
+    bot->phase = BOT_DRAW;
+    bot->round++;
+    if (bot->round >= bot->total_rounds) {
+        bot_end_game(w, bot);
+    }
+    return now + dist_sample(&opts->think, &w->rng);
+}
+
+static void sleep_until(int64_t due) {
+    int64_t delta = due - now_ns();
+    if (delta <= 0) {
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(delta / 1000000000LL);
+    ts.tv_nsec = (long)(delta % 1000000000LL);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+/** Set when a worker could not start or allocate; the others stop early */
+static atomic_bool run_aborted;
+
+static void* worker_main(void *arg) {
+    Worker *w = (Worker*)arg;
+
+    /* Bind first, then allocate: first touch places the sessions on the
+     * worker's node. */
+    if (w->topo != NULL && topology_bind_thread(w->topo, w->node) != 0) {
+        print_error("Failed to bind a worker to node %d", w->topo->node_ids[w->node]);
+    }
+    if (session_pool_init(&w->pool, (size_t)w->bot_count) != 0) {
+        w->failed = true;
+        atomic_store(&run_aborted, true);
+        return NULL;
+    }
+    w->bots = (Bot*)calloc((size_t)w->bot_count, sizeof(Bot));
+    w->heap = (HeapEntry*)malloc((size_t)w->bot_count * sizeof(HeapEntry));
+    if (w->bots == NULL || w->heap == NULL) {
+        free(w->bots);
+        free(w->heap);
+        session_pool_destroy(&w->pool);
+        w->failed = true;
+        atomic_store(&run_aborted, true);
+        return NULL;
+    }
+
+    for (int i = 0; i < w->bot_count; i++) {
+        heap_push(w, w->start_ns + dist_sample(&w->opts->think, &w->rng), i);
+    }
+
+    while (w->heap_len > 0) {
+        int64_t due = w->heap[0].due_ns;
+        if (w->end_ns > 0 && due >= w->end_ns) {
+            break;
+        }
+        sleep_until(due);
+        HeapEntry e = heap_pop(w);
+        int64_t now = now_ns();
+        if ((w->end_ns > 0 && now >= w->end_ns) || atomic_load(&run_aborted)) {
+            break;
+        }
+        hist_record(&w->lag, (uint64_t)(now - e.due_ns));
+        int64_t next = bot_step(w, &w->bots[e.bot], now);
+        if (next >= 0) {
+            heap_push(w, next, e.bot);
+        }
+    }
+
+    for (int i = 0; i < w->bot_count; i++) {
+        if (w->bots[i].active) {
+            game_destroy(w->bots[i].game);
+            w->bots[i].active = false;
+        }
+    }
+    free(w->bots);
+    free(w->heap);
+    session_pool_destroy(&w->pool);
+    return NULL;
+}
+
+/**
+ * @brief Parse "fixed:MS", "uniform:MS" or "exp:MS" (mean in milliseconds)
+ */
+static int parse_distribution(const char *spec, Distribution *d) {
+    const char *colon = strchr(spec, ':');
+    const char *num = spec;
+    d->kind = DIST_FIXED;
+    if (colon != NULL) {
+        size_t len = (size_t)(colon - spec);
+        if (len == 5 && strncmp(spec, "fixed", 5) == 0) {
+            d->kind = DIST_FIXED;
+        } else if (len == 7 && strncmp(spec, "uniform", 7) == 0) {
+            d->kind = DIST_UNIFORM;
+        } else if (len == 3 && strncmp(spec, "exp", 3) == 0) {
+            d->kind = DIST_EXP;
+        } else {
+            return -1;
+        }
+        num = colon + 1;
+    }
+    char *end;
+    double ms = strtod(num, &end);
+    if (end == num || *end != '\0' || ms < 0.0) {
+        return -1;
+    }
+    d->mean_ns = ms * 1e6;
+    return 0;
+}
+
+/**
+ * @brief Parse a finite number in [min, max]
+ */
+static int parse_double(const char *text, double min, double max, double *out) {
+    char *end;
+    errno = 0;
+    double v = strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !isfinite(v) || v < min || v > max) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n\n", prog);
+    printf("  --bank FILE        Questions file (default %s)\n", DEFAULT_QUESTIONS_FILE);
+    printf("  --sessions N       Concurrent bot sessions (default 1000)\n");
+    printf("  --threads N        Worker threads (default: online CPUs)\n");
+    printf("  --duration SEC     Stop after SEC seconds (default 10)\n");
+    printf("  --games N          Games per session, 0 = run for duration (default 0)\n");
+    printf("  --questions N      Questions per game (default 5)\n");
+    printf("  --players N        Players per session (default 1)\n");
+    printf("  --difficulty D     easy|medium|hard|any (default any)\n");
+    printf("  --time-limit SEC   Seconds per question (default 30)\n");
+    printf("  --accuracy P       Probability of a correct answer (default 0.7)\n");
+    printf("  --think DIST       Delay between questions (default exp:500)\n");
+    printf("  --latency DIST     Delay before answering (default exp:3000)\n");
+    printf("  --seed N           RNG seed (default 1)\n");
+    printf("  --numa             Bind workers to NUMA nodes with node-local sessions\n");
+    printf("  --replicate        Also copy the question bank onto every node\n\n");
+    printf("  DIST is fixed:MS, uniform:MS or exp:MS, MS being the mean in ms.\n");
+}
+
+static int parse_args(int argc, char *argv[], LoadgenOptions *o) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ival = 0;
+        double dval = 0.0;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        if (strcmp(arg, "--numa") == 0) {
+            o->numa = true;
+            continue;
+        }
+        if (strcmp(arg, "--replicate") == 0) {
+            o->numa = true;
+            o->replicate = true;
+            continue;
+        }
+        if (val == NULL) {
+            print_error("Missing value for %s", arg);
+            return -1;
+        }
+        i++;
+
+        if (strcmp(arg, "--bank") == 0) {
+            o->bank_file = val;
+        } else if (strcmp(arg, "--sessions") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            o->sessions = ival;
+        } else if (strcmp(arg, "--threads") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            o->threads = ival;
+        } else if (strcmp(arg, "--games") == 0 && is_valid_integer(val, &ival) && ival >= 0) {
+            o->games = ival;
+        } else if (strcmp(arg, "--duration") == 0 && parse_double(val, 0.0, 1e9, &dval) == 0) {
+            o->duration_s = dval;
+        } else if (strcmp(arg, "--questions") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            o->questions_per_game = ival;
+        } else if (strcmp(arg, "--players") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            o->players = ival;
+        } else if (strcmp(arg, "--difficulty") == 0) {
+            if (strcmp(val, "easy") == 0) {
+                o->difficulty = DIFFICULTY_EASY;
+            } else if (strcmp(val, "medium") == 0) {
+                o->difficulty = DIFFICULTY_MEDIUM;
+            } else if (strcmp(val, "hard") == 0) {
+                o->difficulty = DIFFICULTY_HARD;
+            } else if (strcmp(val, "any") == 0) {
+                o->difficulty = -1;
+            } else {
+                print_error("Unknown difficulty: %s", val);
+                return -1;
+            }
+        } else if (strcmp(arg, "--time-limit") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            o->time_limit_s = ival;
+        } else if (strcmp(arg, "--accuracy") == 0 && parse_double(val, 0.0, 1.0, &dval) == 0) {
+            o->accuracy = dval;
+        } else if (strcmp(arg, "--think") == 0) {
+            if (parse_distribution(val, &o->think) != 0) {
+                print_error("Invalid distribution: %s", val);
+                return -1;
+            }
+        } else if (strcmp(arg, "--latency") == 0) {
+            if (parse_distribution(val, &o->latency) != 0) {
+                print_error("Invalid distribution: %s", val);
+                return -1;
+            }
+        } else if (strcmp(arg, "--seed") == 0) {
+            char *end;
+            errno = 0;
+            o->seed = strtoull(val, &end, 10);
+            if (end == val || *end != '\0' || errno != 0) {
+                print_error("Invalid seed: %s", val);
+                return -1;
+            }
+        } else {
+            print_error("Invalid option or value: %s %s", arg, val);
+            return -1;
+        }
+    }
+
+    if (o->games == 0 && o->duration_s <= 0.0) {
+        print_error("Either --games or a positive --duration is required");
+        return -1;
+    }
+    return 0;
+}
+
+static void print_hist(const char *label, const Histogram *h) {
+    printf("  %-18s p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+           label,
+           hist_percentile(h, 50.0) / 1e3, hist_percentile(h, 90.0) / 1e3,
+           hist_percentile(h, 99.0) / 1e3, hist_percentile(h, 99.9) / 1e3,
+           h->max / 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    LoadgenOptions opts;
+    opts.bank_file = DEFAULT_QUESTIONS_FILE;
+    opts.sessions = 1000;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.threads = cpus > 0 ? (int)cpus : 1;
+    opts.games = 0;
+    opts.duration_s = 10.0;
+    opts.questions_per_game = 5;
+    opts.players = 1;
+    opts.difficulty = -1;
+    opts.time_limit_s = 30;
+    opts.accuracy = 0.7;
+    opts.think.kind = DIST_EXP;
+    opts.think.mean_ns = 500e6;
+    opts.latency.kind = DIST_EXP;
+    opts.latency.mean_ns = 3000e6;
+    opts.seed = 1;
+    opts.numa = false;
+    opts.replicate = false;
+
+    if (parse_args(argc, argv, &opts) != 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (opts.threads > opts.sessions) {
+        opts.threads = opts.sessions;
+    }
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (question_bank_load_from_json(&bank, opts.bank_file) <= 0 ||
+        question_bank_prepare(&bank, NULL) <= 0) {
+        print_error("No questions loaded from %s", opts.bank_file);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+
+    Topology topo;
+    QuestionBank replicas[TOPOLOGY_MAX_NODES];
+    bool replicated = false;
+    if (opts.numa && topology_load(&topo) < 0) {
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    if (opts.replicate) {
+        if (topology_replicate_bank(&topo, &bank, replicas) != 0) {
+            question_bank_free(&bank);
+            return EXIT_FAILURE;
+        }
+        replicated = true;
+    }
+
+    Worker *workers = (Worker*)calloc((size_t)opts.threads, sizeof(Worker));
+    if (workers == NULL) {
+        print_error("Failed to allocate %d workers", opts.threads);
+        for (int n = 0; replicated && n < topo.node_count; n++) {
+            question_bank_free(&replicas[n]);
+        }
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+
+    printf("trivia-loadgen: %d sessions on %d threads, %zu questions, think %.0f ms, "
+           "latency %.0f ms, accuracy %.2f\n",
+           opts.sessions, opts.threads, bank.count,
+           opts.think.mean_ns / 1e6, opts.latency.mean_ns / 1e6, opts.accuracy);
+    if (opts.numa) {
+        printf("NUMA: %d node(s), workers bound per node, %s bank\n", topo.node_count,
+               replicated ? "per-node" : "shared");
+    }
+
+    int64_t start = now_ns();
+    int64_t end = opts.duration_s > 0.0 ? start + (int64_t)(opts.duration_s * 1e9) : 0;
+    for (int t = 0; t < opts.threads; t++) {
+        Worker *w = &workers[t];
+        int share = opts.sessions / opts.threads + (t < opts.sessions % opts.threads ? 1 : 0);
+        w->opts = &opts;
+        w->bank = &bank;
+        if (opts.numa) {
+            w->topo = &topo;
+            w->node = topology_node_for_worker(&topo, t, opts.threads);
+            if (replicated) {
+                w->bank = &replicas[w->node];
+            }
+        }
+        w->bot_count = share;
+        w->rng = (opts.seed + (uint64_t)t + 1) * 0x9E3779B97F4A7C15ULL;
+        w->start_ns = start;
+        w->end_ns = end;
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            print_error("Failed to start worker %d", t);
+            atomic_store(&run_aborted, true);
+            break;
+        }
+        w->started = true;
+    }
+
+    Histogram service;
+    Histogram lag;
+    memset(&service, 0, sizeof(service));
+    memset(&lag, 0, sizeof(lag));
+    uint64_t steps = 0, answers = 0, correct = 0, timeouts = 0, games = 0, points = 0;
+    for (int t = 0; t < opts.threads; t++) {
+        Worker *w = &workers[t];
+        if (w->started) {
+            pthread_join(w->thread, NULL);
+        }
+        if (w->failed) {
+            print_error("Worker %d could not allocate its %d sessions", t, w->bot_count);
+        }
+    }
+    if (atomic_load(&run_aborted)) {
+        /* Totals missing a worker's sessions would understate the load. */
+        print_error("Run aborted, no results reported");
+        free(workers);
+        for (int n = 0; replicated && n < topo.node_count; n++) {
+            question_bank_free(&replicas[n]);
+        }
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    for (int t = 0; t < opts.threads; t++) {
+        Worker *w = &workers[t];
+        steps += w->steps;
+        answers += w->answers;
+        correct += w->correct;
+        timeouts += w->timeouts;
+        games += w->games;
+        points += w->points;
+        hist_merge(&service, &w->service);
+        hist_merge(&lag, &w->lag);
+        session_pool_publish(&w->pool);
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    printf("\nElapsed: %.2f s\n", elapsed);
+    printf("  Steps:    %llu (%.0f/s)\n", (unsigned long long)steps, steps / elapsed);
+    printf("  Answers:  %llu (%.0f/s), %.1f%% correct, %llu timeouts\n",
+           (unsigned long long)answers, answers / elapsed,
+           answers > 0 ? 100.0 * (double)correct / (double)answers : 0.0,
+           (unsigned long long)timeouts);
+    printf("  Games:    %llu (%.1f/s), %llu points\n",
+           (unsigned long long)games, games / elapsed, (unsigned long long)points);
+    printf("  Pool:     %.1f%% hits (%.0f allocations, %.0f from malloc)\n",
+           100.0 * metrics_get("pool.hit_rate"),
+           metrics_get("pool.hits") + metrics_get("pool.misses"), metrics_get("pool.misses"));
+    printf("\nLatency percentiles:\n");
+    print_hist("engine service", &service);
+    print_hist("scheduling lag", &lag);
+
+    free(workers);
+    if (replicated) {
+        for (int n = 0; n < topo.node_count; n++) {
+            question_bank_free(&replicas[n]);
+        }
+    }
+    question_bank_free(&bank);
+    return EXIT_SUCCESS;
+}
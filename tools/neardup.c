@@ -0,0 +1,113 @@
+/**
+ * @file neardup.c
+ * @brief trivia-neardup: report near-duplicate questions in a pack
+ *
+ * Computes a MinHash signature per question, finds candidates with LSH
+ * banding and prints each cluster of reworded duplicates, representative
+ * first.
+ *
+ *   trivia-neardup --bank data/questions.json --threshold 0.7 --threads 4
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "questions.h"
+#include "metrics.h"
+#include "neardup.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+
+int main(int argc, char *argv[]) {
+    const char *bank_file = DEFAULT_QUESTIONS_FILE;
+    double threshold = NEARDUP_DEFAULT_THRESHOLD;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        int value = 0;
+        if (strcmp(argv[i], "--bank") == 0 && i + 1 < argc) {
+            bank_file = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+            if (threshold <= 0.0 || threshold > 1.0) {
+                print_error("Threshold must be in (0, 1]");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc &&
+                   is_valid_integer(argv[i + 1], &value) && value > 0) {
+            threads = value;
+            i++;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--bank FILE] [--threshold S] [--threads N] [--quiet]\n", argv[0]);
+            printf("Prints clusters of questions whose estimated similarity is at least S.\n");
+            return EXIT_SUCCESS;
+        } else {
+            print_error("Unknown option: %s", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return EXIT_FAILURE;
+    }
+    double t0 = monotonic_ms();
+    if (question_bank_load_from_json(&bank, bank_file) <= 0) {
+        print_error("No questions loaded from %s", bank_file);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    double t1 = monotonic_ms();
+
+    NearDupResult result;
+    if (neardup_find_clusters(&bank, threshold, threads, &result) != 0) {
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    double t2 = monotonic_ms();
+
+    if (!quiet) {
+        /* Chain each cluster's members in bank order, then walk the chains. */
+        size_t *first = (size_t*)malloc((result.count + 1) * sizeof(size_t));
+        size_t *next = (size_t*)malloc((result.count + 1) * sizeof(size_t));
+        if (first != NULL && next != NULL) {
+            for (size_t i = 0; i < result.count; i++) {
+                first[i] = SIZE_MAX;
+            }
+            for (size_t i = result.count; i-- > 0;) {
+                size_t rep = result.cluster_of[i];
+                if (rep != i) {
+                    next[i] = first[rep];
+                    first[rep] = i;
+                }
+            }
+            for (size_t rep = 0; rep < result.count; rep++) {
+                if (first[rep] == SIZE_MAX) {
+                    continue;
+                }
+                printf("#%zu %s\n", rep, bank.questions[rep].question);
+                for (size_t i = first[rep]; i != SIZE_MAX; i = next[i]) {
+                    printf("  #%zu %s\n", i, bank.questions[i].question);
+                }
+            }
+        }
+        free(first);
+        free(next);
+    }
+
+    fprintf(stderr, "Loaded %zu questions in %.1f ms; %zu cluster(s), %zu near-duplicate(s) "
+            "in %.1f ms with %d thread(s), %.0f at once\n",
+            bank.count, t1 - t0, result.clusters, result.duplicates, t2 - t1, threads,
+            metrics_get("neardup.peak_workers"));
+
+    neardup_result_free(&result);
+    question_bank_free(&bank);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file search.c
+ * @brief trivia-search: full-text search over a question pack
+ *
+ * Loads a pack, builds the inverted index and answers queries given on
+ * the command line, or one per line from stdin when none are given.
+ *
+ *   trivia-search --bank data/questions.json mars
+ *   trivia-search --bank data/questions.json '"red planet"'
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "questions.h"
+#include "search.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+#define DEFAULT_LIMIT 20
+
+static void run_query(const SearchIndex *index, const QuestionBank *bank,
+                      const char *query, size_t limit) {
+    size_t *results = (size_t*)malloc((limit > 0 ? limit : 1) * sizeof(size_t));
+    if (results == NULL) {
+        return;
+    }
+
+    double t0 = monotonic_ms();
+    long matches = search_query(index, query, results, limit);
+    double elapsed = monotonic_ms() - t0;
+
+    if (matches < 0) {
+        print_error("Invalid query: %s", query);
+        free(results);
+        return;
+    }
+
+    printf("%ld match(es) for %s in %.3f ms\n", matches, query, elapsed);
+    size_t shown = (size_t)matches < limit ? (size_t)matches : limit;
+    for (size_t i = 0; i < shown; i++) {
+        const Question *q = &bank->questions[results[i]];
+        printf("  #%zu [%s] %s\n", results[i], difficulty_to_string(q->difficulty), q->question);
+    }
+    if ((size_t)matches > shown) {
+        printf("  ... %ld more\n", matches - (long)shown);
+    }
+    free(results);
+}
+
+int main(int argc, char *argv[]) {
+    const char *bank_file = DEFAULT_QUESTIONS_FILE;
+    size_t limit = DEFAULT_LIMIT;
+    int first_query = argc;
+
+    for (int i = 1; i < argc; i++) {
+        int value = 0;
+        if (strcmp(argv[i], "--bank") == 0 && i + 1 < argc) {
+            bank_file = argv[++i];
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc &&
+                   is_valid_integer(argv[i + 1], &value) && value >= 0) {
+            limit = (size_t)value;
+            i++;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--bank FILE] [--limit N] [QUERY...]\n", argv[0]);
+            printf("Words must all match; \"quoted words\" must match as a phrase.\n");
+            return EXIT_SUCCESS;
+        } else {
+            first_query = i;
+            break;
+        }
+    }
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return EXIT_FAILURE;
+    }
+    double t0 = monotonic_ms();
+    if (question_bank_load_from_json(&bank, bank_file) <= 0) {
+        print_error("No questions loaded from %s", bank_file);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    double t1 = monotonic_ms();
+
+    SearchIndex index;
+    if (search_index_build(&index, &bank) != 0) {
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    double t2 = monotonic_ms();
+    fprintf(stderr, "Loaded %zu questions in %.1f ms; indexed %zu terms "
+            "(%zu posting bytes) in %.1f ms\n",
+            bank.count, t1 - t0, index.term_count,
+            search_index_posting_bytes(&index), t2 - t1);
+
+    if (first_query < argc) {
+        for (int i = first_query; i < argc; i++) {
+            run_query(&index, &bank, argv[i], limit);
+        }
+    } else {
+        char line[MAX_INPUT_LEN];
+        while (read_input(line, sizeof(line)) == UTILS_SUCCESS) {
+            sanitize_input(line);
+            if (line[0] != '\0') {
+                run_query(&index, &bank, line, limit);
+            }
+        }
+    }
+
+    search_index_free(&index);
+    question_bank_free(&bank);
+    return EXIT_SUCCESS;
+}
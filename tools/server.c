@@ -0,0 +1,341 @@
+/**
+ * @file server.c
+ * @brief trivia-server: the game over WebSocket for browser clients
+ *
+ *   trivia-server --bank data/questions.json --port 8080
+ *
+ * Clients connect to ws://HOST:PORT/, send "JOIN <room> [seats]" and get
+ * JSON messages back; see server.h for the protocol. Holding tens of
+ * thousands of connections needs a matching open-file limit, so the soft
+ * limit is raised to the hard limit at startup.
+ *
+ * With --http-port the read-only admin query API (http.h) runs alongside
+ * on its own thread.
+ *
+ * For a deploy, start the new node with --handoff-port and the old one
+ * with --handoff-to pointing at it; SIGUSR1 to the old node moves its
+ * rooms over and redirects their clients (see server.h).
+ *
+ * To upgrade in place, install the new binary over the old one and send
+ * SIGUSR2: the server starts it with the same arguments plus --upgrade-fd,
+ * passes it the listening sockets (the admin API's too), hands it every
+ * room and exits once its remaining clients are gone.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "http.h"
+#include "metrics.h"
+#include "questions.h"
+#include "server.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+
+static Server *running_server = NULL;
+static char *handoff_host = NULL;
+static int handoff_port = 0;
+static char **upgrade_argv = NULL;
+static char upgrade_binary[PATH_MAX];
+static int upgrade_fd = -1;
+static int upgrade_extra[1] = { -1 };
+static int upgrade_extra_count = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    server_stop(running_server);
+}
+
+static void handle_handoff(int sig) {
+    (void)sig;
+    server_handoff(running_server, handoff_host, handoff_port);
+}
+
+/**
+ * @brief Start this program's binary as it is on disk now, connected to
+ *        us by a socket pair
+ */
+static int spawn_upgrade(void *ctx) {
+    (void)ctx;
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+        return -1;
+    }
+    /* Formatted before forking: only exec is safe in the child. */
+    char fd_arg[16];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", pair[1]);
+    int argc = 0;
+    while (upgrade_argv[argc] != NULL) {
+        argc++;
+    }
+    char **argv = (char**)calloc((size_t)argc + 3, sizeof(char*));
+    if (argv == NULL) {
+        close(pair[0]);
+        close(pair[1]);
+        return -1;
+    }
+    memcpy(argv, upgrade_argv, (size_t)argc * sizeof(char*));
+    argv[argc] = "--upgrade-fd";
+    argv[argc + 1] = fd_arg;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(pair[0]);
+        fcntl(pair[1], F_SETFD, 0);
+        execv(upgrade_binary, argv);
+        _exit(127);
+    }
+    free(argv);
+    close(pair[1]);
+    if (pid < 0) {
+        close(pair[0]);
+        return -1;
+    }
+    return pair[0];
+}
+
+static void handle_upgrade(int sig) {
+    (void)sig;
+    server_upgrade(running_server, spawn_upgrade, NULL, upgrade_extra, upgrade_extra_count);
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --bank FILE            Question bank (default %s)\n", DEFAULT_QUESTIONS_FILE);
+    printf("  --host ADDR            IPv4 address to listen on (default 0.0.0.0)\n");
+    printf("  --port N               WebSocket port (default 8080, 0 picks one)\n");
+    printf("  --max-connections N    Connections held at once (default 50000)\n");
+    printf("  --questions N          Questions per player (default 5)\n");
+    printf("  --time-limit SEC       Seconds per question (default 30)\n");
+    printf("  --difficulty LEVEL     easy, medium, hard or any (default any)\n");
+    printf("  --http-port N          Also serve the admin query API on this port (default off)\n");
+    printf("  --http-host ADDR       IPv4 address for the admin API (default 127.0.0.1)\n");
+    printf("  --handoff-port N       Take rooms from other nodes on this port (default off)\n");
+    printf("  --handoff-to HOST:PORT On SIGUSR1, hand every room to this node\n");
+    printf("SIGUSR2 restarts the binary in place without dropping connections.\n");
+}
+
+static int parse_args(int argc, char *argv[], ServerOptions *opts, HttpOptions *http,
+                      const char **bank_file) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        int ival = 0;
+        if (strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        if (val == NULL) {
+            print_error("Missing value for %s", arg);
+            return -1;
+        }
+        i++;
+
+        if (strcmp(arg, "--bank") == 0) {
+            *bank_file = val;
+        } else if (strcmp(arg, "--host") == 0) {
+            opts->host = val;
+        } else if (strcmp(arg, "--port") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 0 && ival <= 65535) {
+            opts->port = ival;
+        } else if (strcmp(arg, "--max-connections") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            opts->max_connections = ival;
+        } else if (strcmp(arg, "--questions") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            opts->questions_per_game = ival;
+        } else if (strcmp(arg, "--time-limit") == 0 && is_valid_integer(val, &ival) && ival > 0) {
+            opts->time_limit_s = ival;
+        } else if (strcmp(arg, "--http-port") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 0 && ival <= 65535) {
+            http->port = ival;
+        } else if (strcmp(arg, "--http-host") == 0) {
+            http->host = val;
+        } else if (strcmp(arg, "--handoff-port") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 0 && ival <= 65535) {
+            opts->handoff_port = ival;
+        } else if (strcmp(arg, "--handoff-to") == 0) {
+            char *colon = strrchr(argv[i], ':');
+            if (colon == NULL || !is_valid_integer(colon + 1, &ival) || ival < 1 || ival > 65535) {
+                print_error("--handoff-to needs HOST:PORT");
+                return -1;
+            }
+            *colon = '\0';
+            handoff_host = argv[i];
+            handoff_port = ival;
+        } else if (strcmp(arg, "--upgrade-fd") == 0 && is_valid_integer(val, &ival) && ival >= 0) {
+            upgrade_fd = ival;
+        } else if (strcmp(arg, "--difficulty") == 0) {
+            if (strcmp(val, "easy") == 0) {
+                opts->difficulty = DIFFICULTY_EASY;
+            } else if (strcmp(val, "medium") == 0) {
+                opts->difficulty = DIFFICULTY_MEDIUM;
+            } else if (strcmp(val, "hard") == 0) {
+                opts->difficulty = DIFFICULTY_HARD;
+            } else if (strcmp(val, "any") == 0) {
+                opts->difficulty = -1;
+            } else {
+                print_error("Unknown difficulty: %s", val);
+                return -1;
+            }
+        } else {
+            print_error("Invalid option or value: %s %s", arg, val);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Raise the open-file soft limit as far as allowed
+ *
+ * @return long The limit now in effect
+ */
+static long raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return -1;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return (long)limit.rlim_cur;
+}
+
+int main(int argc, char *argv[]) {
+    /* Kept before parse_args() splits --handoff-to, for the upgrade's exec.
+     * The path, not /proc/self/exe, so the upgrade runs the binary now
+     * installed there rather than this one. */
+    if (realpath("/proc/self/exe", upgrade_binary) == NULL) {
+        upgrade_binary[0] = '\0';
+    }
+    upgrade_argv = (char**)calloc((size_t)argc + 1, sizeof(char*));
+    for (int i = 0; upgrade_argv != NULL && i < argc; i++) {
+        upgrade_argv[i] = strdup(argv[i]);
+    }
+    ServerOptions opts;
+    server_options_init(&opts);
+    HttpOptions http_opts;
+    http_options_init(&http_opts);
+    http_opts.port = -1;
+    const char *bank_file = DEFAULT_QUESTIONS_FILE;
+    if (parse_args(argc, argv, &opts, &http_opts, &bank_file) != 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (upgrade_fd >= 0) {
+        /* Started by an upgrade: drop our own --upgrade-fd for the next one. */
+        if (upgrade_argv != NULL && argc >= 3 &&
+            strcmp(upgrade_argv[argc - 2], "--upgrade-fd") == 0) {
+            free(upgrade_argv[argc - 2]);
+            free(upgrade_argv[argc - 1]);
+            upgrade_argv[argc - 2] = NULL;
+        }
+        int extra = 1;
+        if (server_inherit(upgrade_fd, &opts, upgrade_extra, &extra) != 0) {
+            return EXIT_FAILURE;
+        }
+        http_opts.listen_fd = extra > 0 ? upgrade_extra[0] : -1;
+    }
+
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (question_bank_load_from_json(&bank, bank_file) <= 0 ||
+        question_bank_prepare(&bank, NULL) <= 0) {
+        print_error("No questions loaded from %s", bank_file);
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+
+    long fd_limit = raise_fd_limit();
+    if (fd_limit > 0 && fd_limit < (long)opts.max_connections + 16) {
+        printf("Note: open-file limit %ld caps connections below %d\n", fd_limit,
+               opts.max_connections);
+    }
+
+    Server server;
+    if (server_init(&server, &bank, &opts) != 0) {
+        question_bank_free(&bank);
+        return EXIT_FAILURE;
+    }
+    HttpServer http;
+    bool http_running = false;
+    if (http_opts.port >= 0) {
+        if (http_server_start(&http, &bank, &http_opts) != 0) {
+            server_destroy(&server);
+            question_bank_free(&bank);
+            return EXIT_FAILURE;
+        }
+        http_running = true;
+        upgrade_extra[0] = http.listen_fd;
+        upgrade_extra_count = 1;
+    }
+    if (upgrade_fd >= 0) {
+        server_take_over(&server, upgrade_fd);
+        close(upgrade_fd);
+    }
+    running_server = &server;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+    if (handoff_host != NULL) {
+        signal(SIGUSR1, handle_handoff);
+    }
+    if (upgrade_argv != NULL && upgrade_binary[0] != '\0') {
+        signal(SIGUSR2, handle_upgrade);
+    }
+
+    printf("trivia-server: %zu questions, listening on ws://%s:%d/\n",
+           bank.count, opts.host, server.port);
+    if (server.handoff_fd >= 0) {
+        printf("trivia-server: taking handoffs on port %d\n", server.handoff_port);
+    }
+    if (http_running) {
+        printf("trivia-server: admin API on http://%s:%d/\n", http_opts.host, http.port);
+    }
+    fflush(stdout);
+    int result = server_run(&server);
+    if (http_running) {
+        http_server_stop(&http);
+        http_publish_metrics(&http);
+        printf("\nAdmin API: %llu requests (%llu errors), %llu body bytes from the bank, "
+               "%llu formatted\n",
+               (unsigned long long)http.stats.requests, (unsigned long long)http.stats.errors,
+               (unsigned long long)http.stats.bank_bytes,
+               (unsigned long long)http.stats.copied_bytes);
+    }
+
+    server_publish_metrics(&server);
+    printf("\nAccepted %llu, rejected %llu, %llu messages in, %llu frames out "
+           "(%llu broadcasts), %llu/%llu games finished\n",
+           (unsigned long long)server.stats.accepted, (unsigned long long)server.stats.rejected,
+           (unsigned long long)server.stats.messages_in, (unsigned long long)server.stats.frames_out,
+           (unsigned long long)server.stats.broadcasts,
+           (unsigned long long)server.stats.games_finished,
+           (unsigned long long)server.stats.games_started);
+    if (server.stats.rooms_out > 0 || server.stats.rooms_in > 0) {
+        printf("Handoff: %llu rooms out, %llu rooms in, %llu seats resumed, %llu expired\n",
+               (unsigned long long)server.stats.rooms_out, (unsigned long long)server.stats.rooms_in,
+               (unsigned long long)server.stats.resumed,
+               (unsigned long long)server.stats.resume_expired);
+    }
+    if (server.stats.upgrades > 0) {
+        printf("Upgraded: listeners and rooms passed to the new process\n");
+    }
+    printf("Connection memory: %zu bytes for %d open connections\n",
+           server_connection_bytes(&server), server.conn_count);
+    metrics_dump(stdout);
+
+    server_destroy(&server);
+    question_bank_free(&bank);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
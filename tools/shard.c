@@ -0,0 +1,257 @@
+/**
+ * @file shard.c
+ * @brief trivia-shard: serve one shard of the bank, route draws, or draw
+ *
+ *   trivia-shard serve --bank data/questions.json --map category:3 --shard 0 --port 9001
+ *   trivia-shard router --shards 127.0.0.1:9001,127.0.0.1:9002,127.0.0.1:9003 --port 9000
+ *   trivia-shard draw --port 9000 --count 5 --category science
+ *
+ * Every shard process reads the pack but loads only its own questions.
+ * The router learns the map from the shards and speaks the same protocol
+ * to its clients; see shard.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include "questions.h"
+#include "shard.h"
+#include "utils.h"
+
+#define DEFAULT_QUESTIONS_FILE "data/questions.json"
+
+static ShardServer *running_server = NULL;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    shard_server_stop(running_server);
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s serve|router|draw [options]\n", prog);
+    printf("  serve:  --bank FILE --map SPEC --shard N [--host ADDR] [--port N]\n");
+    printf("          SPEC is category:N (category modulo N) or id:B1,B2,... (ID ranges)\n");
+    printf("  router: --shards HOST:PORT,... [--host ADDR] [--port N]\n");
+    printf("  draw:   [--host ADDR] [--port N] [--count N] [--difficulty LEVEL]\n");
+    printf("          [--category NAME] [--draws N] [--rounds N]\n");
+}
+
+/**
+ * @brief Options of every mode
+ */
+typedef struct {
+    const char *bank_file;
+    const char *map_spec;
+    int shard;
+    char *shards;
+    const char *host;
+    int port;
+    int count;
+    int difficulty;
+    int category;
+    int draws;
+    int rounds;
+} ShardToolOptions;
+
+static int parse_args(int argc, char *argv[], ShardToolOptions *opts) {
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        int ival = 0;
+        if (val == NULL) {
+            print_error("Missing value for %s", arg);
+            return -1;
+        }
+        i++;
+
+        if (strcmp(arg, "--bank") == 0) {
+            opts->bank_file = val;
+        } else if (strcmp(arg, "--map") == 0) {
+            opts->map_spec = val;
+        } else if (strcmp(arg, "--shard") == 0 && is_valid_integer(val, &ival) && ival >= 0) {
+            opts->shard = ival;
+        } else if (strcmp(arg, "--shards") == 0) {
+            opts->shards = argv[i];
+        } else if (strcmp(arg, "--host") == 0) {
+            opts->host = val;
+        } else if (strcmp(arg, "--port") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 0 && ival <= 65535) {
+            opts->port = ival;
+        } else if (strcmp(arg, "--count") == 0 && is_valid_integer(val, &ival) &&
+                   ival >= 1 && ival <= SHARD_MAX_DRAW) {
+            opts->count = ival;
+        } else if (strcmp(arg, "--difficulty") == 0 && difficulty_from_name(val) >= 0) {
+            opts->difficulty = difficulty_from_name(val);
+        } else if (strcmp(arg, "--category") == 0 && category_from_name(val) >= 0) {
+            opts->category = category_from_name(val);
+        } else if (strcmp(arg, "--draws") == 0 && is_valid_integer(val, &ival) && ival >= 1) {
+            opts->draws = ival;
+        } else if (strcmp(arg, "--rounds") == 0 && is_valid_integer(val, &ival) && ival >= 1) {
+            opts->rounds = ival;
+        } else {
+            print_error("Invalid option or value: %s %s", arg, val);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Serve until SIGINT or SIGTERM, then print the totals
+ */
+static int serve(ShardServer *server, const char *what) {
+    running_server = server;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+    printf("trivia-shard: %s, listening on port %d\n", what, server->port);
+    fflush(stdout);
+    int result = shard_server_run(server);
+    printf("\n%llu connections, %llu requests, %llu draws, %llu questions in %llu rounds\n",
+           (unsigned long long)server->stats.accepted, (unsigned long long)server->stats.requests,
+           (unsigned long long)server->stats.draws, (unsigned long long)server->stats.questions,
+           (unsigned long long)server->stats.batches);
+    return result;
+}
+
+static int run_serve(const ShardToolOptions *opts) {
+    ShardMap map;
+    if (opts->map_spec == NULL || shard_map_parse(&map, opts->map_spec) != 0 ||
+        opts->shard >= map.count) {
+        print_error("serve needs a valid --map and a --shard below its shard count");
+        return -1;
+    }
+    QuestionBank bank;
+    if (question_bank_init(&bank) != 0) {
+        return -1;
+    }
+    size_t loaded = 0;
+    long kept = shard_bank_load(&bank, opts->bank_file, &map, opts->shard, &loaded);
+    if (kept > 0) {
+        kept = question_bank_prepare(&bank, NULL);
+    }
+    if (kept < 0 || loaded == 0) {
+        print_error("No questions loaded from %s", opts->bank_file);
+        question_bank_free(&bank);
+        return -1;
+    }
+    ShardStore store;
+    ShardServer server;
+    if (shard_store_init(&store, &bank, &map, opts->shard) != 0) {
+        question_bank_free(&bank);
+        return -1;
+    }
+    if (shard_server_init(&server, opts->host, opts->port, &store, NULL) != 0) {
+        shard_store_free(&store);
+        question_bank_free(&bank);
+        return -1;
+    }
+    char what[SHARD_MAX_SPEC + 96];
+    snprintf(what, sizeof(what), "shard %d of %s holds %ld of %zu questions",
+             opts->shard, map.spec, kept, loaded);
+    int result = serve(&server, what);
+    shard_server_destroy(&server);
+    shard_store_free(&store);
+    question_bank_free(&bank);
+    return result;
+}
+
+static int run_router(const ShardToolOptions *opts) {
+    const char *addrs[SHARD_MAX];
+    int n = 0;
+    for (char *addr = opts->shards != NULL ? strtok(opts->shards, ",") : NULL;
+         addr != NULL && n < SHARD_MAX; addr = strtok(NULL, ",")) {
+        addrs[n++] = addr;
+    }
+    ShardRouter router;
+    if (n == 0 || shard_router_connect(&router, addrs, n) != 0) {
+        print_error("router needs --shards HOST:PORT,... for every shard of one map");
+        return -1;
+    }
+    ShardServer server;
+    if (shard_server_init(&server, opts->host, opts->port, NULL, &router) != 0) {
+        shard_router_close(&router);
+        return -1;
+    }
+    char what[SHARD_MAX_SPEC + 64];
+    snprintf(what, sizeof(what), "routing %s across %d shards", router.map.spec, n);
+    int result = serve(&server, what);
+    printf("%llu draws forwarded in %llu rounds, %llu shard messages\n",
+           (unsigned long long)router.draws, (unsigned long long)router.rounds,
+           (unsigned long long)router.messages);
+    shard_server_destroy(&server);
+    shard_router_close(&router);
+    return result;
+}
+
+static int run_draw(const ShardToolOptions *opts) {
+    int fd = shard_connect(opts->host, opts->port);
+    if (fd < 0) {
+        return -1;
+    }
+    ShardDraw *draws = (ShardDraw*)calloc((size_t)opts->draws, sizeof(ShardDraw));
+    ShardReply reply;
+    shard_reply_init(&reply);
+    int result = draws != NULL ? 0 : -1;
+    uint32_t seed = (uint32_t)getpid() * 2654435761u | 1u;
+    double t0 = monotonic_ms();
+    for (int r = 0; r < opts->rounds && result == 0; r++) {
+        for (int i = 0; i < opts->draws; i++) {
+            draws[i].difficulty = (int8_t)opts->difficulty;
+            draws[i].category = (int8_t)opts->category;
+            draws[i].count = (uint16_t)opts->count;
+            seed = seed * 1664525u + 1013904223u;
+            draws[i].seed = seed | 1u;
+        }
+        shard_reply_clear(&reply);
+        result = shard_call_draw(fd, draws, (size_t)opts->draws, &reply);
+    }
+    double elapsed = monotonic_ms() - t0;
+    if (result == 0) {
+        size_t count = 0;
+        const Question *q = shard_reply_draw(&reply, 0, &count);
+        for (size_t i = 0; i < count; i++) {
+            printf("%6u  %-13s %-6s  %s\n", q[i].id, category_to_string(q[i].category),
+                   difficulty_to_string(q[i].difficulty), q[i].question);
+        }
+        printf("%d rounds of %d draws in %.2f ms (%.3f ms per round)\n", opts->rounds,
+               opts->draws, elapsed, elapsed / opts->rounds);
+    } else {
+        print_error("Draw failed");
+    }
+    shard_reply_free(&reply);
+    free(draws);
+    close(fd);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        print_usage(argv[0]);
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    ShardToolOptions opts = {
+        .bank_file = DEFAULT_QUESTIONS_FILE, .map_spec = NULL, .shard = 0, .shards = NULL,
+        .host = "127.0.0.1", .port = 9000, .count = 5, .difficulty = -1, .category = -1,
+        .draws = 1, .rounds = 1
+    };
+    if (parse_args(argc, argv, &opts) != 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int result;
+    if (strcmp(argv[1], "serve") == 0) {
+        result = run_serve(&opts);
+    } else if (strcmp(argv[1], "router") == 0) {
+        result = run_router(&opts);
+    } else if (strcmp(argv[1], "draw") == 0) {
+        result = run_draw(&opts);
+    } else {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1066 @@
+/**
+ * @file validate.c
+ * @brief trivia-validate: check question packs before they ship
+ *
+ * Reports every problem the loader would silently skip or mangle, as
+ * `file:line:column: error: message`, and exits non-zero on errors:
+ * - malformed JSON, unknown or mistyped fields, missing required fields
+ * - `correct` outside the actual option count, too few or too many options
+ * - empty, duplicate or over-long question and option text
+ * - invalid UTF-8, control characters and unsupported escapes
+ * - duplicate question IDs
+ *
+ * Each file is mapped and split at line boundaries into one chunk per
+ * thread. A first parallel pass measures the brace depth change of every
+ * chunk, so that in the second pass each thread knows where the objects
+ * starting in its chunk begin and validates them independently.
+ *
+ *   trivia-validate --threads 8 packs/general.json packs/science.json
+ *   trivia-validate --variants data/questions.es.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "questions.h"
+#include "utf8.h"
+#include "utils.h"
+
+/** Files smaller than this are validated by a single thread. */
+#define MIN_CHUNK_BYTES (1024 * 1024)
+
+/** Maximum nesting accepted inside one question object. */
+#define MAX_VALUE_DEPTH 32
+
+#define MAX_THREADS 64
+
+typedef enum {
+    SEVERITY_ERROR = 0,
+    SEVERITY_WARNING
+} Severity;
+
+/**
+ * @brief One problem found in a pack
+ */
+typedef struct {
+    size_t offset;                 /**< Byte offset in the file */
+    Severity severity;             /**< Error or warning */
+    char message[120];             /**< Description */
+} Finding;
+
+/**
+ * @brief Question ID and where it was defined
+ */
+typedef struct {
+    uint32_t id;
+    size_t offset;
+} IdRef;
+
+/**
+ * @brief Work and results of one thread over one part of a file
+ */
+typedef struct {
+    const char *data;              /**< Whole file */
+    size_t len;                    /**< File length */
+    size_t begin;                  /**< First byte of the chunk */
+    size_t end;                    /**< One past the last byte of the chunk */
+    bool variants;                 /**< Validate as a locale pack */
+    long depth_delta;              /**< Brace depth change over the chunk (pass 1) */
+    long depth_min;                /**< Lowest running depth relative to begin (pass 1) */
+    long start_depth;              /**< Brace depth at begin (pass 2) */
+    Finding *findings;
+    size_t finding_count;
+    size_t finding_cap;
+    IdRef *ids;
+    size_t id_count;
+    size_t id_cap;
+    size_t objects;                /**< Question objects starting in the chunk */
+    bool out_of_memory;
+} Chunk;
+
+/**
+ * @brief Cursor over one question object
+ */
+typedef struct {
+    Chunk *chunk;
+    const char *data;
+    size_t pos;
+    size_t end;                    /**< End of the file */
+} Parser;
+
+/**
+ * @brief Raw string token (escapes are not decoded, like the loader)
+ */
+typedef struct {
+    size_t offset;                 /**< Offset of the opening quote */
+    const char *text;              /**< First byte after the opening quote */
+    size_t len;                    /**< Raw length in bytes */
+} StringToken;
+
+static void add_finding(Chunk *chunk, size_t offset, Severity severity, const char *fmt, ...) {
+    if (chunk->finding_count == chunk->finding_cap) {
+        size_t cap = chunk->finding_cap > 0 ? chunk->finding_cap * 2 : 16;
+        Finding *items = (Finding*)realloc(chunk->findings, cap * sizeof(Finding));
+        if (items == NULL) {
+            chunk->out_of_memory = true;
+            return;
+        }
+        chunk->findings = items;
+        chunk->finding_cap = cap;
+    }
+    Finding *f = &chunk->findings[chunk->finding_count++];
+    f->offset = offset;
+    f->severity = severity;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(f->message, sizeof(f->message), fmt, args);
+    va_end(args);
+}
+
+static void add_id(Chunk *chunk, uint32_t id, size_t offset) {
+    if (chunk->id_count == chunk->id_cap) {
+        size_t cap = chunk->id_cap > 0 ? chunk->id_cap * 2 : 1024;
+        IdRef *ids = (IdRef*)realloc(chunk->ids, cap * sizeof(IdRef));
+        if (ids == NULL) {
+            chunk->out_of_memory = true;
+            return;
+        }
+        chunk->ids = ids;
+        chunk->id_cap = cap;
+    }
+    chunk->ids[chunk->id_count].id = id;
+    chunk->ids[chunk->id_count].offset = offset;
+    chunk->id_count++;
+}
+
+/* ----------------------------------------------------------------------
+ * Lexical scan shared by both passes. Its own rules, not the loader's
+ * (question_scan_objects()): only braces count towards depth, as in the
+ * loader, but a raw newline always ends a string (valid JSON strings
+ * cannot contain one), which makes line starts safe split points. A pack
+ * that splits a string across lines is reported, where the loader would
+ * read on to the next quote.
+ * -------------------------------------------------------------------- */
+
+/**
+ * @brief Brace depth and string state of a scan
+ */
+typedef struct {
+    long depth;                    /**< Current brace depth */
+    long min;                      /**< Lowest depth reached */
+    bool in_string;                /**< Inside a string literal */
+} LexState;
+
+/**
+ * @brief Whether a byte can change lexical state
+ */
+static bool is_structural(char c) {
+    return c == '"' || c == '\\' || c == '{' || c == '}' || c == '\n';
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Bit per byte of data[0..15] that can change lexical state
+ */
+static unsigned int structural_mask(const char *data) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)data);
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                               _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')),
+                                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    return (unsigned int)_mm_movemask_epi8(hit);
+}
+#endif
+
+/**
+ * @brief Index of the next byte in [i, end) that can change lexical state
+ */
+static size_t next_structural(const char *data, size_t i, size_t end) {
+#if defined(__SSE2__)
+    for (; i + 16 <= end; i += 16) {
+        unsigned int mask = structural_mask(data + i);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < end && !is_structural(data[i])) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @brief Apply one structural byte to the scan state
+ *
+ * @return int 1 if the next byte is escaped, 2 if depth returned to 0
+ *         and the caller asked to stop there, else 0
+ */
+static int lex_step(const char *data, size_t i, size_t end, LexState *st, bool stop_at_zero) {
+    char c = data[i];
+    if (st->in_string) {
+        if (c == '\n' || c == '"') {
+            st->in_string = false;
+        } else if (c == '\\' && i + 1 < end && data[i + 1] != '\n') {
+            return 1;
+        }
+    } else if (c == '"') {
+        st->in_string = true;
+    } else if (c == '{') {
+        st->depth++;
+    } else if (c == '}') {
+        st->depth--;
+        if (st->depth < st->min) {
+            st->min = st->depth;
+        }
+        if (stop_at_zero && st->depth == 0) {
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Offset just past the string whose body starts at @p i
+ */
+static size_t skip_string(const char *data, size_t i, size_t end) {
+    while ((i = next_structural(data, i, end)) < end) {
+        char c = data[i];
+        if (c == '"' || c == '\n') {
+            return i + 1;
+        }
+        i += (c == '\\' && i + 1 < end && data[i + 1] != '\n') ? 2 : 1;
+    }
+    return end;
+}
+
+/**
+ * @brief Scan [i, end) updating @p st
+ *
+ * With SSE2 each 16-byte block is classified once and its structural
+ * bytes are visited bit by bit; JSON has one every few bytes.
+ *
+ * @param stop_at_zero Return right after a '}' that brings depth to 0
+ * @return size_t Where the scan stopped
+ */
+static size_t lex_scan(const char *data, size_t i, size_t end, LexState *st, bool stop_at_zero) {
+#if defined(__SSE2__)
+    while (i + 16 <= end) {
+        unsigned int mask = structural_mask(data + i);
+        size_t next = i + 16;
+        while (mask != 0) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            mask &= mask - 1;
+            int action = lex_step(data, pos, end, st, stop_at_zero);
+            if (action == 2) {
+                return pos + 1;
+            }
+            if (action == 1) {
+                /* Skip the escaped byte and reload from after it. */
+                next = pos + 2;
+                break;
+            }
+        }
+        i = next;
+    }
+#endif
+    while (i < end) {
+        if (is_structural(data[i])) {
+            int action = lex_step(data, i, end, st, stop_at_zero);
+            if (action == 2) {
+                return i + 1;
+            }
+            if (action == 1) {
+                i++;
+            }
+        }
+        i++;
+    }
+    return i < end ? i : end;
+}
+
+static void* depth_worker(void *arg) {
+    Chunk *chunk = (Chunk*)arg;
+    LexState st = { 0, 0, false };
+    lex_scan(chunk->data, chunk->begin, chunk->end, &st, false);
+    chunk->depth_delta = st.depth;
+    chunk->depth_min = st.min;
+    return NULL;
+}
+
+/* ----------------------------------------------------------------------
+ * Object parser
+ * -------------------------------------------------------------------- */
+
+static void skip_ws(Parser *p) {
+    while (p->pos < p->end) {
+        char c = p->data[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        p->pos++;
+    }
+}
+
+static bool expect_char(Parser *p, char expected, const char *what) {
+    skip_ws(p);
+    if (p->pos < p->end && p->data[p->pos] == expected) {
+        p->pos++;
+        return true;
+    }
+    add_finding(p->chunk, p->pos, SEVERITY_ERROR, "expected %s", what);
+    return false;
+}
+
+/**
+ * @brief Index of the next quote, backslash or control byte in [i, end)
+ */
+static size_t next_string_special(const char *data, size_t i, size_t end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= end; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, control_max), v);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                _mm_cmpeq_epi8(v, backslash)), control);
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+#endif
+    while (i < end) {
+        unsigned char c = (unsigned char)data[i];
+        if (c == '"' || c == '\\' || c < 0x20) {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+static bool hex_digit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/**
+ * @brief Parse a string at the cursor, checking escapes and encoding
+ *
+ * Content problems are reported but do not stop parsing; only a missing
+ * or unterminated string returns false.
+ */
+static bool parse_string(Parser *p, StringToken *token) {
+    skip_ws(p);
+    if (p->pos >= p->end || p->data[p->pos] != '"') {
+        add_finding(p->chunk, p->pos, SEVERITY_ERROR, "expected string");
+        return false;
+    }
+    token->offset = p->pos;
+    size_t i = ++p->pos;
+    token->text = p->data + i;
+
+    while ((i = next_string_special(p->data, i, p->end)) < p->end && p->data[i] != '"') {
+        unsigned char c = (unsigned char)p->data[i];
+        if (c == '\n') {
+            break;
+        }
+        if (c < 0x20) {
+            add_finding(p->chunk, i, SEVERITY_ERROR, "control character 0x%02x in string", c);
+            i++;
+        } else if (c == '\\') {
+            char e = i + 1 < p->end ? p->data[i + 1] : '\0';
+            if (e == '"') {
+                add_finding(p->chunk, i, SEVERITY_ERROR,
+                            "escaped quote is not supported by the loader");
+            } else if (e == 'u') {
+                for (int k = 2; k < 6; k++) {
+                    if (i + (size_t)k >= p->end || !hex_digit(p->data[i + k])) {
+                        add_finding(p->chunk, i, SEVERITY_ERROR, "invalid \\u escape");
+                        break;
+                    }
+                }
+            } else if (strchr("\\/bfnrt", e) == NULL || e == '\0') {
+                add_finding(p->chunk, i, SEVERITY_ERROR, "invalid escape sequence");
+            }
+            i += e == '\n' ? 1 : 2;
+        } else {
+            i++;
+        }
+    }
+    if (i >= p->end || p->data[i] != '"') {
+        add_finding(p->chunk, token->offset, SEVERITY_ERROR, "unterminated string");
+        p->pos = i;
+        return false;
+    }
+
+    token->len = (size_t)(p->data + i - token->text);
+    p->pos = i + 1;
+    if (!utf8_validate(token->text, token->len)) {
+        add_finding(p->chunk, token->offset, SEVERITY_ERROR, "invalid UTF-8 in string");
+    }
+    return true;
+}
+
+/**
+ * @brief Parse an integer; reports non-integers
+ */
+static bool parse_integer(Parser *p, long *value, const char *field) {
+    skip_ws(p);
+    size_t start = p->pos;
+    bool negative = false;
+    if (p->pos < p->end && p->data[p->pos] == '-') {
+        negative = true;
+        p->pos++;
+    }
+    long v = 0;
+    size_t digits = 0;
+    while (p->pos < p->end && p->data[p->pos] >= '0' && p->data[p->pos] <= '9') {
+        if (v < 100000000000L) {
+            v = v * 10 + (p->data[p->pos] - '0');
+        }
+        p->pos++;
+        digits++;
+    }
+    if (digits == 0 || (p->pos < p->end && strchr(".eE", p->data[p->pos]) != NULL &&
+                        p->data[p->pos] != '\0')) {
+        add_finding(p->chunk, start, SEVERITY_ERROR, "\"%s\" must be an integer", field);
+        return false;
+    }
+    *value = negative ? -v : v;
+    return true;
+}
+
+static bool skip_value(Parser *p, int depth);
+
+static bool skip_container(Parser *p, char close, int depth) {
+    p->pos++;
+    skip_ws(p);
+    if (p->pos < p->end && p->data[p->pos] == close) {
+        p->pos++;
+        return true;
+    }
+    for (;;) {
+        if (close == '}') {
+            StringToken key;
+            if (!parse_string(p, &key) || !expect_char(p, ':', "':'")) {
+                return false;
+            }
+        }
+        if (!skip_value(p, depth + 1)) {
+            return false;
+        }
+        skip_ws(p);
+        if (p->pos < p->end && p->data[p->pos] == ',') {
+            p->pos++;
+            continue;
+        }
+        return expect_char(p, close, close == '}' ? "',' or '}'" : "',' or ']'");
+    }
+}
+
+static bool skip_value(Parser *p, int depth) {
+    skip_ws(p);
+    if (depth > MAX_VALUE_DEPTH) {
+        add_finding(p->chunk, p->pos, SEVERITY_ERROR, "nesting too deep");
+        return false;
+    }
+    if (p->pos >= p->end) {
+        add_finding(p->chunk, p->pos, SEVERITY_ERROR, "expected value");
+        return false;
+    }
+    char c = p->data[p->pos];
+    if (c == '"') {
+        StringToken token;
+        return parse_string(p, &token);
+    }
+    if (c == '{' || c == '[') {
+        return skip_container(p, c == '{' ? '}' : ']', depth);
+    }
+    static const char *const literals[] = { "true", "false", "null" };
+    for (size_t i = 0; i < 3; i++) {
+        size_t n = strlen(literals[i]);
+        if (p->end - p->pos >= n && memcmp(p->data + p->pos, literals[i], n) == 0) {
+            p->pos += n;
+            return true;
+        }
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        p->pos++;
+        while (p->pos < p->end && strchr("0123456789.eE+-", p->data[p->pos]) != NULL &&
+               p->data[p->pos] != '\0') {
+            p->pos++;
+        }
+        return true;
+    }
+    add_finding(p->chunk, p->pos, SEVERITY_ERROR, "expected value");
+    return false;
+}
+
+static bool key_is(const StringToken *key, const char *name) {
+    return key->len == strlen(name) && memcmp(key->text, name, key->len) == 0;
+}
+
+/**
+ * @brief Validate the question object whose '{' is at @p start
+ *
+ * A well-formed object ends exactly where the lexical scan would end it,
+ * so the parser finds the extent itself instead of scanning twice.
+ *
+ * @return size_t Offset after the closing brace, or 0 after a syntax error
+ */
+static size_t validate_object(Chunk *chunk, size_t start) {
+    Parser parser = { chunk, chunk->data, start + 1, chunk->len };
+    Parser *p = &parser;
+
+    bool has_question = false;
+    bool has_options = false;
+    bool has_correct = false;
+    bool has_difficulty = false;
+    long correct = -1;
+    size_t correct_offset = start;
+    int option_count = 0;
+    StringToken options[MAX_OPTIONS];
+
+    skip_ws(p);
+    bool ok = true;
+    if (p->pos < p->end && p->data[p->pos] == '}') {
+        p->pos++;
+    } else {
+        for (;;) {
+            StringToken key;
+            if (!parse_string(p, &key) || !expect_char(p, ':', "':'")) {
+                ok = false;
+                break;
+            }
+            skip_ws(p);
+            size_t value_offset = p->pos;
+
+            if (key_is(&key, "question")) {
+                StringToken text;
+                has_question = true;
+                if (!parse_string(p, &text)) {
+                    ok = false;
+                    break;
+                }
+                if (text.len == 0) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR, "question text is empty");
+                } else if (text.len >= MAX_QUESTION_LEN) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR,
+                                "question is %zu bytes; the loader truncates at %d",
+                                text.len, MAX_QUESTION_LEN - 1);
+                }
+            } else if (key_is(&key, "options")) {
+                has_options = true;
+                if (!expect_char(p, '[', "options array")) {
+                    ok = false;
+                    break;
+                }
+                skip_ws(p);
+                if (p->pos < p->end && p->data[p->pos] == ']') {
+                    p->pos++;
+                } else {
+                    int total = 0;
+                    for (;;) {
+                        StringToken option;
+                        skip_ws(p);
+                        size_t option_offset = p->pos;
+                        if (!parse_string(p, &option)) {
+                            ok = false;
+                            break;
+                        }
+                        if (option.len == 0) {
+                            add_finding(chunk, option_offset, SEVERITY_ERROR, "option %d is empty",
+                                        total + 1);
+                        } else if (option.len >= MAX_ANSWER_LEN) {
+                            add_finding(chunk, option_offset, SEVERITY_ERROR,
+                                        "option %d is %zu bytes; the loader truncates at %d",
+                                        total + 1, option.len, MAX_ANSWER_LEN - 1);
+                        }
+                        for (int k = 0; k < option_count; k++) {
+                            if (options[k].len == option.len &&
+                                memcmp(options[k].text, option.text, option.len) == 0) {
+                                add_finding(chunk, option_offset, SEVERITY_ERROR,
+                                            "option %d duplicates option %d", total + 1, k + 1);
+                                break;
+                            }
+                        }
+                        if (option_count < MAX_OPTIONS) {
+                            options[option_count++] = option;
+                        }
+                        total++;
+                        skip_ws(p);
+                        if (p->pos < p->end && p->data[p->pos] == ',') {
+                            p->pos++;
+                            continue;
+                        }
+                        if (!expect_char(p, ']', "',' or ']'")) {
+                            ok = false;
+                        }
+                        break;
+                    }
+                    if (!ok) {
+                        break;
+                    }
+                    if (total > MAX_OPTIONS) {
+                        add_finding(chunk, value_offset, SEVERITY_ERROR,
+                                    "%d options; the loader keeps only the first %d",
+                                    total, MAX_OPTIONS);
+                    }
+                }
+                if (option_count < 2) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR,
+                                "at least 2 options are required");
+                }
+            } else if (key_is(&key, "correct")) {
+                has_correct = true;
+                correct_offset = value_offset;
+                if (!parse_integer(p, &correct, "correct")) {
+                    ok = false;
+                    break;
+                }
+            } else if (key_is(&key, "difficulty")) {
+                StringToken level;
+                has_difficulty = true;
+                if (!parse_string(p, &level)) {
+                    ok = false;
+                    break;
+                }
+                if (!key_is(&level, "easy") && !key_is(&level, "medium") && !key_is(&level, "hard")) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR,
+                                "difficulty must be \"easy\", \"medium\" or \"hard\"");
+                }
+            } else if (key_is(&key, "id")) {
+                long id = 0;
+                if (!parse_integer(p, &id, "id")) {
+                    ok = false;
+                    break;
+                }
+                if (id <= 0 || id > (long)UINT32_MAX) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR,
+                                "id must be between 1 and %u", UINT32_MAX);
+                } else {
+                    add_id(chunk, (uint32_t)id, value_offset);
+                }
+            } else if (key_is(&key, "category")) {
+                StringToken name;
+                if (!parse_string(p, &name)) {
+                    ok = false;
+                    break;
+                }
+                if (!key_is(&name, "general") && !key_is(&name, "science") &&
+                    !key_is(&name, "history") && !key_is(&name, "sports") &&
+                    !key_is(&name, "entertainment")) {
+                    add_finding(chunk, value_offset, SEVERITY_ERROR, "unknown category");
+                }
+            } else {
+                add_finding(chunk, key.offset, SEVERITY_WARNING, "unknown field \"%.*s\"",
+                            (int)(key.len < 40 ? key.len : 40), key.text);
+                if (!skip_value(p, 1)) {
+                    ok = false;
+                    break;
+                }
+            }
+
+            skip_ws(p);
+            if (p->pos < p->end && p->data[p->pos] == ',') {
+                p->pos++;
+                continue;
+            }
+            if (p->pos < p->end && p->data[p->pos] == '}') {
+                p->pos++;
+            } else {
+                add_finding(chunk, p->pos, SEVERITY_ERROR, "expected ',' or '}'");
+                ok = false;
+            }
+            break;
+        }
+    }
+    if (!ok) {
+        /* Field checks below would only repeat the syntax error. */
+        return 0;
+    }
+    size_t end = p->pos;
+
+    if (!has_question) {
+        add_finding(chunk, start, SEVERITY_ERROR, "missing \"question\"");
+    }
+    if (!has_options) {
+        add_finding(chunk, start, SEVERITY_ERROR, "missing \"options\"");
+    }
+    if (chunk->variants) {
+        return end;
+    }
+    if (!has_correct) {
+        add_finding(chunk, start, SEVERITY_ERROR, "missing \"correct\"");
+    } else if (has_options && (correct < 0 || correct >= option_count)) {
+        add_finding(chunk, correct_offset, SEVERITY_ERROR,
+                    "correct is %ld but there are %d options", correct, option_count);
+    }
+    if (!has_difficulty) {
+        add_finding(chunk, start, SEVERITY_WARNING, "missing \"difficulty\"; defaults to easy");
+    }
+    return end;
+}
+
+/**
+ * @brief Pass 2: validate every object that starts inside the chunk
+ *
+ * Tracks depth exactly like pass 1 (a stray '}' at depth 0 is reported
+ * and ignored), so the start depths computed from pass 1 line up.
+ */
+static void* validate_worker(void *arg) {
+    Chunk *chunk = (Chunk*)arg;
+    const char *data = chunk->data;
+    size_t i = chunk->begin;
+    size_t junk_line_end = 0;
+
+    if (chunk->start_depth > 0) {
+        /* Skip the tail of an object that started in an earlier chunk. */
+        LexState st = { chunk->start_depth, 0, false };
+        i = lex_scan(data, i, chunk->end, &st, true);
+    }
+
+    while (i < chunk->end) {
+        char c = data[i];
+        if (c == '{') {
+            chunk->objects++;
+            size_t end = validate_object(chunk, i);
+            if (end == 0) {
+                LexState st = { 0, 0, false };
+                end = lex_scan(data, i, chunk->len, &st, true);
+                if (st.depth != 0) {
+                    add_finding(chunk, i, SEVERITY_ERROR, "unterminated object");
+                    break;
+                }
+            }
+            if (end - i >= MAX_OBJECT_LEN) {
+                add_finding(chunk, i, SEVERITY_ERROR,
+                            "object is %zu bytes; the loader skips objects over %d",
+                            end - i, MAX_OBJECT_LEN - 1);
+            }
+            i = end;
+            continue;
+        }
+
+        bool junk = false;
+        size_t next = i + 1;
+        if (c == '"') {
+            next = skip_string(data, i + 1, chunk->end);
+            junk = true;
+        } else if (c == '}') {
+            add_finding(chunk, i, SEVERITY_ERROR, "unmatched '}'");
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r' &&
+                   c != '[' && c != ']' && c != ',') {
+            junk = true;
+        }
+
+        /* One report per line is enough for junk between objects. */
+        if (junk && i >= junk_line_end) {
+            add_finding(chunk, i, SEVERITY_ERROR, "unexpected '%c' outside a question object",
+                        (c >= 0x20 && c < 0x7F) ? c : '?');
+            const char *nl = memchr(data + i, '\n', chunk->len - i);
+            junk_line_end = nl != NULL ? (size_t)(nl - data) : chunk->len;
+        }
+        i = next;
+    }
+    return NULL;
+}
+
+/* ----------------------------------------------------------------------
+ * Driver
+ * -------------------------------------------------------------------- */
+
+static int compare_findings(const void *a, const void *b) {
+    const Finding *fa = (const Finding*)a;
+    const Finding *fb = (const Finding*)b;
+    return fa->offset < fb->offset ? -1 : (fa->offset > fb->offset);
+}
+
+static int compare_ids(const void *a, const void *b) {
+    const IdRef *ia = (const IdRef*)a;
+    const IdRef *ib = (const IdRef*)b;
+    if (ia->id != ib->id) {
+        return ia->id < ib->id ? -1 : 1;
+    }
+    return ia->offset < ib->offset ? -1 : (ia->offset > ib->offset);
+}
+
+/**
+ * @brief Run a pass over all chunks, one thread per chunk
+ */
+static void run_pass(Chunk *chunks, int count, void *(*worker)(void*)) {
+    pthread_t tids[MAX_THREADS];
+    bool started[MAX_THREADS];
+    for (int t = 0; t < count; t++) {
+        started[t] = t > 0 && pthread_create(&tids[t], NULL, worker, &chunks[t]) == 0;
+        if (!started[t] && t > 0) {
+            worker(&chunks[t]);
+        }
+    }
+    worker(&chunks[0]);
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        }
+    }
+}
+
+/**
+ * @brief Totals across all validated files
+ */
+typedef struct {
+    size_t files;
+    size_t bytes;
+    size_t objects;
+    size_t errors;
+    size_t warnings;
+} Totals;
+
+/**
+ * @brief Print findings with line and column numbers
+ *
+ * Findings are sorted by offset, so one forward scan over the file
+ * resolves every position. Columns count code points, starting at 1.
+ */
+static void report_findings(const char *path, const char *data, Finding *findings,
+                            size_t count, bool quiet, Totals *totals) {
+    qsort(findings, count, sizeof(Finding), compare_findings);
+    size_t line = 1;
+    size_t line_start = 0;
+    size_t scanned = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Finding *f = &findings[i];
+        while (scanned < f->offset) {
+            const char *nl = memchr(data + scanned, '\n', f->offset - scanned);
+            if (nl == NULL) {
+                scanned = f->offset;
+                break;
+            }
+            line++;
+            scanned = (size_t)(nl - data) + 1;
+            line_start = scanned;
+        }
+        size_t column = 1;
+        for (size_t k = line_start; k < f->offset; k++) {
+            column += ((unsigned char)data[k] & 0xC0) != 0x80;
+        }
+        if (f->severity == SEVERITY_ERROR) {
+            totals->errors++;
+        } else {
+            totals->warnings++;
+        }
+        if (!quiet) {
+            printf("%s:%zu:%zu: %s: %s\n", path, line, column,
+                   f->severity == SEVERITY_ERROR ? "error" : "warning", f->message);
+        }
+    }
+}
+
+static int validate_file(const char *path, int threads, bool variants, bool quiet,
+                         Totals *totals) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        print_error("Failed to open %s", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        print_error("Failed to stat %s", path);
+        close(fd);
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+    const char *data = "";
+    void *map = NULL;
+    if (len > 0) {
+        map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            print_error("Failed to map %s", path);
+            close(fd);
+            return -1;
+        }
+        madvise(map, len, MADV_SEQUENTIAL);
+        data = (const char*)map;
+    }
+    close(fd);
+
+    int count = threads;
+    if ((size_t)count > len / MIN_CHUNK_BYTES) {
+        count = (int)(len / MIN_CHUNK_BYTES);
+    }
+    if (count < 1) {
+        count = 1;
+    }
+
+    Chunk chunks[MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    size_t begin = 0;
+    for (int t = 0; t < count; t++) {
+        size_t end = t == count - 1 ? len : len * (size_t)(t + 1) / (size_t)count;
+        if (end < begin) {
+            end = begin;
+        }
+        /* Move the split to the start of the next line. */
+        const char *nl = end < len ? memchr(data + end, '\n', len - end) : NULL;
+        end = t == count - 1 ? len : (nl != NULL ? (size_t)(nl - data) + 1 : len);
+        chunks[t].data = data;
+        chunks[t].len = len;
+        chunks[t].begin = begin;
+        chunks[t].end = end;
+        chunks[t].variants = variants;
+        begin = end;
+    }
+
+    run_pass(chunks, count, depth_worker);
+    /* A '}' at depth 0 is ignored, so the depth after a chunk that starts
+     * at depth s is max(s + delta, delta - min). */
+    long depth = 0;
+    for (int t = 0; t < count; t++) {
+        chunks[t].start_depth = depth;
+        long clamped = chunks[t].depth_delta - chunks[t].depth_min;
+        depth += chunks[t].depth_delta;
+        if (depth < clamped) {
+            depth = clamped;
+        }
+    }
+    run_pass(chunks, count, validate_worker);
+
+    /* Merge per-chunk results: findings, objects and IDs. */
+    Chunk merged;
+    memset(&merged, 0, sizeof(merged));
+    bool failed = false;
+    for (int t = 0; t < count; t++) {
+        failed |= chunks[t].out_of_memory;
+        merged.objects += chunks[t].objects;
+        for (size_t i = 0; i < chunks[t].finding_count; i++) {
+            const Finding *f = &chunks[t].findings[i];
+            add_finding(&merged, f->offset, f->severity, "%s", f->message);
+        }
+        for (size_t i = 0; i < chunks[t].id_count; i++) {
+            add_id(&merged, chunks[t].ids[i].id, chunks[t].ids[i].offset);
+        }
+        free(chunks[t].findings);
+        free(chunks[t].ids);
+    }
+
+    const char *first = data;
+    while (first < data + len && (*first == ' ' || *first == '\n' || *first == '\r' ||
+                                  *first == '\t')) {
+        first++;
+    }
+    if (first == data + len || (*first != '[' && *first != '{')) {
+        add_finding(&merged, (size_t)(first - data), SEVERITY_ERROR,
+                    "a pack must be a JSON array or JSON Lines of question objects");
+    } else if (merged.objects == 0) {
+        add_finding(&merged, (size_t)(first - data), SEVERITY_WARNING, "pack has no questions");
+    }
+
+    if (merged.id_count > 1) {
+        qsort(merged.ids, merged.id_count, sizeof(IdRef), compare_ids);
+        for (size_t i = 1; i < merged.id_count; i++) {
+            if (merged.ids[i].id == merged.ids[i - 1].id) {
+                add_finding(&merged, merged.ids[i].offset, SEVERITY_ERROR,
+                            "duplicate id %u", merged.ids[i].id);
+            }
+        }
+    }
+    failed |= merged.out_of_memory;
+
+    size_t errors_before = totals->errors;
+    report_findings(path, data, merged.findings, merged.finding_count, quiet, totals);
+    totals->files++;
+    totals->bytes += len;
+    totals->objects += merged.objects;
+
+    free(merged.findings);
+    free(merged.ids);
+    if (map != NULL) {
+        munmap(map, len);
+    }
+    if (failed) {
+        print_error("Out of memory while validating %s", path);
+        return -1;
+    }
+    return totals->errors > errors_before ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    bool variants = false;
+    bool quiet = false;
+    bool werror = false;
+    int first_file = argc;
+
+    for (int i = 1; i < argc; i++) {
+        int value = 0;
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc &&
+            is_valid_integer(argv[i + 1], &value) && value > 0) {
+            threads = value;
+            i++;
+        } else if (strcmp(argv[i], "--variants") == 0) {
+            variants = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--werror") == 0) {
+            werror = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--threads N] [--variants] [--werror] [--quiet] FILE...\n", argv[0]);
+            printf("  --variants  validate locale packs (no \"correct\" or \"difficulty\")\n");
+            printf("  --werror    treat warnings as errors\n");
+            printf("  --quiet     print only the summary\n");
+            return EXIT_SUCCESS;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            print_error("Unknown option: %s", argv[i]);
+            return 2;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+    if (first_file >= argc) {
+        print_error("No packs given (see --help)");
+        return 2;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    Totals totals;
+    memset(&totals, 0, sizeof(totals));
+    bool io_failed = false;
+    double t0 = monotonic_ms();
+    for (int i = first_file; i < argc; i++) {
+        if (validate_file(argv[i], threads, variants, quiet, &totals) < 0) {
+            io_failed = true;
+        }
+    }
+    double elapsed = monotonic_ms() - t0;
+
+    fprintf(stderr, "%zu file(s), %zu question(s): %zu error(s), %zu warning(s) "
+            "in %.1f ms (%.0f MB/s)\n",
+            totals.files, totals.objects, totals.errors, totals.warnings, elapsed,
+            elapsed > 0.0 ? (double)totals.bytes / 1e6 / (elapsed / 1e3) : 0.0);
+
+    if (io_failed) {
+        return 2;
+    }
+    if (totals.errors > 0 || (werror && totals.warnings > 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file wsclient.c
+ * @brief trivia-wsclient: bundled WebSocket client for trivia-server
+ *
+ *   trivia-wsclient --port 8080 --games 100
+ *   trivia-wsclient --port 8080 --connections 20000 --hold 60
+ *
+ * --games plays two-seat games to the end, answering each question as
+ * soon as it arrives, and reports the answer-to-result round trip. It
+ * follows redirects, so games carry on across a handoff or an upgrade
+ * (see server.h).
+ * --connections opens that many idle connections and holds them, to
+ * check how many a server process keeps and what they cost it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "utils.h"
+#include "websocket.h"
+
+#define MESSAGE_CAP 16384
+
+static int json_int(const char *message, const char *field) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", field);
+    const char *at = strstr(message, pattern);
+    return at != NULL ? atoi(at + strlen(pattern)) : -1;
+}
+
+/**
+ * @brief Copy a string field without escapes (hosts and session IDs)
+ */
+static int json_text(const char *message, const char *field, char *out, size_t cap) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", field);
+    const char *at = strstr(message, pattern);
+    const char *end = at != NULL ? strchr(at + strlen(pattern), '"') : NULL;
+    if (end == NULL || (size_t)(end - at) - strlen(pattern) >= cap) {
+        return -1;
+    }
+    at += strlen(pattern);
+    memcpy(out, at, (size_t)(end - at));
+    out[end - at] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Move to the node a redirect names and take the seat back there
+ *
+ * A redirect without a session comes from a server that is draining
+ * before it had seated us, so we join again instead.
+ *
+ * @param join JOIN command this client sent
+ */
+static int follow_redirect(WsClient *client, const char *message, const char *join) {
+    char host[64];
+    char command[96];
+    char session[64];
+    int port = json_int(message, "port");
+    if (json_text(message, "host", host, sizeof(host)) != 0 || port <= 0) {
+        return -1;
+    }
+    ws_client_close(client);
+    int n = json_text(message, "session", session, sizeof(session)) == 0
+            ? snprintf(command, sizeof(command), "RESUME %s", session)
+            : snprintf(command, sizeof(command), "%s", join);
+    return ws_client_connect(client, host, port) == 0 &&
+           ws_client_send_text(client, command, (size_t)n) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Receive the next message, following redirects on the way
+ *
+ * @return int Message length, -1 on close, error or a 10 s timeout
+ */
+static int recv_message(WsClient *client, char *out, const char *join) {
+    for (;;) {
+        int n = ws_client_recv(client, out, MESSAGE_CAP, 10000);
+        if (n <= 0) {
+            return -1;
+        }
+        if (strstr(out, "\"type\":\"redirect\"") == NULL) {
+            return n;
+        }
+        if (follow_redirect(client, out, join) != 0) {
+            return -1;
+        }
+    }
+}
+
+static int expect_message(WsClient *client, const char *type, char *out, const char *join) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"type\":\"%s\"", type);
+    for (;;) {
+        if (recv_message(client, out, join) < 0) {
+            return -1;
+        }
+        if (strstr(out, pattern) != NULL) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Play one two-seat game; both seats are driven from this thread
+ *
+ * @return int Rounds played, -1 on error
+ */
+static int play_game(const char *host, int port, unsigned room, double *rtt_ms, int *samples) {
+    WsClient seats[2] = { { .fd = -1 }, { .fd = -1 } };
+    char *message = (char*)malloc(MESSAGE_CAP);
+    int rounds = -1;
+    if (message == NULL || ws_client_connect(&seats[0], host, port) != 0 ||
+        ws_client_connect(&seats[1], host, port) != 0) {
+        goto done;
+    }
+    char command[64];
+    char join[32];
+    int join_len = snprintf(join, sizeof(join), "JOIN %u 2", room);
+    for (int s = 0; s < 2; s++) {
+        if (ws_client_send_text(&seats[s], join, (size_t)join_len) != 0) {
+            goto done;
+        }
+    }
+
+    /* The server seats players in the order their JOINs arrive. */
+    int seat_of[2] = { 0, 1 };
+    for (int s = 0; s < 2; s++) {
+        if (expect_message(&seats[s], "start", message, join) != 0) {
+            goto done;
+        }
+        int player = json_int(message, "player");
+        if (player < 0 || player > 1) {
+            goto done;
+        }
+        seat_of[player] = s;
+    }
+
+    rounds = 0;
+    for (;;) {
+        int turn = -1;
+        bool ended = false;
+        for (int s = 0; s < 2; s++) {
+            /* A question, or the end of the game. */
+            for (;;) {
+                if (recv_message(&seats[s], message, join) < 0) {
+                    rounds = -1;
+                    goto done;
+                }
+                if (strstr(message, "\"type\":\"question\"") != NULL) {
+                    turn = json_int(message, "player");
+                    break;
+                }
+                if (strstr(message, "\"type\":\"end\"") != NULL) {
+                    ended = true;
+                    break;
+                }
+            }
+        }
+        if (ended) {
+            break;
+        }
+        if (turn < 0 || turn > 1) {
+            rounds = -1;
+            goto done;
+        }
+        turn = seat_of[turn];
+        int n = snprintf(command, sizeof(command), "ANSWER %d", 1 + rounds % 4);
+        double t0 = monotonic_ms();
+        if (ws_client_send_text(&seats[turn], command, (size_t)n) != 0 ||
+            expect_message(&seats[turn], "result", message, join) != 0) {
+            rounds = -1;
+            goto done;
+        }
+        *rtt_ms += monotonic_ms() - t0;
+        (*samples)++;
+        if (expect_message(&seats[1 - turn], "result", message, join) != 0) {
+            rounds = -1;
+            goto done;
+        }
+        rounds++;
+    }
+
+done:
+    ws_client_close(&seats[0]);
+    ws_client_close(&seats[1]);
+    free(message);
+    return rounds;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--host ADDR] [--port N] [--games N] [--connections N --hold SEC]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = "127.0.0.1";
+    int port = 8080;
+    int games = 0;
+    int connections = 0;
+    int hold_s = 10;
+
+    for (int i = 1; i < argc; i++) {
+        int value = 0;
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--host") == 0 && val != NULL) {
+            host = val;
+        } else if (strcmp(argv[i], "--port") == 0 && val != NULL &&
+                   is_valid_integer(val, &value) && value > 0) {
+            port = value;
+        } else if (strcmp(argv[i], "--games") == 0 && val != NULL &&
+                   is_valid_integer(val, &value) && value >= 0) {
+            games = value;
+        } else if (strcmp(argv[i], "--connections") == 0 && val != NULL &&
+                   is_valid_integer(val, &value) && value >= 0) {
+            connections = value;
+        } else if (strcmp(argv[i], "--hold") == 0 && val != NULL &&
+                   is_valid_integer(val, &value) && value >= 0) {
+            hold_s = value;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+    if (games == 0 && connections == 0) {
+        games = 1;
+    }
+
+    if (games > 0) {
+        double rtt_ms = 0.0;
+        int samples = 0;
+        int played = 0;
+        double t0 = monotonic_ms();
+        for (int g = 0; g < games; g++) {
+            if (play_game(host, port, (unsigned)getpid() * 1000u + (unsigned)g + 1,
+                          &rtt_ms, &samples) < 0) {
+                print_error("Game %d failed", g + 1);
+                continue;
+            }
+            played++;
+        }
+        double elapsed = (monotonic_ms() - t0) / 1000.0;
+        printf("%d/%d games in %.2f s, %d answers, mean answer round trip %.3f ms\n",
+               played, games, elapsed, samples, samples > 0 ? rtt_ms / samples : 0.0);
+        if (played != games) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (connections > 0) {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+        WsClient *clients = (WsClient*)calloc((size_t)connections, sizeof(WsClient));
+        if (clients == NULL) {
+            print_error("Failed to allocate %d clients", connections);
+            return EXIT_FAILURE;
+        }
+        int open = 0;
+        double t0 = monotonic_ms();
+        while (open < connections && ws_client_connect(&clients[open], host, port) == 0) {
+            /* Idle clients never read again; drop the receive buffer. */
+            free(clients[open].buf);
+            clients[open].buf = NULL;
+            clients[open].cap = 0;
+            clients[open].len = 0;
+            open++;
+        }
+        printf("%d/%d connections open in %.2f s, holding for %d s\n",
+               open, connections, (monotonic_ms() - t0) / 1000.0, hold_s);
+        fflush(stdout);
+        sleep((unsigned)hold_s);
+        for (int i = 0; i < open; i++) {
+            ws_client_close(&clients[i]);
+        }
+        free(clients);
+        if (open != connections) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}